@@ -139,6 +139,8 @@ BatchHDRDialog::BatchHDRDialog(QWidget *p, QSqlDatabase db)
 
         ct.weightFunction = static_cast<WeightFunctionType>(weight_);
         ct.fusionOperator = static_cast<FusionOperator>(model_);
+        ct.responseSamples = 0;
+        ct.responseSeed = 0;
 
         switch (response_) {
             case 0:
@@ -28,24 +28,36 @@
  */
 
 #include <cassert>
-#include <climits>
 
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QPixmap>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
 
 #include <BatchTM/BatchTMDialog.h>
 #include <BatchTM/ui_BatchTMDialog.h>
 
-#include <BatchTM/BatchTMJob.h>
 #include <UI/SavedParametersDialog.h>
 #include <Common/config.h>
+#include <Core/BatchTMScheduler.h>
+#include <Core/PreviewCache.h>
 #include <Core/TonemappingOptions.h>
 #include <Exif/ExifOperations.h>
 #include <OsIntegration/osintegration.h>
 
+namespace {
+const int THUMBNAIL_SIZE = 48;
+
+QImage hdrThumbnail(const QString &filename) {
+    HdrPreviewPtr preview = PreviewCache::load(filename);
+    if (!preview) return QImage();
+    return PreviewCache::thumbnail(*preview, THUMBNAIL_SIZE);
+}
+}  // anonymous namespace
+
 BatchTMDialog::BatchTMDialog(QWidget *p, QSqlDatabase db)
     : QDialog(p), m_Ui(new Ui::BatchTMDialog), m_abort(false), m_db(db) {
     m_Ui->setupUi(this);
@@ -95,15 +107,14 @@ BatchTMDialog::BatchTMDialog(QWidget *p, QSqlDatabase db)
     m_Ui->Log_Widget->setModel(log_filter);
     m_Ui->Log_Widget->setWordWrap(true);
 
+    m_Ui->listWidget_HDRs->setIconSize(
+        QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE));
+    connect(&m_thumbnailWatcher, &QFutureWatcherBase::resultReadyAt, this,
+            &BatchTMDialog::thumbnailReady);
+
     m_formatHelper.initConnection(m_Ui->comboBoxFormat,
                                   m_Ui->formatSettingsButton, false);
 
-    m_thread_slot.release(m_max_num_threads);
-    m_available_threads = new bool[m_max_num_threads];
-    for (int r = 0; r < m_max_num_threads; r++)
-        m_available_threads[r] = true;  // reset to true
-
-    m_next_hdr_file = 0;
     m_is_batch_running = false;
 
     add_log_message(tr("Using %n thread(s)", "", m_max_num_threads));
@@ -115,9 +126,11 @@ BatchTMDialog::BatchTMDialog(QWidget *p, QSqlDatabase db)
 BatchTMDialog::~BatchTMDialog() {
     this->hide();
 
+    m_thumbnailWatcher.cancel();
+    m_thumbnailWatcher.waitForFinished();
+
     delete log_filter;
     delete full_Log_Model;
-    delete[] m_available_threads;
 
     QApplication::restoreOverrideCursor();
 }
@@ -256,9 +269,47 @@ void BatchTMDialog::add_view_model_HDRs(const QStringList &list) {
         m_Ui->listWidget_HDRs->addItem(item);
     }
     // HDRs_list += list;
+    update_HDR_thumbnails();
     check_enable_start();
 }
 
+void BatchTMDialog::update_HDR_thumbnails() {
+    m_thumbnailWatcher.cancel();
+    m_thumbnailWatcher.waitForFinished();
+
+    m_thumbnailFiles.clear();
+    for (int idx = 0; idx < m_Ui->listWidget_HDRs->count(); ++idx) {
+        QListWidgetItem *item = m_Ui->listWidget_HDRs->item(idx);
+        if (!item->icon().isNull()) continue;
+
+        QString filename = item->data(Qt::UserRole + 1).toString();
+        HdrPreviewPtr preview = PreviewCache::lookup(filename);
+        if (preview) {
+            item->setIcon(QPixmap::fromImage(
+                PreviewCache::thumbnail(*preview, THUMBNAIL_SIZE)));
+        } else if (!m_thumbnailFiles.contains(filename)) {
+            m_thumbnailFiles << filename;
+        }
+    }
+    if (!m_thumbnailFiles.isEmpty()) {
+        m_thumbnailWatcher.setFuture(
+            QtConcurrent::mapped(m_thumbnailFiles, hdrThumbnail));
+    }
+}
+
+void BatchTMDialog::thumbnailReady(int index) {
+    QImage thumbnail = m_thumbnailWatcher.resultAt(index);
+    if (thumbnail.isNull()) return;
+
+    const QString &filename = m_thumbnailFiles.at(index);
+    for (int idx = 0; idx < m_Ui->listWidget_HDRs->count(); ++idx) {
+        QListWidgetItem *item = m_Ui->listWidget_HDRs->item(idx);
+        if (item->data(Qt::UserRole + 1).toString() == filename) {
+            item->setIcon(QPixmap::fromImage(thumbnail));
+        }
+    }
+}
+
 void BatchTMDialog::add_view_model_TM_OPTs(const QStringList &list) {
     bool errors = false;
 
@@ -371,92 +422,39 @@ void BatchTMDialog::batch_core() {
                          ->data(Qt::UserRole + 1)
                          .toString();
     }
-    start_batch_thread();  // kick off the conversion!
-}
-
-void BatchTMDialog::start_batch_thread() {
-    // lock the class resources in order to work free of race-condition
-    m_class_data_mutex.lock();
-
-    if (m_abort) {
-        m_class_data_mutex.unlock();
-        emit stop_batch_tm_ui();
-        return;
-    }
 
-    if (m_next_hdr_file == HDRs_list.size()) {
-        m_class_data_mutex.unlock();
-        emit stop_batch_tm_ui();
-    } else {
-        int t_id = get_available_thread_id();
-        if (t_id != INT_MAX) {
-            // at least one thread free!
-            // start thread
-            // I create the thread with NEW, but I let it die on its own, so
-            // don't
-            // need to store its pointer somewhere
-            QString fileExtension = m_formatHelper.getFileExtension();
-
-            BatchTMJob *job_thread = new BatchTMJob(
-                t_id, HDRs_list.at(m_next_hdr_file), &m_tm_options_list,
-                m_Ui->out_folder_widgets->text(), fileExtension,
-                m_formatHelper.getParams());
-
-            // Thread deletes itself when it has done with its job
-            connect(job_thread, &QThread::finished, job_thread,
-                    &QObject::deleteLater);
-            connect(job_thread, &BatchTMJob::done, this,
-                    &BatchTMDialog::release_thread);  //, Qt::DirectConnection);
-            connect(
-                job_thread, &BatchTMJob::add_log_message, this,
-                &BatchTMDialog::add_log_message);  //, Qt::DirectConnection);
-            connect(job_thread, &BatchTMJob::increment_progress_bar, this,
-                    &BatchTMDialog::
-                        increment_progress_bar);  //, Qt::DirectConnection);
-
-            job_thread->start();
-            m_next_hdr_file++;
-
-            m_class_data_mutex.unlock();
-            emit start_batch_thread();
-        } else {
-            m_class_data_mutex.unlock();
-            // no thread available!
-            // I return without doing anything!
-            return;
+    const QString fileExtension = m_formatHelper.getFileExtension();
+    const QString outputFolder = m_Ui->out_folder_widgets->text();
+    const pfs::Params params = m_formatHelper.getParams();
+
+    // one task per (HDR, tonemapping options) pair
+    m_scheduler.reset(new BatchTMScheduler);
+    m_scheduler->setNumThreads(m_max_num_threads);
+    m_scheduler->setMemoryLimit(
+        static_cast<size_t>(qMax(LuminanceOptions().getBatchTmMemoryLimit(), 0))
+        << 20);
+
+    foreach (const QString &hdr, HDRs_list) {
+        const QString base =
+            outputFolder + "/" + QFileInfo(hdr).completeBaseName();
+
+        QList<BatchTMOutput> outputs;
+        foreach (TonemappingOptions *opts, m_tm_options_list) {
+            outputs << BatchTMOutput(
+                *opts, base + "_" + opts->getPostfix() + "." + fileExtension,
+                params);
         }
+        m_scheduler->addFile(hdr, outputs);
     }
-}
 
-int BatchTMDialog::get_available_thread_id() {
-    if (m_thread_slot.tryAcquire()) {
-        // if I'm here, at least one thread is available
-
-        m_thread_control_mutex.lock();
-        int t_id;
-        // look for the first available ID
-        for (t_id = 0; t_id < m_max_num_threads; t_id++) {
-            if (m_available_threads[t_id] == true) {
-                m_available_threads[t_id] = false;
-                break;
-            }
-        }
-        m_thread_control_mutex.unlock();
+    connect(m_scheduler.data(), &BatchTMScheduler::add_log_message, this,
+            &BatchTMDialog::add_log_message);
+    connect(m_scheduler.data(), &BatchTMScheduler::increment_progress_bar,
+            this, &BatchTMDialog::increment_progress_bar);
+    connect(m_scheduler.data(), &BatchTMScheduler::finished, this,
+            &BatchTMDialog::stop_batch_tm_ui);
 
-        assert(t_id != m_max_num_threads);
-        return (t_id);
-    } else
-        return INT_MAX;
-}
-
-void BatchTMDialog::release_thread(int t_id) {
-    m_thread_control_mutex.lock();
-    m_available_threads[t_id] = true;
-    m_thread_control_mutex.unlock();
-
-    m_thread_slot.release();
-
-    emit start_batch_thread();
+    m_scheduler->start();  // kick off the conversion!
 }
 
 void BatchTMDialog::init_batch_tm_ui() {
@@ -492,23 +490,22 @@ void BatchTMDialog::init_batch_tm_ui() {
 }
 
 void BatchTMDialog::stop_batch_tm_ui() {
-    if (m_thread_slot.tryAcquire(m_max_num_threads)) {
-        m_Ui->cancelbutton->setDisabled(false);
-        m_Ui->cancelbutton->setText(tr("Close"));
+    // the workers are on their way out
+    m_scheduler->wait();
 
-        m_Ui->BatchGoButton->setText(tr("&Done"));
+    m_Ui->cancelbutton->setDisabled(false);
+    m_Ui->cancelbutton->setText(tr("Close"));
 
-        if (m_abort)
-            add_log_message(tr("Conversion aborted by user request."));
-        else
-            add_log_message(tr("All tasks completed."));
+    m_Ui->BatchGoButton->setText(tr("&Done"));
 
-        QApplication::restoreOverrideCursor();
+    if (m_abort)
+        add_log_message(tr("Conversion aborted by user request."));
+    else
+        add_log_message(tr("All tasks completed."));
 
-        m_is_batch_running = false;
+    QApplication::restoreOverrideCursor();
 
-        m_thread_slot.release(m_max_num_threads);
-    }
+    m_is_batch_running = false;
 }
 
 void BatchTMDialog::closeEvent(QCloseEvent *ce) {
@@ -531,6 +528,7 @@ void BatchTMDialog::increment_progress_bar(int inc) {
 void BatchTMDialog::abort() {
     if (m_is_batch_running) {
         m_abort = true;
+        m_scheduler->abort();
         m_Ui->cancelbutton->setText(tr("Aborting..."));
         m_Ui->cancelbutton->setEnabled(false);
     } else
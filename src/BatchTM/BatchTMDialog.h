@@ -30,8 +30,9 @@
 
 #include <QDialog>
 #include <QFuture>
+#include <QFutureWatcher>
+#include <QImage>
 #include <QMutex>
-#include <QSemaphore>
 #include <QSortFilterProxyModel>
 #include <QStringListModel>
 #include <QVector>
@@ -44,6 +45,7 @@
 
 // Forward declaration
 class TonemappingOptions;
+class BatchTMScheduler;
 
 namespace Ui {
 class BatchTMDialog;
@@ -78,8 +80,6 @@ class BatchTMDialog : public QDialog {
     void add_log_message(const QString &);
 
     void batch_core();
-    void release_thread(int t_id);
-    void start_batch_thread();
     void stop_batch_tm_ui();
     void increment_progress_bar(int);
 
@@ -87,6 +87,8 @@ class BatchTMDialog : public QDialog {
 
     void updateWidth(int);
 
+    void thumbnailReady(int);
+
    protected:
     void closeEvent(QCloseEvent *);
 
@@ -110,22 +112,22 @@ class BatchTMDialog : public QDialog {
     // Davide Anastasia <davideanastasia@users.sourceforge.net>
     // Max number of threads allowed
     int m_max_num_threads;
-    QSemaphore m_thread_slot;
-    QMutex m_thread_control_mutex;
-    QMutex m_class_data_mutex;
+    QScopedPointer<BatchTMScheduler> m_scheduler;
     bool m_is_batch_running;
-    bool *m_available_threads;
     bool m_abort;
     QSqlDatabase m_db;
-    int m_next_hdr_file;
 
     pfsadditions::FormatHelper m_formatHelper;
 
-    int get_available_thread_id();
+    // thumbnails of the HDRs that are not in the preview cache yet
+    QFutureWatcher<QImage> m_thumbnailWatcher;
+    QStringList m_thumbnailFiles;
 
     void init_batch_tm_ui();
     // updates graphica widget (view) and data structure (model) for HDR list
     void add_view_model_HDRs(const QStringList &);
+    // sets the icons of the HDR list, from the preview cache or in background
+    void update_HDR_thumbnails();
     // updates graphica widget (view) and data structure (model) for TM_opts
     // list
     void add_view_model_TM_OPTs(const QStringList &);
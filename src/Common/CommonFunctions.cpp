@@ -40,6 +40,7 @@
 #include <Libpfs/io/framereaderfactory.h>
 #include <Libpfs/io/framewriter.h>
 #include <Libpfs/io/framewriterfactory.h>
+#include <Libpfs/io/rawreader.h>
 #include <Libpfs/io/tiffreader.h>
 #include <Libpfs/io/tiffwriter.h>
 #include <Libpfs/manip/copy.h>
@@ -279,7 +280,14 @@ void LoadFile::operator()(HdrCreationItem &currentItem) {
                         .arg(filePath.constData());
 
         FrameReaderPtr reader = FrameReaderFactory::open(filePath.constData());
-        reader->read(*currentItem.frame(), getRawSettings());
+        const bool preview =
+            m_preview && dynamic_cast<RAWReader *>(reader.get()) != NULL;
+        pfs::Params params = getRawSettings();
+        if (preview) {
+            params.set("raw.half_size", true);
+        }
+        reader->read(*currentItem.frame(), params);
+        currentItem.setPreview(preview);
 
         // read Average Luminance
         pfs::exif::ExifData exifData(currentItem.filename().toStdString());
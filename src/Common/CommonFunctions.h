@@ -132,14 +132,19 @@ struct ConvertToQRgb {
 };
 
 struct LoadFile {
-    explicit LoadFile(bool fromFITS = false) : m_datamax(0.f), m_datamin(0.f) {
+    //! \param preview develop RAW files at half size, see
+    //! HdrCreationItem::isPreview()
+    explicit LoadFile(bool fromFITS = false, bool preview = false)
+        : m_datamax(0.f), m_datamin(0.f) {
         m_fromFITS = fromFITS;
+        m_preview = preview;
     }
     void operator()(HdrCreationItem &currentItem);
     float normalize(float);
     float m_datamax;
     float m_datamin;
     bool m_fromFITS;
+    bool m_preview;
 };
 
 struct SaveFile {
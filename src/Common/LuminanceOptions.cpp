@@ -42,6 +42,7 @@
 
 #include "Common/LuminanceOptions.h"
 #include "Common/config.h"
+#include "Libpfs/utils/scratchallocator.h"
 
 #if defined(Q_OS_WIN)
 const QString LuminanceOptions::LUMINANCE_HDR_HOME_FOLDER = "LuminanceHDR";
@@ -617,6 +618,14 @@ void LuminanceOptions::setBatchTmNumThreads(int v) {
     m_settingHolder->setValue(KEY_BATCH_TM_NUM_THREADS, v);
 }
 
+int LuminanceOptions::getBatchTmMemoryLimit() {
+    return m_settingHolder->value(KEY_BATCH_TM_MEMORY_LIMIT, 0).toInt();
+}
+
+void LuminanceOptions::setBatchTmMemoryLimit(int mb) {
+    m_settingHolder->setValue(KEY_BATCH_TM_MEMORY_LIMIT, mb);
+}
+
 namespace {
 #ifdef QT_DEBUG
 struct PrintTempDir {
@@ -673,6 +682,21 @@ void LuminanceOptions::setTempDir(const QString &path) {
     m_settingHolder->setValue(KEY_TEMP_RESULT_PATH, path);
 }
 
+int LuminanceOptions::getScratchThreshold() {
+    return m_settingHolder->value(KEY_SCRATCH_THRESHOLD, 0).toInt();
+}
+
+void LuminanceOptions::setScratchThreshold(int mb) {
+    m_settingHolder->setValue(KEY_SCRATCH_THRESHOLD, mb);
+}
+
+void LuminanceOptions::applyScratchStorage() {
+    pfs::utils::ScratchStorage::setDirectory(
+        QFile::encodeName(getTempDir()).toStdString());
+    pfs::utils::ScratchStorage::setThreshold(
+        static_cast<size_t>(qMax(getScratchThreshold(), 0)) << 20);
+}
+
 QString LuminanceOptions::getDefaultPathHdrIn() {
     return m_settingHolder->value(KEY_RECENT_PATH_LOAD_HDR, QDir::currentPath())
         .toString();
@@ -175,11 +175,15 @@ class LuminanceOptions : public QObject {
     QString getBatchTmPathTmoSettings();
     QString getBatchTmPathLdrOutput();
     int getBatchTmNumThreads();
+    // Size (in MB) of the frames a batch may keep in memory at once, 0 means
+    // no limit
+    int getBatchTmMemoryLimit();
 
     void setBatchTmPathHdrInput(const QString &);
     void setBatchTmPathTmoSettings(const QString &);
     void setBatchTmPathLdrOutput(const QString &);
     void setBatchTmNumThreads(int);
+    void setBatchTmMemoryLimit(int);
 
     int getNumThreads() { return getBatchTmNumThreads(); }
     void setNumThreads(int i) { setBatchTmNumThreads(i); }
@@ -195,6 +199,14 @@ class LuminanceOptions : public QObject {
     QString getDefaultResponseCurveFilename();
 
     void setTempDir(const QString &);
+
+    // Out-of-core storage
+    // Size (in MB) above which images are backed by a scratch file in
+    // getTempDir(), 0 keeps everything in memory
+    int getScratchThreshold();
+    void setScratchThreshold(int);
+    //! \brief push the settings above to pfs::utils::ScratchStorage
+    void applyScratchStorage();
     void setDefaultPathHdrIn(const QString &);
     void setDefaultPathHdrOut(const QString &);
     void setDefaultPathLdrIn(const QString &);  // HdrWizard
@@ -0,0 +1,348 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Common/fftw_plans.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <Common/LuminanceOptions.h>
+#include <Common/init_fftw.h>
+
+namespace {
+struct Key {
+    FftwPlans::Kind kind;
+    int rows;
+    int cols;
+    int inAlignment;
+    int outAlignment;
+    bool inPlace;
+    bool unaligned;
+
+    bool operator==(const Key &other) const {
+        return kind == other.kind && rows == other.rows &&
+               cols == other.cols && inAlignment == other.inAlignment &&
+               outAlignment == other.outAlignment &&
+               inPlace == other.inPlace && unaligned == other.unaligned;
+    }
+};
+
+struct Entry {
+    Key key;
+    FftwPlans::Plan plan;
+    bool measured;
+};
+
+// the registry and the pool are never destroyed: plans and buffers may be
+// released, and the wisdom written, after the static objects are gone
+struct Registry {
+    Registry() : wisdomRead(false), wisdomChanged(false) {}
+
+    std::mutex mutex;
+    // most recently used first
+    std::list<Entry> entries;
+    bool wisdomRead;
+    bool wisdomChanged;
+    std::string wisdomFile;
+};
+
+Registry &registry() {
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+struct Pool {
+    Pool() : bytes(0) {}
+
+    std::mutex mutex;
+    std::multimap<size_t, void *> buffers;
+    size_t bytes;
+};
+
+Pool &pool() {
+    static Pool *instance = new Pool;
+    return *instance;
+}
+
+// room for any alignment offset of fftwf_alignment_of()
+const size_t ALIGNMENT_PAD = 64;
+
+struct DestroyPlan {
+    void operator()(fftwf_plan p) const {
+        boost::mutex::scoped_lock lock(FFTW_MUTEX::fftw_mutex_destroy_plan);
+        fftwf_destroy_plan(p);
+    }
+};
+
+size_t inputBytes(const Key &key) {
+    const size_t rows = key.kind == FftwPlans::REDFT00_1D ? 1 : key.rows;
+    switch (key.kind) {
+        case FftwPlans::C2R_2D:
+            return rows * (key.cols / 2 + 1) * sizeof(fftwf_complex);
+        case FftwPlans::FORWARD_2D:
+        case FftwPlans::BACKWARD_2D:
+            return rows * key.cols * sizeof(fftwf_complex);
+        default:
+            return rows * key.cols * sizeof(float);
+    }
+}
+
+size_t outputBytes(const Key &key) {
+    const size_t rows = key.kind == FftwPlans::REDFT00_1D ? 1 : key.rows;
+    switch (key.kind) {
+        case FftwPlans::R2C_2D:
+            return rows * (key.cols / 2 + 1) * sizeof(fftwf_complex);
+        case FftwPlans::FORWARD_2D:
+        case FftwPlans::BACKWARD_2D:
+            return rows * key.cols * sizeof(fftwf_complex);
+        default:
+            return rows * key.cols * sizeof(float);
+    }
+}
+
+// must be called under FFTW_MUTEX::fftw_mutex_plan
+fftwf_plan plan(const Key &key, void *in, void *out, unsigned flags) {
+    float *realIn = static_cast<float *>(in);
+    float *realOut = static_cast<float *>(out);
+    fftwf_complex *complexIn = static_cast<fftwf_complex *>(in);
+    fftwf_complex *complexOut = static_cast<fftwf_complex *>(out);
+
+    switch (key.kind) {
+        case FftwPlans::R2C_2D:
+            return fftwf_plan_dft_r2c_2d(key.rows, key.cols, realIn,
+                                         complexOut, flags);
+        case FftwPlans::C2R_2D:
+            return fftwf_plan_dft_c2r_2d(key.rows, key.cols, complexIn,
+                                         realOut, flags);
+        case FftwPlans::FORWARD_2D:
+            return fftwf_plan_dft_2d(key.rows, key.cols, complexIn,
+                                     complexOut, FFTW_FORWARD, flags);
+        case FftwPlans::BACKWARD_2D:
+            return fftwf_plan_dft_2d(key.rows, key.cols, complexIn,
+                                     complexOut, FFTW_BACKWARD, flags);
+        case FftwPlans::REDFT00_2D:
+            return fftwf_plan_r2r_2d(key.rows, key.cols, realIn, realOut,
+                                     FFTW_REDFT00, FFTW_REDFT00, flags);
+        case FftwPlans::REDFT00_1D:
+            return fftwf_plan_r2r_1d(key.cols, realIn, realOut,
+                                     FFTW_REDFT00, flags);
+    }
+    return NULL;
+}
+
+// FFTW_MEASURE overwrites the buffers it plans for: measure on buffers of
+// our own, offset to the alignment of the key
+fftwf_plan measure(const Key &key, unsigned flags) {
+    const size_t inBytes = inputBytes(key);
+    const size_t outBytes = outputBytes(key);
+    const size_t bytes = key.inPlace ? std::max(inBytes, outBytes) : inBytes;
+
+    char *scratchIn = static_cast<char *>(fftwf_malloc(bytes + ALIGNMENT_PAD));
+    char *scratchOut =
+        key.inPlace
+            ? scratchIn
+            : static_cast<char *>(fftwf_malloc(outBytes + ALIGNMENT_PAD));
+    fftwf_plan p = NULL;
+    if (scratchIn && scratchOut) {
+        p = plan(key, scratchIn + key.inAlignment,
+                 scratchOut + key.outAlignment, flags);
+    }
+    if (!key.inPlace) fftwf_free(scratchOut);
+    fftwf_free(scratchIn);
+    return p;
+}
+
+void saveWisdomAtExit() { FftwPlans::saveWisdom(); }
+
+// must be called under the mutex of the registry
+void readWisdom(Registry &r) {
+    if (r.wisdomRead) return;
+    r.wisdomRead = true;
+    r.wisdomFile = LuminanceOptions().getFftwWisdomFileName().toStdString();
+    {
+        boost::mutex::scoped_lock lock(FFTW_MUTEX::fftw_mutex_plan);
+        fftwf_import_wisdom_from_filename(r.wisdomFile.c_str());
+    }
+    std::atexit(&saveWisdomAtExit);
+}
+}
+
+FftwPlans::Plan FftwPlans::get(Kind kind, int rows, int cols, void *in,
+                               void *out, unsigned flags) {
+    // activate parallel execution of fft routines
+    init_fftw();
+
+    const bool unaligned = (flags & FFTW_UNALIGNED) != 0;
+    const Key key = {kind,
+                     kind == REDFT00_1D ? 1 : rows,
+                     cols,
+                     unaligned ? 0 : fftwf_alignment_of(
+                                         static_cast<float *>(in)),
+                     unaligned ? 0 : fftwf_alignment_of(
+                                         static_cast<float *>(out)),
+                     in == out,
+                     unaligned};
+    const bool measured = (flags & FFTW_ESTIMATE) == 0;
+
+    Registry &r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        readWisdom(r);
+        for (std::list<Entry>::iterator it = r.entries.begin();
+             it != r.entries.end(); ++it) {
+            if (it->key == key && (it->measured || !measured)) {
+                r.entries.splice(r.entries.begin(), r.entries, it);
+                return it->plan;
+            }
+        }
+    }
+
+    // plan outside of the lock of the registry, so that a long measurement
+    // does not hold up the threads whose plans are ready
+    fftwf_plan p;
+    bool changed = false;
+    {
+        boost::mutex::scoped_lock lock(FFTW_MUTEX::fftw_mutex_plan);
+        // neither FFTW_WISDOM_ONLY nor FFTW_ESTIMATE touch the buffers
+        p = plan(key, in, out, flags | FFTW_WISDOM_ONLY);
+        if (!p && measured) {
+            p = measure(key, flags);
+            changed = true;
+        } else if (!p) {
+            p = plan(key, in, out, flags);
+        }
+    }
+    if (!p) {
+        throw std::runtime_error("FftwPlans: cannot plan the transform");
+    }
+    Plan result(p, DestroyPlan());
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.wisdomChanged = r.wisdomChanged || changed;
+    for (std::list<Entry>::iterator it = r.entries.begin();
+         it != r.entries.end(); ++it) {
+        if (it->key == key) {
+            // planned by another thread in the meantime
+            if (it->measured || !measured) {
+                r.entries.splice(r.entries.begin(), r.entries, it);
+                return it->plan;
+            }
+            r.entries.erase(it);
+            break;
+        }
+    }
+    const Entry entry = {key, result, measured};
+    r.entries.push_front(entry);
+    if (r.entries.size() > MAX_PLANS) r.entries.pop_back();
+    return result;
+}
+
+void FftwPlans::saveWisdom() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.wisdomChanged) return;
+    {
+        boost::mutex::scoped_lock planLock(FFTW_MUTEX::fftw_mutex_plan);
+        fftwf_export_wisdom_to_filename(r.wisdomFile.c_str());
+    }
+    r.wisdomChanged = false;
+}
+
+void FftwPlans::clear() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.entries.clear();
+}
+
+FftwBuffer::FftwBuffer(size_t bytes) : m_data(NULL), m_bytes(bytes) {
+    if (bytes == 0) return;
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        std::multimap<size_t, void *>::iterator it = p.buffers.find(bytes);
+        if (it != p.buffers.end()) {
+            m_data = it->second;
+            p.buffers.erase(it);
+            p.bytes -= bytes;
+            return;
+        }
+    }
+    boost::mutex::scoped_lock lock(FFTW_MUTEX::fftw_mutex_alloc);
+    m_data = fftwf_malloc(bytes);
+    if (!m_data) throw std::bad_alloc();
+}
+
+FftwBuffer::FftwBuffer(FftwBuffer &&other)
+    : m_data(other.m_data), m_bytes(other.m_bytes) {
+    other.m_data = NULL;
+    other.m_bytes = 0;
+}
+
+FftwBuffer &FftwBuffer::operator=(FftwBuffer &&other) {
+    if (this != &other) {
+        release();
+        m_data = other.m_data;
+        m_bytes = other.m_bytes;
+        other.m_data = NULL;
+        other.m_bytes = 0;
+    }
+    return *this;
+}
+
+FftwBuffer::~FftwBuffer() { release(); }
+
+void FftwBuffer::release() {
+    if (!m_data) return;
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.bytes + m_bytes <= MAX_POOLED_BYTES) {
+            p.buffers.insert(std::make_pair(m_bytes, m_data));
+            p.bytes += m_bytes;
+            m_data = NULL;
+            return;
+        }
+    }
+    boost::mutex::scoped_lock lock(FFTW_MUTEX::fftw_mutex_free);
+    fftwf_free(m_data);
+    m_data = NULL;
+}
+
+void FftwBuffer::trim() {
+    std::multimap<size_t, void *> buffers;
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        buffers.swap(p.buffers);
+        p.bytes = 0;
+    }
+    boost::mutex::scoped_lock lock(FFTW_MUTEX::fftw_mutex_free);
+    for (std::multimap<size_t, void *>::iterator it = buffers.begin();
+         it != buffers.end(); ++it) {
+        fftwf_free(it->second);
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \file fftw_plans.h
+//! \brief FFTW plans and buffers shared by every operator of the process
+
+#ifndef FFTW_PLANS_H
+#define FFTW_PLANS_H
+
+#include <cstddef>
+#include <memory>
+
+#include <fftw3.h>
+
+//! \brief Process-wide registry of FFTW plans
+//!
+//! Plans are keyed by the kind of the transform, its size, whether it runs
+//! in place and the alignment (\c fftwf_alignment_of()) of its buffers. The
+//! first request of a key builds the plan, from the wisdom file when it
+//! knows the transform; every later request of the key, from any thread,
+//! gets the same plan. Plans are run with the new-array execute functions of
+//! FFTW (\c fftwf_execute_dft_r2c() and so on), which are thread-safe, on
+//! any buffers of the size and alignment of the key.
+//!
+//! The wisdom file is read once, by the first request, and written once,
+//! when the process exits, if plans were measured in between. The registry
+//! keeps the \c MAX_PLANS most recently used plans.
+class FftwPlans {
+   public:
+    enum Kind {
+        //! \brief fftwf_plan_dft_r2c_2d(rows, cols): real in, rows x
+        //! (cols / 2 + 1) complex out
+        R2C_2D,
+        //! \brief fftwf_plan_dft_c2r_2d(rows, cols), the inverse of R2C_2D
+        C2R_2D,
+        //! \brief fftwf_plan_dft_2d(rows, cols, FFTW_FORWARD)
+        FORWARD_2D,
+        //! \brief fftwf_plan_dft_2d(rows, cols, FFTW_BACKWARD)
+        BACKWARD_2D,
+        //! \brief discrete cosine transform FFTW_REDFT00 of both dimensions
+        REDFT00_2D,
+        //! \brief FFTW_REDFT00 of a single row of cols values (rows is
+        //! ignored)
+        REDFT00_1D
+    };
+
+    typedef std::shared_ptr<fftwf_plan_s> Plan;
+
+    static const size_t MAX_PLANS = 32;
+
+    //! \brief plan of \a kind for buffers like \a in and \a out (the same
+    //! pointer for a transform in place)
+    //!
+    //! \a in and \a out are neither read nor written: FFTW_MEASURE plans are
+    //! measured on buffers of the registry.
+    //! \param flags FFTW_MEASURE or FFTW_ESTIMATE, optionally with
+    //! FFTW_UNALIGNED for a plan run on buffers of any alignment. A measured
+    //! plan serves FFTW_ESTIMATE requests as well, while an FFTW_MEASURE
+    //! request replaces the estimated plan of its key.
+    static Plan get(Kind kind, int rows, int cols, void *in, void *out,
+                    unsigned flags = FFTW_MEASURE);
+
+    //! \brief write the wisdom file now, if plans were measured since it
+    //! was read or last written
+    static void saveWisdom();
+
+    //! \brief drop every plan not in use, once the image they were made
+    //! for is closed
+    static void clear();
+};
+
+//! \brief Buffer from fftwf_malloc(), taken from and given back to a
+//! process-wide pool of the buffers released recently
+//!
+//! Operators allocate the same few sizes over and over (the size of the
+//! preview, the size of the image): the pool keeps up to
+//! \c MAX_POOLED_BYTES of released buffers, and hands them out again to
+//! requests of exactly the same size. Buffers from fftwf_malloc() are
+//! aligned for SIMD, and thus all fit the same plans.
+class FftwBuffer {
+   public:
+    static const size_t MAX_POOLED_BYTES = 256 * 1024 * 1024;
+
+    FftwBuffer() : m_data(NULL), m_bytes(0) {}
+    explicit FftwBuffer(size_t bytes);
+    FftwBuffer(FftwBuffer &&other);
+    FftwBuffer &operator=(FftwBuffer &&other);
+    ~FftwBuffer();
+
+    static FftwBuffer allocReal(size_t count) {
+        return FftwBuffer(count * sizeof(float));
+    }
+    static FftwBuffer allocComplex(size_t count) {
+        return FftwBuffer(count * sizeof(fftwf_complex));
+    }
+
+    inline float *real() const { return static_cast<float *>(m_data); }
+    inline fftwf_complex *complex() const {
+        return static_cast<fftwf_complex *>(m_data);
+    }
+    inline size_t bytes() const { return m_bytes; }
+
+    //! \brief free the buffers of the pool, once the image they were kept
+    //! for is closed
+    static void trim();
+
+   private:
+    FftwBuffer(const FftwBuffer &);
+    FftwBuffer &operator=(const FftwBuffer &);
+
+    void release();
+
+    void *m_data;
+    size_t m_bytes;
+};
+
+#endif  // FFTW_PLANS_H
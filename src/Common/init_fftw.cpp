@@ -40,6 +40,9 @@ void init_fftw() {
     // activate parallel execution of fft routines
     if (!is_init_threads) {
         fftwf_init_threads();
+        // operators plan (and destroy plans) from several worker threads at
+        // once, not all of them under the same FFTW_MUTEX
+        fftwf_make_planner_thread_safe();
 #ifdef _OPENMP
         fftwf_plan_with_nthreads(omp_get_max_threads());
 #else
@@ -0,0 +1,398 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Core/BatchTMScheduler.h>
+
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <Common/fftw_plans.h>
+#include <Core/IOWorker.h>
+#include <Core/TMWorker.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/manip/copy.h>
+#include <Libpfs/manip/gamma.h>
+#include <Libpfs/manip/pyramid.h>
+#include <Libpfs/manip/resize.h>
+
+namespace {
+size_t frameBytes(const pfs::Frame &frame) {
+    return frame.size() * frame.getChannels().size() * sizeof(float);
+}
+}
+
+struct BatchTMScheduler::File {
+    enum State { QUEUED, LOADING, LOADED, FAILED };
+
+    explicit File(const QString &n)
+        : name(n), state(QUEUED), pending(0), bytes(0) {}
+
+    QString name;
+    State state;
+    // tasks of this file not yet completed
+    int pending;
+    std::shared_ptr<const pfs::Frame> hdr;
+    // resized variants by width, NULL while being computed
+    std::map<size_t, std::shared_ptr<const pfs::Frame>> resized;
+    // bytes of hdr and resized
+    size_t bytes;
+};
+
+BatchTMScheduler::BatchTMScheduler(QObject *parent)
+    : QObject(parent),
+      m_num_threads(1),
+      m_memory_limit(0),
+      m_num_tasks(0),
+      m_abort(false),
+      m_running(0),
+      m_active(0),
+      m_failed(0),
+      m_shared_bytes(0),
+      m_working_bytes(0) {}
+
+BatchTMScheduler::~BatchTMScheduler() {
+    abort();
+    wait();
+}
+
+void BatchTMScheduler::setNumThreads(int threads) {
+    m_num_threads = std::max(threads, 1);
+}
+
+void BatchTMScheduler::setMemoryLimit(size_t bytes) { m_memory_limit = bytes; }
+
+void BatchTMScheduler::addFile(const QString &hdrFile,
+                               const QList<BatchTMOutput> &outputs) {
+    m_files.emplace_back(new File(hdrFile));
+    m_files.back()->pending = outputs.size();
+
+    foreach (const BatchTMOutput &output, outputs) {
+        Task task = {m_files.size() - 1, output};
+        m_tasks.push_back(task);
+    }
+    m_num_tasks += outputs.size();
+}
+
+int BatchTMScheduler::numTasks() const { return m_num_tasks; }
+
+void BatchTMScheduler::start() {
+    if (!m_threads.empty()) return;
+
+    // the tasks of a file stay together, so that its owner decodes it once
+    m_queues.assign(m_num_threads, std::deque<Task>());
+    for (size_t i = 0; i < m_tasks.size(); ++i) {
+        m_queues[m_tasks[i].file % m_num_threads].push_back(m_tasks[i]);
+    }
+    m_tasks.clear();
+
+    m_running = m_num_threads;
+    for (int i = 0; i < m_num_threads; ++i) {
+        m_threads.emplace_back(&BatchTMScheduler::run, this, i);
+    }
+}
+
+void BatchTMScheduler::abort() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_abort = true;
+    m_cond.notify_all();
+}
+
+bool BatchTMScheduler::wait() {
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_threads[i].join();
+    }
+    m_threads.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed == 0 && !m_abort;
+}
+
+bool BatchTMScheduler::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running > 0;
+}
+
+bool BatchTMScheduler::isAborted() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_abort;
+}
+
+int BatchTMScheduler::numFailed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+void BatchTMScheduler::run(int worker) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_abort) {
+        Task task;
+        if (!takeTask(worker, task)) {
+            bool empty = true;
+            for (size_t q = 0; q < m_queues.size(); ++q) {
+                empty = empty && m_queues[q].empty();
+            }
+            if (empty) break;
+
+            // wait for memory to be released
+            m_cond.wait(lock);
+            continue;
+        }
+
+        ++m_active;
+        lock.unlock();
+
+        process(worker, task);
+
+        lock.lock();
+        --m_active;
+        taskDone(*m_files[task.file]);
+        m_cond.notify_all();
+    }
+
+    const bool last = (--m_running == 0);
+    m_cond.notify_all();
+    lock.unlock();
+
+    if (last) {
+        // the buffers and plans kept for the tone mapping of the batch
+        pfs::PyramidPool::clear();
+        FftwBuffer::trim();
+        FftwPlans::clear();
+        emit finished();
+    }
+}
+
+bool BatchTMScheduler::takeTask(int worker, Task &task) {
+    // a new file is decoded only under the limit, or when nothing else runs
+    const bool canDecode = m_memory_limit == 0 || m_active == 0 ||
+                           m_shared_bytes + m_working_bytes < m_memory_limit;
+
+    // own queue first, then steal: decoded files, new files, files being
+    // decoded by someone else
+    int best = -1;
+    int bestRank = 3;
+    for (int i = 0; i < m_num_threads; ++i) {
+        const int q = (worker + i) % m_num_threads;
+        if (m_queues[q].empty()) continue;
+
+        int rank = 3;
+        switch (m_files[m_queues[q].front().file]->state) {
+            case File::LOADED:
+            case File::FAILED:
+                rank = 0;
+                break;
+            case File::QUEUED:
+                rank = canDecode ? 1 : 3;
+                break;
+            case File::LOADING:
+                rank = 2;
+                break;
+        }
+        if (rank < bestRank) {
+            best = q;
+            bestRank = rank;
+            if (rank == 0) break;
+        }
+    }
+    if (best < 0) return false;
+
+    task = m_queues[best].front();
+    m_queues[best].pop_front();
+    return true;
+}
+
+void BatchTMScheduler::taskDone(File &file) {
+    if (--file.pending == 0) {
+        m_shared_bytes -= file.bytes;
+        file.bytes = 0;
+        file.hdr.reset();
+        file.resized.clear();
+    }
+}
+
+std::shared_ptr<const pfs::Frame> BatchTMScheduler::acquireFrame(int worker,
+                                                                 File &file) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (file.state == File::LOADING) m_cond.wait(lock);
+    if (file.state != File::QUEUED) return file.hdr;
+
+    file.state = File::LOADING;
+    lock.unlock();
+
+    const QString name = QFileInfo(file.name).fileName();
+    emit add_log_message(
+        tr("[T%1] Start processing %2").arg(worker).arg(name));
+
+    IOWorker io_worker;
+    std::shared_ptr<const pfs::Frame> frame(
+        io_worker.read_hdr_frame(file.name));
+
+    if (frame) {
+        emit add_log_message(
+            tr("[T%1] Successfully load %2").arg(worker).arg(name));
+    } else {
+        emit add_log_message(
+            tr("[T%1] ERROR: Loading of %2 failed").arg(worker).arg(name));
+        emit task_failed(file.name, QString());
+    }
+    emit increment_progress_bar(1);
+
+    lock.lock();
+    if (frame) {
+        file.hdr = frame;
+        file.bytes = frameBytes(*frame);
+        m_shared_bytes += file.bytes;
+        file.state = File::LOADED;
+    } else {
+        file.state = File::FAILED;
+        ++m_failed;
+    }
+    m_cond.notify_all();
+
+    return frame;
+}
+
+std::shared_ptr<const pfs::Frame> BatchTMScheduler::acquireResized(
+    File &file, const std::shared_ptr<const pfs::Frame> &hdr, size_t width) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = file.resized.find(width);
+    while (it != file.resized.end() && !it->second) {
+        m_cond.wait(lock);
+        it = file.resized.find(width);
+    }
+    if (it != file.resized.end()) return it->second;
+
+    // a null frame marks the resize in progress
+    file.resized[width];
+    lock.unlock();
+
+    std::shared_ptr<const pfs::Frame> resized;
+    try {
+        resized.reset(pfs::resize(hdr.get(), width, BilinearInterp));
+    } catch (...) {
+        // let the workers waiting for this size try for themselves
+        lock.lock();
+        file.resized.erase(width);
+        m_cond.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    file.resized[width] = resized;
+    file.bytes += frameBytes(*resized);
+    m_shared_bytes += frameBytes(*resized);
+    m_cond.notify_all();
+
+    return resized;
+}
+
+void BatchTMScheduler::reserveWorking(size_t bytes) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // the working copies are the only bytes sure to be released: wait for
+    // them, not for the shared frames
+    while (m_memory_limit != 0 && m_working_bytes != 0 &&
+           m_shared_bytes + m_working_bytes + bytes > m_memory_limit) {
+        m_cond.wait(lock);
+    }
+    m_working_bytes += bytes;
+}
+
+void BatchTMScheduler::releaseWorking(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_working_bytes -= bytes;
+    m_cond.notify_all();
+}
+
+void BatchTMScheduler::process(int worker, const Task &task) {
+    File &file = *m_files[task.file];
+
+    std::shared_ptr<const pfs::Frame> source = acquireFrame(worker, file);
+    if (!source) {
+        emit increment_progress_bar(1);
+        return;
+    }
+
+    TonemappingOptions opts(task.output.options);
+    opts.tonemapSelection = false;  // just to be sure!
+    opts.origxsize = source->getWidth();
+    opts.xsize = (int)opts.origxsize * opts.xsize_percent / 100;
+
+    const QString &output_file_name = task.output.fileName;
+    size_t bytes = 0;
+    bool success = false;
+    QScopedPointer<pfs::Frame> working_frame;
+    try {
+        if (opts.xsize != opts.origxsize) {
+            source = acquireResized(file, source, opts.xsize);
+        }
+        bytes = frameBytes(*source);
+        reserveWorking(bytes);
+
+        working_frame.reset(pfs::copy(source.get()));
+        source.reset();
+
+        if (opts.pregamma != 1.0f) {
+            pfs::applyGamma(working_frame.data(), opts.pregamma);
+        }
+
+        TMWorker tm_worker;
+        // the output must not depend on the jobs run before
+        tm_worker.setSolverCacheEnabled(false);
+        tm_worker.tonemapFrame(working_frame.data(), &opts);
+        tm_worker.postprocessFrame(working_frame.data(), &opts);
+        success = true;
+    } catch (...) {
+        emit add_log_message(tr("[T%1] ERROR: Failed to tonemap file: %2")
+                                 .arg(worker)
+                                 .arg(QFileInfo(file.name).fileName()));
+    }
+
+    if (success) {
+        IOWorker io_worker;
+        success = io_worker.write_ldr_frame(
+            working_frame.data(), output_file_name,
+            "FromHdrFile",  // inform we tonemapped an existing HDR with no
+                            // exif data
+            QVector<float>(), &opts, task.output.params);
+
+        if (success) {
+            emit add_log_message(tr("[T%1] Successfully saved LDR file: %2")
+                                     .arg(worker)
+                                     .arg(QFileInfo(output_file_name).fileName()));
+        } else {
+            emit add_log_message(tr("[T%1] ERROR: Cannot save to file: %2")
+                                     .arg(worker)
+                                     .arg(QFileInfo(output_file_name).fileName()));
+        }
+    }
+
+    working_frame.reset();
+    releaseWorking(bytes);
+
+    if (!success) {
+        emit task_failed(file.name, output_file_name);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_failed;
+    }
+    emit increment_progress_bar(1);
+}
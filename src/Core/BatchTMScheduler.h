@@ -0,0 +1,148 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#ifndef BATCHTMSCHEDULER_H
+#define BATCHTMSCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include <Core/TonemappingOptions.h>
+#include <Libpfs/params.h>
+
+namespace pfs {
+class Frame;
+}
+
+//! \brief One LDR file to produce out of an HDR file
+struct BatchTMOutput {
+    BatchTMOutput() {}
+    BatchTMOutput(const TonemappingOptions &opts, const QString &file,
+                  const pfs::Params &p = pfs::Params())
+        : options(opts), fileName(file), params(p) {}
+
+    TonemappingOptions options;
+    //! \brief output file name, its extension selects the format
+    QString fileName;
+    //! \brief writer parameters
+    pfs::Params params;
+};
+
+//! \brief Tonemap a set of HDR files with a pool of persistent workers
+//!
+//! Every (file, output) pair is a task. The tasks of a file are queued on one
+//! worker, so they share a single decoded HDR (and its resized variants) that
+//! is released as soon as the last of them is done. Idle workers steal from
+//! the other queues, preferring files that are already decoded.
+//! Memory is bounded by the bytes of the frames in flight: a new file is only
+//! decoded while the total is under the limit, and a task waits for its
+//! working copy while other tasks can still release theirs.
+class BatchTMScheduler : public QObject {
+    Q_OBJECT
+
+   public:
+    BatchTMScheduler(QObject *parent = 0);
+    //! \brief abort the pending tasks and wait for the running ones
+    ~BatchTMScheduler();
+
+    //! \brief number of workers (at least 1)
+    void setNumThreads(int threads);
+    //! \brief bytes of frames allowed in flight, 0 means no limit
+    void setMemoryLimit(size_t bytes);
+
+    //! \brief queue \a hdrFile, tonemapped once for each entry of \a outputs
+    //! \note files must be queued before start()
+    void addFile(const QString &hdrFile, const QList<BatchTMOutput> &outputs);
+
+    //! \brief number of tasks queued so far
+    int numTasks() const;
+
+    //! \brief start the workers, returns immediately
+    void start();
+    //! \brief drop the tasks not yet started
+    void abort();
+    //! \brief block until every worker is done
+    //! \return true if no task failed
+    bool wait();
+
+    bool isRunning() const;
+    bool isAborted() const;
+    int numFailed() const;
+
+   signals:
+    void add_log_message(const QString &);
+    //! \brief one step per decoded file and one per task
+    void increment_progress_bar(int);
+    //! \brief \a outputFile could not be produced, empty if \a hdrFile could
+    //! not be loaded
+    void task_failed(const QString &hdrFile, const QString &outputFile);
+    //! \brief the last worker is about to exit
+    void finished();
+
+   private:
+    struct File;
+    struct Task {
+        size_t file;
+        BatchTMOutput output;
+    };
+
+    void run(int worker);
+    bool takeTask(int worker, Task &task);
+    void process(int worker, const Task &task);
+    std::shared_ptr<const pfs::Frame> acquireFrame(int worker, File &file);
+    std::shared_ptr<const pfs::Frame> acquireResized(
+        File &file, const std::shared_ptr<const pfs::Frame> &hdr, size_t width);
+    void reserveWorking(size_t bytes);
+    void releaseWorking(size_t bytes);
+    void taskDone(File &file);
+
+    int m_num_threads;
+    size_t m_memory_limit;
+
+    std::vector<std::unique_ptr<File>> m_files;
+    // tasks queued before start()
+    std::vector<Task> m_tasks;
+    std::vector<std::deque<Task>> m_queues;
+    std::vector<std::thread> m_threads;
+    int m_num_tasks;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_abort;
+    int m_running;
+    int m_active;
+    int m_failed;
+    // bytes of the decoded files and their resized variants
+    size_t m_shared_bytes;
+    // bytes of the working copies being tonemapped
+    size_t m_working_bytes;
+};
+
+#endif  // BATCHTMSCHEDULER_H
@@ -37,6 +37,7 @@
 #include <QString>
 
 #include <Core/IOWorker.h>
+#include <Core/PreviewCache.h>
 #include <Libpfs/frame.h>
 #include <Common/LuminanceOptions.h>
 #include <Core/TonemappingOptions.h>
@@ -51,7 +52,8 @@ using namespace pfs;
 using namespace pfs::io;
 using namespace std;
 
-IOWorker::IOWorker(QObject *parent) : QObject(parent) {}
+IOWorker::IOWorker(QObject *parent)
+    : QObject(parent), m_previewCache(false) {}
 
 IOWorker::~IOWorker() {
 #ifdef QT_DEBUG
@@ -109,6 +111,7 @@ bool IOWorker::write_hdr_frame(pfs::Frame *hdr_frame, const QString &filename,
     }
 
     if (status) {
+        if (m_previewCache) PreviewCache::store(filename, *hdr_frame);
         emit write_hdr_success(hdr_frame, filename);
     } else {
         emit write_hdr_failed(filename);
@@ -243,6 +246,13 @@ pfs::Frame *IOWorker::read_hdr_frame(const QString &filename) {
         return NULL;
     }
 
+    // shown while the full resolution frame is read
+    HdrPreviewPtr preview;
+    if (m_previewCache) {
+        preview = PreviewCache::lookup(filename);
+        if (preview) emit read_hdr_preview(preview, filename);
+    }
+
     QScopedPointer<pfs::Frame> hdrpfsframe(new pfs::Frame());
     try {
         QByteArray encodedFileName = QFile::encodeName(qfi.absoluteFilePath());
@@ -252,6 +262,10 @@ pfs::Frame *IOWorker::read_hdr_frame(const QString &filename) {
             FrameReaderFactory::open(encodedFileName.constData());
         reader->read(*hdrpfsframe, params);
         reader->close();
+
+        if (m_previewCache && !preview) {
+            PreviewCache::store(filename, *hdrpfsframe);
+        }
     } catch (pfs::io::UnsupportedFormat &exUnsupported) {
         emit read_hdr_failed(
             tr("IOWorker: file %1 has unsupported extension: %2")
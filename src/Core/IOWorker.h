@@ -39,6 +39,7 @@
 #include <QObject>
 #include <QString>
 
+#include <Core/PreviewCache.h>
 #include <Libpfs/colorspace/rgbremapper_fwd.h>
 #include <Libpfs/params.h>
 
@@ -71,6 +72,11 @@ class IOWorker : public QObject {
     IOWorker(QObject *parent = 0);
     ~IOWorker();
 
+    //! \brief keep the previews of the HDR files read and written up to
+    //! date in the PreviewCache, and emit the cached preview of a file
+    //! before reading it (off by default)
+    void setPreviewCacheEnabled(bool enabled) { m_previewCache = enabled; }
+
    public Q_SLOTS:
     pfs::Frame *read_hdr_frame(const QString &filename);
 
@@ -94,6 +100,8 @@ class IOWorker : public QObject {
    signals:
     void read_hdr_failed(const QString &);
     void read_hdr_success(pfs::Frame *, const QString &);
+    //! \brief cached preview of the file being read, if any
+    void read_hdr_preview(const HdrPreviewPtr &, const QString &);
 
     void write_hdr_failed(const QString &);
     void write_hdr_success(pfs::Frame *, const QString &);
@@ -108,6 +116,9 @@ class IOWorker : public QObject {
 
     void IO_init();
     void IO_finish();
+
+   private:
+    bool m_previewCache;
 };
 
 #endif  // IOWORKER_H
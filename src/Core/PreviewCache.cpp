@@ -0,0 +1,433 @@
+/**
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Core/PreviewCache.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <Core/IOWorker.h>
+#include <Fileformat/pfsoutldrimage.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/io/framereaderfactory.h>
+#include <Libpfs/manip/resize.h>
+
+namespace {
+const quint32 CACHE_MAGIC = 0x4c485043;  // LHPC
+const quint32 CACHE_VERSION = 1;
+
+// oldest entries are removed beyond this size
+const qint64 MAX_CACHE_BYTES = 512 * 1024 * 1024;
+
+// previews most recently used, first
+const int MEMORY_ENTRIES = 4;
+
+//! \brief what makes a cached preview valid
+struct CacheKey {
+    QString path;
+    qint64 size;
+    qint64 modified;
+
+    bool operator==(const CacheKey &other) const {
+        return path == other.path && size == other.size &&
+               modified == other.modified;
+    }
+};
+
+typedef QPair<CacheKey, HdrPreviewPtr> MemoryEntry;
+
+QMutex s_mutex;
+QList<MemoryEntry> s_memory;
+
+bool makeKey(const QString &filename, CacheKey &key) {
+    QFileInfo info(filename);
+    if (!info.isFile()) return false;
+
+    key.path = info.absoluteFilePath();
+    key.size = info.size();
+    key.modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+QString cacheFile(const CacheKey &key) {
+    const QByteArray hash = QCryptographicHash::hash(
+        key.path.toUtf8(), QCryptographicHash::Sha1);
+    return PreviewCache::cacheDir() + QLatin1Char('/') +
+           QString::fromLatin1(hash.toHex()) + QStringLiteral(".lpc");
+}
+
+HdrPreviewPtr fromMemory(const CacheKey &key) {
+    QMutexLocker lock(&s_mutex);
+    for (int i = 0; i < s_memory.size(); ++i) {
+        if (s_memory[i].first == key) {
+            s_memory.move(i, 0);
+            return s_memory.first().second;
+        }
+    }
+    return HdrPreviewPtr();
+}
+
+void toMemory(const CacheKey &key, const HdrPreviewPtr &preview) {
+    QMutexLocker lock(&s_mutex);
+    for (int i = 0; i < s_memory.size(); ++i) {
+        if (s_memory[i].first.path == key.path) {
+            s_memory.removeAt(i);
+            break;
+        }
+    }
+    s_memory.prepend(MemoryEntry(key, preview));
+    while (s_memory.size() > MEMORY_ENTRIES) s_memory.removeLast();
+}
+
+//! \brief 2x2 box filter of \a in
+QSharedPointer<pfs::Frame> halve(const pfs::Frame &in) {
+    const int w = std::max(static_cast<int>(in.getWidth() / 2), 1);
+    const int h = std::max(static_cast<int>(in.getHeight() / 2), 1);
+    const int inW = in.getWidth();
+    const int inH = in.getHeight();
+
+    QSharedPointer<pfs::Frame> out(new pfs::Frame(w, h));
+    pfs::Channel *X, *Y, *Z;
+    out->createXYZChannels(X, Y, Z);
+
+    const pfs::Channel *inX, *inY, *inZ;
+    in.getXYZChannels(inX, inY, inZ);
+
+    const pfs::Channel *src[] = {inX, inY, inZ};
+    pfs::Channel *dst[] = {X, Y, Z};
+    for (int c = 0; c < 3; ++c) {
+        const pfs::Channel &s = *src[c];
+        pfs::Channel &d = *dst[c];
+#pragma omp parallel for
+        for (int y = 0; y < h; ++y) {
+            const int y0 = std::min(2 * y, inH - 1);
+            const int y1 = std::min(2 * y + 1, inH - 1);
+            for (int x = 0; x < w; ++x) {
+                const int x0 = std::min(2 * x, inW - 1);
+                const int x1 = std::min(2 * x + 1, inW - 1);
+                d(x, y) = 0.25f * (s(x0, y0) + s(x1, y0) + s(x0, y1) +
+                                   s(x1, y1));
+            }
+        }
+    }
+    return out;
+}
+
+QSharedPointer<pfs::Frame> copyFrame(const pfs::Frame &in) {
+    QSharedPointer<pfs::Frame> out(
+        new pfs::Frame(in.getWidth(), in.getHeight()));
+    pfs::Channel *X, *Y, *Z;
+    out->createXYZChannels(X, Y, Z);
+
+    const pfs::Channel *inX, *inY, *inZ;
+    in.getXYZChannels(inX, inY, inZ);
+    std::copy(inX->begin(), inX->end(), X->begin());
+    std::copy(inY->begin(), inY->end(), Y->begin());
+    std::copy(inZ->begin(), inZ->end(), Z->begin());
+    return out;
+}
+
+// the channels of a level are stored as raw floats in the native byte order
+// of the machine that owns the cache
+void writeLevel(QDataStream &out, const pfs::Frame &level) {
+    out << qint32(level.getWidth()) << qint32(level.getHeight());
+
+    const pfs::Channel *X, *Y, *Z;
+    level.getXYZChannels(X, Y, Z);
+    const int bytes = static_cast<int>(level.size() * sizeof(float));
+    out.writeRawData(reinterpret_cast<const char *>(X->data()), bytes);
+    out.writeRawData(reinterpret_cast<const char *>(Y->data()), bytes);
+    out.writeRawData(reinterpret_cast<const char *>(Z->data()), bytes);
+}
+
+QSharedPointer<pfs::Frame> readLevel(QDataStream &in) {
+    qint32 w = 0, h = 0;
+    in >> w >> h;
+    if (in.status() != QDataStream::Ok || w <= 0 || h <= 0 ||
+        w > PreviewCache::MAX_LEVEL_SIZE || h > PreviewCache::MAX_LEVEL_SIZE) {
+        return QSharedPointer<pfs::Frame>();
+    }
+
+    QSharedPointer<pfs::Frame> level(new pfs::Frame(w, h));
+    pfs::Channel *X, *Y, *Z;
+    level->createXYZChannels(X, Y, Z);
+    const int bytes = static_cast<int>(level->size() * sizeof(float));
+    if (in.readRawData(reinterpret_cast<char *>(X->data()), bytes) != bytes ||
+        in.readRawData(reinterpret_cast<char *>(Y->data()), bytes) != bytes ||
+        in.readRawData(reinterpret_cast<char *>(Z->data()), bytes) != bytes) {
+        return QSharedPointer<pfs::Frame>();
+    }
+    return level;
+}
+
+HdrPreviewPtr readCacheFile(const QString &filename, const CacheKey &key) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return HdrPreviewPtr();
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0, version = 0;
+    CacheKey stored;
+    in >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        return HdrPreviewPtr();
+    }
+    in >> stored.path >> stored.size >> stored.modified;
+    if (!(stored == key)) return HdrPreviewPtr();
+
+    QSharedPointer<HdrPreview> preview(new HdrPreview);
+    qint32 w = 0, h = 0, levels = 0;
+    in >> w >> h >> preview->minLuminance >> preview->maxLuminance >>
+        preview->histogram >> levels;
+    if (in.status() != QDataStream::Ok || levels <= 0 ||
+        preview->histogram.size() != PreviewCache::HISTOGRAM_BINS) {
+        return HdrPreviewPtr();
+    }
+    preview->width = w;
+    preview->height = h;
+    for (int l = 0; l < levels; ++l) {
+        QSharedPointer<pfs::Frame> level = readLevel(in);
+        if (!level) return HdrPreviewPtr();
+        preview->levels.append(level);
+    }
+    return preview;
+}
+
+void writeCacheFile(const QString &filename, const CacheKey &key,
+                    const HdrPreview &preview) {
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << CACHE_MAGIC << CACHE_VERSION;
+    out << key.path << key.size << key.modified;
+    out << qint32(preview.width) << qint32(preview.height)
+        << preview.minLuminance << preview.maxLuminance << preview.histogram
+        << qint32(preview.levels.size());
+    foreach (const QSharedPointer<pfs::Frame> &level, preview.levels) {
+        writeLevel(out, *level);
+    }
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+#ifdef QT_DEBUG
+        qDebug() << "PreviewCache: cannot write" << filename;
+#endif
+    }
+}
+
+//! \brief remove the least recently written entries beyond MAX_CACHE_BYTES
+void prune(const QString &dir) {
+    QFileInfoList entries =
+        QDir(dir).entryInfoList(QStringList(QStringLiteral("*.lpc")),
+                                QDir::Files, QDir::Time);
+    qint64 total = 0;
+    foreach (const QFileInfo &entry, entries) {
+        total += entry.size();
+        if (total > MAX_CACHE_BYTES) QFile::remove(entry.absoluteFilePath());
+    }
+}
+
+void save(const QString &dir, const QString &filename, const CacheKey &key,
+          const HdrPreviewPtr &preview) {
+    if (!QDir().mkpath(dir)) return;
+    writeCacheFile(filename, key, *preview);
+    prune(dir);
+}
+
+//! \brief writes one file at a time, so that pruning sees whole files; its
+//! destruction at exit waits for the pending ones
+struct WriterPool : public QThreadPool {
+    WriterPool() { setMaxThreadCount(1); }
+};
+
+WriterPool s_writerPool;
+}  // anonymous namespace
+
+const pfs::Frame *HdrPreview::level(int size) const {
+    const pfs::Frame *best = NULL;
+    foreach (const QSharedPointer<pfs::Frame> &l, levels) {
+        if (best != NULL &&
+            std::max(l->getWidth(), l->getHeight()) < size) {
+            break;
+        }
+        best = l.data();
+    }
+    return best;
+}
+
+bool HdrPreview::matches(const pfs::Frame &frame) const {
+    return frame.getWidth() == static_cast<size_t>(width) &&
+           frame.getHeight() == static_cast<size_t>(height);
+}
+
+HdrPreviewPtr PreviewCache::build(const pfs::Frame &frame) {
+    QSharedPointer<HdrPreview> preview(new HdrPreview);
+    preview->width = frame.getWidth();
+    preview->height = frame.getHeight();
+    preview->minLuminance = 0.f;
+    preview->maxLuminance = 0.f;
+    preview->histogram.fill(0.f, HISTOGRAM_BINS);
+
+    const pfs::Channel *X, *Y, *Z;
+    frame.getXYZChannels(X, Y, Z);
+    if (Y == NULL || frame.size() == 0) return HdrPreviewPtr();
+
+    // the range of the full resolution image, and its histogram from about
+    // a million samples
+    float minY = (*Y)(0);
+    float maxY = (*Y)(0);
+    for (size_t i = 0; i < frame.size(); ++i) {
+        minY = std::min(minY, (*Y)(i));
+        maxY = std::max(maxY, (*Y)(i));
+    }
+
+    QVector<float> &histogram = preview->histogram;
+    const float binScale =
+        HISTOGRAM_BINS / static_cast<float>(HISTOGRAM_MAX - HISTOGRAM_MIN);
+    const size_t step = std::max<size_t>(frame.size() >> 20, 1);
+    float count = 0.f;
+    for (size_t i = 0; i < frame.size(); i += step) {
+        const float v = (*Y)(i);
+        if (v <= 0.f) continue;
+        const int bin =
+            static_cast<int>((std::log10(v) - HISTOGRAM_MIN) * binScale);
+        if (bin < 0 || bin > HISTOGRAM_BINS) continue;
+        histogram[std::min(bin, HISTOGRAM_BINS - 1)] += 1.f;
+        count += 1.f;
+    }
+    if (count > 0.f) {
+        for (int i = 0; i < HISTOGRAM_BINS; ++i) histogram[i] /= count;
+    }
+    preview->minLuminance = minY;
+    preview->maxLuminance = maxY;
+
+    // halve until the image fits MAX_LEVEL_SIZE, then keep every level
+    QSharedPointer<pfs::Frame> level;
+    const pfs::Frame *current = &frame;
+    while (std::max(current->getWidth(), current->getHeight()) >
+           static_cast<size_t>(MAX_LEVEL_SIZE)) {
+        level = halve(*current);
+        current = level.data();
+    }
+    preview->levels.append(level ? level : copyFrame(frame));
+    while (std::max(current->getWidth(), current->getHeight()) >=
+           static_cast<size_t>(2 * MIN_LEVEL_SIZE)) {
+        level = halve(*current);
+        current = level.data();
+        preview->levels.append(level);
+    }
+    return preview;
+}
+
+HdrPreviewPtr PreviewCache::lookup(const QString &filename) {
+    CacheKey key;
+    if (!makeKey(filename, key)) return HdrPreviewPtr();
+
+    HdrPreviewPtr preview = fromMemory(key);
+    if (preview) return preview;
+
+    preview = readCacheFile(cacheFile(key), key);
+    if (preview) toMemory(key, preview);
+    return preview;
+}
+
+HdrPreviewPtr PreviewCache::store(const QString &filename,
+                                  const pfs::Frame &frame) {
+    CacheKey key;
+    if (!makeKey(filename, key)) return HdrPreviewPtr();
+
+    HdrPreviewPtr preview = build(frame);
+    if (!preview) return preview;
+    toMemory(key, preview);
+
+    QtConcurrent::run(&s_writerPool, save, cacheDir(), cacheFile(key), key,
+                      preview);
+    return preview;
+}
+
+HdrPreviewPtr PreviewCache::load(const QString &filename) {
+    HdrPreviewPtr preview = lookup(filename);
+    if (preview) return preview;
+
+    try {
+        QByteArray encodedFileName =
+            QFile::encodeName(QFileInfo(filename).absoluteFilePath());
+        pfs::Frame frame;
+        pfs::io::FrameReaderPtr reader =
+            pfs::io::FrameReaderFactory::open(encodedFileName.constData());
+        reader->read(frame, getRawSettings());
+        reader->close();
+        return store(filename, frame);
+    } catch (...) {
+#ifdef QT_DEBUG
+        qDebug() << "PreviewCache: cannot read" << filename;
+#endif
+    }
+    return HdrPreviewPtr();
+}
+
+QImage PreviewCache::thumbnail(const HdrPreview &preview, int size) {
+    const pfs::Frame *level = preview.level(size);
+    if (level == NULL) return QImage();
+
+    QScopedPointer<pfs::Frame> resized;
+    if (std::max(level->getWidth(), level->getHeight()) >
+        static_cast<size_t>(size)) {
+        int width = size;
+        if (level->getHeight() > level->getWidth()) {
+            width = size * level->getWidth() / level->getHeight();
+        }
+        resized.reset(pfs::resize(level, std::max(width, 1), BilinearInterp));
+        level = resized.data();
+    }
+
+    QScopedPointer<QImage> image(fromLDRPFStoQImage(
+        const_cast<pfs::Frame *>(level),
+        std::max(preview.minLuminance, 0.000001f), preview.maxLuminance,
+        MAP_GAMMA2_2));
+    return *image;
+}
+
+QString PreviewCache::cacheDir() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           QStringLiteral("/previews");
+}
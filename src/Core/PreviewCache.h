@@ -0,0 +1,104 @@
+/**
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief On-disk cache of reduced resolution copies of HDR files, so that
+//! viewers, previews and thumbnails do not need to decode the whole file
+
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <QImage>
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+namespace pfs {
+class Frame;
+}
+
+//! \brief Reduced resolution copy of an HDR image
+struct HdrPreview {
+    //! \brief size of the full resolution image
+    int width;
+    int height;
+
+    //! \brief box filtered levels, largest first, each one half the size of
+    //! the previous one
+    QVector<QSharedPointer<pfs::Frame>> levels;
+
+    //! \brief extrema of the Y channel at full resolution
+    float minLuminance;
+    float maxLuminance;
+
+    //! \brief distribution of log10(Y) over [HISTOGRAM_MIN, HISTOGRAM_MAX],
+    //! the scale of LuminanceRangeWidget
+    QVector<float> histogram;
+
+    //! \brief smallest level whose longer side is at least \a size, or the
+    //! largest level
+    const pfs::Frame *level(int size) const;
+
+    //! \brief true if this is a preview of an image of the size of \a frame
+    bool matches(const pfs::Frame &frame) const;
+};
+
+typedef QSharedPointer<const HdrPreview> HdrPreviewPtr;
+Q_DECLARE_METATYPE(HdrPreviewPtr)
+
+class PreviewCache {
+   public:
+    static const int MAX_LEVEL_SIZE = 1024;
+    static const int MIN_LEVEL_SIZE = 32;
+    static const int HISTOGRAM_BINS = 512;
+    static const int HISTOGRAM_MIN = -6;
+    static const int HISTOGRAM_MAX = 8;
+
+    //! \brief compute the preview of \a frame
+    static HdrPreviewPtr build(const pfs::Frame &frame);
+
+    //! \brief cached preview of \a filename
+    //! \return null if there is none, or if the file changed since
+    static HdrPreviewPtr lookup(const QString &filename);
+
+    //! \brief compute the preview of \a frame, just read from or written to
+    //! \a filename, and save it in the cache: the preview is available at
+    //! once, its file is written in the background
+    static HdrPreviewPtr store(const QString &filename,
+                               const pfs::Frame &frame);
+
+    //! \brief cached preview of \a filename, which is read (and its preview
+    //! stored) if needed
+    //! \return null if \a filename cannot be read
+    static HdrPreviewPtr load(const QString &filename);
+
+    //! \brief 8 bit rendering of \a preview, whose longer side is at most
+    //! \a size, as shown by the HDR viewer with its default settings
+    static QImage thumbnail(const HdrPreview &preview, int size);
+
+    //! \brief folder of the cache
+    static QString cacheDir();
+
+   private:
+    PreviewCache();
+};
+
+#endif  // PREVIEWCACHE_H
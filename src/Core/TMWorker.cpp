@@ -40,11 +40,12 @@
 #include <Libpfs/manip/saturation.h>
 #include <Libpfs/params.h>
 #include <Libpfs/tm/TonemapOperator.h>
+#include <Libpfs/utils/solvercache.h>
 #include <Common/ProgressHelper.h>
 #include <Core/TonemappingOptions.h>
 
 TMWorker::TMWorker(QObject *parent)
-    : QObject(parent), m_Callback(new ProgressHelper) {
+    : QObject(parent), m_Callback(new ProgressHelper), m_solverCache(false) {
 #ifdef QT_DEBUG
     qDebug() << "TMWorker::TMWorker() ctor";
 #endif
@@ -168,6 +169,7 @@ void TMWorker::tonemapFrame(pfs::Frame *working_frame,
         TonemapOperator::getTonemapOperator(tm_options->tmoperator);
 
     // build object, pass new frame to it and collect the result
+    pfs::utils::SolverCache::ScopedEnable solverCache(m_solverCache);
     tmEngine->tonemapFrame(*working_frame, tm_options, *m_Callback);
 
     emit tonemapEnd();
@@ -47,6 +47,10 @@ class TMWorker : public QObject {
     TMWorker(QObject *parent = 0);
     ~TMWorker();
 
+    //! \brief let the operators restart from their last run on the same
+    //! frame (off by default, results then depend on the previous runs)
+    void setSolverCacheEnabled(bool enabled) { m_solverCache = enabled; }
+
    public Q_SLOTS:
     //!
     //!  This function creates a copy of the input frame, tonemap the copy
@@ -66,10 +70,14 @@ class TMWorker : public QObject {
     //!
     void tonemapFrame(pfs::Frame *, TonemappingOptions *);
 
+    //!
+    //! This function applies post-saturation and post-gamma
+    //!
+    void postprocessFrame(pfs::Frame *, TonemappingOptions *);
+
    private:
     pfs::Frame *preprocessFrame(pfs::Frame *, TonemappingOptions *,
                                 InterpolationMethod m);
-    void postprocessFrame(pfs::Frame *, TonemappingOptions *);
 
    Q_SIGNALS:
     void tonemapSuccess(pfs::Frame *, TonemappingOptions *);
@@ -84,6 +92,7 @@ class TMWorker : public QObject {
 
    private:
     ProgressHelper *m_Callback;
+    bool m_solverCache;
 };
 
 #endif  // TMWORKER_H
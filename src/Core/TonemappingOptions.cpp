@@ -47,6 +47,7 @@ void TonemappingOptions::setDefaultTonemapParameters() {
     operator_options.mantiuk06options.detailfactor = MANTIUK06_DETAIL_FACTOR;
     operator_options.mantiuk06options.contrastequalization =
         MANTIUK06_CONTRAST_EQUALIZATION;
+    operator_options.mantiuk06options.multigrid = MANTIUK06_MULTIGRID;
 
     // Mantiuk08
     operator_options.mantiuk08options.colorsaturation =
@@ -640,6 +641,9 @@ TonemappingOptions *TMOptionsOperations::parseFile(const QString &fname) {
         } else if (field == QLatin1String("CONTRASTEQUALIZATION")) {
             toreturn->operator_options.mantiuk06options.contrastequalization =
                 (value == QLatin1String("YES"));
+        } else if (field == QLatin1String("MULTIGRID")) {
+            toreturn->operator_options.mantiuk06options.multigrid =
+                (value == QLatin1String("YES"));
         } else if (field == QLatin1String("COLORSATURATION")) {
             toreturn->operator_options.mantiuk08options.colorsaturation =
                 value.toFloat();
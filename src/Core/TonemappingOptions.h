@@ -118,6 +118,7 @@ class TonemappingOptions {
             float saturationfactor;
             float detailfactor;
             bool contrastequalization;
+            bool multigrid;
         } mantiuk06options;
         struct {
             float colorsaturation;
@@ -44,7 +44,7 @@
 #include <Libpfs/colorspace/rgbremapper.h>
 #include <Libpfs/exception.h>
 #include <Libpfs/frame.h>
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 using namespace std;
@@ -65,10 +65,9 @@ void QRgbRemapper::operator()(float r, float g, float b, QRgb &qrgb) const {
 
 QImage *fromLDRPFStoQImage(pfs::Frame *in_frame, float min_luminance,
                            float max_luminance, RGBMappingType mapping_method) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "fromLDRPFStoQImage",
+        in_frame->size() * in_frame->getChannels().size() * sizeof(float));
 
     qDebug() << "Min Luminance: " << min_luminance;
     qDebug() << "Max Luminance: " << max_luminance;
@@ -87,11 +86,5 @@ QImage *fromLDRPFStoQImage(pfs::Frame *in_frame, float min_luminance,
     utils::transform(Xc->begin(), Xc->end(), Yc->begin(), Zc->begin(),
                      reinterpret_cast<QRgb *>(temp_qimage->bits()), remapper);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "fromLDRPFStoQImage() = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
-
     return temp_qimage;
 }
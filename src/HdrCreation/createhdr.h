@@ -36,6 +36,11 @@ struct FusionOperatorConfig {
     libhdr::fusion::FusionOperator fusionOperator;
     QString inputResponseCurveFilename;
     QString outputResponseCurveFilename;
+    //! \brief pixels used to estimate the response with robertson-auto,
+    //! 0 for all of them
+    size_t responseSamples;
+    //! \brief seed of the positions of the samples
+    unsigned int responseSeed;
 };
 
 #endif
@@ -28,7 +28,7 @@
 
 #include "HdrCreation/debevec.h"
 #include <Libpfs/colorspace/normalizer.h>
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/numeric.h>
 
 #include <QtGlobal>
@@ -63,201 +63,192 @@ using namespace boost::math;
 namespace libhdr {
 namespace fusion {
 
+namespace {
+// pixels merged at once: the per block buffers stay in the L1 cache
+const size_t BLOCK_SIZE = 1024;
+
+// sum[c] += (log(response[c]) + cadd) * w, wsum += w
+void accumulate(float *const response[3], const float *w, float cadd,
+                float *const sum[3], float *wsum, size_t size) {
+    for (int c = 0; c < 3; c++) {
+        size_t k = 0;
+#ifdef __SSE2__
+        vfloat caddv = F2V(cadd);
+        for (; k + 3 < size; k += 4) {
+            STVFU(sum[c][k], LVFU(sum[c][k]) +
+                                 (xlogf(LVFU(response[c][k])) + caddv) *
+                                     LVFU(w[k]));
+        }
+#endif
+        for (; k < size; k++) {
+            sum[c][k] += (xlogf(response[c][k]) + cadd) * w[k];
+        }
+    }
+    vadd(wsum, w, wsum, size);
+}
+}
+
 void DebevecOperator::computeFusion(ResponseCurve &response,
                                     WeightFunction &weight,
                                     const vector<FrameEnhanced> &images,
                                     pfs::Frame &frame) {
 
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span("MergeDebevec");
     assert(images.size() != 0);
 
-    vector<float> times;
-
     const size_t W = images[0].frame()->getWidth();
     const size_t H = images[0].frame()->getHeight();
 
-    for (size_t idx = 0; idx < images.size(); ++idx) {
-        times.push_back(images[idx].averageLuminance());
-    }
-
     const int channels = 3;
+    const int length = images.size();
     const size_t size = W * H;
+    trace_span.setBytes(length * channels * size * sizeof(float));
 
-    vector<float> exp_values(times);
-
-    transform(exp_values.begin(), exp_values.end(), exp_values.begin(), logf);
-
-    frame.resize(W, H);
-    Channel *Ch[3];
-    frame.createXYZChannels(Ch[0], Ch[1], Ch[2]);
-    Array2Df *resultCh[channels] = {Ch[0], Ch[1], Ch[2]};
-
-#ifdef _OPENMP
-    #pragma omp parallel for
-#endif
-    for (int c = 0; c < channels; c++) {
-        resultCh[c]->fill(0.f);
-    }
-    Array2Df weight_sum(W, H);
-    weight_sum.fill(0.f);
-
-    int length = images.size();
-
-#ifdef _OPENMP
-    int numthreads = omp_get_max_threads();
-    int nestedthreads = std::max(numthreads / length, 1);
-    bool oldNested = omp_get_nested();
-    if(nestedthreads > 1) {
-        omp_set_nested(true);
-    }
-    #pragma omp parallel for
-#endif
+    // the exposures are read in place, never normalized into temporaries
+    vector<const float *> input(length * channels);
     for (int i = 0; i < length; i++) {
         Channel *Ch[channels];
         images[i].frame()->getXYZChannels(Ch[0], Ch[1], Ch[2]);
-        Array2Df *imagesCh[channels] = {Ch[0], Ch[1], Ch[2]};
-
-        float cmax[3];
-        float cmin[3];
-#ifdef _OPENMP
-        #pragma omp parallel for num_threads(nestedthreads) if (nestedthreads>1)
-#endif
         for (int c = 0; c < channels; c++) {
-            float minval = numeric_limits<float>::max();
-            float maxval = numeric_limits<float>::min();
-            for (size_t k = 0; k < size; k++) {
-                minval = std::min(minval, (*imagesCh[c])(k));
-                maxval = std::max(maxval, (*imagesCh[c])(k));
-            }
-            cmax[c] = maxval;
-            cmin[c] = minval;
+            input[i * channels + c] = Ch[c]->data();
         }
+    }
 
-        float Max = max(cmax[0], max(cmax[1], cmax[2]));
-        float Min = min(cmin[0], min(cmin[1], cmin[2]));
+    const long numBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
+    // range of every exposure, over its three channels
+    vector<float> cmin(length, numeric_limits<float>::max());
+    vector<float> cmax(length, numeric_limits<float>::min());
 #ifdef _OPENMP
-        #pragma omp parallel for num_threads(nestedthreads) if (nestedthreads>1)
+    #pragma omp parallel
 #endif
-        for (int c = 0; c < channels; c++) {
-            transform(Ch[c]->begin(), Ch[c]->end(), Ch[c]->begin(),
-                      Normalizer(Min, Max));
-        }
-
-        Array2Df response_img(W, H);
-        Array2Df w(W, H);
-
-        float cmul = 1.f / channels;
+    {
+        vector<float> tmin(cmin);
+        vector<float> tmax(cmax);
 #ifdef _OPENMP
-        #pragma omp parallel for num_threads(nestedthreads) if (nestedthreads>1)
-#endif
-        for (size_t k = 0; k < size; k++) {
-            w(k) = cmul * (weight((*imagesCh[0])(k)) + weight((*imagesCh[1])(k)) + weight((*imagesCh[2])(k)));
-        }
-        float cadd = -logf(times.at((int)i));
-        for (int c = 0; c < channels; c++) {
-            #pragma omp parallel for num_threads(nestedthreads) if (nestedthreads>1)
-            for (size_t k = 0; k < size; k++) {
-                (response_img)(k) = response((*imagesCh[c])(k));
+        #pragma omp for schedule(static) nowait
+#endif
+        for (long b = 0; b < numBlocks; b++) {
+            const size_t begin = b * BLOCK_SIZE;
+            const size_t end = std::min(begin + BLOCK_SIZE, size);
+            for (int i = 0; i < length * channels; i++) {
+                const float *in = input[i];
+                float minval = tmin[i / channels];
+                float maxval = tmax[i / channels];
+                for (size_t k = begin; k < end; k++) {
+                    minval = std::min(minval, in[k]);
+                    maxval = std::max(maxval, in[k]);
+                }
+                tmin[i / channels] = minval;
+                tmax[i / channels] = maxval;
             }
-#ifdef __SSE2__
-            vfloat caddv = F2V(cadd);
-#ifdef _OPENMP
-            #pragma omp parallel for num_threads(nestedthreads) if (nestedthreads>1)
-#endif
-            for (size_t k = 0; k < size - 3; k+=4) {
-                STVFU((response_img)(k), (xlogf(LVFU((response_img)(k))) + caddv) * LVFU(w(k)));
-            }
-            for (size_t k = size - (size % 4); k < size; k++) {
-                (response_img)(k) = (xlogf((response_img)(k)) + cadd) * w(k);
-            }
-#else
-#ifdef _OPENMP
-            #pragma omp parallel for num_threads(nestedthreads) if (nestedthreads>1)
-#endif
-            for (size_t k = 0; k < size; k++) {
-                (response_img)(k) = (xlogf((response_img)(k)) + cadd) * w(k);
-            }
-#endif
-
-#ifdef _OPENMP
-            #pragma omp critical
-#endif
-            vadd(resultCh[c]->data(), response_img.data(), resultCh[c]->data(), size);
         }
-
 #ifdef _OPENMP
         #pragma omp critical
 #endif
-        vadd(weight_sum.data(), w.data(), weight_sum.data(), size);
+        for (int i = 0; i < length; i++) {
+            cmin[i] = std::min(cmin[i], tmin[i]);
+            cmax[i] = std::max(cmax[i], tmax[i]);
+        }
     }
-#ifdef _OPENMP
-    omp_set_nested(oldNested);
-#endif
 
-    for (int c = 0; c < channels; c++) {
-#ifdef _OPENMP
-        #pragma omp parallel for
-#endif
-        for(size_t y = 0; y < H; ++y) {
-            size_t x = 0;
-#ifdef __SSE2__
-            for(; x < W - 3; x += 4) {
-                STVFU((*resultCh[c])(x, y), xexpf(LVFU((*resultCh[c])(x,y)) / LVFU(weight_sum(x,y))));
-            }
-#endif
-            for(; x < W; ++x) {
-                (*resultCh[c])(x, y) = xexpf((*resultCh[c])(x,y) / weight_sum(x,y));
-            }
-        }
+    vector<Normalizer> normalizers;
+    vector<float> cadd;
+    for (int i = 0; i < length; i++) {
+        normalizers.push_back(Normalizer(cmin[i], cmax[i]));
+        cadd.push_back(-logf(images[i].averageLuminance()));
     }
-    float cmax[3];
-    for (int c = 0; c < channels; c++) {
-        float max = numeric_limits<float>::min();
+
+    frame.resize(W, H);
+    Channel *Ch[channels];
+    frame.createXYZChannels(Ch[0], Ch[1], Ch[2]);
+    float *result[channels] = {Ch[0]->data(), Ch[1]->data(), Ch[2]->data()};
+
+    const float cmul = 1.f / channels;
+    float Max = numeric_limits<float>::min();
+    bool invalid = false;
 #ifdef _OPENMP
-    #pragma omp parallel for reduction(max:max)
+    #pragma omp parallel
 #endif
-        for (size_t k = 0; k < size; k++) {
-            float val = (*resultCh[c])(k);
-            if(std::isnormal(val)) {
-                max = std::max(max, val);
-            }
+    {
+        // response and sum of each channel, weight and sum of the weights
+        vector<float> buffer(BLOCK_SIZE * (2 * channels + 2));
+        float *resp[channels];
+        float *sum[channels];
+        for (int c = 0; c < channels; c++) {
+            resp[c] = &buffer[c * BLOCK_SIZE];
+            sum[c] = &buffer[(channels + c) * BLOCK_SIZE];
         }
-        cmax[c] = max;
-    }
+        float *w = &buffer[2 * channels * BLOCK_SIZE];
+        float *wsum = w + BLOCK_SIZE;
 
-    float Max = max(cmax[0], max(cmax[1], cmax[2]));
-
-    for (int c = 0; c < channels; c++) {
 #ifdef _OPENMP
-    #pragma omp parallel for
-#endif
-        for (size_t k = 0; k < size; k++) {
-            float val = (*resultCh[c])(k);
-            if(!std::isnormal(val)) {
-                (*resultCh[c])(k) = Max;
+        #pragma omp for schedule(dynamic, 16) reduction(max : Max) reduction(|| : invalid)
+#endif
+        for (long b = 0; b < numBlocks; b++) {
+            const size_t begin = b * BLOCK_SIZE;
+            const size_t n = std::min(BLOCK_SIZE, size - begin);
+            std::fill(buffer.begin() + channels * BLOCK_SIZE, buffer.end(),
+                      0.f);
+
+            for (int i = 0; i < length; i++) {
+                const Normalizer &normalize = normalizers[i];
+                const float *in[channels] = {input[i * channels] + begin,
+                                             input[i * channels + 1] + begin,
+                                             input[i * channels + 2] + begin};
+                for (size_t k = 0; k < n; k++) {
+                    const float v0 = normalize(in[0][k]);
+                    const float v1 = normalize(in[1][k]);
+                    const float v2 = normalize(in[2][k]);
+                    w[k] = cmul * (weight(v0) + weight(v1) + weight(v2));
+                    resp[0][k] = response(v0);
+                    resp[1][k] = response(v1);
+                    resp[2][k] = response(v2);
+                }
+                accumulate(resp, w, cadd[i], sum, wsum, n);
+            }
+
+            for (int c = 0; c < channels; c++) {
+                size_t k = 0;
+#ifdef __SSE2__
+                for (; k + 3 < n; k += 4) {
+                    STVFU(sum[c][k], xexpf(LVFU(sum[c][k]) / LVFU(wsum[k])));
+                }
+#endif
+                for (; k < n; k++) {
+                    sum[c][k] = xexpf(sum[c][k] / wsum[k]);
+                }
+
+                // TODO: Investigate why scaling hdr yields better result
+                float *out = result[c] + begin;
+                for (k = 0; k < n; k++) {
+                    const float val = sum[c][k];
+                    if (std::isnormal(val)) {
+                        Max = std::max(Max, val);
+                        out[k] = val * 0.1f;
+                    } else {
+                        // marked, fixed once the maximum is known
+                        out[k] = numeric_limits<float>::quiet_NaN();
+                        invalid = true;
+                    }
+                }
             }
         }
     }
 
-    // TODO: Investigate why scaling hdr yields better result
-    for (int c = 0; c < channels; c++) {
+    // pixels with no valid exposure get the brightest value
+    if (invalid) {
+        for (int c = 0; c < channels; c++) {
 #ifdef _OPENMP
-    #pragma omp parallel for
+            #pragma omp parallel for
 #endif
-        for (size_t k = 0; k < size; k++) {
-            (*resultCh[c])(k) *= 0.1f;
+            for (size_t k = 0; k < size; k++) {
+                if (std::isnan(result[c][k])) {
+                    result[c][k] = Max * 0.1f;
+                }
+            }
         }
     }
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    cout << "MergeDebevec = " << f_timer.get_time() << " msec"
-              << endl;
-#endif
 }
 
 }  // libhdr
@@ -0,0 +1,906 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include "feature_alignment.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <Libpfs/array2d.h>
+#include <Libpfs/colorspace/xyz.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/utils/trace.h>
+#include <Libpfs/utils/transform.h>
+
+using namespace std;
+using namespace pfs;
+
+#ifndef NDEBUG
+#define PRINT_DEBUG(str) std::cerr << "FeatureAlignment: " << str << std::endl
+#else
+#define PRINT_DEBUG(str)
+#endif
+
+typedef Array2D<float> Array2Df;
+
+namespace libhdr {
+
+namespace {
+// the corners are detected on the first level not larger than this
+const size_t DETECTION_SIZE = 1200;
+// side of the cells of the grid that spreads the corners over the image
+const int CELL_SIZE = 32;
+const size_t CORNERS_PER_CELL = 4;
+// half side of the descriptor patch
+const int PATCH_RADIUS = 15;
+const int DESCRIPTOR_BITS = 256;
+// half side of the patches tracked during the refinement, and search radius
+const int TRACK_RADIUS = 7;
+const int SEARCH_RADIUS = 3;
+const size_t MIN_INLIERS = 12;
+const int RANSAC_ITERATIONS = 2000;
+
+//! \brief 3x3 projective transform, row major
+struct Homography {
+    Homography() {
+        for (int i = 0; i < 9; i++) m[i] = (i % 4 == 0) ? 1.0 : 0.0;
+    }
+
+    void apply(double x, double y, double &u, double &v) const {
+        const double w = m[6] * x + m[7] * y + m[8];
+        u = (m[0] * x + m[1] * y + m[2]) / w;
+        v = (m[3] * x + m[4] * y + m[5]) / w;
+    }
+
+    //! \brief transform that applies \a other first, then this one
+    Homography operator*(const Homography &other) const {
+        Homography r;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                double s = 0.0;
+                for (int k = 0; k < 3; k++) {
+                    s += m[i * 3 + k] * other.m[k * 3 + j];
+                }
+                r.m[i * 3 + j] = s;
+            }
+        }
+        r.normalize();
+        return r;
+    }
+
+    Homography inverse() const {
+        Homography r;
+        r.m[0] = m[4] * m[8] - m[5] * m[7];
+        r.m[1] = m[2] * m[7] - m[1] * m[8];
+        r.m[2] = m[1] * m[5] - m[2] * m[4];
+        r.m[3] = m[5] * m[6] - m[3] * m[8];
+        r.m[4] = m[0] * m[8] - m[2] * m[6];
+        r.m[5] = m[2] * m[3] - m[0] * m[5];
+        r.m[6] = m[3] * m[7] - m[4] * m[6];
+        r.m[7] = m[1] * m[6] - m[0] * m[7];
+        r.m[8] = m[0] * m[4] - m[1] * m[3];
+        r.normalize();
+        return r;
+    }
+
+    bool isIdentity() const {
+        const Homography i;
+        for (int k = 0; k < 9; k++) {
+            if (std::fabs(m[k] - i.m[k]) > 1e-12) return false;
+        }
+        return true;
+    }
+
+    void normalize() {
+        if (m[8] != 0.0) {
+            const double s = 1.0 / m[8];
+            for (int i = 0; i < 9; i++) m[i] *= s;
+        }
+    }
+
+    double m[9];
+};
+
+// the same transform on the level below: a pixel x of a level covers the
+// pixels 2x and 2x + 1 of the one below
+Homography upscale(const Homography &h) {
+    Homography s;
+    s.m[0] = 2.0;
+    s.m[2] = 0.5;
+    s.m[4] = 2.0;
+    s.m[5] = 0.5;
+    return s * h * s.inverse();
+}
+
+struct Point {
+    Point(double x_ = 0.0, double y_ = 0.0) : x(x_), y(y_) {}
+    double x;
+    double y;
+};
+
+struct Match {
+    Match(const Point &p1, const Point &p2) : ref(p1), other(p2) {}
+    Point ref;
+    Point other;
+};
+
+struct Keypoint {
+    float x;
+    float y;
+    uint64_t descriptor[DESCRIPTOR_BITS / 64];
+};
+
+struct FrameFeatures {
+    //! \brief log luminance, full resolution first
+    std::vector<Array2Df> pyramid;
+    //! \brief corners, in the coordinates of pyramid[detectionLevel]
+    std::vector<Keypoint> keypoints;
+};
+
+inline int popcount(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(v);
+#else
+    return static_cast<int>(std::bitset<64>(v).count());
+#endif
+}
+
+inline int hamming(const Keypoint &a, const Keypoint &b) {
+    int d = 0;
+    for (int i = 0; i < DESCRIPTOR_BITS / 64; i++) {
+        d += popcount(a.descriptor[i] ^ b.descriptor[i]);
+    }
+    return d;
+}
+
+// the log makes a change of exposure an offset, that the corner response,
+// the descriptors and the NCC are all blind to
+void logLuminance(const Frame &in, Array2Df &out) {
+    const Channel *R;
+    const Channel *G;
+    const Channel *B;
+    in.getXYZChannels(R, G, B);
+
+    Array2Df lum(in.getWidth(), in.getHeight());
+    utils::transform(R->begin(), R->end(), G->begin(), B->begin(),
+                     lum.begin(), colorspace::ConvertRGB2Y());
+
+    double sum = 0.0;
+    for (Array2Df::const_iterator it = lum.begin(); it != lum.end(); ++it) {
+        sum += std::max(*it, 0.f);
+    }
+    // keeps the noise of the shadows from dominating
+    const float eps =
+        std::max(static_cast<float>(0.01 * sum / lum.size()), 1e-6f);
+
+    const int size = lum.size();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < size; i++) {
+        lum(i) = std::log(std::max(lum(i), 0.f) + eps);
+    }
+    out.swap(lum);
+}
+
+void downsample(const Array2Df &in, Array2Df &out) {
+    const int width = in.getCols() / 2;
+    const int height = in.getRows() / 2;
+    Array2Df small(width, height);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int y = 0; y < height; y++) {
+        const float *r0 = in.data() + (2 * y) * in.getCols();
+        const float *r1 = r0 + in.getCols();
+        float *o = small.data() + y * width;
+        for (int x = 0; x < width; x++) {
+            o[x] = 0.25f * (r0[2 * x] + r0[2 * x + 1] + r1[2 * x] +
+                            r1[2 * x + 1]);
+        }
+    }
+    out.swap(small);
+}
+
+// separable [1 4 6 4 1] / 16, the borders are clamped
+void blur(const Array2Df &in, Array2Df &out) {
+    const int width = in.getCols();
+    const int height = in.getRows();
+    Array2Df tmp(width, height);
+    Array2Df result(width, height);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int y = 0; y < height; y++) {
+        const float *r = in.data() + y * width;
+        float *o = tmp.data() + y * width;
+        for (int x = 0; x < width; x++) {
+            const float a = r[std::max(x - 2, 0)];
+            const float b = r[std::max(x - 1, 0)];
+            const float d = r[std::min(x + 1, width - 1)];
+            const float e = r[std::min(x + 2, width - 1)];
+            o[x] = (a + e + 4.f * (b + d) + 6.f * r[x]) * (1.f / 16.f);
+        }
+    }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int y = 0; y < height; y++) {
+        const float *a = tmp.data() + std::max(y - 2, 0) * width;
+        const float *b = tmp.data() + std::max(y - 1, 0) * width;
+        const float *c = tmp.data() + y * width;
+        const float *d = tmp.data() + std::min(y + 1, height - 1) * width;
+        const float *e = tmp.data() + std::min(y + 2, height - 1) * width;
+        float *o = result.data() + y * width;
+        for (int x = 0; x < width; x++) {
+            o[x] = (a[x] + e[x] + 4.f * (b[x] + d[x]) + 6.f * c[x]) *
+                   (1.f / 16.f);
+        }
+    }
+    out.swap(result);
+}
+
+struct BriefPair {
+    int x1, y1, x2, y2;
+};
+
+// smoothed BRIEF: the same random pairs of the patch for every keypoint
+const std::vector<BriefPair> &briefPattern() {
+    static const std::vector<BriefPair> pattern = [] {
+        std::mt19937 rng(0x5eed);
+        std::normal_distribution<float> dist(0.f, PATCH_RADIUS / 2.5f);
+        std::vector<BriefPair> p(DESCRIPTOR_BITS);
+        for (size_t i = 0; i < p.size(); i++) {
+            int *c[4] = {&p[i].x1, &p[i].y1, &p[i].x2, &p[i].y2};
+            for (int k = 0; k < 4; k++) {
+                const int v = static_cast<int>(std::floor(dist(rng) + 0.5f));
+                *c[k] = std::max(-PATCH_RADIUS, std::min(PATCH_RADIUS, v));
+            }
+        }
+        return p;
+    }();
+    return pattern;
+}
+
+struct Corner {
+    Corner(float r, int x_, int y_) : response(r), x(x_), y(y_) {}
+    bool operator<(const Corner &o) const { return response > o.response; }
+    float response;
+    int x;
+    int y;
+};
+
+// Harris corners, the strongest CORNERS_PER_CELL of every cell of the grid
+void detectKeypoints(const Array2Df &lum, std::vector<Keypoint> &keypoints) {
+    const int width = lum.getCols();
+    const int height = lum.getRows();
+
+    Array2Df ixx(width, height);
+    Array2Df iyy(width, height);
+    Array2Df ixy(width, height);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int y = 0; y < height; y++) {
+        const float *r = lum.data() + y * width;
+        const float *up = lum.data() + std::max(y - 1, 0) * width;
+        const float *down = lum.data() + std::min(y + 1, height - 1) * width;
+        for (int x = 0; x < width; x++) {
+            const float dx =
+                0.5f * (r[std::min(x + 1, width - 1)] - r[std::max(x - 1, 0)]);
+            const float dy = 0.5f * (down[x] - up[x]);
+            ixx(x, y) = dx * dx;
+            iyy(x, y) = dy * dy;
+            ixy(x, y) = dx * dy;
+        }
+    }
+    blur(ixx, ixx);
+    blur(iyy, iyy);
+    blur(ixy, ixy);
+
+    Array2Df response(width, height);
+    float maxResponse = 0.f;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(max : maxResponse)
+#endif
+    for (int i = 0; i < width * height; i++) {
+        const float a = ixx(i);
+        const float b = iyy(i);
+        const float c = ixy(i);
+        const float r = a * b - c * c - 0.04f * (a + b) * (a + b);
+        response(i) = r;
+        maxResponse = std::max(maxResponse, r);
+    }
+
+    Array2Df smooth;
+    blur(lum, smooth);
+    blur(smooth, smooth);
+
+    const std::vector<BriefPair> &pattern = briefPattern();
+    const float threshold = 1e-4f * maxResponse;
+    const int margin = PATCH_RADIUS + 2;
+    const int cellsX = (width + CELL_SIZE - 1) / CELL_SIZE;
+    const int cellsY = (height + CELL_SIZE - 1) / CELL_SIZE;
+
+    std::vector<std::vector<Keypoint>> cells(cellsX * cellsY);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int cell = 0; cell < cellsX * cellsY; cell++) {
+        const int x0 = std::max((cell % cellsX) * CELL_SIZE, margin);
+        const int y0 = std::max((cell / cellsX) * CELL_SIZE, margin);
+        const int x1 =
+            std::min((cell % cellsX + 1) * CELL_SIZE, width - margin);
+        const int y1 =
+            std::min((cell / cellsX + 1) * CELL_SIZE, height - margin);
+
+        std::vector<Corner> corners;
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                const float r = response(x, y);
+                if (r <= threshold) continue;
+
+                bool isMax = true;
+                for (int j = -1; j <= 1 && isMax; j++) {
+                    for (int i = -1; i <= 1; i++) {
+                        if ((i || j) && response(x + i, y + j) >= r) {
+                            isMax = false;
+                            break;
+                        }
+                    }
+                }
+                if (isMax) corners.push_back(Corner(r, x, y));
+            }
+        }
+        const size_t n = std::min(corners.size(), CORNERS_PER_CELL);
+        std::partial_sort(corners.begin(), corners.begin() + n, corners.end());
+
+        for (size_t c = 0; c < n; c++) {
+            Keypoint k;
+            k.x = corners[c].x;
+            k.y = corners[c].y;
+            for (int w = 0; w < DESCRIPTOR_BITS / 64; w++) {
+                uint64_t bits = 0;
+                for (int b = 0; b < 64; b++) {
+                    const BriefPair &p = pattern[w * 64 + b];
+                    if (smooth(corners[c].x + p.x1, corners[c].y + p.y1) <
+                        smooth(corners[c].x + p.x2, corners[c].y + p.y2)) {
+                        bits |= uint64_t(1) << b;
+                    }
+                }
+                k.descriptor[w] = bits;
+            }
+            cells[cell].push_back(k);
+        }
+    }
+
+    keypoints.clear();
+    for (size_t c = 0; c < cells.size(); c++) {
+        keypoints.insert(keypoints.end(), cells[c].begin(), cells[c].end());
+    }
+}
+
+void extractFeatures(const Frame &frame, size_t detectionLevel,
+                     FrameFeatures &features) {
+    features.pyramid.clear();
+    features.pyramid.reserve(detectionLevel + 1);
+    features.pyramid.push_back(Array2Df());
+    logLuminance(frame, features.pyramid.back());
+    for (size_t level = 1; level <= detectionLevel; level++) {
+        features.pyramid.push_back(Array2Df());
+        downsample(features.pyramid[level - 1], features.pyramid.back());
+    }
+    detectKeypoints(features.pyramid.back(), features.keypoints);
+}
+
+// index of the best match of every keypoint of a in b, -1 if ambiguous
+void bestMatches(const std::vector<Keypoint> &a,
+                 const std::vector<Keypoint> &b, float maxDistance,
+                 std::vector<int> &best) {
+    const float maxDistance2 = maxDistance * maxDistance;
+    best.assign(a.size(), -1);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+    for (int i = 0; i < static_cast<int>(a.size()); i++) {
+        int first = DESCRIPTOR_BITS + 1;
+        int second = DESCRIPTOR_BITS + 1;
+        int index = -1;
+        for (size_t j = 0; j < b.size(); j++) {
+            const float dx = a[i].x - b[j].x;
+            const float dy = a[i].y - b[j].y;
+            if (dx * dx + dy * dy > maxDistance2) continue;
+
+            const int d = hamming(a[i], b[j]);
+            if (d < first) {
+                second = first;
+                first = d;
+                index = j;
+            } else if (d < second) {
+                second = d;
+            }
+        }
+        if (first <= DESCRIPTOR_BITS / 4 && first < 0.8f * second) {
+            best[i] = index;
+        }
+    }
+}
+
+void matchKeypoints(const std::vector<Keypoint> &ref,
+                    const std::vector<Keypoint> &other, float maxDistance,
+                    std::vector<Match> &matches) {
+    std::vector<int> forward;
+    std::vector<int> backward;
+    bestMatches(ref, other, maxDistance, forward);
+    bestMatches(other, ref, maxDistance, backward);
+
+    matches.clear();
+    for (size_t i = 0; i < forward.size(); i++) {
+        if (forward[i] >= 0 && backward[forward[i]] == static_cast<int>(i)) {
+            const Keypoint &o = other[forward[i]];
+            matches.push_back(
+                Match(Point(ref[i].x, ref[i].y), Point(o.x, o.y)));
+        }
+    }
+}
+
+// Gaussian elimination with partial pivoting of the n x n system a x = b,
+// the solution replaces b
+bool solve(double *a, double *b, int n) {
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) {
+            if (std::fabs(a[r * n + c]) > std::fabs(a[pivot * n + c])) {
+                pivot = r;
+            }
+        }
+        if (std::fabs(a[pivot * n + c]) < 1e-12) return false;
+        if (pivot != c) {
+            for (int k = 0; k < n; k++) {
+                std::swap(a[c * n + k], a[pivot * n + k]);
+            }
+            std::swap(b[c], b[pivot]);
+        }
+        for (int r = c + 1; r < n; r++) {
+            const double f = a[r * n + c] / a[c * n + c];
+            for (int k = c; k < n; k++) a[r * n + k] -= f * a[c * n + k];
+            b[r] -= f * b[c];
+        }
+    }
+    for (int c = n - 1; c >= 0; c--) {
+        for (int k = c + 1; k < n; k++) b[c] -= a[c * n + k] * b[k];
+        b[c] /= a[c * n + c];
+    }
+    return true;
+}
+
+// similarity that centers the points around the origin at mean distance
+// sqrt(2), to condition the fit
+Homography normalization(const std::vector<Match> &matches,
+                         const std::vector<int> &subset, bool ref) {
+    double cx = 0.0;
+    double cy = 0.0;
+    for (size_t i = 0; i < subset.size(); i++) {
+        const Match &m = matches[subset[i]];
+        const Point &p = ref ? m.ref : m.other;
+        cx += p.x;
+        cy += p.y;
+    }
+    cx /= subset.size();
+    cy /= subset.size();
+    double d = 0.0;
+    for (size_t i = 0; i < subset.size(); i++) {
+        const Match &m = matches[subset[i]];
+        const Point &p = ref ? m.ref : m.other;
+        d += std::sqrt((p.x - cx) * (p.x - cx) + (p.y - cy) * (p.y - cy));
+    }
+    const double s = (d > 0.0) ? std::sqrt(2.0) * subset.size() / d : 1.0;
+
+    Homography t;
+    t.m[0] = s;
+    t.m[2] = -s * cx;
+    t.m[4] = s;
+    t.m[5] = -s * cy;
+    return t;
+}
+
+// least squares homography (h33 = 1) mapping ref onto other
+bool fitHomography(const std::vector<Match> &matches,
+                   const std::vector<int> &subset, Homography &h) {
+    if (subset.size() < 4) return false;
+
+    const Homography t1 = normalization(matches, subset, true);
+    const Homography t2 = normalization(matches, subset, false);
+
+    double ata[64] = {0.0};
+    double atb[8] = {0.0};
+    for (size_t i = 0; i < subset.size(); i++) {
+        double x, y, u, v;
+        t1.apply(matches[subset[i]].ref.x, matches[subset[i]].ref.y, x, y);
+        t2.apply(matches[subset[i]].other.x, matches[subset[i]].other.y, u, v);
+
+        const double r1[8] = {x, y, 1.0, 0.0, 0.0, 0.0, -u * x, -u * y};
+        const double r2[8] = {0.0, 0.0, 0.0, x, y, 1.0, -v * x, -v * y};
+        for (int r = 0; r < 8; r++) {
+            for (int c = 0; c < 8; c++) {
+                ata[r * 8 + c] += r1[r] * r1[c] + r2[r] * r2[c];
+            }
+            atb[r] += r1[r] * u + r2[r] * v;
+        }
+    }
+    if (!solve(ata, atb, 8)) return false;
+
+    Homography hn;
+    for (int i = 0; i < 8; i++) hn.m[i] = atb[i];
+    hn.m[8] = 1.0;
+    h = t2.inverse() * hn * t1;
+    return true;
+}
+
+double residual(const Homography &h, const Match &m) {
+    double u, v;
+    h.apply(m.ref.x, m.ref.y, u, v);
+    return (u - m.other.x) * (u - m.other.x) +
+           (v - m.other.y) * (v - m.other.y);
+}
+
+void findInliers(const std::vector<Match> &matches, const Homography &h,
+                 double threshold, std::vector<int> &inliers) {
+    const double threshold2 = threshold * threshold;
+    inliers.clear();
+    for (size_t i = 0; i < matches.size(); i++) {
+        if (residual(h, matches[i]) < threshold2) inliers.push_back(i);
+    }
+}
+
+// refit on the inliers until they do not change
+bool refitHomography(const std::vector<Match> &matches, double threshold,
+                     Homography &h, std::vector<int> &inliers) {
+    findInliers(matches, h, threshold, inliers);
+    for (int iteration = 0; iteration < 3; iteration++) {
+        if (inliers.size() < MIN_INLIERS) return false;
+
+        Homography refined;
+        if (!fitHomography(matches, inliers, refined)) return false;
+
+        std::vector<int> refinedInliers;
+        findInliers(matches, refined, threshold, refinedInliers);
+        if (refinedInliers.size() < inliers.size()) break;
+
+        h = refined;
+        const bool converged = (refinedInliers == inliers);
+        inliers.swap(refinedInliers);
+        if (converged) break;
+    }
+    return inliers.size() >= MIN_INLIERS;
+}
+
+bool ransacHomography(const std::vector<Match> &matches, double threshold,
+                      Homography &h, std::vector<int> &inliers) {
+    if (matches.size() < MIN_INLIERS) return false;
+
+    // fixed seed: the same stack is always aligned the same way
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> pick(0, matches.size() - 1);
+
+    std::vector<int> sample(4);
+    std::vector<int> candidate;
+    size_t bestCount = 0;
+    for (int iteration = 0; iteration < RANSAC_ITERATIONS; iteration++) {
+        for (int i = 0; i < 4; i++) {
+            bool duplicate;
+            do {
+                sample[i] = pick(rng);
+                duplicate = false;
+                for (int j = 0; j < i; j++) {
+                    duplicate |= (sample[j] == sample[i]);
+                }
+            } while (duplicate);
+        }
+
+        Homography model;
+        if (!fitHomography(matches, sample, model)) continue;
+
+        findInliers(matches, model, threshold, candidate);
+        if (candidate.size() > bestCount) {
+            bestCount = candidate.size();
+            h = model;
+            // all the matches agree, no need to look any further
+            if (bestCount == matches.size()) break;
+        }
+    }
+    if (bestCount < MIN_INLIERS) return false;
+
+    return refitHomography(matches, threshold, h, inliers);
+}
+
+// rejects the models that fold or shrink the frame, the product of too few
+// (or wrong) matches
+bool isPlausible(const Homography &h, size_t width, size_t height) {
+    const double cx[4] = {0.0, double(width), double(width), 0.0};
+    const double cy[4] = {0.0, 0.0, double(height), double(height)};
+    double u[4], v[4];
+    for (int i = 0; i < 4; i++) {
+        const double w = h.m[6] * cx[i] + h.m[7] * cy[i] + h.m[8];
+        if (w <= 0.0) return false;
+        h.apply(cx[i], cy[i], u[i], v[i]);
+    }
+    double area = 0.0;
+    for (int i = 0; i < 4; i++) {
+        const int j = (i + 1) % 4;
+        const int k = (i + 2) % 4;
+        const double cross = (u[j] - u[i]) * (v[k] - v[j]) -
+                             (v[j] - v[i]) * (u[k] - u[j]);
+        if (cross <= 0.0) return false;
+        area += u[i] * v[j] - u[j] * v[i];
+    }
+    const double ratio = 0.5 * area / (double(width) * height);
+    return ratio > 0.5 && ratio < 2.0;
+}
+
+// position of \a p of ref in other, by normalized cross correlation of the
+// patches around the prediction \a q
+bool trackPoint(const Array2Df &ref, const Array2Df &other, const Point &p,
+                const Point &q, Point &result) {
+    const int px = static_cast<int>(std::floor(p.x + 0.5));
+    const int py = static_cast<int>(std::floor(p.y + 0.5));
+    const int qx = static_cast<int>(std::floor(q.x + 0.5));
+    const int qy = static_cast<int>(std::floor(q.y + 0.5));
+    const int r = TRACK_RADIUS;
+    const int border = TRACK_RADIUS + SEARCH_RADIUS + 1;
+    if (px < r || py < r || px >= int(ref.getCols()) - r ||
+        py >= int(ref.getRows()) - r || qx < border || qy < border ||
+        qx >= int(other.getCols()) - border ||
+        qy >= int(other.getRows()) - border) {
+        return false;
+    }
+
+    const int n = (2 * r + 1) * (2 * r + 1);
+    float patch[(2 * TRACK_RADIUS + 1) * (2 * TRACK_RADIUS + 1)];
+    double mean = 0.0;
+    for (int y = -r, i = 0; y <= r; y++) {
+        for (int x = -r; x <= r; x++, i++) {
+            patch[i] = ref(px + x, py + y);
+            mean += patch[i];
+        }
+    }
+    mean /= n;
+    double var = 0.0;
+    for (int i = 0; i < n; i++) {
+        patch[i] -= mean;
+        var += patch[i] * patch[i];
+    }
+    // flat (or clipped) patch, no way to locate it
+    if (var < 1e-4 * n) return false;
+
+    const int side = 2 * SEARCH_RADIUS + 1;
+    double ncc[(2 * SEARCH_RADIUS + 1) * (2 * SEARCH_RADIUS + 1)];
+    int best = -1;
+    for (int dy = -SEARCH_RADIUS, c = 0; dy <= SEARCH_RADIUS; dy++) {
+        for (int dx = -SEARCH_RADIUS; dx <= SEARCH_RADIUS; dx++, c++) {
+            double sum = 0.0;
+            double sum2 = 0.0;
+            double cross = 0.0;
+            for (int y = -r, i = 0; y <= r; y++) {
+                const float *row = other.data() +
+                                   (qy + dy + y) * other.getCols() + qx + dx;
+                for (int x = -r; x <= r; x++, i++) {
+                    sum += row[x];
+                    sum2 += row[x] * row[x];
+                    cross += patch[i] * row[x];
+                }
+            }
+            const double otherVar = sum2 - sum * sum / n;
+            ncc[c] = (otherVar > 1e-12) ? cross / std::sqrt(var * otherVar)
+                                        : -1.0;
+            if (best < 0 || ncc[c] > ncc[best]) best = c;
+        }
+    }
+
+    const int bx = best % side;
+    const int by = best / side;
+    if (ncc[best] < 0.8 || bx == 0 || by == 0 || bx == side - 1 ||
+        by == side - 1) {
+        return false;
+    }
+
+    // parabola through the best score and its neighbours
+    double sx = 0.0;
+    double sy = 0.0;
+    const double ddx = ncc[best - 1] - 2.0 * ncc[best] + ncc[best + 1];
+    const double ddy = ncc[best - side] - 2.0 * ncc[best] + ncc[best + side];
+    if (ddx < 0.0) sx = 0.5 * (ncc[best - 1] - ncc[best + 1]) / ddx;
+    if (ddy < 0.0) sy = 0.5 * (ncc[best - side] - ncc[best + side]) / ddy;
+
+    // the patch was centered on the pixel nearest to p
+    sx = std::max(-0.5, std::min(0.5, sx)) + p.x - px;
+    sy = std::max(-0.5, std::min(0.5, sy)) + p.y - py;
+    result = Point(qx + bx - SEARCH_RADIUS + sx, qy + by - SEARCH_RADIUS + sy);
+    return true;
+}
+
+// homography from frame ref to frame other, at full resolution
+bool registerPair(const FrameFeatures &ref, const FrameFeatures &other,
+                  Homography &h) {
+    const size_t detectionLevel = ref.pyramid.size() - 1;
+    const Array2Df &detection = ref.pyramid[detectionLevel];
+    const float maxDistance =
+        std::max(detection.getCols(), detection.getRows()) / 8.f;
+
+    std::vector<Match> matches;
+    matchKeypoints(ref.keypoints, other.keypoints, maxDistance, matches);
+    PRINT_DEBUG(matches.size() << " matches out of " << ref.keypoints.size()
+                               << " and " << other.keypoints.size()
+                               << " keypoints");
+
+    std::vector<int> inliers;
+    if (!ransacHomography(matches, 2.0, h, inliers)) return false;
+    PRINT_DEBUG(inliers.size() << " inliers at level " << detectionLevel);
+
+    std::vector<Point> points;
+    for (size_t i = 0; i < inliers.size(); i++) {
+        points.push_back(matches[inliers[i]].ref);
+    }
+
+    // track the inliers down the pyramid, starting with the detection level
+    // itself: the corners are only located to the pixel, and the error of a
+    // level is halved on the next one
+    for (int level = detectionLevel; level >= 0; level--) {
+        if (level < static_cast<int>(detectionLevel)) {
+            h = upscale(h);
+            for (size_t i = 0; i < points.size(); i++) {
+                points[i] =
+                    Point(2.0 * points[i].x + 0.5, 2.0 * points[i].y + 0.5);
+            }
+        }
+
+        std::vector<Match> tracked;
+        for (size_t i = 0; i < points.size(); i++) {
+            Point q;
+            h.apply(points[i].x, points[i].y, q.x, q.y);
+            Point found;
+            if (trackPoint(ref.pyramid[level], other.pyramid[level], points[i],
+                           q, found)) {
+                tracked.push_back(Match(points[i], found));
+            }
+        }
+
+        Homography refined = h;
+        std::vector<int> trackedInliers;
+        if (refitHomography(tracked, 1.5, refined, trackedInliers)) {
+            h = refined;
+        }
+        PRINT_DEBUG(trackedInliers.size() << " of " << points.size()
+                                          << " points tracked at level "
+                                          << level);
+    }
+
+    const Array2Df &full = ref.pyramid[0];
+    return isPlausible(h, full.getCols(), full.getRows());
+}
+
+// out(x, y) = in(h(x, y)), bilinear, 0 outside of the frame
+Frame *warp(const Frame &in, const Homography &h) {
+    const int width = in.getWidth();
+    const int height = in.getHeight();
+    Frame *out = new Frame(width, height);
+
+    const ChannelContainer &channels = in.getChannels();
+    std::vector<const Channel *> src;
+    std::vector<Channel *> dst;
+    for (ChannelContainer::const_iterator it = channels.begin();
+         it != channels.end(); ++it) {
+        src.push_back(*it);
+        dst.push_back(out->createChannel((*it)->getName()));
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            double u, v;
+            h.apply(x, y, u, v);
+
+            const double fu = std::floor(u);
+            const double fv = std::floor(v);
+            const int x0 = static_cast<int>(fu);
+            const int y0 = static_cast<int>(fv);
+            if (u < 0.0 || v < 0.0 || u > width - 1 || v > height - 1) {
+                for (size_t c = 0; c < dst.size(); c++) (*dst[c])(x, y) = 0.f;
+                continue;
+            }
+            const int x1 = std::min(x0 + 1, width - 1);
+            const int y1 = std::min(y0 + 1, height - 1);
+            const float ax = static_cast<float>(u - fu);
+            const float ay = static_cast<float>(v - fv);
+
+            for (size_t c = 0; c < dst.size(); c++) {
+                const Channel &s = *src[c];
+                const float top = s(x0, y0) + ax * (s(x1, y0) - s(x0, y0));
+                const float bottom = s(x0, y1) + ax * (s(x1, y1) - s(x0, y1));
+                (*dst[c])(x, y) = top + ay * (bottom - top);
+            }
+        }
+    }
+
+    pfs::copyTags(&in, out);
+    return out;
+}
+}
+
+bool feature_alignment(std::vector<pfs::FramePtr> &framePtrList) {
+    if (framePtrList.size() <= 1) return true;
+
+    const size_t width = framePtrList[0]->getWidth();
+    const size_t height = framePtrList[0]->getHeight();
+    pfs::utils::TraceSpan trace_span(
+        "feature_alignment",
+        framePtrList.size() * framePtrList[0]->size() * 3 * sizeof(float));
+
+    size_t detectionLevel = 0;
+    while ((std::max(width, height) >> detectionLevel) > DETECTION_SIZE) {
+        detectionLevel++;
+    }
+    PRINT_DEBUG("width=" << width << ", height=" << height
+                         << ", detection level=" << detectionLevel);
+
+    // the middle exposure is the reference: its pyramid is kept for the
+    // whole run, while the pyramid of every other frame only lives as long
+    // as its registration
+    const int numFrames = framePtrList.size();
+    const int reference = numFrames / 2;
+    FrameFeatures ref;
+    extractFeatures(*framePtrList[reference], detectionLevel, ref);
+
+    std::vector<char> registered(numFrames, 1);
+    for (int i = 0; i < numFrames; i++) {
+        if (i == reference) continue;
+
+        Homography h;
+        {
+            FrameFeatures other;
+            extractFeatures(*framePtrList[i], detectionLevel, other);
+            registered[i] = registerPair(ref, other, h);
+        }
+        if (!registered[i]) {
+            // keep the frame where it is
+            PRINT_DEBUG("frame " << i << " could not be registered to frame "
+                                 << reference);
+            continue;
+        }
+        if (h.isIdentity()) continue;
+
+        FramePtr warped(warp(*framePtrList[i], h));
+        framePtrList[i]->swap(*warped);
+    }
+
+    return std::find(registered.begin(), registered.end(), 0) ==
+           registered.end();
+}
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Feature based alignment of an exposure stack, done in memory
+//!
+//! Corners are detected on a log luminance pyramid and described with binary
+//! intensity comparisons, that do not change with the exposure. The matches
+//! of every exposure with the middle one give a homography (RANSAC), that
+//! is then refined level by level down to the full resolution. Unlike MTB,
+//! rotation and small perspective changes are recovered as well.
+
+#ifndef LIBHDR_FEATURE_ALIGNMENT_H
+#define LIBHDR_FEATURE_ALIGNMENT_H
+
+#include <vector>
+
+#include <Libpfs/frame.h>
+
+namespace libhdr {
+
+//! \brief warp every frame of \a framePtrList onto the middle one
+//! \return false if a frame could not be registered: it is left in place,
+//! the other frames are still aligned
+bool feature_alignment(std::vector<pfs::FramePtr> &framePtrList);
+
+}  // libhdr
+
+#endif
@@ -25,8 +25,10 @@
 
 #include <iso646.h>
 #include <boost/lexical_cast.hpp>
+#include <bitset>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -37,6 +39,7 @@
 #include <Libpfs/frame.h>
 #include <Libpfs/manip/resize.h>
 #include <Libpfs/manip/shift.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 #include <Libpfs/io/jpegwriter.h>
@@ -52,108 +55,189 @@ using namespace pfs;
 #endif
 
 typedef Array2D<uint8_t> Array2D8u;
-typedef Array2D<bool> Array2Db;
 
 namespace libhdr {
 
-long XORimages(const Array2Db &img1, const Array2Db &mask1,
-               const Array2Db &img2, const Array2Db &mask2) {
-    long err = 0;
-    for (size_t i = 0; i < img1.getRows(); i++) {
-        Array2Db::const_iterator p1 = img1.row_begin(i);
-        Array2Db::const_iterator p2 = img2.row_begin(i);
-        Array2Db::const_iterator m1 = mask1.row_begin(i);
-        Array2Db::const_iterator m2 = mask2.row_begin(i);
-
-        for (size_t j = 0; j < img1.getCols(); j++) {
-            err += (long)((*p1++ xor *p2++) and *m1++ and *m2++);
-        }
-    }
-    return err;
+namespace {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MTB_POPCNT_DISPATCH
+#endif
+
+// the kernels are inlined in their callers, so that the popcnt one gets the
+// hardware instruction
+#if defined(__GNUC__)
+#define MTB_INLINE inline __attribute__((always_inline))
+#else
+#define MTB_INLINE inline
+#endif
+
+MTB_INLINE int popcount(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(v);
+#else
+    return static_cast<int>(std::bitset<64>(v).count());
+#endif
 }
 
-// setThreshold gets the data from the input image and creates the threshold
-// and mask images.
-// Those are bitmap (0,1 valued) with depth()=1
+//! \brief 1 bit per pixel image, every row padded to a multiple of 64 bits
+//! with zeroes
+class BitMap {
+   public:
+    BitMap(size_t width, size_t height)
+        : m_width(width),
+          m_height(height),
+          m_stride((width + 63) / 64),
+          m_bits(m_stride * height, 0) {}
+
+    size_t getWidth() const { return m_width; }
+    size_t getHeight() const { return m_height; }
+    //! \brief number of words in a row
+    size_t getStride() const { return m_stride; }
+
+    uint64_t *row(size_t y) { return &m_bits[y * m_stride]; }
+    const uint64_t *row(size_t y) const { return &m_bits[y * m_stride]; }
+
+    //! \brief the 64 pixels of \a row starting at column \a x, that can be
+    //! negative: the pixels outside of the bitmap are 0
+    MTB_INLINE uint64_t word(const uint64_t *row, long x) const {
+        if (x <= -64 || x >= static_cast<long>(m_width)) return 0;
+
+        const long k = (x >= 0) ? x / 64 : -1;
+        const int s = static_cast<int>(x - k * 64);
+        const uint64_t lo = (k >= 0) ? row[k] : 0;
+        if (s == 0) return lo;
+        const uint64_t hi =
+            (k + 1 < static_cast<long>(m_stride)) ? row[k + 1] : 0;
+        return (lo >> s) | (hi << (64 - s));
+    }
+
+   private:
+    size_t m_width;
+    size_t m_height;
+    size_t m_stride;
+    std::vector<uint64_t> m_bits;
+};
+
+//! \brief median threshold bitmap and exclusion mask of a pyramid level
+struct MTBLevel {
+    MTBLevel(size_t width, size_t height)
+        : threshold(width, height), mask(width, height) {}
+
+    BitMap threshold;
+    BitMap mask;
+};
+
+typedef std::vector<MTBLevel> MTBPyramid;
+
+// the threshold bitmap is set above the median, the mask is set out of the
+// noise band around it
 void setThreshold(const Array2D8u &in, const int threshold, const int noise,
-                  Array2Db &threshold_out, Array2Db &mask_out) {
-    assert(in.getCols() == threshold_out.getCols());
-    assert(in.getRows() == threshold_out.getRows());
-    assert(in.getCols() == mask_out.getCols());
-    assert(in.getRows() == mask_out.getRows());
+                  MTBLevel &out) {
+    assert(in.getCols() == out.threshold.getWidth());
+    assert(in.getRows() == out.threshold.getHeight());
 
     for (size_t i = 0; i < in.getRows(); i++) {
         Array2D8u::const_iterator inp = in.row_begin(i);
+        uint64_t *outp = out.threshold.row(i);
+        uint64_t *maskp = out.mask.row(i);
 
-        Array2Db::iterator outp = threshold_out.row_begin(i);
-        Array2Db::iterator maskp = mask_out.row_begin(i);
-
-        for (size_t j = 0; j < in.getCols(); j++) {
-            *outp++ = *inp < threshold ? 0 : 1;
-            *maskp++ =
-                (*inp > (threshold - noise)) && (*inp < (threshold + noise))
-                    ? 0
-                    : 1;
-            ++inp;
+        for (size_t j = 0; j < in.getCols(); j++, ++inp) {
+            const uint64_t bit = uint64_t(1) << (j % 64);
+            if (*inp >= threshold) {
+                outp[j / 64] |= bit;
+            }
+            if (*inp <= (threshold - noise) || *inp >= (threshold + noise)) {
+                maskp[j / 64] |= bit;
+            }
         }
     }
 }
 
-void getExpShift(const Array2D8u &img1, const int median1,
-                 const Array2D8u &img2, const int median2, const int noise,
-                 const int shift_bits, int &shift_x, int &shift_y) {
-    assert(img1.getCols() == img2.getCols());
-    assert(img1.getRows() == img2.getRows());
-
-    int curr_x = 0;
-    int curr_y = 0;
-
-    if (shift_bits > 0) {
-        Array2D8u img1small(img1.getCols() / 2, img1.getRows() / 2);
-        Array2D8u img2small(img2.getCols() / 2, img2.getRows() / 2);
+// adds to errors[0..2] the pixels of row y of img1 that differ from img2
+// shifted by (dx - 1 .. dx + 1, dy), out of the masks
+MTB_INLINE void rowErrors(const MTBLevel &img1, const MTBLevel &img2, size_t y,
+                      int dx, int dy, long errors[3]) {
+    const long y2 = static_cast<long>(y) + dy;
+    if (y2 < 0 || y2 >= static_cast<long>(img2.threshold.getHeight())) {
+        return;
+    }
 
-        pfs::resize(img1, img1small, BilinearInterp);
-        pfs::resize(img2, img2small, BilinearInterp);
+    const uint64_t *t1 = img1.threshold.row(y);
+    const uint64_t *m1 = img1.mask.row(y);
+    const uint64_t *t2 = img2.threshold.row(y2);
+    const uint64_t *m2 = img2.mask.row(y2);
+
+    for (size_t k = 0; k < img1.threshold.getStride(); k++) {
+        if (!m1[k]) continue;
+        for (int i = 0; i < 3; i++) {
+            const long x = static_cast<long>(k * 64) + dx + i - 1;
+            const uint64_t diff = (t1[k] ^ img2.threshold.word(t2, x)) &
+                                  m1[k] & img2.mask.word(m2, x);
+            errors[i] += popcount(diff);
+        }
+    }
+}
 
-        getExpShift(img1small, median1, img2small, median2, noise,
-                    shift_bits - 1, curr_x, curr_y);
-        curr_x *= 2;
-        curr_y *= 2;
+MTB_INLINE void shiftErrors(const MTBLevel &img1, const MTBLevel &img2, int curr_x,
+                 int curr_y, long errors[3][3]) {
+    for (size_t y = 0; y < img1.threshold.getHeight(); y++) {
+        for (int j = 0; j < 3; j++) {
+            long rowErr[3] = {0, 0, 0};
+            rowErrors(img1, img2, y, curr_x, curr_y + j - 1, rowErr);
+            for (int i = 0; i < 3; i++) {
+                errors[i][j] += rowErr[i];
+            }
+        }
     }
+}
 
-    Array2Db img1threshold(img1.getCols(), img1.getRows());
-    Array2Db img1mask(img1.getCols(), img1.getRows());
-    Array2Db img2threshold(img2.getCols(), img2.getRows());
-    Array2Db img2mask(img2.getCols(), img2.getRows());
+void shiftErrorsGeneric(const MTBLevel &img1, const MTBLevel &img2,
+                        int curr_x, int curr_y, long errors[3][3]) {
+    shiftErrors(img1, img2, curr_x, curr_y, errors);
+}
 
-    setThreshold(img1, median1, noise, img1threshold, img1mask);
-    setThreshold(img2, median2, noise, img2threshold, img2mask);
+#ifdef MTB_POPCNT_DISPATCH
+__attribute__((target("popcnt"))) void shiftErrorsPopcnt(
+    const MTBLevel &img1, const MTBLevel &img2, int curr_x, int curr_y,
+    long errors[3][3]) {
+    shiftErrors(img1, img2, curr_x, curr_y, errors);
+}
 
-    Array2Db img2_shifted(img2.getCols(), img2.getRows());
-    Array2Db img2mask_shifted(img2.getCols(), img2.getRows());
+bool hasPopcnt() {
+    static const bool popcnt = __builtin_cpu_supports("popcnt");
+    return popcnt;
+}
+#endif
 
-    int minerr = img1.size();
-    for (int i = -1; i <= 1; i++) {
-        for (int j = -1; j <= 1; j++) {
-            int dx = curr_x + i;
-            int dy = curr_y + j;
+// best of the 9 shifts around (curr_x, curr_y) of img2 against img1
+void getExpShift(const MTBLevel &img1, const MTBLevel &img2, int &shift_x,
+                 int &shift_y) {
+    assert(img1.threshold.getWidth() == img2.threshold.getWidth());
+    assert(img1.threshold.getHeight() == img2.threshold.getHeight());
 
-            pfs::shift(img2threshold, dx, dy, img2_shifted);
-            pfs::shift(img2mask, dx, dy, img2mask_shifted);
+    const int curr_x = shift_x;
+    const int curr_y = shift_y;
 
-            long err = XORimages(img1threshold, img1mask, img2_shifted,
-                                 img2mask_shifted);
+    long errors[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+#ifdef MTB_POPCNT_DISPATCH
+    if (hasPopcnt()) {
+        shiftErrorsPopcnt(img1, img2, curr_x, curr_y, errors);
+    } else
+#endif
+    {
+        shiftErrorsGeneric(img1, img2, curr_x, curr_y, errors);
+    }
 
-            if (err < minerr) {
-                minerr = err;
-                shift_x = dx;
-                shift_y = dy;
+    long minerr = img1.threshold.getWidth() * img1.threshold.getHeight();
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (errors[i][j] < minerr) {
+                minerr = errors[i][j];
+                shift_x = curr_x + i - 1;
+                shift_y = curr_y + j - 1;
             }
         }
     }
-
-    PRINT_DEBUG("getExpShift::Level " << shift_bits << " shift (" << shift_x
-                                      << "," << shift_y << ")");
 }
 
 int getLum(const Frame &in, Array2D8u &out, double quantile) {
@@ -194,67 +278,122 @@ int getLum(const Frame &in, Array2D8u &out, double quantile) {
     return idx;
 }
 
-void mtbalign(const pfs::Frame &image1, const pfs::Frame &image2,
-              const double quantile, const int noise, const int shift_bits,
-              int &shift_x, int &shift_y) {
-    Array2D8u img1lum;
-    Array2D8u img2lum;
-
-    int median1 = getLum(image1, img1lum, quantile);
-    int median2 = getLum(image2, img2lum, quantile);
-
-    PRINT_DEBUG("align::medians, image 1: " << median1
-                                            << ", image 2: " << median2);
-    getExpShift(img1lum, median1, img2lum, median2, noise, shift_bits, shift_x,
-                shift_y);
+// threshold bitmaps of \a in and of its halvings, down to shift_bits
+void buildPyramid(const Frame &in, const double quantile, const int noise,
+                  const int shift_bits, MTBPyramid &pyramid) {
+    Array2D8u lum;
+    const int median = getLum(in, lum, quantile);
+    PRINT_DEBUG("median: " << median);
+
+    pyramid.clear();
+    pyramid.reserve(shift_bits + 1);
+    for (int level = 0; level <= shift_bits; level++) {
+        if (level > 0) {
+            Array2D8u small(lum.getCols() / 2, lum.getRows() / 2);
+            pfs::resize(lum, small, BilinearInterp);
+            lum.swap(small);
+        }
+        pyramid.push_back(MTBLevel(lum.getCols(), lum.getRows()));
+        setThreshold(lum, median, noise, pyramid.back());
+    }
+}
 
-    PRINT_DEBUG("align::done, final shift is (" << shift_x << "," << shift_y
-                                                << ")");
+// shift of img2 against img1, from the coarsest level to the finest
+void mtbalign(const MTBPyramid &img1, const MTBPyramid &img2, int &shift_x,
+              int &shift_y) {
+    assert(img1.size() == img2.size());
+
+    shift_x = 0;
+    shift_y = 0;
+    for (int level = img1.size() - 1; level >= 0; level--) {
+        getExpShift(img1[level], img2[level], shift_x, shift_y);
+        PRINT_DEBUG("getExpShift::Level " << level << " shift (" << shift_x
+                                          << "," << shift_y << ")");
+        if (level > 0) {
+            shift_x *= 2;
+            shift_y *= 2;
+        }
+    }
 }
 
-static const double quantile = 0.5;
-static const int noise = 4;
+const double quantile = 0.5;
+const int noise = 4;
+}
 
-void mtb_alignment(std::vector<pfs::FramePtr> &framePtrList) {
+void mtb_shifts(const std::vector<pfs::FramePtr> &framePtrList,
+                std::vector<int> &cumulativeX, std::vector<int> &cumulativeY) {
+    cumulativeX.assign(framePtrList.size(), 0);
+    cumulativeY.assign(framePtrList.size(), 0);
     if (framePtrList.size() <= 1) return;
 
     int width = framePtrList[0]->getWidth();
     int height = framePtrList[0]->getHeight();
+    pfs::utils::TraceSpan trace_span(
+        "mtb_alignment",
+        framePtrList.size() * framePtrList[0]->size() * 3 * sizeof(float));
 
     int shift_bits =
         std::max((int)floor(log2((double)std::min(width, height))) - 6, 0);
     PRINT_DEBUG("width=" << width << ", height=" << height
                          << ", shift_bits=" << shift_bits);
 
+    const int numFrames = framePtrList.size();
+
+    // every frame is thresholded once, and only its bitmaps are kept
+    std::vector<MTBPyramid> pyramids(numFrames);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < numFrames; i++) {
+        buildPyramid(*framePtrList[i], quantile, noise, shift_bits,
+                     pyramids[i]);
+    }
+
     // these arrays contain the shifts of each image (except the 0-th) wrt the
     // previous one
-    vector<int> shiftsX(framePtrList.size() - 1);
-    vector<int> shiftsY(framePtrList.size() - 1);
+    vector<int> shiftsX(numFrames - 1);
+    vector<int> shiftsY(numFrames - 1);
+
+    // find the shifts, the pairs are independent
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < numFrames - 1; i++) {
+        mtbalign(pyramids[i], pyramids[i + 1], shiftsX[i], shiftsY[i]);
+        PRINT_DEBUG("align::done, shift of " << i + 1 << " is (" << shiftsX[i]
+                                             << "," << shiftsY[i] << ")");
+    }
+    pyramids.clear();
 
-    // find the shitfs
-    for (size_t i = 0; i < framePtrList.size() - 1; i++) {
-        mtbalign(*framePtrList[i], *framePtrList[i + 1], quantile, noise,
-                 shift_bits, shiftsX[i], shiftsY[i]);
+    for (int i = 1; i < numFrames; i++) {
+        cumulativeX[i] = cumulativeX[i - 1] + shiftsX[i - 1];
+        cumulativeY[i] = cumulativeY[i - 1] + shiftsY[i - 1];
     }
+}
+
+void mtb_alignment(std::vector<pfs::FramePtr> &framePtrList) {
+    if (framePtrList.size() <= 1) return;
+
+    const int numFrames = framePtrList.size();
+    vector<int> cumulativeX;
+    vector<int> cumulativeY;
+    mtb_shifts(framePtrList, cumulativeX, cumulativeY);
 
     PRINT_DEBUG("shifting the images");
-    int originalsize = framePtrList.size();
 
-    int cumulativeX = 0;
-    int cumulativeY = 0;
     // shift the images (apply the shifts starting from the second (index=1))
-    for (int i = 1; i < originalsize; i++) {
-        cumulativeX += shiftsX[i - 1];
-        cumulativeY += shiftsY[i - 1];
-
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 1; i < numFrames; i++) {
         // avoid shifting if cumulativeX and cumulativeY are zero
-        if (cumulativeX || cumulativeY) {
+        if (cumulativeX[i] || cumulativeY[i]) {
             PRINT_DEBUG("Cumulative shift for image "
-                        << i << " = (" << cumulativeX << "," << cumulativeY
-                        << ")");
+                        << i << " = (" << cumulativeX[i] << ","
+                        << cumulativeY[i] << ")");
 
             FramePtr shiftedFrame(
-                pfs::shift(*framePtrList[i], cumulativeX, cumulativeY));
+                pfs::shift(*framePtrList[i], cumulativeX[i], cumulativeY[i]));
 
             framePtrList[i]->swap(*shiftedFrame);
         }
@@ -37,6 +37,11 @@
 
 namespace libhdr {
 
+//! \brief shifts that align every frame of \a framePtrList to the first one
+//! \param cumulativeX,cumulativeY one shift per frame, 0 for the first
+void mtb_shifts(const std::vector<pfs::FramePtr> &framePtrList,
+                std::vector<int> &cumulativeX, std::vector<int> &cumulativeY);
+
 void mtb_alignment(std::vector<pfs::FramePtr> &framePtrList);
 
 }  // libhdr
@@ -30,8 +30,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 #include <iterator>
+#include <random>
 #include <vector>
 
 #include <boost/bind.hpp>
@@ -40,6 +42,7 @@
 #include <boost/numeric/conversion/bounds.hpp>
 
 #include <Libpfs/array2d.h>
+#include <Libpfs/utils/trace.h>
 
 #ifndef NDEBUG
 #define PRINT_DEBUG(str) std::cerr << "Robertson: " << str << std::endl
@@ -135,6 +138,8 @@ void RobertsonOperator::computeFusion(ResponseCurve &response,
     size_t numExposures = frames.size();
     Frame tempFrame(frames[0].frame()->getWidth(),
                     frames[0].frame()->getHeight());
+    pfs::utils::TraceSpan trace_span(
+        "MergeRobertson", 3 * numExposures * tempFrame.size() * sizeof(float));
 
     Channel *outputRed;
     Channel *outputGreen;
@@ -229,6 +234,37 @@ float normalizeI(ResponseCurve::ResponseContainer &I) {
     return mid;
 }
 
+// pixel indices of a stratified sample of the frame: a grid of about
+// numSamples cells with the aspect ratio of the frame, one pixel at a random
+// position inside each cell
+std::vector<size_t> stratifiedSamples(size_t width, size_t height,
+                                      size_t numSamples, unsigned int seed) {
+    const size_t gx = std::min(
+        width, std::max<size_t>(
+                   1, std::sqrt(double(numSamples) * width / height) + 0.5));
+    const size_t gy =
+        std::min(height, std::max<size_t>(1, (numSamples + gx - 1) / gx));
+
+    // the raw output of mt19937 is the same on every platform, unlike the
+    // standard distributions
+    std::mt19937 rng(seed);
+
+    std::vector<size_t> samples;
+    samples.reserve(gx * gy);
+    for (size_t cy = 0; cy < gy; ++cy) {
+        const size_t y0 = cy * height / gy;
+        const size_t y1 = (cy + 1) * height / gy;
+        for (size_t cx = 0; cx < gx; ++cx) {
+            const size_t x0 = cx * width / gx;
+            const size_t x1 = (cx + 1) * width / gx;
+            const size_t x = x0 + rng() % (x1 - x0);
+            const size_t y = y0 + rng() % (y1 - y0);
+            samples.push_back(y * width + x);
+        }
+    }
+    return samples;
+}
+
 /*
 void pseudoSort(const float* arrayofexptime, int* i_lower, int* i_upper, int N)
 {
@@ -270,6 +306,8 @@ void RobertsonOperatorAuto::computeResponse(
     typedef ResponseCurve::ResponseContainer ResponseContainer;
 
     int N = inputData.size();
+    pfs::utils::TraceSpan trace_span("RobertsonResponse",
+                                     N * width * height * sizeof(float));
 
     // 0 . initialization
     // a. normalize response
@@ -376,6 +414,9 @@ void RobertsonOperatorAuto::computeFusion(
     size_t numExposures = frames.size();
     Frame tempFrame(frames[0].frame()->getWidth(),
                     frames[0].frame()->getHeight());
+    pfs::utils::TraceSpan trace_span(
+        "MergeRobertsonAuto",
+        3 * numExposures * tempFrame.size() * sizeof(float));
 
     Channel *outputRed;
     Channel *outputGreen;
@@ -396,21 +437,48 @@ void RobertsonOperatorAuto::computeFusion(
                    std::back_inserter(averageLuminances),
                    boost::bind(&FrameEnhanced::averageLuminance, _1));
 
-    // red
-    computeResponse(response, weight, RESPONSE_CHANNEL_RED, redChannels,
-                    outputRed->data(), tempFrame.getWidth(),
-                    tempFrame.getHeight(), minAllowedValue, maxAllowedValue,
-                    averageLuminances.data());
-    // green
-    computeResponse(response, weight, RESPONSE_CHANNEL_GREEN, greenChannels,
-                    outputGreen->data(), tempFrame.getWidth(),
-                    tempFrame.getHeight(), minAllowedValue, maxAllowedValue,
-                    averageLuminances.data());
-    // blue
-    computeResponse(response, weight, RESPONSE_CHANNEL_BLUE, blueChannels,
-                    outputBlue->data(), tempFrame.getWidth(),
-                    tempFrame.getHeight(), minAllowedValue, maxAllowedValue,
-                    averageLuminances.data());
+    const size_t width = tempFrame.getWidth();
+    const size_t height = tempFrame.getHeight();
+    const ResponseChannel channels[3] = {
+        RESPONSE_CHANNEL_RED, RESPONSE_CHANNEL_GREEN, RESPONSE_CHANNEL_BLUE};
+    const DataList *inputs[3] = {&redChannels, &greenChannels, &blueChannels};
+    Channel *outputs[3] = {outputRed, outputGreen, outputBlue};
+
+    if (m_responseSamples == 0 || m_responseSamples >= width * height) {
+        for (int c = 0; c < 3; ++c) {
+            computeResponse(response, weight, channels[c], *inputs[c],
+                            outputs[c]->data(), width, height, minAllowedValue,
+                            maxAllowedValue, averageLuminances.data());
+        }
+    } else {
+        const std::vector<size_t> samples = stratifiedSamples(
+            width, height, m_responseSamples, m_responseSeed);
+        const size_t numSamples = samples.size();
+        PRINT_DEBUG("Response estimated on " << numSamples << " pixels");
+
+        std::vector<float> sampledData(numExposures * numSamples);
+        std::vector<float> sampledOutput(numSamples);
+        DataList sampledChannels(numExposures);
+        for (size_t i = 0; i < numExposures; ++i) {
+            sampledChannels[i] = &sampledData[i * numSamples];
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            for (size_t i = 0; i < numExposures; ++i) {
+                const float *input = (*inputs[c])[i];
+                for (size_t s = 0; s < numSamples; ++s) {
+                    sampledChannels[i][s] = input[samples[s]];
+                }
+            }
+            computeResponse(response, weight, channels[c], sampledChannels,
+                            sampledOutput.data(), numSamples, 1,
+                            minAllowedValue, maxAllowedValue,
+                            averageLuminances.data());
+            applyResponse(response, weight, channels[c], *inputs[c],
+                          outputs[c]->data(), width, height, minAllowedValue,
+                          maxAllowedValue, averageLuminances.data());
+        }
+    }
 
     float cmax[3];
     cmax[0] = *max_element(outputRed->begin(), outputRed->end());
@@ -54,10 +54,20 @@ class RobertsonOperator : public IFusionOperator {
 
 class RobertsonOperatorAuto : public RobertsonOperator {
    public:
-    RobertsonOperatorAuto() : RobertsonOperator() {}
+    RobertsonOperatorAuto()
+        : RobertsonOperator(), m_responseSamples(0), m_responseSeed(0) {}
 
     FusionOperator getType() const { return ROBERTSON_AUTO; }
 
+    //! \brief estimate the response curve on \a samples pixels only, one
+    //! in each cell of a grid over the frame at a position drawn from \a seed.
+    //! The radiance map is then computed once at full resolution.
+    //! \note 0 (default) estimates the response on every pixel
+    void setResponseSampling(size_t samples, unsigned int seed = 0) {
+        m_responseSamples = samples;
+        m_responseSeed = seed;
+    }
+
    private:
     void computeFusion(ResponseCurve &response, WeightFunction &weight,
                        const std::vector<FrameEnhanced> &frames,
@@ -68,6 +78,9 @@ class RobertsonOperatorAuto : public RobertsonOperator {
                          float *outputData, size_t width, size_t height,
                          float minAllowedValue, float maxAllowedValue,
                          const float *arrayofexptime);
+
+    size_t m_responseSamples;
+    unsigned int m_responseSeed;
 };
 
 }  // fusion
@@ -33,12 +33,12 @@
 #endif
 
 #include <Common/CommonFunctions.h>
-#include <Common/init_fftw.h>
+#include <Common/fftw_plans.h>
 #include <Libpfs/colorspace/colorspace.h>
 #include <Libpfs/frame.h>
 #include <Libpfs/manip/copy.h>
 #include <Libpfs/utils/minmax.h>
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 
 #include "AutoAntighosting.h"
 // --- LEGACY CODE ---
@@ -50,28 +50,26 @@ float max(const Array2Df &u) { return *std::max_element(u.begin(), u.end()); }
 float min(const Array2Df &u) { return *std::min_element(u.begin(), u.end()); }
 
 void solve_pde_dct(Array2Df &F, Array2Df &U) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
-    // activate parallel execution of fft routines
-    init_fftw();
-
+    pfs::utils::TraceSpan trace_span("solve_pde_dct");
     const int width = U.getCols();
     const int height = U.getRows();
     assert((int)F.getCols() == width && (int)F.getRows() == height);
 
     Array2Df Ftr(width, height);
 
-    FFTW_MUTEX::fftw_mutex_plan.lock();
-    fftwf_plan p = fftwf_plan_r2r_1d(width, F.data() + width,
-                              Ftr.data() + width, FFTW_REDFT00,
-                              FFTW_ESTIMATE);
-    FFTW_MUTEX::fftw_mutex_plan.unlock();
+    // the plans run on every row, whose alignment depends on the width: they
+    // must not assume any. FFTW tells plans in place from the others
+    const FftwPlans::Plan p =
+        FftwPlans::get(FftwPlans::REDFT00_1D, 1, width, F.data(), Ftr.data(),
+                       FFTW_ESTIMATE | FFTW_UNALIGNED);
+    const FftwPlans::Plan inPlace =
+        FftwPlans::get(FftwPlans::REDFT00_1D, 1, width, U.data(), U.data(),
+                       FFTW_ESTIMATE | FFTW_UNALIGNED);
 
 #pragma omp parallel for
     for (int j = 0; j < height; j++) {
-        fftwf_execute_r2r(p, F.data() + width * j, Ftr.data() + width * j);
+        fftwf_execute_r2r(p.get(), F.data() + width * j,
+                          Ftr.data() + width * j);
     }
 
 #pragma omp parallel
@@ -104,21 +102,13 @@ void solve_pde_dct(Array2Df &F, Array2Df &U) {
     const float invDivisor = 1.0f / (2.0f * (width - 1));
 #pragma omp parallel for
     for (int j = 0; j < height; j++) {
-        fftwf_execute_r2r(p, U.data() + width * j, U.data() + width * j);
+        fftwf_execute_r2r(inPlace.get(), U.data() + width * j,
+                          U.data() + width * j);
 
         for (int i = 0; i < width; i++) {
             U(i, j) *= invDivisor;
         }
     }
-
-    FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-    fftwf_destroy_plan(p);
-    FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "solve_pde_dct = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 int findIndex(const float *data, int size) {
@@ -352,10 +342,7 @@ bool comparePatches(const HdrCreationItem &item1, const HdrCreationItem &item2,
 }
 
 void computeIrradiance(Array2Df &irradiance, const Array2Df &in) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("computeIrradiance");
 
     const int width = in.getCols();
     const int height = in.getRows();
@@ -364,19 +351,10 @@ void computeIrradiance(Array2Df &irradiance, const Array2Df &in) {
     for (int i = 0; i < width * height; ++i) {
         irradiance(i) = std::exp(in(i));
     }
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "computeIrradiance = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void computeLogIrradiance(Array2Df &logIrradiance, const Array2Df &u) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("computeLogIrradiance");
     const int width = u.getCols();
     const int height = u.getRows();
 
@@ -391,20 +369,11 @@ void computeLogIrradiance(Array2Df &logIrradiance, const Array2Df &u) {
 
         logIrradiance(i) = logIr;
     }
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "computeLogIrradiance = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void computeGradient(Array2Df &gradientX, Array2Df &gradientY,
                      const Array2Df &in) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("computeGradient");
 
     const int width = in.getCols();
     const int height = in.getRows();
@@ -436,19 +405,11 @@ void computeGradient(Array2Df &gradientX, Array2Df &gradientY,
         gradientX(width - 1, height - 1) = 0.0f;
     gradientY(0, 0) = gradientY(0, height - 1) = gradientY(width - 1, 0) =
         gradientY(width - 1, height - 1) = 0.0f;
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "computeGradient = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void computeDivergence(Array2Df &divergence, const Array2Df &gradientX,
                        const Array2Df &gradientY) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("computeDivergence");
     const int width = gradientX.getCols();
     const int height = gradientX.getRows();
 
@@ -478,11 +439,6 @@ void computeDivergence(Array2Df &divergence, const Array2Df &gradientX,
                 (gradientX(i + 1, height - 1) - gradientX(i - 1, height - 1)) +
             gradientY(i, height - 1) - gradientY(i, height - 2);
     }
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "computeDivergence = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void blendGradients(Array2Df &gradientXBlended, Array2Df &gradientYBlended,
@@ -491,10 +447,7 @@ void blendGradients(Array2Df &gradientXBlended, Array2Df &gradientYBlended,
                     const Array2Df &gradientYGood,
                     bool patches[agGridSize][agGridSize], const int gridX,
                     const int gridY) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("blendGradients");
     int width = gradientX.getCols();
     int height = gradientY.getRows();
 
@@ -533,21 +486,13 @@ void blendGradients(Array2Df &gradientXBlended, Array2Df &gradientYBlended,
             }
         }
     }
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "blendGradients = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void blendGradients(Array2Df &gradientXBlended, Array2Df &gradientYBlended,
                     const Array2Df &gradientX, const Array2Df &gradientY,
                     const Array2Df &gradientXGood,
                     const Array2Df &gradientYGood, const QImage &agMask) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("blendGradients_mask");
     int width = gradientX.getCols();
     int height = gradientY.getRows();
 
@@ -563,11 +508,6 @@ void blendGradients(Array2Df &gradientXBlended, Array2Df &gradientYBlended,
             }
         }
     }
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "blendGradients = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void colorBalance(pfs::Array2Df &U, const pfs::Array2Df &F, const int x,
@@ -36,6 +36,7 @@ HdrCreationItem::HdrCreationItem(const QString &filename)
       m_exposureTime(-1.f),
       m_datamin(0.f),
       m_datamax(1.f),
+      m_isPreview(false),
       m_frame(std::make_shared<pfs::Frame>()),
       m_thumbnail(new QImage()) {
     // qDebug() << QString("Building HdrCreationItem for %1").arg(m_filename);
@@ -50,6 +51,7 @@ HdrCreationItem::HdrCreationItem(const QString &filename,
       m_exposureTime(-1.f),
       m_datamin(0.f),
       m_datamax(1.f),
+      m_isPreview(false),
       m_frame(std::make_shared<pfs::Frame>()),
       m_thumbnail(new QImage()) {}
 
@@ -50,6 +50,11 @@ class HdrCreationItem {
     pfs::FramePtr &frame() { return m_frame; }
     bool isValid() const { return m_frame->isValid(); }
 
+    //! \brief true if frame() is a quick, half size development of a RAW
+    //! file, to be developed again at full size before merging
+    bool isPreview() const { return m_isPreview; }
+    void setPreview(bool p) { m_isPreview = p; }
+
     bool hasAverageLuminance() const { return (m_averageLuminance != -1.f); }
     void setAverageLuminance(float avl) { m_averageLuminance = avl; }
     float getAverageLuminance() const { return m_averageLuminance; }
@@ -78,6 +83,7 @@ class HdrCreationItem {
     float m_exposureTime;
     float m_datamin;
     float m_datamax;
+    bool m_isPreview;
     pfs::FramePtr m_frame;
     QSharedPointer<QImage> m_thumbnail;
 };
@@ -59,11 +59,13 @@
 #include <Libpfs/manip/copy.h>
 #include <Libpfs/manip/cut.h>
 #include <Libpfs/manip/shift.h>
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 #include <Exif/ExifOperations.h>
+#include <HdrCreation/feature_alignment.h>
 #include <HdrCreation/mtb_alignment.h>
+#include <HdrCreation/robertson02.h>
 #include <HdrWizard/WhiteBalance.h>
 #include <TonemappingOperators/fattal02/pde.h>
 #include <arch/math.h>
@@ -76,12 +78,12 @@ using namespace utils;
 using namespace libhdr::fusion;
 
 const FusionOperatorConfig predef_confs[6] = {
-    {WEIGHT_TRIANGULAR, RESPONSE_LINEAR, DEBEVEC, QString(), QString()},
-    {WEIGHT_TRIANGULAR, RESPONSE_GAMMA, DEBEVEC, QString(), QString()},
-    {WEIGHT_PLATEAU, RESPONSE_LINEAR, DEBEVEC, QString(), QString()},
-    {WEIGHT_PLATEAU, RESPONSE_GAMMA, DEBEVEC, QString(), QString()},
-    {WEIGHT_GAUSSIAN, RESPONSE_LINEAR, DEBEVEC, QString(), QString()},
-    {WEIGHT_GAUSSIAN, RESPONSE_GAMMA, DEBEVEC, QString(), QString()},
+    {WEIGHT_TRIANGULAR, RESPONSE_LINEAR, DEBEVEC, QString(), QString(), 0, 0},
+    {WEIGHT_TRIANGULAR, RESPONSE_GAMMA, DEBEVEC, QString(), QString(), 0, 0},
+    {WEIGHT_PLATEAU, RESPONSE_LINEAR, DEBEVEC, QString(), QString(), 0, 0},
+    {WEIGHT_PLATEAU, RESPONSE_GAMMA, DEBEVEC, QString(), QString(), 0, 0},
+    {WEIGHT_GAUSSIAN, RESPONSE_LINEAR, DEBEVEC, QString(), QString(), 0, 0},
+    {WEIGHT_GAUSSIAN, RESPONSE_GAMMA, DEBEVEC, QString(), QString(), 0, 0},
 };
 
 // --- NEW CODE ---
@@ -114,6 +116,24 @@ void shiftItem(HdrCreationItem &item, int dx, int dy) {
     item.qimage().swap(*img);
     img.reset();  // release memory
 }
+
+struct DevelopFullSize {
+    void operator()(HdrCreationItem &item) const {
+        if (!item.isPreview()) return;
+
+        // the user may have edited the EV of the preview
+        const float averageLuminance = item.getAverageLuminance();
+        LoadFile()(item);
+        item.setAverageLuminance(averageLuminance);
+    }
+};
+
+bool containsPreviews(const HdrCreationItemContainer &data) {
+    for (const auto &item : data) {
+        if (item.isPreview()) return true;
+    }
+    return false;
+}
 }
 
 static bool checkFileName(const HdrCreationItem &item, const QString &str) {
@@ -149,7 +169,8 @@ void HdrCreationManager::loadFiles(const QStringList &filenames) {
 
     // Start the computation.
     m_futureWatcher.setFuture(
-        QtConcurrent::map(m_tmpdata.begin(), m_tmpdata.end(), LoadFile()));
+        QtConcurrent::map(m_tmpdata.begin(), m_tmpdata.end(),
+                          LoadFile(false, m_loadPreviews)));
 }
 
 void HdrCreationManager::loadFilesDone() {
@@ -189,6 +210,30 @@ void HdrCreationManager::loadFilesDone() {
 
     refreshEVOffset();
 
+    // RAW previews cannot be compared with frames of other formats
+    if (!framesHaveSameSize() && containsPreviews(m_data)) {
+        connect(&m_developWatcher, &QFutureWatcherBase::finished, this,
+                &HdrCreationManager::developFullSizeDone);
+        m_developWatcher.setFuture(developFullSizeAsync());
+        return;
+    }
+    checkLoadedFiles();
+}
+
+void HdrCreationManager::developFullSizeDone() {
+    disconnect(&m_developWatcher, &QFutureWatcherBase::finished, this,
+               &HdrCreationManager::developFullSizeDone);
+    if (m_developWatcher.isCanceled())  // LoadFile() threw an exception
+    {
+        m_data.clear();
+        emit errorWhileLoading(
+            tr("HdrCreationManager::loadFilesDone(): Error loading a file."));
+        return;
+    }
+    checkLoadedFiles();
+}
+
+void HdrCreationManager::checkLoadedFiles() {
     if (!framesHaveSameSize()) {
         m_data.clear();
         emit errorWhileLoading(
@@ -199,6 +244,21 @@ void HdrCreationManager::loadFilesDone() {
     }
 }
 
+void HdrCreationManager::developFullSize() {
+    if (!containsPreviews(m_data)) return;
+
+    pfs::utils::TraceSpan trace_span("developFullSize");
+    QtConcurrent::blockingMap(m_data.begin(), m_data.end(), DevelopFullSize());
+}
+
+QFuture<void> HdrCreationManager::developFullSizeAsync() {
+    return QtConcurrent::map(m_data.begin(), m_data.end(), DevelopFullSize());
+}
+
+bool HdrCreationManager::hasPreviews() const {
+    return containsPreviews(m_data);
+}
+
 void HdrCreationManager::refreshEVOffset() {
     // no data
     if (m_data.size() <= 0) {
@@ -270,10 +330,13 @@ HdrCreationManager::HdrCreationManager(bool fromCommandLine)
       m_response(new ResponseCurve(predef_confs[0].responseCurve)),
       m_weight(new WeightFunction(predef_confs[0].weightFunction)),
       m_responseCurveInputFilename(),
+      m_responseSamples(0),
+      m_responseSeed(0),
       m_agMask(NULL),
       m_align(),
       m_ais_crop_flag(false),
       fromCommandLine(fromCommandLine),
+      m_loadPreviews(false),
       m_isLoadResponseCurve(false) {
     // setConfig(predef_confs[0]);
     setFusionOperator(predef_confs[0].fusionOperator);
@@ -305,6 +368,7 @@ void HdrCreationManager::setConfig(const FusionOperatorConfig &c) {
     }
     getWeightFunction().setType(c.weightFunction);
     setFusionOperator(c.fusionOperator);
+    setResponseSampling(c.responseSamples, c.responseSeed);
 }
 
 QVector<float> HdrCreationManager::getExpotimes() const {
@@ -337,8 +401,29 @@ void HdrCreationManager::align_with_mtb() {
         frames.push_back(m_data[i].frame());
     }
 
-    // run MTB
-    libhdr::mtb_alignment(frames);
+    if (containsPreviews(m_data)) {
+        // estimate the shifts on the previews, apply them at full size
+        vector<int> shiftsX;
+        vector<int> shiftsY;
+        libhdr::mtb_shifts(frames, shiftsX, shiftsY);
+
+        const double previewWidth = m_data[0].frame()->getWidth();
+        developFullSize();
+        const double scale = m_data[0].frame()->getWidth() / previewWidth;
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 1; i < (int)m_data.size(); ++i) {
+            const int dx = static_cast<int>(std::lround(shiftsX[i] * scale));
+            const int dy = static_cast<int>(std::lround(shiftsY[i] * scale));
+            if (dx || dy) {
+                FramePtr shiftedFrame(pfs::shift(*m_data[i].frame(), dx, dy));
+                m_data[i].frame()->swap(*shiftedFrame);
+            }
+        }
+    } else {
+        // run MTB
+        libhdr::mtb_alignment(frames);
+    }
 
     // rebuild previews
     QFutureWatcher<void> futureWatcher;
@@ -350,11 +435,33 @@ void HdrCreationManager::align_with_mtb() {
     emit finishedAligning(0);
 }
 
+void HdrCreationManager::align_with_features() {
+    developFullSize();
+
+    // build temporary container...
+    vector<FramePtr> frames;
+    for (size_t i = 0; i < m_data.size(); ++i) {
+        frames.push_back(m_data[i].frame());
+    }
+
+    const bool registered = libhdr::feature_alignment(frames);
+
+    // rebuild previews
+    QFutureWatcher<void> futureWatcher;
+    futureWatcher.setFuture(
+        QtConcurrent::map(m_data.begin(), m_data.end(), RefreshPreview()));
+    futureWatcher.waitForFinished();
+
+    emit finishedAligning(registered ? 0 : 1);
+}
+
 void HdrCreationManager::set_ais_crop_flag(bool flag) {
     m_ais_crop_flag = flag;
 }
 
 void HdrCreationManager::align_with_ais() {
+    developFullSize();
+
     m_align.reset(new Align(m_data, fromCommandLine, 1));
     connect(m_align.get(), &Align::finishedAligning, this,
             &HdrCreationManager::finishedAligning);
@@ -374,6 +481,8 @@ void HdrCreationManager::ais_failed_slot(QProcess::ProcessError error) {
 }
 
 pfs::Frame *HdrCreationManager::createHdr() {
+    developFullSize();
+
     std::vector<FrameEnhanced> frames;
 
     for (size_t idx = 0; idx < m_data.size(); ++idx) {
@@ -384,6 +493,10 @@ pfs::Frame *HdrCreationManager::createHdr() {
 
     libhdr::fusion::FusionOperatorPtr fusionOperatorPtr =
         IFusionOperator::build(m_fusionOperator);
+    if (m_fusionOperator == ROBERTSON_AUTO) {
+        std::static_pointer_cast<RobertsonOperatorAuto>(fusionOperatorPtr)
+            ->setResponseSampling(m_responseSamples, m_responseSeed);
+    }
     pfs::Frame *outputFrame(
         fusionOperatorPtr->computeFusion(*m_response, *m_weight, frames));
 
@@ -438,6 +551,8 @@ HdrCreationManager::~HdrCreationManager() {
 }
 
 void HdrCreationManager::saveImages(const QString &prefix) {
+    developFullSize();
+
     int idx = 0;
     for (HdrCreationItemContainer::const_iterator it = m_data.begin(),
                                                   itEnd = m_data.end();
@@ -463,10 +578,8 @@ int HdrCreationManager::computePatches(float threshold,
                                        QList<QPair<int, int>> HV_offset) {
     qDebug() << "HdrCreationManager::computePatches";
     qDebug() << threshold;
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("computePatches");
+    developFullSize();
     const int width = m_data[0].frame()->getWidth();
     const int height = m_data[0].frame()->getHeight();
     const int gridX = width / agGridSize;
@@ -517,11 +630,6 @@ int HdrCreationManager::computePatches(float threshold,
 
     memcpy(patches, m_patches, agGridSize * agGridSize);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "computePatches = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
     return m_agGoodImageIndex;
 }
 
@@ -529,10 +637,8 @@ pfs::Frame *HdrCreationManager::doAntiGhosting(bool patches[][agGridSize],
                                                int h0, bool manualAg,
                                                ProgressHelper *ph) {
     qDebug() << "HdrCreationManager::doAntiGhosting";
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("doAntiGhosting");
+    developFullSize();
     const int width = m_data[0].frame()->getWidth();
     const int height = m_data[0].frame()->getHeight();
     const int gridX = width / agGridSize;
@@ -806,11 +912,6 @@ pfs::Frame *HdrCreationManager::doAntiGhosting(bool patches[][agGridSize],
 
     emit progressFinished();
     //this->reset();
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "doAntiGhosting = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
     return deghosted;
 }
 
@@ -835,9 +936,16 @@ void HdrCreationManager::reset() {
         m_futureWatcher.waitForFinished();
         emit loadFilesAborted();
     }
+    if (m_developWatcher.isRunning()) {
+        m_developWatcher.cancel();
+        m_developWatcher.waitForFinished();
+        emit loadFilesAborted();
+    }
 
     disconnect(&m_futureWatcher, &QFutureWatcherBase::finished, this,
                &HdrCreationManager::loadFilesDone);
+    disconnect(&m_developWatcher, &QFutureWatcherBase::finished, this,
+               &HdrCreationManager::developFullSizeDone);
     m_data.clear();
     m_tmpdata.clear();
 }
@@ -65,6 +65,11 @@ class HdrCreationManager : public QObject {
     HdrCreationItem &getFile(size_t idx) { return m_data[idx]; }
     const HdrCreationItem &getFile(size_t idx) const { return m_data[idx]; }
 
+    //! \brief load the RAW files as half size previews, developed again at
+    //! full size by \c developFullSize(): for the wizard, which shows them
+    //! before merging (off by default)
+    void setLoadPreviews(bool b) { m_loadPreviews = b; }
+
     void loadFiles(const QStringList &filenames);
     void removeFile(int idx);
     void clearFiles() {
@@ -73,6 +78,14 @@ class HdrCreationManager : public QObject {
     }
     size_t availableInputFiles() const { return m_data.size(); }
 
+    //! \brief develop again at full size the RAW files that were loaded as
+    //! previews, keeping their EV. Alignment and merging call it first.
+    void developFullSize();
+    //! \brief same as \c developFullSize(), in the thread pool
+    QFuture<void> developFullSizeAsync();
+    //! \return whether some RAW files are still loaded as previews
+    bool hasPreviews() const;
+
     QStringList getFilesWithoutExif() const;
     size_t numFilesWithoutExif() const;
 
@@ -111,6 +124,12 @@ class HdrCreationManager : public QObject {
         return m_fusionOperator;
     }
 
+    //! \brief see RobertsonOperatorAuto::setResponseSampling()
+    void setResponseSampling(size_t samples, unsigned int seed) {
+        m_responseSamples = samples;
+        m_responseSeed = seed;
+    }
+
     void setResponseCurveOutputFile(const QString &filename) {
         m_responseCurveOutputFilename = filename;
     }
@@ -125,6 +144,9 @@ class HdrCreationManager : public QObject {
     void set_ais_crop_flag(bool flag);
     void align_with_ais();
     void align_with_mtb();
+    //! \brief in memory feature based alignment, that also recovers
+    //! rotation and small perspective changes
+    void align_with_features();
 
     const HdrCreationItemContainer &getData() const { return m_data; }
     // const QList<QImage*>& getAntiGhostingMasksList() const  { return
@@ -176,6 +198,9 @@ class HdrCreationManager : public QObject {
 
    private:
     bool framesHaveSameSize();
+    //! \brief emit \c finishedLoadingFiles(), or an error if the frames
+    //! have different sizes
+    void checkLoadedFiles();
     void refreshEVOffset();
 
     float m_evOffset;
@@ -185,8 +210,11 @@ class HdrCreationManager : public QObject {
     libhdr::fusion::FusionOperator m_fusionOperator;
     QString m_responseCurveInputFilename;
     QString m_responseCurveOutputFilename;
+    size_t m_responseSamples;
+    unsigned int m_responseSeed;
 
     QFutureWatcher<void> m_futureWatcher;
+    QFutureWatcher<void> m_developWatcher;
     // QList<QImage*> m_antiGhostingMasksList;  //QImages used for manual
     // anti-ghosting
     QImage *m_agMask;
@@ -197,6 +225,7 @@ class HdrCreationManager : public QObject {
 
     bool m_ais_crop_flag;
     bool fromCommandLine;
+    bool m_loadPreviews;
     int m_agGoodImageIndex;
     bool m_patches[agGridSize][agGridSize];
     bool m_isLoadResponseCurve;
@@ -204,5 +233,6 @@ class HdrCreationManager : public QObject {
    private slots:
     void ais_failed_slot(QProcess::ProcessError);
     void loadFilesDone();
+    void developFullSizeDone();
 };
 #endif
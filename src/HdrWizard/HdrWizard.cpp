@@ -39,7 +39,7 @@
 #include <QStringList>
 #include <QTextStream>
 #include <QUrl>
-// #include <QProgressDialog>
+#include <QProgressDialog>
 #include <QComboBox>
 #include <QLabel>
 #include <QThread>
@@ -108,6 +108,7 @@ HdrWizard::HdrWizard(QWidget *p, const QStringList &files,
       m_db(db),
       m_hdrPreview(new HdrPreview(0)) {
     m_Ui->setupUi(this);
+    m_hdrCreationManager->setLoadPreviews(true);
 
     if (!QIcon::hasThemeIcon(QStringLiteral("edit-clear-list")))
         m_Ui->clearListButton->setIcon(
@@ -136,6 +137,8 @@ HdrWizard::HdrWizard(QWidget *p, const QStringList &files,
 }
 
 HdrWizard::~HdrWizard() {
+    // the development works on the frames of the manager
+    m_developWatcher.waitForFinished();
 }
 
 void HdrWizard::setupConnections() {
@@ -164,6 +167,8 @@ void HdrWizard::setupConnections() {
     connect(m_Ui->cancelButton, SIGNAL(clicked()), this, SLOT(reject()));
     connect(m_Ui->pagestack, &QStackedWidget::currentChanged, this,
             &HdrWizard::currentPageChangedInto);
+    connect(&m_developWatcher, &QFutureWatcherBase::finished, this,
+            &HdrWizard::developFullSizeFinished);
 
     connect(m_Ui->loadImagesButton, &QAbstractButton::clicked, this,
             &HdrWizard::loadImagesButtonClicked);
@@ -786,6 +791,39 @@ void HdrWizard::createHdrFinished() {
 
 void HdrWizard::currentPageChangedInto(int newindex) {
     m_Ui->NextFinishButton->setText(tr("&Compute"));
+    // the RAW previews of the first page are not good enough from now on
+    if (m_hdrCreationManager->hasPreviews()) {
+        m_Ui->NextFinishButton->setEnabled(false);
+        QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+
+        QProgressDialog *progress =
+            new QProgressDialog(tr("Developing the RAW files at full size..."),
+                                QString(), 0, 0, this);
+        progress->setWindowModality(Qt::WindowModal);
+        progress->setMinimumDuration(0);
+        connect(&m_developWatcher,
+                &QFutureWatcherBase::progressRangeChanged, progress,
+                &QProgressDialog::setRange);
+        connect(&m_developWatcher,
+                &QFutureWatcherBase::progressValueChanged, progress,
+                &QProgressDialog::setValue);
+        connect(&m_developWatcher, &QFutureWatcherBase::finished, progress,
+                &QObject::deleteLater);
+
+        m_developWatcher.setFuture(
+            m_hdrCreationManager->developFullSizeAsync());
+        return;
+    }
+    showEditingTools();
+}
+
+void HdrWizard::developFullSizeFinished() {
+    QApplication::restoreOverrideCursor();
+    m_Ui->NextFinishButton->setEnabled(true);
+    showEditingTools();
+}
+
+void HdrWizard::showEditingTools() {
     // when at least 2 LDR or MDR inputs perform Manual Alignment
     int num_images = m_hdrCreationManager->getData().size();
     if (m_Ui->checkBoxEditingTools->isChecked() && num_images >= 2) {
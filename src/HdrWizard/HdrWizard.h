@@ -50,6 +50,8 @@ class HdrWizard : public QDialog {
 
     QFutureWatcher<void> m_futureWatcher;
     QFuture<pfs::Frame *> m_future;
+    // full size development of the RAW previews
+    QFutureWatcher<void> m_developWatcher;
 
     LuminanceOptions luminance_options;
 
@@ -138,6 +140,8 @@ class HdrWizard : public QDialog {
 
     void NextFinishButtonClicked();
     void currentPageChangedInto(int);
+    void developFullSizeFinished();
+    void showEditingTools();
     void editingEVfinished();
     void reject();
     void ais_failed(QProcess::ProcessError);
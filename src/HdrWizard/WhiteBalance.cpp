@@ -15,7 +15,7 @@
 #include <Libpfs/utils/clamp.h>
 #include <Libpfs/utils/numeric.h>
 #include <Libpfs/utils/transform.h>
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 using namespace pfs;
 using namespace pfs::colorspace;
@@ -129,10 +129,7 @@ void colorBalanceRGB(Array2Df &R, Array2Df &G, Array2Df &B, float nb_min,
 }
 
 void robustAWB(Array2Df *R_orig, Array2Df *G_orig, Array2Df *B_orig) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("robustAWB");
     const int width = R_orig->getCols();
     const int height = R_orig->getRows();
     float u = 0.3f;
@@ -209,11 +206,6 @@ void robustAWB(Array2Df *R_orig, Array2Df *G_orig, Array2Df *B_orig) {
     }
     copy(&R, R_orig);
     copy(&B, B_orig);
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "robustAWB = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 float computeAccumulation(const pfs::Array2Df &matrix) {
@@ -225,10 +217,7 @@ float computeAccumulation(const pfs::Array2Df &matrix) {
 }
 
 void shadesOfGrayAWB(Array2Df &R, Array2Df &G, Array2Df &B) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("shadesOfGrayAWB");
 
     float eR = 0.f;
     float eG = 0.f;
@@ -279,12 +268,6 @@ void shadesOfGrayAWB(Array2Df &R, Array2Df &G, Array2Df &B) {
             pfs::utils::vsmul(B.data(), gainB, B.data(), B.size());
         }
     }
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "shadesOfGrayAWB = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void whiteBalance(Frame &frame, WhiteBalanceType type) {
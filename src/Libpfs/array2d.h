@@ -28,6 +28,7 @@
 #include <vector>
 
 #include <Libpfs/strideiterator.h>
+#include <Libpfs/utils/scratchallocator.h>
 
 //! \file array2d.h
 //! \brief general 2d array interface
@@ -44,11 +45,15 @@ namespace pfs {
 //! order. Allows easy indexing and retrieving array dimensions.
 //! It offers an undirect access to the data (using (x)(y) or (elem) ) or a
 //! direct access to the data (using getRawData() or data()).
+//! Large arrays can be transparently backed by a memory-mapped scratch file
+//! (see \c pfs::utils::ScratchStorage): the layout stays contiguous, so
+//! every accessor keeps working, but code walking big arrays should do so
+//! by tile or by band of rows (see \c pfs::utils::forEachTile).
 //!
 template <typename Type>
 class Array2D {
    public:
-    typedef std::vector<Type> DataBuffer;
+    typedef std::vector<Type, utils::ScratchAllocator<Type> > DataBuffer;
     typedef typename DataBuffer::value_type value_type;
     typedef Array2D<Type> self;
 
@@ -56,8 +61,14 @@ class Array2D {
     Array2D();
 
     //! \brief init \c Array2D with a matrix of \a cols times \a rows
+    //! \note elements are zeroed
     Array2D(size_t cols, size_t rows);  // (width, height)
 
+    //! \brief init \c Array2D with a matrix of \a cols times \a rows showing
+    //! \a region of a file (see \c utils::ScratchStorage::adopt()), or
+    //! zeroed if the region cannot be mapped
+    Array2D(size_t cols, size_t rows, const utils::FileRegion &region);
+
     //! \brief copy ctor
     //! \note If you want to build an empty \c Array2D with the same size of the
     //! source, use the ctor that takes dimension and you will spare the copy
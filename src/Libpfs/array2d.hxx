@@ -44,6 +44,23 @@ template <typename Type>
 Array2D<Type>::Array2D(size_t cols, size_t rows)
     : m_data(cols * rows), m_cols(cols), m_rows(rows) {
     assert(m_data.size() >= m_cols * m_rows);
+    // elements are only default-initialised by the allocator
+    std::fill(m_data.begin(), m_data.end(), Type());
+}
+
+template <typename Type>
+Array2D<Type>::Array2D(size_t cols, size_t rows,
+                       const utils::FileRegion &region)
+    : m_data(typename DataBuffer::allocator_type(region)),
+      m_cols(cols),
+      m_rows(rows) {
+    // a single allocation of the exact size, which the allocator serves
+    // with the mapping
+    m_data.reserve(cols * rows);
+    m_data.resize(cols * rows);
+    if (!utils::ScratchStorage::isAdopted(m_data.data())) {
+        std::fill(m_data.begin(), m_data.end(), Type());
+    }
 }
 
 template <typename Type>
@@ -64,7 +81,11 @@ Array2D<Type> &Array2D<Type>::operator=(const Array2D<Type> &other) {
 
 template <typename Type>
 void Array2D<Type>::resize(size_t width, size_t height) {
+    const size_t oldSize = m_data.size();
     m_data.resize(width * height);
+    if (m_data.size() > oldSize) {
+        std::fill(m_data.begin() + oldSize, m_data.end(), Type());
+    }
     m_cols = width;
     m_rows = height;
 
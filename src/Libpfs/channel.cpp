@@ -33,6 +33,10 @@ namespace pfs {
 Channel::Channel(size_t width, size_t height, const std::string &channelName)
     : ChannelData(width, height), m_name(channelName), m_tags() {}
 
+Channel::Channel(size_t width, size_t height, const std::string &channelName,
+                 const utils::FileRegion &region)
+    : ChannelData(width, height, region), m_name(channelName), m_tags() {}
+
 Channel::~Channel() {}
 
 }  // pfs
@@ -43,6 +43,9 @@ class Channel : public Array2D<float> {
     typedef Array2D<float> ChannelData;
 
     Channel(size_t width, size_t height, const std::string &channelName);
+    //! \brief channel showing \a region of a file (see \c Array2D)
+    Channel(size_t width, size_t height, const std::string &channelName,
+            const utils::FileRegion &region);
 
     virtual ~Channel();
 
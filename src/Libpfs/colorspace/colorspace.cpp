@@ -38,7 +38,7 @@
 
 #include "Libpfs/array2d.h"
 #include "Libpfs/pfs.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 #include "Libpfs/colorspace/rgb.h"
 #include "Libpfs/colorspace/xyz.h"
@@ -58,20 +58,12 @@ namespace pfs {
 void transformSRGB2XYZ(const Array2Df *inC1, const Array2Df *inC2,
                        const Array2Df *inC3, Array2Df *outC1, Array2Df *outC2,
                        Array2Df *outC3) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "transformSRGB2XYZ", 3 * inC1->size() * sizeof(float));
 
     utils::transform(inC1->begin(), inC1->end(), inC2->begin(), inC3->begin(),
                      outC1->begin(), outC2->begin(), outC3->begin(),
                      colorspace::ConvertSRGB2XYZ());
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "transformSRGB2XYZ() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 void transformSRGB2Y(const Array2Df *inC1, const Array2Df *inC2,
                      const Array2Df *inC3, Array2Df *outC1) {
@@ -85,20 +77,12 @@ void transformSRGB2Y(const Array2Df *inC1, const Array2Df *inC2,
 void transformRGB2XYZ(const Array2Df *inC1, const Array2Df *inC2,
                       const Array2Df *inC3, Array2Df *outC1, Array2Df *outC2,
                       Array2Df *outC3) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "transformRGB2XYZ", 3 * inC1->size() * sizeof(float));
 
     utils::transform(inC1->begin(), inC1->end(), inC2->begin(), inC3->begin(),
                      outC1->begin(), outC2->begin(), outC3->begin(),
                      colorspace::ConvertRGB2XYZ());
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "transformRGB2XYZ() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void transformRGB2Y(const Array2Df *inC1, const Array2Df *inC2,
@@ -110,58 +94,34 @@ void transformRGB2Y(const Array2Df *inC1, const Array2Df *inC2,
 void transformRGB2Yuv(const Array2Df *inC1, const Array2Df *inC2,
                       const Array2Df *inC3, Array2Df *outC1, Array2Df *outC2,
                       Array2Df *outC3) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "transformRGB2Yuv", 3 * inC1->size() * sizeof(float));
 
     utils::transform(inC1->begin(), inC1->end(), inC2->begin(), inC3->begin(),
                      outC1->begin(), outC2->begin(), outC3->begin(),
                      colorspace::ConvertRGB2YUV());
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "transformRGB2Yuv() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void transformXYZ2SRGB(const Array2Df *inC1, const Array2Df *inC2,
                        const Array2Df *inC3, Array2Df *outC1, Array2Df *outC2,
                        Array2Df *outC3) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "transformXYZ2SRGB", 3 * inC1->size() * sizeof(float));
 
     utils::transform(inC1->begin(), inC1->end(), inC2->begin(), inC3->begin(),
                      outC1->begin(), outC2->begin(), outC3->begin(),
                      colorspace::ConvertXYZ2SRGB());
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "transformXYZ2SRGB() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void transformXYZ2RGB(const Array2Df *inC1, const Array2Df *inC2,
                       const Array2Df *inC3, Array2Df *outC1, Array2Df *outC2,
                       Array2Df *outC3) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "transformXYZ2RGB", 3 * inC1->size() * sizeof(float));
 
     utils::transform(inC1->begin(), inC1->end(), inC2->begin(), inC3->begin(),
                      outC1->begin(), outC2->begin(), outC3->begin(),
                      colorspace::ConvertXYZ2RGB());
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "transformXYZ2RGB() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void transformXYZ2Yuv(const Array2Df *inC1, const Array2Df *inC2,
@@ -204,20 +164,12 @@ void transformYuv2XYZ(const Array2Df *inC1, const Array2Df *inC2,
 void transformYuv2RGB(const Array2Df *inC1, const Array2Df *inC2,
                       const Array2Df *inC3, Array2Df *outC1, Array2Df *outC2,
                       Array2Df *outC3) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "transformYuv2RGB", 3 * inC1->size() * sizeof(float));
 
     utils::transform(inC1->begin(), inC1->end(), inC2->begin(), inC3->begin(),
                      outC1->begin(), outC2->begin(), outC3->begin(),
                      colorspace::ConvertYUV2RGB());
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "transformYuv2RGB() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 void transformYxy2XYZ(const Array2Df *inC1, const Array2Df *inC2,
@@ -0,0 +1,242 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Libpfs/colorspace/lcms.h>
+#include <Libpfs/utils/resourcehandlerlcms.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#ifndef NDEBUG
+#include <iostream>
+#define PRINT_DEBUG(str) std::cerr << "LCMS: " << str << std::endl
+#else
+#define PRINT_DEBUG(str)
+#endif
+
+namespace pfs {
+namespace colorspace {
+
+namespace {
+// enough for a few cameras, a monitor and a printer
+const size_t CACHE_SIZE = 16;
+
+// stands for the profile built by cmsCreate_sRGBProfile()
+const uint64_t SRGB_HASH = 1;
+
+// FNV-1a, 0 is kept for "no profile"
+uint64_t hashBytes(const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return std::max<uint64_t>(hash, 2);
+}
+
+// 0 if the profile cannot be serialized: its transforms are not cached
+uint64_t hashProfile(cmsHPROFILE profile) {
+    if (profile == NULL) return 0;
+
+    cmsUInt32Number size = 0;
+    if (!cmsSaveProfileToMem(profile, NULL, &size) || size == 0) return 0;
+    std::vector<unsigned char> iccData(size);
+    if (!cmsSaveProfileToMem(profile, iccData.data(), &size)) return 0;
+    return hashBytes(iccData.data(), size);
+}
+
+struct CacheKey {
+    uint64_t input;
+    uint64_t output;
+    uint64_t proof;
+    cmsUInt32Number inputFormat;
+    cmsUInt32Number outputFormat;
+    cmsUInt32Number intent;
+    cmsUInt32Number proofingIntent;
+    cmsUInt32Number flags;
+
+    bool operator==(const CacheKey &other) const {
+        return input == other.input && output == other.output &&
+               proof == other.proof && inputFormat == other.inputFormat &&
+               outputFormat == other.outputFormat && intent == other.intent &&
+               proofingIntent == other.proofingIntent && flags == other.flags;
+    }
+};
+
+typedef std::pair<CacheKey, CmsTransformPtr> CacheEntry;
+
+// most recently used first
+std::mutex s_mutex;
+std::list<CacheEntry> s_cache;
+
+CmsTransformPtr makeTransformPtr(cmsHTRANSFORM xform) {
+    if (xform == NULL) return CmsTransformPtr();
+    return CmsTransformPtr(xform, &utils::CleanUpCmsTransform::cleanup);
+}
+
+CmsTransformPtr lookup(const CacheKey &key) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (std::list<CacheEntry>::iterator it = s_cache.begin();
+         it != s_cache.end(); ++it) {
+        if (it->first == key) {
+            s_cache.splice(s_cache.begin(), s_cache, it);
+            return it->second;
+        }
+    }
+    return CmsTransformPtr();
+}
+
+// two threads may both miss and build the same transform: the second one
+// simply replaces the first, which lives on with its current users
+void insert(const CacheKey &key, const CmsTransformPtr &xform) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (std::list<CacheEntry>::iterator it = s_cache.begin();
+         it != s_cache.end(); ++it) {
+        if (it->first == key) {
+            s_cache.erase(it);
+            break;
+        }
+    }
+    s_cache.push_front(CacheEntry(key, xform));
+    if (s_cache.size() > CACHE_SIZE) s_cache.pop_back();
+}
+
+CmsTransformPtr createTransform(cmsHPROFILE input,
+                                cmsUInt32Number inputFormat,
+                                cmsHPROFILE output,
+                                cmsUInt32Number outputFormat,
+                                cmsUInt32Number intent, cmsUInt32Number flags,
+                                cmsHPROFILE proof,
+                                cmsUInt32Number proofingIntent) {
+    if (proof != NULL) {
+        return makeTransformPtr(cmsCreateProofingTransform(
+            input, inputFormat, output, outputFormat, proof, intent,
+            proofingIntent, flags));
+    }
+    return makeTransformPtr(cmsCreateTransform(input, inputFormat, output,
+                                               outputFormat, intent, flags));
+}
+}  // anonymous namespace
+
+CmsTransformPtr getCmsTransform(cmsHPROFILE input,
+                                cmsUInt32Number inputFormat,
+                                cmsHPROFILE output,
+                                cmsUInt32Number outputFormat,
+                                cmsUInt32Number intent, cmsUInt32Number flags,
+                                cmsHPROFILE proof,
+                                cmsUInt32Number proofingIntent) {
+    if (input == NULL || output == NULL) return CmsTransformPtr();
+
+    CacheKey key = {hashProfile(input),
+                    hashProfile(output),
+                    hashProfile(proof),
+                    inputFormat,
+                    outputFormat,
+                    intent,
+                    proof != NULL ? proofingIntent : 0,
+                    flags};
+    if (key.input == 0 || key.output == 0 ||
+        (proof != NULL && key.proof == 0)) {
+        return createTransform(input, inputFormat, output, outputFormat,
+                               intent, flags, proof, proofingIntent);
+    }
+
+    CmsTransformPtr xform = lookup(key);
+    if (xform) {
+        PRINT_DEBUG("Cached transform");
+        return xform;
+    }
+
+    xform = createTransform(input, inputFormat, output, outputFormat, intent,
+                            flags, proof, proofingIntent);
+    if (xform) insert(key, xform);
+    return xform;
+}
+
+CmsTransformPtr getCmsTransformToSRGB(const void *iccData, size_t iccSize,
+                                      cmsUInt32Number inputFormat,
+                                      cmsUInt32Number outputFormat,
+                                      cmsUInt32Number intent) {
+    if (iccData == NULL || iccSize == 0) return CmsTransformPtr();
+
+    CacheKey key = {hashBytes(iccData, iccSize),
+                    SRGB_HASH,
+                    0,
+                    inputFormat,
+                    outputFormat,
+                    intent,
+                    0,
+                    0};
+    CmsTransformPtr xform = lookup(key);
+    if (xform) {
+        PRINT_DEBUG("Cached transform");
+        return xform;
+    }
+
+    utils::ScopedCmsProfile hIn(cmsOpenProfileFromMem(
+        iccData, static_cast<cmsUInt32Number>(iccSize)));
+    utils::ScopedCmsProfile hsRGB(cmsCreate_sRGBProfile());
+    if (!hIn || !hsRGB) return CmsTransformPtr();
+
+    xform = createTransform(hIn.data(), inputFormat, hsRGB.data(),
+                            outputFormat, intent, 0, NULL, 0);
+    if (xform) insert(key, xform);
+    return xform;
+}
+
+void clearCmsTransformCache() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_cache.clear();
+}
+
+void RowTransform::operator()(const void *in, float *red, float *green,
+                              float *blue, size_t width) const {
+    // the three planes come out one after the other
+    thread_local std::vector<float> planes;
+    planes.resize(width * 3);
+
+    cmsDoTransform(xform_.get(), in, planes.data(),
+                   static_cast<cmsUInt32Number>(width));
+
+    std::copy(planes.begin(), planes.begin() + width, red);
+    std::copy(planes.begin() + width, planes.begin() + 2 * width, green);
+    std::copy(planes.begin() + 2 * width, planes.end(), blue);
+}
+
+void RowTransform::operator()(const void *in, size_t inStride, void *out,
+                              size_t outStride, size_t width,
+                              size_t numRows) const {
+    const char *inBytes = static_cast<const char *>(in);
+    char *outBytes = static_cast<char *>(out);
+#pragma omp parallel for
+    for (int row = 0; row < (int)numRows; ++row) {
+        cmsDoTransform(xform_.get(), inBytes + row * inStride,
+                       outBytes + row * outStride,
+                       static_cast<cmsUInt32Number>(width));
+    }
+}
+
+}  // colorspace
+}  // pfs
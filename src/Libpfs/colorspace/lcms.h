@@ -25,54 +25,69 @@
 #ifndef PFS_COLORSPACE_LCMS_H
 #define PFS_COLORSPACE_LCMS_H
 
-#include <Libpfs/colorspace/convert.h>
 #include <lcms2.h>
 
+#include <cstddef>
+#include <memory>
+
 namespace pfs {
 namespace colorspace {
 
-//! \brief Functor 4 -> 3 conversion based on LCMS
-struct Convert4LCMS3 {
-    Convert4LCMS3(cmsHTRANSFORM transform) : transform_(transform) {}
-
-    //! \brief
-    template <typename TypeIn, typename TypeOut>
-    void operator()(TypeIn i1, TypeIn i2, TypeIn i3, TypeIn i4, TypeOut &o1,
-                    TypeOut &o2, TypeOut &o3) const {
-        TypeIn inBuffer[4] = {i1, i2, i3, i4};
-        TypeOut outBuffer[3];
-
-        cmsDoTransform(transform_, &inBuffer[0], &outBuffer[0], 1);
-
-        o1 = outBuffer[0];
-        o2 = outBuffer[1];
-        o3 = outBuffer[2];
+//! \brief LCMS transform, shared by all the callers that asked for it
+typedef std::shared_ptr<void> CmsTransformPtr;
+
+//! \brief transform from \a input to \a output (soft proofed on \a proof,
+//! if not NULL), or an empty pointer if LCMS cannot build it
+//! Transforms are cached, keyed by a hash of the ICC data of the profiles,
+//! the pixel formats, the intents and the flags: the files of a camera or a
+//! monitor all carry the same profile, and building the transform costs more
+//! than converting a small image.
+CmsTransformPtr getCmsTransform(
+    cmsHPROFILE input, cmsUInt32Number inputFormat, cmsHPROFILE output,
+    cmsUInt32Number outputFormat, cmsUInt32Number intent,
+    cmsUInt32Number flags = 0, cmsHPROFILE proof = NULL,
+    cmsUInt32Number proofingIntent = INTENT_ABSOLUTE_COLORIMETRIC);
+
+//! \brief transform from the ICC profile in \a iccData to sRGB
+//! The cache is looked up on the raw bytes, so the profile is only parsed
+//! the first time it is seen.
+CmsTransformPtr getCmsTransformToSRGB(const void *iccData, size_t iccSize,
+                                      cmsUInt32Number inputFormat,
+                                      cmsUInt32Number outputFormat,
+                                      cmsUInt32Number intent);
+
+//! \brief drop all the cached transforms
+void clearCmsTransformCache();
+
+//! \brief whole scanlines through an LCMS transform, one call per row
+//! LCMS transforms can be used by many threads at once, so the rows of an
+//! image can be spread over the threads.
+class RowTransform {
+   public:
+    explicit RowTransform(const CmsTransformPtr &xform = CmsTransformPtr())
+        : xform_(xform) {}
+
+    bool isValid() const { return static_cast<bool>(xform_); }
+
+    //! \brief \a width pixels from \a in to \a out, both interleaved
+    void operator()(const void *in, void *out, size_t width) const {
+        cmsDoTransform(xform_.get(), in, out,
+                       static_cast<cmsUInt32Number>(width));
     }
 
-   private:
-    cmsHTRANSFORM transform_;
-};
-
-//! \brief Functor 4 -> 3 conversion based on LCMS
-struct Convert3LCMS3 {
-    Convert3LCMS3(cmsHTRANSFORM transform) : transform_(transform) {}
-
-    //! \brief
-    template <typename TypeIn, typename TypeOut>
-    void operator()(TypeIn i1, TypeIn i2, TypeIn i3, TypeOut &o1, TypeOut &o2,
-                    TypeOut &o3) const {
-        TypeIn inBuffer[3] = {i1, i2, i3};
-        TypeOut outBuffer[3];
+    //! \brief \a width pixels from \a in to three planes of floats
+    //! The output format of the transform must be TYPE_RGB_FLT_PLANAR.
+    void operator()(const void *in, float *red, float *green, float *blue,
+                    size_t width) const;
 
-        cmsDoTransform(transform_, &inBuffer[0], &outBuffer[0], 1);
-
-        o1 = outBuffer[0];
-        o2 = outBuffer[1];
-        o3 = outBuffer[2];
-    }
+    //! \brief \a numRows rows of \a width pixels, in parallel
+    //! \param inStride distance between the rows of \a in, in bytes
+    //! \param outStride distance between the rows of \a out, in bytes
+    void operator()(const void *in, size_t inStride, void *out,
+                    size_t outStride, size_t width, size_t numRows) const;
 
    private:
-    cmsHTRANSFORM transform_;
+    CmsTransformPtr xform_;
 };
 
 }  // colorspace
@@ -157,13 +157,19 @@ Channel *Frame::getChannel(const string &name) {
 }
 
 Channel *Frame::createChannel(const string &name) {
+    return createChannel(name, utils::FileRegion());
+}
+
+Channel *Frame::createChannel(const string &name,
+                              const utils::FileRegion &region) {
     Channel *ch = NULL;
     ChannelContainer::iterator it =
         find_if(m_channels.begin(), m_channels.end(), FindChannel(name));
     if (it != m_channels.end()) {
         ch = *it;
     } else {
-        ch = new Channel(m_width, m_height, name);
+        ch = region.bytes ? new Channel(m_width, m_height, name, region)
+                          : new Channel(m_width, m_height, name);
         m_channels.push_back(ch);
     }
 
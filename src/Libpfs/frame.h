@@ -104,6 +104,10 @@ class Frame {
     //! character long.
     //! \return existing or newly created channel
     Channel *createChannel(const std::string &name);
+    //! \brief as above, except that a newly created channel shows \a region
+    //! of a file (see \c Array2D)
+    Channel *createChannel(const std::string &name,
+                           const utils::FileRegion &region);
 
     //! Removes a channel. It is safe to remove the channel pointed by
     //! the ChannelIterator.
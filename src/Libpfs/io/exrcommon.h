@@ -0,0 +1,90 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Settings shared by the OpenEXR reader and writer
+
+#ifndef PFS_IO_EXRCOMMON_H
+#define PFS_IO_EXRCOMMON_H
+
+#include <ImfCompression.h>
+#include <ImfThreading.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include <Libpfs/params.h>
+#include <Libpfs/utils/string.h>
+
+namespace pfs {
+namespace io {
+
+//! \brief size the global thread pool of OpenEXR after the "exr_threads"
+//! (int) parameter: all the cores when it is missing or not positive
+//! OpenEXR compresses and decompresses the chunks of a file on this pool;
+//! the count is also to be given to the file, to size its line buffers.
+//! \return the number of threads
+inline int setExrThreadCount(const Params &params) {
+    int threads = 0;
+    if (!params.get("exr_threads", threads) || threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (threads > 0 && Imf::globalThreadCount() != threads) {
+        Imf::setGlobalThreadCount(threads);
+    }
+    return std::max(threads, 0);
+}
+
+//! \brief names accepted by the "exr_compression" parameter
+struct ExrCompressionName {
+    const char *name;
+    Imf::Compression compression;
+};
+
+static const ExrCompressionName EXR_COMPRESSION_NAMES[] = {
+    {"none", Imf::NO_COMPRESSION},  {"rle", Imf::RLE_COMPRESSION},
+    {"zips", Imf::ZIPS_COMPRESSION}, {"zip", Imf::ZIP_COMPRESSION},
+    {"piz", Imf::PIZ_COMPRESSION},   {"pxr24", Imf::PXR24_COMPRESSION},
+    {"b44", Imf::B44_COMPRESSION},   {"b44a", Imf::B44A_COMPRESSION},
+    {"dwaa", Imf::DWAA_COMPRESSION}, {"dwab", Imf::DWAB_COMPRESSION}};
+
+//! \brief compression called \a name (case insensitive)
+//! \return false if \a name is unknown, leaving \a compression untouched
+inline bool exrCompressionFromName(const std::string &name,
+                                   Imf::Compression &compression) {
+    utils::StringUnsensitiveComp less;
+    const size_t count =
+        sizeof(EXR_COMPRESSION_NAMES) / sizeof(EXR_COMPRESSION_NAMES[0]);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string candidate(EXR_COMPRESSION_NAMES[i].name);
+        if (!less(name, candidate) && !less(candidate, name)) {
+            compression = EXR_COMPRESSION_NAMES[i].compression;
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // io
+}  // pfs
+
+#endif  // PFS_IO_EXRCOMMON_H
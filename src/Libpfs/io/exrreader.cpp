@@ -27,19 +27,34 @@
 
 #include <ImfChannelList.h>
 #include <ImfHeader.h>
-#include <ImfInputFile.h>
+#include <ImfInputPart.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfPartType.h>
 #include <ImfRgbaFile.h>
 #include <ImfStandardAttributes.h>
 #include <ImfStringAttribute.h>
 
+#include <cassert>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include <Libpfs/array2d.h>
 #include <Libpfs/frame.h>
+#include <Libpfs/io/exrcommon.h>
 #include <Libpfs/io/exrreader.h>
 #include <Libpfs/io/ioexception.h>
+#include <Libpfs/utils/trace.h>
+
+#ifndef NDEBUG
+#define PRINT_DEBUG(str) std::cerr << "EXRReader: " << str << std::endl
+#else
+#define PRINT_DEBUG(str)
+#endif
 
 using namespace Imf;
 using namespace Imath;
@@ -57,6 +72,138 @@ static string escapeString(const string &src) {
     }
     return ret;
 }
+
+//! \brief point the R, G and B slices of \a frameBuffer to \a X, \a Y and
+//! \a Z, whose first pixel is (\a xMin, \a yMin) in the data window
+void insertRGBSlices(FrameBuffer &frameBuffer, pfs::Array2Df &X,
+                     pfs::Array2Df &Y, pfs::Array2Df &Z, int xMin, int yMin) {
+    const ptrdiff_t width = X.getCols();
+    const char *names[] = {"R", "G", "B"};
+    pfs::Array2Df *channels[] = {&X, &Y, &Z};
+
+    for (int c = 0; c < 3; ++c) {
+        frameBuffer.insert(
+            names[c],     // name
+            Slice(FLOAT,  // type
+                  (char *)(channels[c]->data() - xMin - yMin * width),
+                  sizeof(float),          // xStride
+                  sizeof(float) * width,  // yStride
+                  1, 1,                   // x/y sampling
+                  0.0));                  // fillValue
+    }
+}
+
+bool hasRGB(const Header &header) {
+    const ChannelList &channels = header.channels();
+    return channels.findChannel("R") != NULL &&
+           channels.findChannel("G") != NULL &&
+           channels.findChannel("B") != NULL;
+}
+
+//! \brief first part of \a file with the R, G and B channels, -1 if none
+int findRGBPart(const MultiPartInputFile &file) {
+    for (int part = 0; part < file.parts(); ++part) {
+        const Header &header = file.header(part);
+        if (header.hasType() && isDeepData(header.type())) continue;
+        if (hasRGB(header)) return part;
+    }
+    return -1;
+}
+
+//! \brief name of the pfs channel holding \a exrName, of the part called
+//! \a partName: "Z" is the depth, and X, Y and Z are kept for the radiance
+string pfsChannelName(const pfs::Frame &frame, const string &partName,
+                      const string &exrName) {
+    string name = (exrName == "Z") ? string("DEPTH") : exrName;
+    if (name == "X" || name == "Y" || frame.getChannel(name) != NULL) {
+        name = (partName.empty() ? string("layer") : partName) + "." + exrName;
+    }
+    return name;
+}
+
+//! \brief create a channel of \a frame for each channel of \a header but
+//! R, G and B, with its slice in \a frameBuffer
+//! Subsampled channels (the RY and BY chroma of luminance/chroma files) have
+//! no pixel of their own to map to, and are skipped.
+void insertLayerSlices(FrameBuffer &frameBuffer, pfs::Frame &frame,
+                       const Header &header, int xMin, int yMin) {
+    const string partName = header.hasName() ? header.name() : string();
+    const ptrdiff_t width = frame.getWidth();
+
+    const ChannelList &channels = header.channels();
+    for (ChannelList::ConstIterator i = channels.begin(), iEnd = channels.end();
+         i != iEnd; ++i) {
+        if (!strcmp(i.name(), "R") || !strcmp(i.name(), "G") ||
+            !strcmp(i.name(), "B")) {
+            continue;
+        }
+        if (i.channel().xSampling != 1 || i.channel().ySampling != 1) {
+            PRINT_DEBUG("Skipping subsampled channel " << i.name());
+            continue;
+        }
+
+        pfs::Channel *channel =
+            frame.createChannel(pfsChannelName(frame, partName, i.name()));
+        frameBuffer.insert(
+            i.name(),     // name
+            Slice(FLOAT,  // type
+                  (char *)(channel->data() - xMin - yMin * width),
+                  sizeof(float),          // xStride
+                  sizeof(float) * width,  // yStride
+                  1, 1,                   // x/y sampling
+                  0.0));                  // fillValue
+    }
+}
+
+//! \brief copy the string attributes of \a header to the tags of \a frame
+//! ("channel:tag" ones to the tags of the channel)
+void copyAttributes(const Header &header, pfs::Frame &frame, bool frameTags) {
+    for (Header::ConstIterator it = header.begin(), itEnd = header.end();
+         it != itEnd; ++it) {
+        const char *attribName = it.name();
+        const StringAttribute *attrib =
+            header.findTypedAttribute<StringAttribute>(attribName);
+
+        if (attrib == NULL) continue;  // Skip if type is not String
+
+        // fprintf( stderr, "Tag: %s = %s\n", attribName,
+        // attrib->value().c_str() );
+
+        const char *colon = strstr(attribName, ":");
+        if (colon == NULL)  // frame tag
+        {
+            // the name and the type of the part are not tags
+            if (!frameTags || !strcmp(attribName, "name") ||
+                !strcmp(attribName, "type")) {
+                continue;
+            }
+            frame.getTags().setTag(attribName, escapeString(attrib->value()));
+        } else  // channel tag
+        {
+            std::string channelName = string(attribName, colon - attribName);
+            pfs::Channel *ch = frame.getChannel(channelName);
+            if (ch == NULL) {
+                PRINT_DEBUG("Can not set tag for "
+                            << channelName
+                            << " channel because it does not exist");
+            } else {
+                ch->getTags().setTag(colon + 1, escapeString(attrib->value()));
+            }
+        }
+    }
+}
+
+void applyWhiteLuminance(const Header &header, pfs::Array2Df &X,
+                         pfs::Array2Df &Y, pfs::Array2Df &Z) {
+    float scaleFactor = whiteLuminance(header);
+    int pixelCount = X.size();
+
+    for (int i = 0; i < pixelCount; i++) {
+        X(i) *= scaleFactor;
+        Y(i) *= scaleFactor;
+        Z(i) *= scaleFactor;
+    }
+}
 }
 
 namespace pfs {
@@ -64,15 +211,25 @@ namespace io {
 
 class EXRReader::EXRReaderData {
    public:
-    explicit EXRReaderData(const string &filename)
-        : file_(filename.c_str())
-          // , dw_(file_.header().displayWindow())
-          ,
-          dtw_(file_.header().dataWindow()) {}
+    EXRReaderData(const string &filename, int threads)
+        : file_(filename.c_str(), threads),
+          rgbPart_(findRGBPart(file_)),
+          threads_(threads) {
+        if (rgbPart_ >= 0) {
+            rgb_.reset(new InputPart(file_, rgbPart_));
+            dtw_ = rgb_->header().dataWindow();
+        }
+    }
 
-    Imf::InputFile file_;
+    // single part files are read as multi-part files with one part
+    Imf::MultiPartInputFile file_;
+    // the part with the radiance, -1 (and no rgb_) if none
+    int rgbPart_;
+    std::unique_ptr<Imf::InputPart> rgb_;
     // Box2i dtw_;
     Box2i dtw_;
+    // decoding threads, fixed when the file is opened
+    int threads_;
 };
 
 EXRReader::EXRReader(const string &filename) : FrameReader(filename) {
@@ -83,35 +240,22 @@ EXRReader::~EXRReader() { close(); }
 
 void EXRReader::open() {
     // open file and read dimensions
-    m_data.reset(new EXRReaderData(filename().c_str()));
-
-    int width = m_data->dtw_.max.x - m_data->dtw_.min.x + 1;
-    int height = m_data->dtw_.max.y - m_data->dtw_.min.y + 1;
-
-    assert(width > 0);
-    assert(height > 0);
+    m_data.reset(
+        new EXRReaderData(filename().c_str(), setExrThreadCount(Params())));
 
     // check that file contains RGB data
-    bool red = false;
-    bool green = false;
-    bool blue = false;
-    const ChannelList &channels = m_data->file_.header().channels();
-    for (ChannelList::ConstIterator i = channels.begin(), iEnd = channels.end();
-         i != iEnd; ++i) {
-        if (!strcmp(i.name(), "R"))
-            red = true;
-        else if (!strcmp(i.name(), "G"))
-            green = true;
-        else if (!strcmp(i.name(), "B"))
-            blue = true;
-    }
-
-    if (!(red && green && blue)) {
+    if (m_data->rgbPart_ < 0) {
         throw pfs::io::InvalidHeader("OpenEXR file " + filename() +
                                      " does "
                                      " not contain RGB data");
     }
 
+    int width = m_data->dtw_.max.x - m_data->dtw_.min.x + 1;
+    int height = m_data->dtw_.max.y - m_data->dtw_.min.y + 1;
+
+    assert(width > 0);
+    assert(height > 0);
+
     // check boundaries
     /*
     if ( (m_data->dtw_.min.x < m_data->dw_.min.x &&
@@ -135,118 +279,78 @@ void EXRReader::close() {
     setHeight(0);
 }
 
-void EXRReader::read(Frame &frame, const Params & /*params*/) {
+void EXRReader::prepare(const Params &params) {
     if (!isOpen()) open();
 
+    const int threads = setExrThreadCount(params);
+    if (m_data->threads_ != threads) {
+        m_data.reset(new EXRReaderData(filename().c_str(), threads));
+    }
+}
+
+void EXRReader::read(Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span("EXRReader::read");
+    prepare(params);
+
     // helpers...
-    InputFile &file = m_data->file_;
+    InputPart &file = *m_data->rgb_;
     Box2i &dtw = m_data->dtw_;
 
+    bool readLayers = true;
+    params.get("exr_layers", readLayers);
+
     pfs::Frame tempFrame(width(), height());
     pfs::Channel *X, *Y, *Z;
     tempFrame.createXYZChannels(X, Y, Z);
 
     FrameBuffer frameBuffer;
-    frameBuffer.insert(
-        "R",          // name
-        Slice(FLOAT,  // type
-              (char *)(X->data() - dtw.min.x - dtw.min.y * width()),
-              sizeof(float),            // xStride
-              sizeof(float) * width(),  // yStride
-              1, 1,                     // x/y sampling
-              0.0));                    // fillValue
-
-    frameBuffer.insert(
-        "G",          // name
-        Slice(FLOAT,  // type
-              (char *)(Y->data() - dtw.min.x - dtw.min.y * width()),
-              sizeof(float),            // xStride
-              sizeof(float) * width(),  // yStride
-              1, 1,                     // x/y sampling
-              0.0));                    // fillValue
-
-    frameBuffer.insert(
-        "B",          // name
-        Slice(FLOAT,  // type
-              (char *)(Z->data() - dtw.min.x - dtw.min.y * width()),
-              sizeof(float),            // xStride
-              sizeof(float) * width(),  // yStride
-              1, 1,                     // x/y sampling
-              0.0));                    // fillValue
-
-    // I know I have the channels I need because I have checked that I have the
-    // RGB channels. Hence, I don't load any further that that...
-    /*
-    const ChannelList &channels = file.header().channels();
-    for ( ChannelList::ConstIterator i = channels.begin(); i != channels.end();
-    ++i )
-    {
-        if ( !strcmp( i.name(), "R" ) ||
-             !strcmp( i.name(), "G" ) || !strcmp( i.name(), "B" ) ) continue;
-
-        std::string channelName( i.name() );
-        if ( channelName == "Z" ) {
-            channelName = "DEPTH";
-        }
-        pfs::Channel *pfsCh = tempFrame.createChannel( channelName );
-        frameBuffer.insert( i.name(),                               // name
-                            Slice( FLOAT,                           // type
-                                   (char *)(pfsCh->data() - dtw.min.x -
-    dtw.min.y
-    * width()),
-                                   sizeof(float),                   // xStride
-                                   sizeof(float) * width(),         // yStride
-                                   1, 1,                            // x/y
-    sampling
-                                   0.0));                           // fillValue
-    }
-    */
-
-    // Copy attributes to tags
-    for (Header::ConstIterator it = file.header().begin(),
-                               itEnd = file.header().end();
-         it != itEnd; ++it) {
-        const char *attribName = it.name();
-        const StringAttribute *attrib =
-            file.header().findTypedAttribute<StringAttribute>(attribName);
-
-        if (attrib == NULL) continue;  // Skip if type is not String
-
-        // fprintf( stderr, "Tag: %s = %s\n", attribName,
-        // attrib->value().c_str() );
-
-        const char *colon = strstr(attribName, ":");
-        if (colon == NULL)  // frame tag
-        {
-            tempFrame.getTags().setTag(attribName,
-                                       escapeString(attrib->value()));
-        } else  // channel tag
-        {
-            std::string channelName = string(attribName, colon - attribName);
-            pfs::Channel *ch = tempFrame.getChannel(channelName);
-            if (ch == NULL) {
-                std::cerr << " Warning! Can not set tag for " << channelName
-                          << " channel because it does not exist\n";
-            } else {
-                ch->getTags().setTag(colon + 1, escapeString(attrib->value()));
-            }
-        }
+    insertRGBSlices(frameBuffer, *X, *Y, *Z, dtw.min.x, dtw.min.y);
+    if (readLayers) {
+        insertLayerSlices(frameBuffer, tempFrame, file.header(), dtw.min.x,
+                          dtw.min.y);
     }
 
     file.setFrameBuffer(frameBuffer);
     file.readPixels(dtw.min.y, dtw.max.y);
 
     // Rescale values if WhiteLuminance is present
-    if (hasWhiteLuminance(file.header())) {
-        float scaleFactor = whiteLuminance(file.header());
-        int pixelCount = tempFrame.getHeight() * tempFrame.getWidth();
+    const bool whiteLuminanceScaled = hasWhiteLuminance(file.header());
+    if (whiteLuminanceScaled) {
+        applyWhiteLuminance(file.header(), *X, *Y, *Z);
+    }
 
-        for (int i = 0; i < pixelCount; i++) {
-            (*X)(i) *= scaleFactor;
-            (*Y)(i) *= scaleFactor;
-            (*Z)(i) *= scaleFactor;
+    // the other parts hold further layers (weights, masks, depth...)
+    std::vector<int> layerParts;
+    for (int part = 0; readLayers && part < m_data->file_.parts(); ++part) {
+        if (part == m_data->rgbPart_) continue;
+
+        const Header &header = m_data->file_.header(part);
+        if ((header.hasType() && isDeepData(header.type())) ||
+            header.dataWindow().min != dtw.min ||
+            header.dataWindow().max != dtw.max) {
+            PRINT_DEBUG("Skipping part " << part << " of " << filename()
+                                         << ", not a flat image of the same"
+                                            " size");
+            continue;
         }
 
+        InputPart input(m_data->file_, part);
+        FrameBuffer layerBuffer;
+        insertLayerSlices(layerBuffer, tempFrame, header, dtw.min.x,
+                          dtw.min.y);
+
+        input.setFrameBuffer(layerBuffer);
+        input.readPixels(dtw.min.y, dtw.max.y);
+        layerParts.push_back(part);
+    }
+
+    // Copy attributes to tags, once all the channels exist
+    copyAttributes(file.header(), tempFrame, true);
+    for (size_t i = 0; i < layerParts.size(); ++i) {
+        copyAttributes(m_data->file_.header(layerParts[i]), tempFrame, false);
+    }
+
+    if (whiteLuminanceScaled) {
         // const StringAttribute *relativeLum =
         // file.header().findTypedAttribute<StringAttribute>("RELATIVE_LUMINANCE");
 
@@ -258,8 +362,40 @@ void EXRReader::read(Frame &frame, const Params & /*params*/) {
 
     tempFrame.getTags().setTag("FILE_NAME", filename());
 
+    trace_span.setBytes(
+        tempFrame.size() * tempFrame.getChannels().size() * sizeof(float));
     frame.swap(tempFrame);
 }
 
+void EXRReader::readRows(Frame &band, size_t firstRow, size_t numRows,
+                         const Params &params) {
+    prepare(params);
+
+    assert(firstRow + numRows <= height());
+
+    InputPart &file = *m_data->rgb_;
+    Box2i &dtw = m_data->dtw_;
+
+    pfs::Frame tempFrame(width(), numRows);
+    pfs::Channel *X, *Y, *Z;
+    tempFrame.createXYZChannels(X, Y, Z);
+
+    // readPixels() only decodes the chunks covering the requested rows, so
+    // the memory needed is proportional to the band, not to the image
+    const int yMin = dtw.min.y + static_cast<int>(firstRow);
+
+    FrameBuffer frameBuffer;
+    insertRGBSlices(frameBuffer, *X, *Y, *Z, dtw.min.x, yMin);
+
+    file.setFrameBuffer(frameBuffer);
+    file.readPixels(yMin, yMin + static_cast<int>(numRows) - 1);
+
+    if (hasWhiteLuminance(file.header())) {
+        applyWhiteLuminance(file.header(), *X, *Y, *Z);
+    }
+
+    band.swap(tempFrame);
+}
+
 }  // io
 }  // pfs
@@ -36,11 +36,27 @@ class EXRReader : public FrameReader {
 
     void close();
     void open();
+    //! \brief read the radiance in X, Y and Z, and any other channel of the
+    //! file (of all its parts) in a channel of the same name: "Z" becomes
+    //! "DEPTH", names clashing with the ones already read get the name of
+    //! their part as prefix
+    //!  \c params can take:
+    //!   exr_layers (bool): read the other channels (true)
+    //!   exr_threads (int): threads decoding the file (all the cores)
     void read(Frame &frame, const Params &params);
 
+    //! \brief only the radiance is read a band at a time
+    bool supportsRows() const { return true; }
+    void readRows(Frame &band, size_t firstRow, size_t numRows,
+                  const Params &params);
+
    protected:
     class EXRReaderData;
 
+    //! \brief open the file, again if \a params ask for another number of
+    //! decoding threads (exr_threads, int) than it was opened with
+    void prepare(const Params &params);
+
     std::unique_ptr<EXRReaderData> m_data;
 };
 
@@ -22,16 +22,25 @@
  */
 #include <ImfChannelList.h>
 #include <ImfHeader.h>
+#include <ImfMultiPartOutputFile.h>
 #include <ImfOutputFile.h>
+#include <ImfOutputPart.h>
+#include <ImfPartType.h>
 #include <ImfRgbaFile.h>
 #include <ImfStandardAttributes.h>
 #include <ImfStringAttribute.h>
 
 #include <cmath>
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <Libpfs/frame.h>
+#include <Libpfs/io/exrcommon.h>
 #include <Libpfs/io/exrwriter.h>
+#include <Libpfs/io/ioexception.h>
+#include <Libpfs/utils/trace.h>
 
 // #define min(x,y) ( (x)<(y) ? (x) : (y) )
 
@@ -42,19 +51,88 @@ using namespace std;
 namespace pfs {
 namespace io {
 
-EXRWriter::EXRWriter(const string &filename) : FrameWriter(filename) {}
+struct EXRWriterParams {
+    EXRWriterParams()
+        : compression_(PIZ_COMPRESSION), dwaLevel_(45.f), half_(false) {}
 
-bool EXRWriter::write(const Frame &frame, const Params & /*params*/) {
-    // Channels are named (X Y Z) but contain (R G B) data
-    const pfs::Channel *R, *G, *B;
-    frame.getXYZChannels(R, G, B);
+    void parse(const Params &params) {
+        std::string compression;
+        if (params.get("exr_compression", compression) &&
+            !exrCompressionFromName(compression, compression_)) {
+            throw pfs::io::WriteException(
+                "EXRWriter: unknown compression " + compression);
+        }
+        params.get("exr_dwa_level", dwaLevel_);
+        params.get("exr_half", half_);
+    }
+
+    Compression compression_;
+    float dwaLevel_;
+    bool half_;
+};
+
+namespace {
+// the pfs depth channel is the standard "Z" of OpenEXR: the pfs "Z" holds
+// the blue component
+string exrChannelName(const string &pfsName) {
+    return pfsName == "DEPTH" ? "Z" : pfsName;
+}
+
+// layer of a channel: its name up to the last dot, empty if none
+string layerName(const string &exrName) {
+    const size_t dot = exrName.rfind('.');
+    return dot == string::npos ? string() : exrName.substr(0, dot);
+}
+
+void insertSlice(FrameBuffer &frameBuffer, const string &name,
+                 const pfs::Channel &channel) {
+    frameBuffer.insert(name,                                        // name
+                       Slice(FLOAT,                                 // type
+                             (char *)channel.data(),                // base
+                             sizeof(float) * 1,                     // xStride
+                             sizeof(float) * channel.getWidth()));  // yStride
+}
 
+void insertChannelTags(Header &header, const pfs::Channel &channel) {
+    pfs::TagContainer::const_iterator it = channel.getTags().begin();
+    pfs::TagContainer::const_iterator itEnd = channel.getTags().end();
+
+    for (; it != itEnd; ++it) {
+        header.insert(string(channel.getName() + ":" + it->first).c_str(),
+                      StringAttribute(it->second));
+    }
+}
+
+Header createHeader(const Frame &frame, const EXRWriterParams &p) {
     Header header(frame.getWidth(), frame.getHeight(),
                   1,                 // aspect ratio
                   Imath::V2f(0, 0),  // screenWindowCenter
                   1,                 // screenWindowWidth
                   INCREASING_Y,      // lineOrder
-                  PIZ_COMPRESSION);
+                  p.compression_);
+    if (p.compression_ == DWAA_COMPRESSION ||
+        p.compression_ == DWAB_COMPRESSION) {
+        header.dwaCompressionLevel() = p.dwaLevel_;
+    }
+    return header;
+}
+}
+
+EXRWriter::EXRWriter(const string &filename) : FrameWriter(filename) {}
+
+bool EXRWriter::write(const Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span(
+        "EXRWriter::write",
+        frame.size() * frame.getChannels().size() * sizeof(float));
+    EXRWriterParams p;
+    p.parse(params);
+    const int threads = setExrThreadCount(params);
+
+    // Channels are named (X Y Z) but contain (R G B) data
+    const pfs::Channel *R, *G, *B;
+    frame.getXYZChannels(R, G, B);
+
+    Header header = createHeader(frame, p);
 
     // Copy tags to attributes
     pfs::TagContainer::const_iterator it = frame.getTags().begin();
@@ -64,50 +142,93 @@ bool EXRWriter::write(const Frame &frame, const Params & /*params*/) {
         header.insert(it->first.c_str(), StringAttribute(it->second));
     }
 
-    // Copy all channel tags
-    const pfs::ChannelContainer &channels = frame.getChannels();
+    FrameBuffer frameBuffer;
+
+    // Half float channels are converted from the float slices by OpenEXR
+    const PixelType fileType = p.half_ ? HALF : FLOAT;
 
+    // Define channels in Header
+    // and
+    // Create channels in FrameBuffer
+    header.channels().insert("R", Imf::Channel(fileType));
+    insertSlice(frameBuffer, "R", *R);
+    header.channels().insert("G", Imf::Channel(fileType));
+    insertSlice(frameBuffer, "G", *G);
+    header.channels().insert("B", Imf::Channel(fileType));
+    insertSlice(frameBuffer, "B", *B);
+
+    // The other channels (alpha, depth...) are saved next to R, G and B, in
+    // float: weights and masks need more than the precision of half. Only
+    // the channels of a named layer go to a part of their own.
+    typedef std::map<string, std::vector<const pfs::Channel *>> Layers;
+    Layers layers;
+
+    const pfs::ChannelContainer &channels = frame.getChannels();
     for (pfs::ChannelContainer::const_iterator ch = channels.begin();
          ch != channels.end(); ++ch) {
-        std::string channelName = (*ch)->getName();
-        pfs::TagContainer::const_iterator it = (*ch)->getTags().begin();
-        pfs::TagContainer::const_iterator itEnd = (*ch)->getTags().end();
-
-        for (; it != itEnd; ++it) {
-            header.insert(string(channelName + ":" + it->first).c_str(),
-                          StringAttribute(it->second));
+        if (*ch == R || *ch == G || *ch == B) {
+            insertChannelTags(header, **ch);
+            continue;
+        }
+        const string name = exrChannelName((*ch)->getName());
+        const string layer = layerName(name);
+        if (layer.empty()) {
+            header.channels().insert(name, Imf::Channel(FLOAT));
+            insertSlice(frameBuffer, name, **ch);
+            insertChannelTags(header, **ch);
+        } else {
+            layers[layer].push_back(*ch);
         }
     }
 
-    FrameBuffer frameBuffer;
+    if (layers.empty()) {
+        OutputFile file(filename().c_str(), header, threads);
+        file.setFrameBuffer(frameBuffer);
+        file.writePixels(frame.getHeight());
 
-    // Define channels in Header
-    // and
-    // Create channels in FrameBuffer
-    header.channels().insert("R", Imf::Channel(FLOAT));
-    frameBuffer.insert("R",                                       // name
-                       Slice(FLOAT,                               // type
-                             (char *)R->data(),                   // base
-                             sizeof(float) * 1,                   // xStride
-                             sizeof(float) * frame.getWidth()));  // yStride
-
-    header.channels().insert("G", Imf::Channel(FLOAT));
-    frameBuffer.insert("G",                                       // name
-                       Slice(FLOAT,                               // type
-                             (char *)G->data(),                   // base
-                             sizeof(float) * 1,                   // xStride
-                             sizeof(float) * frame.getWidth()));  // yStride
-
-    header.channels().insert("B", Imf::Channel(FLOAT));
-    frameBuffer.insert("B",                                       // name
-                       Slice(FLOAT,                               // type
-                             (char *)B->data(),                   // base
-                             sizeof(float) * 1,                   // xStride
-                             sizeof(float) * frame.getWidth()));  // yStride
-
-    OutputFile file(filename().c_str(), header);
-    file.setFrameBuffer(frameBuffer);
-    file.writePixels(frame.getHeight());
+        return true;
+    }
+
+    // Multi-part file: the radiance first, so that readers unaware of the
+    // parts still find it, then a part per layer
+    std::vector<Header> headers(1, header);
+    std::vector<FrameBuffer> frameBuffers(1, frameBuffer);
+    std::set<string> partNames;
+
+    headers[0].setName("rgb");
+    headers[0].setType(SCANLINEIMAGE);
+    partNames.insert(headers[0].name());
+
+    for (Layers::const_iterator layer = layers.begin(); layer != layers.end();
+         ++layer) {
+        Header layerHeader = createHeader(frame, p);
+        FrameBuffer layerBuffer;
+
+        string partName = layer->first;
+        while (!partNames.insert(partName).second) partName += "_";
+        layerHeader.setName(partName);
+        layerHeader.setType(SCANLINEIMAGE);
+
+        for (size_t c = 0; c < layer->second.size(); ++c) {
+            const pfs::Channel &channel = *layer->second[c];
+            const string name = exrChannelName(channel.getName());
+
+            layerHeader.channels().insert(name, Imf::Channel(FLOAT));
+            insertSlice(layerBuffer, name, channel);
+            insertChannelTags(layerHeader, channel);
+        }
+
+        headers.push_back(layerHeader);
+        frameBuffers.push_back(layerBuffer);
+    }
+
+    MultiPartOutputFile file(filename().c_str(), headers.data(),
+                             static_cast<int>(headers.size()), false, threads);
+    for (size_t part = 0; part < headers.size(); ++part) {
+        OutputPart output(file, static_cast<int>(part));
+        output.setFrameBuffer(frameBuffers[part]);
+        output.writePixels(frame.getHeight());
+    }
 
     return true;
 }
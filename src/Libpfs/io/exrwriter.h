@@ -39,6 +39,16 @@ class EXRWriter : public FrameWriter {
    public:
     EXRWriter(const std::string &filename);
 
+    //! \brief write \a frame as an OpenEXR file
+    //! X, Y and Z are saved as R, G and B, the other channels next to them
+    //! in float ("DEPTH" as "Z"). The channels of named layers ("layer.name")
+    //! make the file multi-part, with one part per layer after the radiance.
+    //!  \c params can take:
+    //!   exr_compression (std::string): none, rle, zips, zip, piz (default),
+    //!   pxr24, b44, b44a, dwaa or dwab
+    //!   exr_dwa_level (float): level of the DWAA/DWAB compression (45)
+    //!   exr_half (bool): 16 bit half float channels rather than 32 bit float
+    //!   exr_threads (int): threads compressing the file (all the cores)
     bool write(const Frame &frame, const Params &params);
 };
 
@@ -28,6 +28,7 @@
 
 #include <Libpfs/colorspace/normalizer.h>
 #include <Libpfs/frame.h>
+#include <Libpfs/utils/trace.h>
 
 #include <qglobal.h>
 // include windows.h to avoid TBYTE define clashes with fitsio.h
@@ -153,6 +154,7 @@ void FitsReader::close() {
 }
 
 void FitsReader::read(Frame &frame, const Params &) {
+    pfs::utils::TraceSpan trace_span("FitsReader::read");
     if (!isOpen()) open();
 
 #ifndef NDEBUG
@@ -305,6 +307,8 @@ void FitsReader::read(Frame &frame, const Params &) {
     std::copy(Xc->begin(), Xc->end(), Yc->begin());
     std::copy(Xc->begin(), Xc->end(), Zc->begin());
 
+    trace_span.setBytes(
+        tempFrame.size() * tempFrame.getChannels().size() * sizeof(float));
     frame.swap(tempFrame);
 }
 
@@ -22,6 +22,7 @@
 #include <Libpfs/io/framereader.h>
 
 #include <Libpfs/frame.h>
+#include <Libpfs/io/ioexception.h>
 #include <Libpfs/manip/rotate.h>
 #include <Libpfs/exif/exifdata.hpp>
 
@@ -49,5 +50,11 @@ void FrameReader::read(pfs::Frame &frame, const pfs::Params &params) {
     }
 }
 
+void FrameReader::readRows(pfs::Frame & /*band*/, size_t /*firstRow*/,
+                           size_t /*numRows*/, const pfs::Params & /*params*/) {
+    throw UnsupportedFormat("FrameReader: " + m_filename +
+                            " cannot be read one band at a time");
+}
+
 }  // io
 }  // pfs
@@ -53,6 +53,20 @@ class FrameReader {
     virtual void close() = 0;
     virtual void read(pfs::Frame &frame, const pfs::Params &params);
 
+    //! \brief true if the reader can deliver the image one band of scanlines
+    //! at a time through \c readRows()
+    virtual bool supportsRows() const { return false; }
+
+    //! \brief read rows [\a firstRow, \a firstRow + \a numRows) into \a band
+    //! \a band is resized to width() x \a numRows and receives the X, Y, Z
+    //! channels (holding RGB data, as in \c read()). Rows are best requested
+    //! in increasing order: going back to an earlier row may force the reader
+    //! to decode the file again from its start.
+    //! \note no EXIF rotation is applied
+    //! \note the default implementation throws \c UnsupportedFormat
+    virtual void readRows(pfs::Frame &band, size_t firstRow, size_t numRows,
+                          const pfs::Params &params);
+
    protected:
     void setWidth(size_t width) { m_width = width; }
     void setHeight(size_t height) { m_height = height; }
@@ -30,5 +30,18 @@ FrameWriter::FrameWriter() : m_filename() {}
 
 FrameWriter::~FrameWriter() {}
 
+void FrameWriter::beginRows(size_t /*width*/, size_t /*height*/,
+                            const pfs::Params & /*params*/) {
+    throw UnsupportedFormat("FrameWriter: " + m_filename +
+                            " cannot be written one band at a time");
+}
+
+void FrameWriter::writeRows(const pfs::Frame & /*band*/) {
+    throw UnsupportedFormat("FrameWriter: " + m_filename +
+                            " cannot be written one band at a time");
+}
+
+bool FrameWriter::endRows() { return false; }
+
 }  // io
 }  // pfs
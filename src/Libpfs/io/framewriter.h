@@ -44,6 +44,20 @@ class FrameWriter {
 
     virtual bool write(const pfs::Frame &frame, const pfs::Params &params) = 0;
 
+    //! \brief true if the writer can receive the image one band of scanlines
+    //! at a time through \c beginRows(), \c writeRows() and \c endRows()
+    virtual bool supportsRows() const { return false; }
+
+    //! \brief start writing a \a width x \a height image band by band
+    //! \note the default implementation throws \c UnsupportedFormat
+    virtual void beginRows(size_t width, size_t height,
+                           const pfs::Params &params);
+    //! \brief append all the rows of \a band (same width as the image, any
+    //! number of rows) after the ones already written
+    virtual void writeRows(const pfs::Frame &band);
+    //! \brief flush the image once all the rows have been written
+    virtual bool endRows();
+
     const std::string &filename() const { return m_filename; }
 
    private:
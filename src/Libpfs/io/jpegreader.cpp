@@ -27,13 +27,14 @@
 #include <Libpfs/colorspace/lcms.h>
 #include <Libpfs/fixedstrideiterator.h>
 #include <Libpfs/frame.h>
-#include <Libpfs/utils/resourcehandlerlcms.h>
 #include <Libpfs/utils/resourcehandlerstdio.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 #include <jpeglib.h>
 #include <cassert>
 #include <iostream>
+#include <vector>
 
 using namespace pfs;
 
@@ -262,58 +263,76 @@ void JpegReader::open() {
     setHeight(m_data->cinfo()->image_height);
 }
 
-static cmsHTRANSFORM getColorSpaceTransform(j_decompress_ptr cinfo) {
+//! \brief transform of the embedded profile to sRGB, planar float out
+static colorspace::CmsTransformPtr getColorSpaceTransform(
+    j_decompress_ptr cinfo) {
     unsigned int cmsProfileLength;
     JOCTET *cmsProfileBuffer;
     if (!read_icc_profile(cinfo, &cmsProfileBuffer, &cmsProfileLength)) {
-        return NULL;
+        return colorspace::CmsTransformPtr();
     }
     PRINT_DEBUG("Found embedded profile");
 
-    utils::ScopedCmsProfile hsRGB(cmsCreate_sRGBProfile());
-    utils::ScopedCmsProfile hIn(
-        cmsOpenProfileFromMem(cmsProfileBuffer, cmsProfileLength));
-    free(cmsProfileBuffer);
-
-    if ((!hIn) || (!hsRGB)) {  // one of the two profile is not valid
-        return NULL;
-    }
-
-#ifndef NDEBUG
-    if (cmsGetColorSpace(hIn.data()) == cmsSigRgbData)
-        PRINT_DEBUG("Image format = sRGB");
-    else if (cmsGetColorSpace(hIn.data()) == cmsSigCmykData)
-        PRINT_DEBUG("Image format = CMYK");
-    else if (cmsGetColorSpace(hIn.data()) == cmsSigYCbCrData)
-        PRINT_DEBUG("Image format = YCbCr");
-    else if (cmsGetColorSpace(hIn.data()) == cmsSigLuvKData)
-        PRINT_DEBUG("Image format = LuvK");
-#endif
-
+    cmsUInt32Number cmsInputFormat = 0;
     switch (cinfo->jpeg_color_space) {
         case JCS_RGB:
         case JCS_YCbCr: {
             PRINT_DEBUG("Transform colorspace = sRGB");
-            return cmsCreateTransform(hIn.data(), TYPE_RGB_8, hsRGB.data(),
-                                      TYPE_RGB_FLT, /*TYPE_BGRA_8,*/
-                                      INTENT_PERCEPTUAL, 0);
-
+            cmsInputFormat = TYPE_RGB_8;
         } break;
         case JCS_CMYK:
         case JCS_YCCK: {
             PRINT_DEBUG("Transform colorspace = CMYK");
-            return cmsCreateTransform(hIn.data(), TYPE_YUVK_8, hsRGB.data(),
-                                      TYPE_RGB_FLT, /*TYPE_BGRA_8,*/
-                                      INTENT_PERCEPTUAL, 0);
+            cmsInputFormat = TYPE_YUVK_8;
         } break;
         default:
             // This case should never happen, but at least the compiler
             // stops complaining!
-            return NULL;
             break;
     }
 
-    return NULL;
+    colorspace::CmsTransformPtr xform;
+    if (cmsInputFormat != 0) {
+        xform = colorspace::getCmsTransformToSRGB(
+            cmsProfileBuffer, cmsProfileLength, cmsInputFormat,
+            TYPE_RGB_FLT_PLANAR, INTENT_PERCEPTUAL);
+    }
+    free(cmsProfileBuffer);
+
+    return xform;
+}
+
+//! \brief decode the scanlines a band at a time and hand each of them to
+//! \a convert, with its index: the rows of a band are converted in parallel
+template <typename RowConverter>
+static void readRows(j_decompress_ptr cinfo, const RowConverter &convert) {
+    const JDIMENSION bandRows = 64;
+    const size_t rowSamples =
+        (size_t)cinfo->output_width * cinfo->output_components;
+
+    std::vector<JSAMPLE> band(rowSamples * bandRows);
+    std::vector<JSAMPROW> rows(bandRows);
+    for (JDIMENSION r = 0; r < bandRows; ++r) {
+        rows[r] = band.data() + r * rowSamples;
+    }
+
+    while (cinfo->output_scanline < cinfo->output_height) {
+        const JDIMENSION firstRow = cinfo->output_scanline;
+        JDIMENSION numRows = 0;
+        while (numRows < bandRows &&
+               cinfo->output_scanline < cinfo->output_height) {
+            JDIMENSION read = jpeg_read_scanlines(
+                cinfo, rows.data() + numRows, bandRows - numRows);
+            if (read == 0) break;
+            numRows += read;
+        }
+        if (numRows == 0) break;
+
+#pragma omp parallel for
+        for (int r = 0; r < (int)numRows; ++r) {
+            convert(rows[r], firstRow + r);
+        }
+    }
 }
 
 //! \brief read from a 3 components (RGB) input JPEG file
@@ -326,21 +345,14 @@ static void read3Components(j_decompress_ptr cinfo, Frame &frame,
 
     frame.createXYZChannels(red, green, blue);
 
-    std::vector<JSAMPLE> scanLineBuffer((size_t) cinfo->image_width *
-                                        cinfo->num_components);
-    JSAMPROW scanLineBufferArray[1] = {scanLineBuffer.data()};
-
-    for (int i = 0; cinfo->output_scanline < cinfo->output_height; ++i) {
-        jpeg_read_scanlines(cinfo, scanLineBufferArray, 1);
-
-        utils::transform(
-            FixedStrideIterator<JSAMPLE *, 3>(scanLineBuffer.data()),
-            FixedStrideIterator<JSAMPLE *, 3>(scanLineBuffer.data() +
-                                              cinfo->image_width * 3),
-            FixedStrideIterator<JSAMPLE *, 3>(scanLineBuffer.data() + 1),
-            FixedStrideIterator<JSAMPLE *, 3>(scanLineBuffer.data() + 2),
-            red->row_begin(i), green->row_begin(i), blue->row_begin(i), conv);
-    }
+    const size_t width = cinfo->output_width;
+    readRows(cinfo, [&](const JSAMPLE *data, JDIMENSION row) {
+        typedef FixedStrideIterator<const JSAMPLE *, 3> Iterator;
+        utils::transform(Iterator(data), Iterator(data + width * 3),
+                         Iterator(data + 1), Iterator(data + 2),
+                         red->row_begin(row), green->row_begin(row),
+                         blue->row_begin(row), conv);
+    });
 }
 
 //! \brief read from a 4 components (CMYK) input JPEG file
@@ -353,27 +365,38 @@ static void read4Components(j_decompress_ptr cinfo, Frame &frame,
 
     frame.createXYZChannels(red, green, blue);
 
-    std::vector<JSAMPLE> scanLineBuffer((size_t) cinfo->image_width *
-                                        cinfo->num_components);
-    JSAMPROW scanLineBufferArray[1] = {scanLineBuffer.data()};
-
-    for (int i = 0; cinfo->output_scanline < cinfo->output_height; ++i) {
-        jpeg_read_scanlines(cinfo, scanLineBufferArray, 1);
-
-        utils::transform(
-            FixedStrideIterator<JSAMPLE *, 4>(scanLineBuffer.data()),  // C
-            FixedStrideIterator<JSAMPLE *, 4>(scanLineBuffer.data() +
-                                              cinfo->image_width * 4),  // end C
-            FixedStrideIterator<JSAMPLE *, 4>(scanLineBuffer.data() + 1),  // M
-            FixedStrideIterator<JSAMPLE *, 4>(scanLineBuffer.data() + 2),  // Y
-            FixedStrideIterator<JSAMPLE *, 4>(scanLineBuffer.data() + 3),  // K
-            red->row_begin(i), green->row_begin(i),
-            blue->row_begin(i),  // R G B
-            conv);
-    }
+    const size_t width = cinfo->output_width;
+    readRows(cinfo, [&](const JSAMPLE *data, JDIMENSION row) {
+        typedef FixedStrideIterator<const JSAMPLE *, 4> Iterator;
+        utils::transform(Iterator(data),              // C
+                         Iterator(data + width * 4),  // end C
+                         Iterator(data + 1),          // M
+                         Iterator(data + 2),          // Y
+                         Iterator(data + 3),          // K
+                         red->row_begin(row), green->row_begin(row),
+                         blue->row_begin(row),  // R G B
+                         conv);
+    });
+}
+
+//! \brief ICC conversion of 3 or 4 components, a whole row per call to LCMS
+static void readLCMS(j_decompress_ptr cinfo, Frame &frame,
+                     const colorspace::RowTransform &xform) {
+    Channel *red;
+    Channel *green;
+    Channel *blue;
+
+    frame.createXYZChannels(red, green, blue);
+
+    const size_t width = cinfo->output_width;
+    readRows(cinfo, [&](const JSAMPLE *data, JDIMENSION row) {
+        xform(data, red->data() + row * width, green->data() + row * width,
+              blue->data() + row * width, width);
+    });
 }
 
 void JpegReader::read(Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span("JpegReader::read");
     try {
         Frame tempFrame(width(), height());
 
@@ -386,16 +409,15 @@ void JpegReader::read(Frame &frame, const Params &params) {
         assert(m_data->cinfo()->image_height == m_data->cinfo()->output_height);
         assert(m_data->cinfo()->image_width == m_data->cinfo()->output_width);
 
-        utils::ScopedCmsTransform xform(
+        colorspace::RowTransform xform(
             getColorSpaceTransform(m_data->cinfo()));
 
         switch (m_data->cinfo()->jpeg_color_space) {
             case JCS_RGB:
             case JCS_YCbCr: {
-                if (xform) {
+                if (xform.isValid()) {
                     PRINT_DEBUG("Use LCMS RGB");
-                    read3Components(m_data->cinfo(), tempFrame,
-                                    colorspace::Convert3LCMS3(xform.data()));
+                    readLCMS(m_data->cinfo(), tempFrame, xform);
                 } else {
                     read3Components(m_data->cinfo(), tempFrame,
                                     colorspace::Copy());
@@ -403,10 +425,9 @@ void JpegReader::read(Frame &frame, const Params &params) {
             } break;
             case JCS_CMYK:
             case JCS_YCCK: {
-                if (xform) {
+                if (xform.isValid()) {
                     PRINT_DEBUG("Use LCMS CMYK");
-                    read4Components(m_data->cinfo(), tempFrame,
-                                    colorspace::Convert4LCMS3(xform.data()));
+                    readLCMS(m_data->cinfo(), tempFrame, xform);
                 } else {
                     read4Components(m_data->cinfo(), tempFrame,
                                     colorspace::ConvertInvertedCMYK2RGB());
@@ -422,6 +443,8 @@ void JpegReader::read(Frame &frame, const Params &params) {
         jpeg_destroy_decompress(m_data->cinfo());
 
         FrameReader::read(tempFrame, params);
+        trace_span.setBytes(
+            tempFrame.size() * tempFrame.getChannels().size() * sizeof(float));
         frame.swap(tempFrame);
     } catch (...) {
         close();
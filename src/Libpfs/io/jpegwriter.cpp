@@ -31,9 +31,11 @@
 #include <Libpfs/io/jpegwriter.h>
 
 #include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include <jpeglib.h>
@@ -48,6 +50,7 @@
 #include <Libpfs/utils/clamp.h>
 #include <Libpfs/utils/resourcehandlerlcms.h>
 #include <Libpfs/utils/resourcehandlerstdio.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 using namespace std;
@@ -155,7 +158,8 @@ struct JpegWriterParams {
         : quality_(100),
           minLuminance_(0.f),
           maxLuminance_(1.f),
-          luminanceMapping_(MAP_LINEAR) {}
+          luminanceMapping_(MAP_LINEAR),
+          threads_(1) {}
 
     void parse(const Params &params) {
         for (Params::const_iterator it = params.begin(), itEnd = params.end();
@@ -177,13 +181,24 @@ struct JpegWriterParams {
                     it->second.as<RGBMappingType>(luminanceMapping_);
                 continue;
             }
+            if (it->first == "jpeg_threads") {
+                threads_ = it->second.as<int>(threads_);
+                continue;
+            }
         }
     }
 
+    //! \brief number of strips encoded at once, 1 for the plain libjpeg path
+    int threads() const {
+        if (threads_ > 0) return threads_;
+        return std::max<int>(std::thread::hardware_concurrency(), 1);
+    }
+
     size_t quality_;
     float minLuminance_;
     float maxLuminance_;
     RGBMappingType luminanceMapping_;
+    int threads_;
 };
 
 ostream &operator<<(ostream &out, const JpegWriterParams &params) {
@@ -192,23 +207,185 @@ ostream &operator<<(ostream &out, const JpegWriterParams &params) {
     ss << "quality: " << params.quality_ << ", ";
     ss << "min_luminance: " << params.minLuminance_ << ", ";
     ss << "max_luminance: " << params.maxLuminance_ << ", ";
-    ss << "mapping_method: " << params.luminanceMapping_ << "]";
+    ss << "mapping_method: " << params.luminanceMapping_ << ", ";
+    ss << "jpeg_threads: " << params.threads_ << "]";
 
     return (out << ss.str());
 }
 
+static void setupCompress(j_compress_ptr cinfo, size_t width, size_t height,
+                          size_t quality) {
+    cinfo->image_width = width;  // image width and height, in pixels
+    cinfo->image_height = height;
+    cinfo->input_components = cinfo->num_components =
+        3;                            // # of color components per pixel
+    cinfo->in_color_space = JCS_RGB;  // colorspace of input image
+    cinfo->jpeg_color_space = JCS_YCbCr;
+    cinfo->density_unit = 1;  // dots/inch
+    cinfo->X_density = cinfo->Y_density = 72;
+
+    jpeg_set_defaults(cinfo);
+    jpeg_set_colorspace(cinfo, JCS_YCbCr);
+
+    // avoid subsampling on high quality factor
+    jpeg_set_quality(cinfo, quality, 1);
+    if (quality >= 70) {
+        for (int i = 0; i < cinfo->num_components; i++) {
+            cinfo->comp_info[i].h_samp_factor = 1;
+            cinfo->comp_info[i].v_samp_factor = 1;
+        }
+    }
+}
+
+static void convertRow(const pfs::Frame &frame, size_t row,
+                       const JpegWriterParams &params, JSAMPLE *out) {
+    const Channel *rChannel;
+    const Channel *gChannel;
+    const Channel *bChannel;
+    frame.getXYZChannels(rChannel, gChannel, bChannel);
+
+    utils::transform(
+        rChannel->row_begin(row), rChannel->row_end(row),
+        gChannel->row_begin(row), bChannel->row_begin(row),
+        FixedStrideIterator<JSAMPLE *, 3>(out),
+        FixedStrideIterator<JSAMPLE *, 3>(out + 1),
+        FixedStrideIterator<JSAMPLE *, 3>(out + 2),
+        utils::chain(
+            colorspace::Normalizer(params.minLuminance_, params.maxLuminance_),
+            utils::CLAMP_F32, Remapper<JSAMPLE>(params.luminanceMapping_)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Parallel encoding
+//
+// The image is cut in strips of STRIP_ROWS rows, that are encoded at the same
+// time by independent compressors, with a restart marker after every row of
+// MCUs. All the compressors share the same quantization and Huffman tables,
+// and a restart resets the DC predictors, so the entropy coded data of the
+// strips can be stitched together: the first strip gives the headers, the
+// following ones only their scan data, each preceded by the restart marker
+// that libjpeg would have written at that point.
+//
+
+typedef std::vector<JOCTET> JpegBuffer;
+
+// a multiple of 8 MCU rows, whatever the subsampling: the numbering of the
+// restart markers of each strip is the one of the whole image
+static const size_t STRIP_ROWS = 256;
+static const size_t STRIP_BLOCK_SIZE = 65536;
+
+struct StripDestination {
+    struct jpeg_destination_mgr pub;
+    JpegBuffer *buffer;
+};
+
+static void strip_init_destination(j_compress_ptr cinfo) {
+    StripDestination *dest = reinterpret_cast<StripDestination *>(cinfo->dest);
+    dest->buffer->resize(STRIP_BLOCK_SIZE);
+    cinfo->dest->next_output_byte = dest->buffer->data();
+    cinfo->dest->free_in_buffer = dest->buffer->size();
+}
+
+static boolean strip_empty_output_buffer(j_compress_ptr cinfo) {
+    StripDestination *dest = reinterpret_cast<StripDestination *>(cinfo->dest);
+    size_t oldsize = dest->buffer->size();
+    dest->buffer->resize(oldsize * 2);
+    cinfo->dest->next_output_byte = dest->buffer->data() + oldsize;
+    cinfo->dest->free_in_buffer = dest->buffer->size() - oldsize;
+    return true;
+}
+
+static void strip_term_destination(j_compress_ptr cinfo) {
+    StripDestination *dest = reinterpret_cast<StripDestination *>(cinfo->dest);
+    dest->buffer->resize(dest->buffer->size() - cinfo->dest->free_in_buffer);
+}
+
+//! \brief encode \a numRows rows of interleaved RGB samples as a complete
+//! JPEG image into \a out
+//! \return the height of a MCU
+static int encodeStrip(const JSAMPLE *rows, size_t width, size_t numRows,
+                       const JpegWriterParams &params,
+                       const std::vector<JOCTET> &iccProfile, JpegBuffer &out) {
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr errorHandler;
+    cinfo.err = jpeg_std_error(&errorHandler);
+    errorHandler.error_exit = my_writer_error_handler;
+    errorHandler.output_message = my_writer_output_message;
+
+    jpeg_create_compress(&cinfo);
+    int mcuHeight = 0;
+    try {
+        setupCompress(&cinfo, width, numRows, params.quality_);
+        cinfo.optimize_coding = FALSE;  // same Huffman tables for all
+        cinfo.restart_in_rows = 1;
+
+        StripDestination dest;
+        dest.pub.init_destination = strip_init_destination;
+        dest.pub.empty_output_buffer = strip_empty_output_buffer;
+        dest.pub.term_destination = strip_term_destination;
+        dest.buffer = &out;
+        cinfo.dest = &dest.pub;
+
+        jpeg_start_compress(&cinfo, true);
+        if (!iccProfile.empty()) {
+            write_icc_profile(&cinfo, iccProfile.data(), iccProfile.size());
+        }
+        mcuHeight = cinfo.max_v_samp_factor * DCTSIZE;
+
+        for (size_t row = 0; row < numRows; ++row) {
+            JSAMPROW scanLine = const_cast<JSAMPLE *>(rows + row * width * 3);
+            jpeg_write_scanlines(&cinfo, &scanLine, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+    } catch (...) {
+        jpeg_destroy_compress(&cinfo);
+        throw;
+    }
+    jpeg_destroy_compress(&cinfo);
+    return mcuHeight;
+}
+
+//! \return the offset of the entropy coded data in \a jpeg, 0 if there is
+//! no scan. \a sofOffset is set to the offset of the frame header.
+static size_t findScanData(const JpegBuffer &jpeg, size_t &sofOffset) {
+    size_t pos = 2;  // SOI
+    while (pos + 4 <= jpeg.size()) {
+        if (jpeg[pos] != 0xFF) return 0;
+        const int marker = jpeg[pos + 1];
+        if (marker == 0xFF) {  // fill byte
+            ++pos;
+            continue;
+        }
+        const size_t length = (jpeg[pos + 2] << 8) | jpeg[pos + 3];
+        // SOF0 to SOF15, except DHT, JPG and DAC
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+            marker != 0xC8 && marker != 0xCC) {
+            sofOffset = pos;
+        }
+        if (marker == 0xDA) return pos + 2 + length;  // SOS
+        pos += 2 + length;
+    }
+    return 0;
+}
+
 class JpegWriterImpl {
    public:
-    JpegWriterImpl() {}
-    virtual ~JpegWriterImpl() {}
+    JpegWriterImpl() : m_created(false), m_stripWidth(0) {}
+    virtual ~JpegWriterImpl() { abort(); }
 
     virtual void setupJpegDest(j_compress_ptr cinfo,
                                const std::string &filename) = 0;
     virtual void close() = 0;
     virtual size_t getFileSize() const = 0;
 
-    bool write(const pfs::Frame &frame, const JpegWriterParams &params,
+    //! \brief open the destination and write the header of a \a width x
+    //! \a height image
+    //! \throw std::runtime_error on failure
+    void begin(size_t width, size_t height, const JpegWriterParams &params,
                const std::string &filename) {
+        abort();
+
         cmsUInt32Number cmsProfileSize = 0;
         utils::ScopedCmsProfile hsRGB(cmsCreate_sRGBProfile());
 
@@ -220,91 +397,222 @@ class JpegWriterImpl {
         cmsSaveProfileToMem(hsRGB.data(), cmsOutputProfile.data(),
                             &cmsProfileSize);
 
-        struct jpeg_compress_struct cinfo;
-        struct jpeg_error_mgr errorHandler;
-
-        jpeg_create_compress(&cinfo);
-
-        cinfo.err = jpeg_std_error(&errorHandler);
-        errorHandler.error_exit = my_writer_error_handler;
-        errorHandler.output_message = my_writer_output_message;
-
-        cinfo.image_width =
-            frame.getWidth();  // image width and height, in pixels
-        cinfo.image_height = frame.getHeight();
-        cinfo.input_components = cinfo.num_components =
-            3;                           // # of color components per pixel
-        cinfo.in_color_space = JCS_RGB;  // colorspace of input image
-        cinfo.jpeg_color_space = JCS_YCbCr;
-        cinfo.density_unit = 1;  // dots/inch
-        cinfo.X_density = cinfo.Y_density = 72;
-
-        jpeg_set_defaults(&cinfo);
-        jpeg_set_colorspace(&cinfo, JCS_YCbCr);
-
-        // avoid subsampling on high quality factor
-        jpeg_set_quality(&cinfo, params.quality_, 1);
-        if (params.quality_ >= 70) {
-            for (int i = 0; i < cinfo.num_components; i++) {
-                cinfo.comp_info[i].h_samp_factor = 1;
-                cinfo.comp_info[i].v_samp_factor = 1;
-            }
+        m_params = params;
+        if (params.threads() > 1) {
+            beginStrips(width, height, filename);
+            m_iccProfile.swap(cmsOutputProfile);
+            return;
+        }
+
+        m_cinfo.err = jpeg_std_error(&m_errorHandler);
+        m_errorHandler.error_exit = my_writer_error_handler;
+        m_errorHandler.output_message = my_writer_output_message;
+
+        jpeg_create_compress(&m_cinfo);
+        m_created = true;
+
+        setupCompress(&m_cinfo, width, height, params.quality_);
+
+        setupJpegDest(&m_cinfo, filename);
+
+        jpeg_start_compress(&m_cinfo, true);
+
+        write_icc_profile(&m_cinfo, cmsOutputProfile.data(), cmsProfileSize);
+
+        m_scanLineOut.resize((size_t)m_cinfo.image_width *
+                             m_cinfo.num_components);
+    }
+
+    //! \brief encode all the rows of \a frame
+    void writeRows(const pfs::Frame &frame) {
+        if (m_stripWidth) {
+            writeStripRows(frame);
+            return;
+        }
+        assert(m_created);
+        assert(frame.getWidth() == m_cinfo.image_width);
+
+        JSAMPROW scanLineOutArray[1] = {m_scanLineOut.data()};
+
+        for (size_t row = 0; row < frame.getHeight() &&
+                             m_cinfo.next_scanline < m_cinfo.image_height;
+             ++row) {
+            // copy line from Frame into scanLineOut
+            convertRow(frame, row, m_params, m_scanLineOut.data());
+            jpeg_write_scanlines(&m_cinfo, scanLineOutArray, 1);
+        }
+    }
+
+    void finish() {
+        if (m_stripWidth) {
+            finishStrips();
+            return;
         }
+        jpeg_finish_compress(&m_cinfo);
+        jpeg_destroy_compress(&m_cinfo);
+        m_created = false;
 
+        close();
+    }
+
+    //! \brief release the compressor without completing the image
+    void abort() {
+        if (m_created) {
+            jpeg_destroy_compress(&m_cinfo);
+            m_created = false;
+        }
+        m_stripWidth = 0;
+        m_pending.clear();
+    }
+
+    bool write(const pfs::Frame &frame, const JpegWriterParams &params,
+               const std::string &filename) {
         try {
-            setupJpegDest(&cinfo, filename);
-
-            jpeg_start_compress(&cinfo, true);
-
-            const Channel *rChannel;
-            const Channel *gChannel;
-            const Channel *bChannel;
-            frame.getXYZChannels(rChannel, gChannel, bChannel);
-
-            write_icc_profile(&cinfo, cmsOutputProfile.data(), cmsProfileSize);
-
-            // If an exception is raised, this buffer gets automatically
-            // destructed!
-            std::vector<JSAMPLE> scanLineOut((size_t) cinfo.image_width *
-                                             cinfo.num_components);
-            JSAMPROW scanLineOutArray[1] = {scanLineOut.data()};
-
-            while (cinfo.next_scanline < cinfo.image_height) {
-                // copy line from Frame into scanLineOut
-                utils::transform(
-                    rChannel->row_begin(cinfo.next_scanline),
-                    rChannel->row_end(cinfo.next_scanline),
-                    gChannel->row_begin(cinfo.next_scanline),
-                    bChannel->row_begin(cinfo.next_scanline),
-                    FixedStrideIterator<JSAMPLE *, 3>(scanLineOut.data()),
-                    FixedStrideIterator<JSAMPLE *, 3>(scanLineOut.data() + 1),
-                    FixedStrideIterator<JSAMPLE *, 3>(scanLineOut.data() + 2),
-                    utils::chain(colorspace::Normalizer(params.minLuminance_,
-                                                        params.maxLuminance_),
-                                 utils::CLAMP_F32,
-                                 Remapper<JSAMPLE>(params.luminanceMapping_)));
-                jpeg_write_scanlines(&cinfo, scanLineOutArray, 1);
-            }
+            begin(frame.getWidth(), frame.getHeight(), params, filename);
+            writeRows(frame);
+            finish();
         } catch (const std::runtime_error &err) {
             std::clog << err.what() << std::endl;
 
-            jpeg_destroy_compress(&cinfo);
+            abort();
 
             return false;
         }
 
-        jpeg_finish_compress(&cinfo);
-        jpeg_destroy_compress(&cinfo);
+        return true;
+    }
+
+   protected:
+    //! \brief open the destination for writeBytes()
+    virtual void openBytes(const std::string &filename) = 0;
+    virtual void writeBytes(const JOCTET *data, size_t size) = 0;
+
+   private:
+    void beginStrips(size_t width, size_t height,
+                     const std::string &filename) {
+        if (width == 0 || height == 0) {
+            throw std::runtime_error("JPEG: empty image");
+        }
+        openBytes(filename);
+        m_stripWidth = width;
+        m_stripHeight = height;
+        m_rowsReceived = 0;
+        m_stripsWritten = 0;
+        m_intervals = 0;
+        m_pending.clear();
+    }
+
+    void writeStripRows(const pfs::Frame &frame) {
+        assert(frame.getWidth() == m_stripWidth);
+
+        const size_t rowSize = m_stripWidth * 3;
+        const size_t numRows =
+            std::min(frame.getHeight(), m_stripHeight - m_rowsReceived);
+        const size_t offset = m_pending.size();
+        m_pending.resize(offset + numRows * rowSize);
+#pragma omp parallel for
+        for (int row = 0; row < (int)numRows; ++row) {
+            convertRow(frame, row, m_params,
+                       m_pending.data() + offset + row * rowSize);
+        }
+        m_rowsReceived += numRows;
+
+        const size_t batchRows = m_params.threads() * STRIP_ROWS;
+        while (m_pending.size() >= batchRows * rowSize) {
+            encodeStrips(batchRows);
+        }
+    }
+
+    void finishStrips() {
+        if (!m_pending.empty()) {
+            encodeStrips(m_pending.size() / (m_stripWidth * 3));
+        }
+        const JOCTET eoi[2] = {0xFF, JPEG_EOI};
+        writeBytes(eoi, 2);
+        m_stripWidth = 0;
+        m_iccProfile.clear();
 
         close();
+    }
 
-        return true;
+    //! \brief encode and write the first \a numRows pending rows
+    void encodeStrips(size_t numRows) {
+        const size_t rowSize = m_stripWidth * 3;
+        const int numStrips = (numRows + STRIP_ROWS - 1) / STRIP_ROWS;
+        std::vector<JpegBuffer> strips(numStrips);
+        std::vector<int> mcuHeights(numStrips);
+        std::string error;
+
+#pragma omp parallel for num_threads(m_params.threads()) schedule(dynamic)
+        for (int s = 0; s < numStrips; ++s) {
+            const size_t first = s * STRIP_ROWS;
+            const bool header = (m_stripsWritten == 0 && s == 0);
+            try {
+                mcuHeights[s] = encodeStrip(
+                    m_pending.data() + first * rowSize, m_stripWidth,
+                    std::min(STRIP_ROWS, numRows - first), m_params,
+                    header ? m_iccProfile : std::vector<JOCTET>(), strips[s]);
+            } catch (const std::runtime_error &err) {
+#pragma omp critical
+                error = err.what();
+            }
+        }
+        if (!error.empty()) throw std::runtime_error(error);
+
+        for (int s = 0; s < numStrips; ++s) {
+            const size_t rows = std::min(STRIP_ROWS, numRows - s * STRIP_ROWS);
+            writeStrip(strips[s], (rows + mcuHeights[s] - 1) / mcuHeights[s]);
+        }
+        m_pending.erase(m_pending.begin(),
+                        m_pending.begin() + numRows * rowSize);
+    }
+
+    //! \brief append the scan of \a jpeg, made of \a intervals restart
+    //! intervals, to the output
+    void writeStrip(JpegBuffer &jpeg, size_t intervals) {
+        size_t sofOffset = 0;
+        const size_t scan = findScanData(jpeg, sofOffset);
+        if (scan == 0 || sofOffset == 0 || jpeg.size() < scan + 2) {
+            throw std::runtime_error("JPEG: cannot parse an encoded strip");
+        }
+        const size_t end = jpeg.size() - 2;  // EOI
+
+        if (m_stripsWritten == 0) {
+            // the headers are for the whole image
+            jpeg[sofOffset + 5] = (m_stripHeight >> 8) & 0xFF;
+            jpeg[sofOffset + 6] = m_stripHeight & 0xFF;
+            writeBytes(jpeg.data(), end);
+        } else {
+            assert(m_intervals % 8 == 0);
+            const JOCTET restart[2] = {
+                0xFF, static_cast<JOCTET>(JPEG_RST0 + ((m_intervals - 1) & 7))};
+            writeBytes(restart, 2);
+            writeBytes(jpeg.data() + scan, end - scan);
+        }
+        m_intervals += intervals;
+        ++m_stripsWritten;
     }
+
+    struct jpeg_compress_struct m_cinfo;
+    struct jpeg_error_mgr m_errorHandler;
+    bool m_created;
+
+    // parallel encoding, m_stripWidth is 0 for the plain libjpeg path
+    size_t m_stripWidth;
+    size_t m_stripHeight;
+    size_t m_rowsReceived;
+    size_t m_stripsWritten;
+    size_t m_intervals;
+    std::vector<JSAMPLE> m_pending;
+    std::vector<JOCTET> m_iccProfile;
+
+    JpegWriterParams m_params;
+    // If an exception is raised, this buffer gets automatically destructed!
+    std::vector<JSAMPLE> m_scanLineOut;
 };
 
 //! \ref
 //! http://www.andrewewhite.net/wordpress/2010/04/07/simple-cc-jpeg-writer-part-2-write-to-buffer-in-memory/
-typedef std::vector<JOCTET> JpegBuffer;
 
 struct JpegWriterImplMemory : public JpegWriterImpl {
     typedef std::map<j_compress_ptr, JpegBuffer *> JpegRegistry;
@@ -317,11 +625,21 @@ struct JpegWriterImplMemory : public JpegWriterImpl {
     void setupJpegDest(j_compress_ptr cinfo, const std::string &filename);
 
     void close() {
+        if (!m_cinfo) return;
+
         sm_registry.erase(m_cinfo);
         m_cinfo->dest = NULL;
     }
     size_t getFileSize() const { return (m_buffer.size() * sizeof(JOCTET)); }
 
+   protected:
+    void openBytes(const std::string & /*filename*/) { m_buffer.clear(); }
+    void writeBytes(const JOCTET *data, size_t size) {
+        m_buffer.insert(m_buffer.end(), data, data + size);
+    }
+
+   public:
+
     static JpegBuffer &getBuffer(j_compress_ptr cinfo) {
         JpegRegistry::iterator it = sm_registry.find(cinfo);
         if (it != sm_registry.end()) {
@@ -395,6 +713,14 @@ struct JpegWriterImplFile : public JpegWriterImpl {
     void close() { m_handle.reset(); }
     size_t getFileSize() const { return 0; }
 
+   protected:
+    void openBytes(const std::string &filename) { open(filename); }
+    void writeBytes(const JOCTET *data, size_t size) {
+        if (fwrite(data, 1, size, handle()) != size) {
+            throw std::runtime_error("JPEG: cannot write the output file");
+        }
+    }
+
    private:
     void open(const std::string &filename) {
         m_handle.reset(fopen(filename.c_str(), "wb"));
@@ -417,6 +743,9 @@ JpegWriter::JpegWriter(const std::string &filename)
 JpegWriter::~JpegWriter() {}
 
 bool JpegWriter::write(const pfs::Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span(
+        "JpegWriter::write",
+        frame.size() * frame.getChannels().size() * sizeof(float));
     JpegWriterParams p;
     p.parse(params);
 
@@ -427,6 +756,38 @@ bool JpegWriter::write(const pfs::Frame &frame, const Params &params) {
     return m_impl->write(frame, p, filename());
 }
 
+void JpegWriter::beginRows(size_t width, size_t height, const Params &params) {
+    JpegWriterParams p;
+    p.parse(params);
+
+    try {
+        m_impl->begin(width, height, p, filename());
+    } catch (const std::runtime_error &err) {
+        m_impl->abort();
+        throw WriteException(err.what());
+    }
+}
+
+void JpegWriter::writeRows(const pfs::Frame &band) {
+    try {
+        m_impl->writeRows(band);
+    } catch (const std::runtime_error &err) {
+        m_impl->abort();
+        throw WriteException(err.what());
+    }
+}
+
+bool JpegWriter::endRows() {
+    try {
+        m_impl->finish();
+    } catch (const std::runtime_error &err) {
+        std::clog << err.what() << std::endl;
+        m_impl->abort();
+        return false;
+    }
+    return true;
+}
+
 size_t JpegWriter::getFileSize() const { return m_impl->getFileSize(); }
 
 }  // io
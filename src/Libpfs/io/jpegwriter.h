@@ -53,6 +53,11 @@ class JpegWriter : public FrameWriter {
     //! \brief write a pfs::Frame into file or memory
     bool write(const pfs::Frame &frame, const pfs::Params &params);
 
+    bool supportsRows() const { return true; }
+    void beginRows(size_t width, size_t height, const pfs::Params &params);
+    void writeRows(const pfs::Frame &band);
+    bool endRows();
+
     //! \brief return size in bytes of the file written
     size_t getFileSize() const;
 
@@ -33,4 +33,9 @@
 #define MAX_TAG_STRING 1024
 #define MAX_CHANNEL_COUNT 1024
 
+//! \brief channel data aligned on this boundary can be mapped in memory
+#define PFS_DATA_ALIGNMENT 16
+//! \brief tag whose value pads the header up to \c PFS_DATA_ALIGNMENT
+#define PFS_PADDING_TAG "PFS_PADDING"
+
 #endif  // PFS_IO_PFSCOMMON_H
@@ -23,7 +23,11 @@
 #include <Libpfs/io/pfscommon.h>
 #include <Libpfs/io/pfsreader.h>
 
+#include <Libpfs/utils/scratchallocator.h>
+#include <Libpfs/utils/trace.h>
+
 #include <list>
+#include <utility>
 
 namespace pfs {
 namespace io {
@@ -44,6 +48,10 @@ void readTags(TagContainer &tags, FILE *in) {
             throw Exception("Corrupted PFS tag section: missing tag");
         }
         std::string data(buf);
+        // the end of line is not part of the value
+        if (!data.empty() && data[data.size() - 1] == PFSEOLCH) {
+            data.erase(data.size() - 1);
+        }
         size_t found = data.find_first_of("=");
         if (found != std::string::npos) {
 #ifndef NDEBUG
@@ -111,14 +119,18 @@ void PfsReader::close() {
 }
 
 void PfsReader::read(Frame &frame, const Params & /*params*/) {
+    pfs::utils::TraceSpan trace_span("PfsReader::read");
     if (!isOpen()) open();
 
     Frame tempFrame(width(), height());
 
     readTags(tempFrame.getTags(), m_file.data());
+    tempFrame.getTags().removeTag(PFS_PADDING_TAG);
 
-    // read channel IDs and tags
-    std::list<Channel *> orderedChannel;
+    // read channel IDs and tags: channels are only created once the offset
+    // of their data is known
+    typedef std::pair<std::string, TagContainer> ChannelHeader;
+    std::list<ChannelHeader> channelHeaders;
     for (size_t i = 0; i < m_channelCount; i++) {
         char channelName[MAX_CHANNEL_NAME + 1], *rs;
         rs = fgets(channelName, MAX_CHANNEL_NAME, m_file.data());
@@ -133,9 +145,9 @@ void PfsReader::read(Frame &frame, const Params & /*params*/) {
         }
 
         channelName[len - 1] = 0;
-        Channel *ch = tempFrame.createChannel(channelName);
-        readTags(ch->getTags(), m_file.data());
-        orderedChannel.push_back(ch);
+        channelHeaders.push_back(ChannelHeader(channelName, TagContainer()));
+        readTags(channelHeaders.back().second, m_file.data());
+        channelHeaders.back().second.removeTag(PFS_PADDING_TAG);
     }
 
     char buf[5];
@@ -145,11 +157,35 @@ void PfsReader::read(Frame &frame, const Params & /*params*/) {
             "Corrupted PFS file: missing end of header (ENDH) token");
     }
 
-    // Read channels
-    std::list<Channel *>::iterator it;
-    for (it = orderedChannel.begin(); it != orderedChannel.end(); ++it) {
-        Channel *ch = *it;
-        unsigned int size = tempFrame.getWidth() * tempFrame.getHeight();
+    // Read channels: a channel whose data is suitably aligned in the file is
+    // mapped in memory (copy-on-write) rather than read
+    const size_t size = tempFrame.getWidth() * tempFrame.getHeight();
+    const size_t channelBytes = size * sizeof(float);
+    size_t offset = ftell(m_file.data());
+    bool inSequence = true;
+
+    std::list<ChannelHeader>::iterator it;
+    for (it = channelHeaders.begin(); it != channelHeaders.end();
+         ++it, offset += channelBytes) {
+        // a channel met before (same name twice) is read over again
+        const bool mappable = (offset % PFS_DATA_ALIGNMENT == 0) &&
+                              !tempFrame.getChannel(it->first);
+        Channel *ch = mappable
+                          ? tempFrame.createChannel(
+                                it->first,
+                                utils::FileRegion(fileno(m_file.data()),
+                                                  offset, channelBytes))
+                          : tempFrame.createChannel(it->first);
+        ch->getTags().swap(it->second);
+        if (mappable && utils::ScratchStorage::isAdopted(ch->data())) {
+            inSequence = false;
+            continue;
+        }
+
+        if (!inSequence) {
+            fseek(m_file.data(), static_cast<long>(offset), SEEK_SET);
+            inSequence = true;
+        }
         read = fread(ch->data(), sizeof(float), size, m_file.data());
         if (read != size) {
             throw ReadException("Corrupted PFS file: missing channel data");
@@ -159,6 +195,8 @@ void PfsReader::read(Frame &frame, const Params & /*params*/) {
     setmode(fileno(inputStream), old_mode);
 #endif
 
+    trace_span.setBytes(
+        tempFrame.size() * tempFrame.getChannels().size() * sizeof(float));
     frame.swap(tempFrame);
 }
 
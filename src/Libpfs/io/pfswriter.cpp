@@ -21,20 +21,42 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <Libpfs/frame.h>
 #include <Libpfs/io/pfscommon.h>
 #include <Libpfs/io/pfswriter.h>
 #include <Libpfs/tag.h>
 #include <Libpfs/utils/resourcehandlerstdio.h>
+#include <Libpfs/utils/trace.h>
 
 namespace pfs {
 namespace io {
 
 static const char *PFSFILEID = "PFS1\x0a";
 
-void writeTags(const TagContainer &tags, FILE *out) {
-    fprintf(out, "%d" PFSEOL, (int)tags.size());
+//! \brief write \a tags; if \a padHeader, they are the last ones of the
+//! header and a padding tag aligns the data following "ENDH"
+void writeTags(const TagContainer &tags, FILE *out, bool padHeader = false) {
+    if (!padHeader) {
+        fprintf(out, "%d" PFSEOL, (int)tags.size());
+    } else {
+        // header length once the padding tag (and ENDH) are written
+        size_t length = ftell(out) +
+                        fprintf(out, "%d" PFSEOL, (int)tags.size() + 1) +
+                        strlen(PFS_PADDING_TAG "=" PFSEOL "ENDH");
+        for (TagContainer::const_iterator it = tags.begin(); it != tags.end();
+             ++it) {
+            length += it->first.size() + it->second.size() + 2;
+        }
+        const size_t padding =
+            (PFS_DATA_ALIGNMENT - length % PFS_DATA_ALIGNMENT) %
+            PFS_DATA_ALIGNMENT;
+        fprintf(out, "%s", std::string(PFS_PADDING_TAG "=" +
+                                       std::string(padding, ' '))
+                               .c_str());
+        fprintf(out, PFSEOL);
+    }
     for (TagContainer::const_iterator it = tags.begin(); it != tags.end();
          ++it) {
         fprintf(out, "%s", std::string(it->first + "=" + it->second).c_str());
@@ -45,9 +67,17 @@ void writeTags(const TagContainer &tags, FILE *out) {
 PfsWriter::PfsWriter(const std::string &filename) : FrameWriter(filename) {}
 
 bool PfsWriter::write(const Frame &frame, const Params & /*params*/) {
-    utils::ScopedStdIoFile outputStream(fopen(filename().c_str(), "wb"));
+    pfs::utils::TraceSpan trace_span(
+        "PfsWriter::write",
+        frame.size() * frame.getChannels().size() * sizeof(float));
+    // the channels of the frame may be mappings of the file being replaced
+    // (see PfsReader): truncating it would pull the data from under them.
+    // Write a new file instead, then rename it over the old one, which
+    // lives on as long as it is mapped.
+    const std::string tempName = filename() + ".part";
+    utils::ScopedStdIoFile outputStream(fopen(tempName.c_str(), "wb"));
     if (!outputStream) {
-        throw pfs::io::InvalidFile("PfsWriter: cannot open " + filename());
+        throw pfs::io::InvalidFile("PfsWriter: cannot open " + tempName);
     }
 
 #ifdef HAVE_SETMODE
@@ -64,13 +94,15 @@ bool PfsWriter::write(const Frame &frame, const Params & /*params*/) {
             (int)frame.getHeight());
     fprintf(outputStream.data(), "%d" PFSEOL, (int)channels.size());
 
-    writeTags(frame.getTags(), outputStream.data());
+    writeTags(frame.getTags(), outputStream.data(), channels.empty());
 
-    // Write channel IDs and tags
+    // Write channel IDs and tags, then pad the header so that readers can
+    // map the channel data in memory
     for (ChannelContainer::const_iterator it = channels.begin();
          it != channels.end(); ++it) {
         fprintf(outputStream.data(), "%s" PFSEOL, (*it)->getName().c_str());
-        writeTags((*it)->getTags(), outputStream.data());
+        writeTags((*it)->getTags(), outputStream.data(),
+                  it + 1 == channels.end());
     }
 
     fprintf(outputStream.data(), "ENDH");
@@ -87,6 +119,21 @@ bool PfsWriter::write(const Frame &frame, const Params & /*params*/) {
 #ifdef HAVE_SETMODE
     setmode(fileno(outputStream.data()), old_mode);
 #endif
+    const bool failed = ferror(outputStream.data()) != 0;
+    outputStream.reset();
+    if (failed) {
+        std::remove(tempName.c_str());
+        throw pfs::io::WriteException("PfsWriter: cannot write " + tempName);
+    }
+#ifdef _WIN32
+    // rename() does not replace an existing file
+    std::remove(filename().c_str());
+#endif
+    if (std::rename(tempName.c_str(), filename().c_str()) != 0) {
+        std::remove(tempName.c_str());
+        throw pfs::io::WriteException("PfsWriter: cannot replace " +
+                                      filename());
+    }
     return true;
 }
 
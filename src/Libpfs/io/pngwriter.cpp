@@ -23,13 +23,20 @@
 #include "pngwriter.h"
 
 #include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <lcms2.h>
 #include <png.h>
 #include <stdio.h>
+#include <zlib.h>
 
 #include <Libpfs/colorspace/normalizer.h>
 #include <Libpfs/colorspace/rgbremapper.h>
@@ -39,6 +46,7 @@
 #include <Libpfs/utils/clamp.h>
 #include <Libpfs/utils/resourcehandlerlcms.h>
 #include <Libpfs/utils/resourcehandlerstdio.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 using namespace std;
@@ -52,7 +60,8 @@ struct PngWriterParams {
         : quality_(100),
           minLuminance_(0.f),
           maxLuminance_(1.f),
-          luminanceMapping_(MAP_LINEAR) {}
+          luminanceMapping_(MAP_LINEAR),
+          threads_(1) {}
 
     void parse(const Params &params) {
         for (Params::const_iterator it = params.begin(), itEnd = params.end();
@@ -74,6 +83,10 @@ struct PngWriterParams {
                     it->second.as<RGBMappingType>(luminanceMapping_);
                 continue;
             }
+            if (it->first == "png_threads") {
+                threads_ = it->second.as<int>(threads_);
+                continue;
+            }
         }
     }
 
@@ -86,10 +99,17 @@ struct PngWriterParams {
         return compLevel;
     }
 
+    //! \brief number of strips encoded at once, 1 for the plain libpng path
+    int threads() const {
+        if (threads_ > 0) return threads_;
+        return std::max<int>(std::thread::hardware_concurrency(), 1);
+    }
+
     size_t quality_;
     float minLuminance_;
     float maxLuminance_;
     RGBMappingType luminanceMapping_;
+    int threads_;
 };
 
 ostream &operator<<(ostream &out, const PngWriterParams &params) {
@@ -98,7 +118,8 @@ ostream &operator<<(ostream &out, const PngWriterParams &params) {
     ss << "compression_level: " << params.compressionLevel() << ", ";
     ss << "min_luminance: " << params.minLuminance_ << ", ";
     ss << "max_luminance: " << params.maxLuminance_ << ", ";
-    ss << "mapping_method: " << params.luminanceMapping_ << "]";
+    ss << "mapping_method: " << params.luminanceMapping_ << ", ";
+    ss << "png_threads: " << params.threads_ << "]";
 
     return (out << ss.str());
 }
@@ -124,10 +145,152 @@ static void png_write_icc_profile(png_structp png_ptr, png_infop info_ptr) {
                  profileBuffer.data(), (png_uint_32)profileSize);
 }
 
+static void convertRow(const pfs::Frame &frame, size_t row,
+                       const PngWriterParams &params, png_byte *red,
+                       png_byte *green, png_byte *blue) {
+    const Channel *rChannel;
+    const Channel *gChannel;
+    const Channel *bChannel;
+    frame.getXYZChannels(rChannel, gChannel, bChannel);
+
+    utils::transform(
+        rChannel->row_begin(row), rChannel->row_end(row),
+        gChannel->row_begin(row), bChannel->row_begin(row),
+        FixedStrideIterator<png_byte *, 3>(red),
+        FixedStrideIterator<png_byte *, 3>(green),
+        FixedStrideIterator<png_byte *, 3>(blue),
+        utils::chain(
+            colorspace::Normalizer(params.minLuminance_, params.maxLuminance_),
+            utils::CLAMP_F32, Remapper<png_byte>(params.luminanceMapping_)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Parallel encoding
+//
+// The image is cut in strips of STRIP_ROWS rows, that are filtered and
+// deflated at the same time. Each strip is a raw deflate stream primed with
+// the last 32K of the previous strip and closed by a sync flush (the last one
+// by Z_FINISH), so the strips concatenate into one zlib stream, whose adler32
+// is combined from the ones of the strips. Every strip becomes an IDAT chunk.
+//
+
+static const size_t STRIP_ROWS = 128;
+static const size_t WINDOW_SIZE = 32768;
+static const size_t BYTES_PER_PIXEL = 3;
+
+static png_byte PNG_IDAT[5] = {'I', 'D', 'A', 'T', '\0'};
+static png_byte PNG_IEND[5] = {'I', 'E', 'N', 'D', '\0'};
+
+static inline int paethPredictor(int a, int b, int c) {
+    const int pa = std::abs(b - c);
+    const int pb = std::abs(a - c);
+    const int pc = std::abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+//! \brief filter one row, choosing the filter like libpng does: the one with
+//! the smallest sum of the outputs taken as signed bytes
+//! \param prior the row above, NULL for the first row of the image
+//! \param out filter type followed by the filtered row
+static void filterRow(const png_byte *row, const png_byte *prior,
+                      size_t rowBytes, png_byte *out,
+                      std::vector<png_byte> &candidate) {
+    candidate.resize(rowBytes + 1);
+    size_t bestSum = std::numeric_limits<size_t>::max();
+
+    for (png_byte type = PNG_FILTER_VALUE_NONE; type < PNG_FILTER_VALUE_LAST;
+         ++type) {
+        candidate[0] = type;
+        size_t sum = 0;
+        for (size_t i = 0; i < rowBytes; ++i) {
+            const int a = i >= BYTES_PER_PIXEL ? row[i - BYTES_PER_PIXEL] : 0;
+            const int b = prior ? prior[i] : 0;
+            const int c =
+                (prior && i >= BYTES_PER_PIXEL) ? prior[i - BYTES_PER_PIXEL]
+                                                : 0;
+            int predicted = 0;
+            switch (type) {
+                case PNG_FILTER_VALUE_SUB:
+                    predicted = a;
+                    break;
+                case PNG_FILTER_VALUE_UP:
+                    predicted = b;
+                    break;
+                case PNG_FILTER_VALUE_AVG:
+                    predicted = (a + b) / 2;
+                    break;
+                case PNG_FILTER_VALUE_PAETH:
+                    predicted = paethPredictor(a, b, c);
+                    break;
+            }
+            const png_byte v = static_cast<png_byte>(row[i] - predicted);
+            candidate[i + 1] = v;
+            sum += v < 128 ? v : 256 - v;
+        }
+        if (sum < bestSum) {
+            bestSum = sum;
+            std::copy(candidate.begin(), candidate.end(), out);
+        }
+    }
+}
+
+//! \brief raw deflate of \a size bytes of \a data, primed with
+//! \a dictionary, into \a out
+//! \param last close the stream, or leave it open on a byte boundary
+static void deflateStrip(const png_byte *data, size_t size,
+                         const std::vector<png_byte> &dictionary, int level,
+                         bool last, std::vector<png_byte> &out) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_FILTERED) !=
+        Z_OK) {
+        throw io::WriteException("PNG: Failed to initialize zlib");
+    }
+    if (!dictionary.empty()) {
+        deflateSetDictionary(&stream, dictionary.data(), dictionary.size());
+    }
+
+    // room for the sync flush too
+    out.resize(deflateBound(&stream, size) + 16);
+    stream.next_in = const_cast<png_byte *>(data);
+    stream.avail_in = size;
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int ret = deflate(&stream, flush);
+    while (ret == Z_OK && (last || stream.avail_out == 0)) {
+        const size_t used = out.size() - stream.avail_out;
+        out.resize(out.size() * 2);
+        stream.next_out = out.data() + used;
+        stream.avail_out = out.size() - used;
+        ret = deflate(&stream, flush);
+    }
+    out.resize(out.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    if (ret != (last ? Z_STREAM_END : Z_OK)) {
+        throw io::WriteException("PNG: Failed to compress the image");
+    }
+}
+
+//! \brief the two bytes opening a zlib stream compressed at \a level
+static void zlibHeader(int level, png_byte header[2]) {
+    const int levelFlags = level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2
+                                                                        : 3));
+    header[0] = 0x78;  // deflate, 32K window
+    header[1] = levelFlags << 6;
+    header[1] += 31 - (header[0] * 256 + header[1]) % 31;
+}
+
 class PngWriterImpl {
    public:
-    PngWriterImpl() : m_filesize(0) {}
-    virtual ~PngWriterImpl() {}
+    PngWriterImpl()
+        : m_filesize(0), m_pngPtr(NULL), m_infoPtr(NULL), m_stripWidth(0) {}
+    virtual ~PngWriterImpl() { destroy(); }
 
     virtual void setupPngDest(png_structp png_ptr,
                               const std::string &filename) = 0;
@@ -138,81 +301,272 @@ class PngWriterImpl {
     size_t getFileSize() { return m_filesize; }
     void setFileSize(size_t size) { m_filesize = size; }
 
-    bool write(const pfs::Frame &frame, const PngWriterParams &params,
+    //! \brief open the destination and write the header of a \a width x
+    //! \a height image
+    void begin(size_t width, size_t height, const PngWriterParams &params,
                const std::string &filename) {
-        png_uint_32 width = frame.getWidth();
-        png_uint_32 height = frame.getHeight();
+        abort();
 
-        png_structp png_ptr =
+        m_params = params;
+        m_pngPtr =
             png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-        if (!png_ptr) {
+        if (!m_pngPtr) {
             close();
 
             throw io::WriteException("PNG: Failed to create write struct");
-            return false;
         }
 
-        png_infop info_ptr = png_create_info_struct(png_ptr);
-        if (!info_ptr) {
-            png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-            close();
+        m_infoPtr = png_create_info_struct(m_pngPtr);
+        if (!m_infoPtr) {
+            abort();
 
             throw io::WriteException("PNG: Failed to create info struct");
-            return false;
         }
 
-        if (setjmp(png_jmpbuf(png_ptr))) {
-            png_destroy_write_struct(&png_ptr, &info_ptr);
-            close();
+        if (setjmp(png_jmpbuf(m_pngPtr))) {
+            abort();
 
             throw io::WriteException("PNG: Error writing file");
-            return false;
         }
 
-        setupPngDest(png_ptr, filename);
+        setupPngDest(m_pngPtr, filename);
 
-        png_set_IHDR(png_ptr, info_ptr, width, height, 8,
+        png_set_IHDR(m_pngPtr, m_infoPtr, (png_uint_32)width,
+                     (png_uint_32)height, 8,
                      /*PNG_COLOR_TYPE_RGB_ALPHA*/ PNG_COLOR_TYPE_RGB,
                      PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
                      PNG_FILTER_TYPE_DEFAULT);
 
-        png_set_compression_level(png_ptr, params.compressionLevel());
-        png_set_bgr(png_ptr);
-        png_write_icc_profile(png_ptr,
-                              info_ptr);  // user defined function, see above
-        png_write_info(png_ptr, info_ptr);
-
-        const Channel *rChannel;
-        const Channel *gChannel;
-        const Channel *bChannel;
-        frame.getXYZChannels(rChannel, gChannel, bChannel);
-
-        std::vector<png_byte> scanLineOut(width * 3);
-        for (png_uint_32 row = 0; row < height; ++row) {
-            utils::transform(
-                rChannel->row_begin(row), rChannel->row_end(row),
-                gChannel->row_begin(row), bChannel->row_begin(row),
-                FixedStrideIterator<png_byte *, 3>(scanLineOut.data() + 2),
-                FixedStrideIterator<png_byte *, 3>(scanLineOut.data() + 1),
-                FixedStrideIterator<png_byte *, 3>(scanLineOut.data()),
-                utils::chain(colorspace::Normalizer(params.minLuminance_,
-                                                    params.maxLuminance_),
-                             utils::CLAMP_F32,
-                             Remapper<png_byte>(params.luminanceMapping_)));
-            png_write_row(png_ptr, scanLineOut.data());
+        png_set_compression_level(m_pngPtr, params.compressionLevel());
+        png_set_bgr(m_pngPtr);
+        png_write_icc_profile(m_pngPtr,
+                              m_infoPtr);  // user defined function, see above
+        png_write_info(m_pngPtr, m_infoPtr);
+
+        if (params.threads() > 1) {
+            beginStrips(width, height);
+            return;
+        }
+        m_scanLineOut.resize(width * 3);
+    }
+
+    //! \brief encode all the rows of \a frame
+    void writeRows(const pfs::Frame &frame) {
+        assert(m_pngPtr != NULL);
+
+        // libpng reports errors with a longjmp() to the last setjmp(), which
+        // must happen in the calling function
+        if (setjmp(png_jmpbuf(m_pngPtr))) {
+            abort();
+
+            throw io::WriteException("PNG: Error writing file");
+        }
+
+        if (m_stripWidth) {
+            writeStripRows(frame);
+            return;
+        }
+        assert(frame.getWidth() * 3 == m_scanLineOut.size());
+
+        for (size_t row = 0; row < frame.getHeight(); ++row) {
+            // BGR, see png_set_bgr()
+            convertRow(frame, row, m_params, m_scanLineOut.data() + 2,
+                       m_scanLineOut.data() + 1, m_scanLineOut.data());
+            png_write_row(m_pngPtr, m_scanLineOut.data());
+        }
+    }
+
+    void finish() {
+        assert(m_pngPtr != NULL);
+
+        if (setjmp(png_jmpbuf(m_pngPtr))) {
+            abort();
+
+            throw io::WriteException("PNG: Error writing file");
         }
 
-        png_write_end(png_ptr, info_ptr);
-        png_destroy_write_struct(&png_ptr, &info_ptr);
+        if (m_stripWidth) {
+            if (m_rowsReceived != m_stripHeight) {
+                abort();
+                throw io::WriteException("PNG: Missing rows");
+            }
+            // png_write_end() only knows about the rows of png_write_row()
+            encodeStrips(m_pendingRows, true);
+            png_write_chunk(m_pngPtr, PNG_IEND, NULL, 0);
+            m_stripWidth = 0;
+        } else {
+            png_write_end(m_pngPtr, m_infoPtr);
+        }
+        png_destroy_write_struct(&m_pngPtr, &m_infoPtr);
 
         computeSize();
         close();
+    }
+
+    //! \brief release the encoder without completing the image
+    void abort() {
+        if (m_pngPtr) {
+            destroy();
+            close();
+        }
+    }
+
+    bool write(const pfs::Frame &frame, const PngWriterParams &params,
+               const std::string &filename) {
+        begin(frame.getWidth(), frame.getHeight(), params, filename);
+        writeRows(frame);
+        finish();
 
         return true;
     }
 
    protected:
     size_t m_filesize;
+
+   private:
+    void destroy() {
+        if (m_pngPtr) {
+            png_destroy_write_struct(&m_pngPtr, m_infoPtr ? &m_infoPtr : NULL);
+        }
+        m_pngPtr = NULL;
+        m_infoPtr = NULL;
+        m_stripWidth = 0;
+    }
+
+    void beginStrips(size_t width, size_t height) {
+        m_stripWidth = width;
+        m_stripHeight = height;
+        m_rowsReceived = 0;
+        m_pendingRows = 0;
+        m_pending.clear();
+        m_priorRow.clear();
+        m_dictionary.clear();
+        m_adler = adler32(0L, Z_NULL, 0);
+        m_headerWritten = false;
+    }
+
+    void writeStripRows(const pfs::Frame &frame) {
+        assert(frame.getWidth() == m_stripWidth);
+
+        const size_t rowBytes = m_stripWidth * BYTES_PER_PIXEL;
+        const size_t numRows =
+            std::min(frame.getHeight(), m_stripHeight - m_rowsReceived);
+        m_pending.resize((m_pendingRows + numRows) * rowBytes);
+        png_byte *out = m_pending.data() + m_pendingRows * rowBytes;
+#pragma omp parallel for
+        for (int row = 0; row < (int)numRows; ++row) {
+            png_byte *rgb = out + row * rowBytes;
+            convertRow(frame, row, m_params, rgb, rgb + 1, rgb + 2);
+        }
+        m_rowsReceived += numRows;
+        m_pendingRows += numRows;
+
+        // the last strip is left to finish(), that closes the stream
+        const size_t batchRows = m_params.threads() * STRIP_ROWS;
+        while (m_pendingRows > batchRows) {
+            encodeStrips(batchRows, false);
+        }
+    }
+
+    //! \brief filter, compress and write the first \a numRows pending rows
+    //! \param last they end the image
+    void encodeStrips(size_t numRows, bool last) {
+        const size_t rowBytes = m_stripWidth * BYTES_PER_PIXEL;
+        const int numStrips = (numRows + STRIP_ROWS - 1) / STRIP_ROWS;
+        std::vector<std::vector<png_byte>> filtered(numStrips);
+        std::vector<std::vector<png_byte>> compressed(numStrips);
+        std::vector<uLong> adlers(numStrips);
+        std::string error;
+
+#pragma omp parallel num_threads(m_params.threads())
+        {
+            std::vector<png_byte> candidate;
+#pragma omp for schedule(dynamic)
+            for (int s = 0; s < numStrips; ++s) {
+                const size_t first = s * STRIP_ROWS;
+                const size_t rows = std::min(STRIP_ROWS, numRows - first);
+                filtered[s].resize(rows * (rowBytes + 1));
+                for (size_t r = first; r < first + rows; ++r) {
+                    const png_byte *row = m_pending.data() + r * rowBytes;
+                    const png_byte *prior =
+                        r > 0 ? row - rowBytes
+                              : (m_priorRow.empty() ? NULL : m_priorRow.data());
+                    filterRow(row, prior, rowBytes,
+                              filtered[s].data() + (r - first) * (rowBytes + 1),
+                              candidate);
+                }
+            }
+
+#pragma omp for schedule(dynamic)
+            for (int s = 0; s < numStrips; ++s) {
+                const std::vector<png_byte> &data = filtered[s];
+                std::vector<png_byte> dictionary;
+                if (s == 0) {
+                    dictionary = m_dictionary;
+                } else {
+                    const std::vector<png_byte> &previous = filtered[s - 1];
+                    dictionary.assign(
+                        previous.end() - std::min(previous.size(), WINDOW_SIZE),
+                        previous.end());
+                }
+                adlers[s] = adler32(adler32(0L, Z_NULL, 0), data.data(),
+                                    data.size());
+                try {
+                    deflateStrip(data.data(), data.size(), dictionary,
+                                 m_params.compressionLevel(),
+                                 last && s == numStrips - 1, compressed[s]);
+                } catch (const io::WriteException &err) {
+#pragma omp critical
+                    error = err.what();
+                }
+            }
+        }
+        if (!error.empty()) throw io::WriteException(error);
+
+        for (int s = 0; s < numStrips; ++s) {
+            std::vector<png_byte> &chunk = compressed[s];
+            if (!m_headerWritten) {
+                png_byte header[2];
+                zlibHeader(m_params.compressionLevel(), header);
+                chunk.insert(chunk.begin(), header, header + 2);
+                m_headerWritten = true;
+            }
+            m_adler =
+                adler32_combine(m_adler, adlers[s], filtered[s].size());
+            if (last && s == numStrips - 1) {
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    chunk.push_back((m_adler >> shift) & 0xFF);
+                }
+            }
+            png_write_chunk(m_pngPtr, PNG_IDAT, chunk.data(), chunk.size());
+        }
+
+        const std::vector<png_byte> &tail = filtered.back();
+        m_dictionary.assign(tail.end() - std::min(tail.size(), WINDOW_SIZE),
+                            tail.end());
+        m_priorRow.assign(m_pending.begin() + (numRows - 1) * rowBytes,
+                          m_pending.begin() + numRows * rowBytes);
+        m_pending.erase(m_pending.begin(),
+                        m_pending.begin() + numRows * rowBytes);
+        m_pendingRows -= numRows;
+    }
+
+    png_structp m_pngPtr;
+    png_infop m_infoPtr;
+
+    // parallel encoding, m_stripWidth is 0 for the plain libpng path
+    size_t m_stripWidth;
+    size_t m_stripHeight;
+    size_t m_rowsReceived;
+    size_t m_pendingRows;
+    std::vector<png_byte> m_pending;
+    std::vector<png_byte> m_priorRow;
+    std::vector<png_byte> m_dictionary;
+    uLong m_adler;
+    bool m_headerWritten;
+
+    PngWriterParams m_params;
+    std::vector<png_byte> m_scanLineOut;
 };
 
 struct PngWriterImplFile : public PngWriterImpl {
@@ -273,6 +627,9 @@ PngWriter::PngWriter(const string &filename)
 PngWriter::~PngWriter() { m_impl->close(); }
 
 bool PngWriter::write(const pfs::Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span(
+        "PngWriter::write",
+        frame.size() * frame.getChannels().size() * sizeof(float));
     PngWriterParams p;
     p.parse(params);
 
@@ -283,6 +640,20 @@ bool PngWriter::write(const pfs::Frame &frame, const Params &params) {
     return m_impl->write(frame, p, filename());
 }
 
+void PngWriter::beginRows(size_t width, size_t height, const Params &params) {
+    PngWriterParams p;
+    p.parse(params);
+
+    m_impl->begin(width, height, p, filename());
+}
+
+void PngWriter::writeRows(const pfs::Frame &band) { m_impl->writeRows(band); }
+
+bool PngWriter::endRows() {
+    m_impl->finish();
+    return true;
+}
+
 size_t PngWriter::getFileSize() const { return m_impl->getFileSize(); }
 
 }  // io
@@ -50,6 +50,11 @@ class PngWriter : public FrameWriter {
 
     bool write(const pfs::Frame &frame, const pfs::Params &params);
 
+    bool supportsRows() const { return true; }
+    void beginRows(size_t width, size_t height, const pfs::Params &params);
+    void writeRows(const pfs::Frame &band);
+    bool endRows();
+
     size_t getFileSize() const;
 
    private:
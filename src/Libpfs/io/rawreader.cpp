@@ -22,6 +22,7 @@
  *
  */
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <sstream>
@@ -32,6 +33,7 @@
 #include <Libpfs/fixedstrideiterator.h>
 #include <Libpfs/frame.h>
 #include <Libpfs/io/rawreader.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 using namespace pfs;
@@ -112,6 +114,7 @@ struct RAWReaderParams {
           gamma1_(12.92),
           fourColorRGB_(0),
           useFujiRotate_(-1),
+          halfSize_(false),
           userQuality_(USER_QUALITY),
           medPasses_(0),
           wbMethod_(1),
@@ -145,6 +148,9 @@ struct RAWReaderParams {
         if (params.get("raw.fuji_rotate", tempInt)) {
             useFujiRotate_ = tempInt;
         }
+        if (params.get("raw.half_size", tempBool)) {
+            halfSize_ = tempBool;
+        }
         if (params.get("raw.user_quality", tempInt)) {
             userQuality_ = tempInt;
         }
@@ -233,6 +239,7 @@ struct RAWReaderParams {
 
     int fourColorRGB_;
     int useFujiRotate_;
+    bool halfSize_;
 
     int userQuality_;
     int medPasses_;
@@ -267,6 +274,7 @@ ostream &operator<<(ostream &out, const RAWReaderParams &p) {
     ss << "[gamma0: " << p.gamma0_ << ", gamma1: " << p.gamma1_;
     ss << ", 4-Color RGB: " << p.fourColorRGB_;
     ss << ", Fuji Rotate: " << p.useFujiRotate_;
+    ss << ", Half Size: " << p.halfSize_;
     ss << ", User Quality (Demosaicing method): " << p.userQuality_;
     ss << ", Median Filter Passes: " << p.medPasses_;
     ss << ", WB Method: " << p.wbMethod_;
@@ -318,6 +326,7 @@ static void setParams(LibRaw &processor, const RAWReaderParams &params) {
     // do not rotate or strech pixels on fuji cameras - default = 1 (rotate)
     outParams.use_fuji_rotate = params.useFujiRotate_;
     // demosaicing parameters
+    outParams.half_size = params.halfSize_;
     outParams.user_qual = params.userQuality_;
     outParams.med_passes = params.medPasses_;
     outParams.user_flip = 0;  // exif orientation is done afterwards
@@ -395,6 +404,114 @@ static void setParams(LibRaw &processor, const RAWReaderParams &params) {
     }
 }
 
+// same as the first half of LibRaw::copy_mem_image()
+bool RAWProcessor::buildOutputCurve() {
+    int(*histogram)[LIBRAW_HISTOGRAM_SIZE] =
+        libraw_internal_data.output_data.histogram;
+    if (histogram == NULL) return false;
+
+    const libraw_output_params_t &outParams = imgdata.params;
+    int perc = imgdata.sizes.width * imgdata.sizes.height *
+               outParams.auto_bright_thr;
+    if (libraw_internal_data.internal_output_params.fuji_width) perc /= 2;
+
+    int tWhite = 0x2000;
+    if (!((outParams.highlight & ~2) || outParams.no_auto_bright)) {
+        tWhite = 0;
+        for (int c = 0; c < imgdata.idata.colors; ++c) {
+            int val = 0x2000;
+            for (int total = 0; --val > 32;) {
+                if ((total += histogram[c][val]) > perc) break;
+            }
+            tWhite = std::max(tWhite, val);
+        }
+    }
+    gamma_curve(outParams.gamm[0], outParams.gamm[1], 2,
+                (tWhite << 3) / outParams.bright);
+    return true;
+}
+
+// writes the output of dcraw_process() straight into the channels of
+// \a frame, without the interleaved copy of dcraw_make_mem_image()
+// \return false if the image is flipped or is not RGB
+static bool copyPlanar(RAWProcessor &processor, Frame &frame) {
+    int W, H, colors, bps;
+    processor.get_mem_image_format(&W, &H, &colors, &bps);
+
+    const libraw_image_sizes_t &sizes = processor.imgdata.sizes;
+    if (colors != 3 || sizes.flip != 0 || sizes.iwidth != W ||
+        sizes.iheight != H || processor.imgdata.image == NULL) {
+        return false;
+    }
+    if (!processor.buildOutputCurve()) return false;
+
+    // output curve and Gamma1_8 fold in one lookup
+    std::vector<float> lut(0x10000);
+    colorspace::Gamma<colorspace::Gamma1_8> gamma;
+    for (size_t i = 0; i < lut.size(); ++i) {
+        lut[i] = gamma.operator()<uint16_t, float>(
+            processor.imgdata.color.curve[i]);
+    }
+
+    pfs::Frame tempFrame(W, H);
+    pfs::Channel *Xc, *Yc, *Zc;
+    tempFrame.createXYZChannels(Xc, Yc, Zc);
+
+    const ushort(*image)[4] = processor.imgdata.image;
+    float *x = Xc->data();
+    float *y = Yc->data();
+    float *z = Zc->data();
+#pragma omp parallel for
+    for (int row = 0; row < H; ++row) {
+        const size_t offset = static_cast<size_t>(row) * W;
+        for (size_t idx = offset; idx < offset + W; ++idx) {
+            x[idx] = lut[image[idx][0]];
+            y[idx] = lut[image[idx][1]];
+            z[idx] = lut[image[idx][2]];
+        }
+    }
+
+    frame.swap(tempFrame);
+    return true;
+}
+
+static void copyMemImage(RAWProcessor &processor, Frame &frame) {
+    libraw_processed_image_t *image = processor.dcraw_make_mem_image();
+
+    if (!image)  // ret != LIBRAW_SUCCESS ||
+    {
+        PRINT_DEBUG("Memory Error in processing RAW File");
+        processor.recycle();
+        throw pfs::io::ReadException("Memory Error in processing RAW File");
+    }
+
+    int W = image->width;
+    int H = image->height;
+
+    assert(image->data_size == W * H * 3 * sizeof(uint16_t));
+
+    pfs::Frame tempFrame(W, H);
+
+    pfs::Channel *Xc, *Yc, *Zc;
+    tempFrame.createXYZChannels(Xc, Yc, Zc);
+
+    const uint16_t *raw_data = reinterpret_cast<const uint16_t *>(image->data);
+    utils::transform(
+        FixedStrideIterator<const uint16_t *, 3>(raw_data),
+        FixedStrideIterator<const uint16_t *, 3>(raw_data + H * W * 3),
+        FixedStrideIterator<const uint16_t *, 3>(raw_data + 1),
+        FixedStrideIterator<const uint16_t *, 3>(raw_data + 2), Xc->begin(),
+        Yc->begin(), Zc->begin(),
+        colorspace::Gamma<pfs::colorspace::Gamma1_8>());
+
+    PRINT_DEBUG("Data size: " << image->data_size << " "
+                              << W * H * 3 * sizeof(uint16_t));
+    PRINT_DEBUG("W: " << W << " H: " << H);
+
+    LibRaw::dcraw_clear_mem(image);
+    frame.swap(tempFrame);
+}
+
 #define P1 m_processor.imgdata.idata
 #define S m_processor.imgdata.sizes
 #define C m_processor.imgdata.color
@@ -422,6 +539,7 @@ bool RAWReader::isOpen() const { return true; }
 void RAWReader::close() { m_processor.recycle(); }
 
 void RAWReader::read(Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span("RAWReader::read");
     RAWReaderParams p;
     p.parse(params);
 
@@ -450,42 +568,18 @@ void RAWReader::read(Frame &frame, const Params &params) {
         throw pfs::io::ReadException("Error Processing RAW File");
     }
 
-    libraw_processed_image_t *image = m_processor.dcraw_make_mem_image();
-
-    if (!image)  // ret != LIBRAW_SUCCESS ||
-    {
-        PRINT_DEBUG("Memory Error in processing RAW File");
-        m_processor.recycle();
-        throw pfs::io::ReadException("Memory Error in processing RAW File");
+    pfs::Frame tempFrame;
+    if (!copyPlanar(m_processor, tempFrame)) {
+        copyMemImage(m_processor, tempFrame);
     }
+    PRINT_DEBUG("W: " << tempFrame.getWidth()
+                      << " H: " << tempFrame.getHeight());
 
-    int W = image->width;
-    int H = image->height;
-
-    assert(image->data_size == W * H * 3 * sizeof(uint16_t));
-
-    pfs::Frame tempFrame(W, H);
-
-    pfs::Channel *Xc, *Yc, *Zc;
-    tempFrame.createXYZChannels(Xc, Yc, Zc);
-
-    const uint16_t *raw_data = reinterpret_cast<const uint16_t *>(image->data);
-    utils::transform(
-        FixedStrideIterator<const uint16_t *, 3>(raw_data),
-        FixedStrideIterator<const uint16_t *, 3>(raw_data + H * W * 3),
-        FixedStrideIterator<const uint16_t *, 3>(raw_data + 1),
-        FixedStrideIterator<const uint16_t *, 3>(raw_data + 2), Xc->begin(),
-        Yc->begin(), Zc->begin(),
-        colorspace::Gamma<pfs::colorspace::Gamma1_8>());
-
-    PRINT_DEBUG("Data size: " << image->data_size << " "
-                              << W * H * 3 * sizeof(uint16_t));
-    PRINT_DEBUG("W: " << W << " H: " << H);
-
-    LibRaw::dcraw_clear_mem(image);
     m_processor.recycle();
 
     FrameReader::read(tempFrame, params);
+    trace_span.setBytes(
+        tempFrame.size() * tempFrame.getChannels().size() * sizeof(float));
     frame.swap(tempFrame);
 }
 
@@ -42,6 +42,18 @@
 namespace pfs {
 namespace io {
 
+//! \brief LibRaw, with access to the output stage of dcraw_make_mem_image()
+class RAWProcessor : public LibRaw {
+   public:
+    //! \brief build imgdata.color.curve as dcraw_make_mem_image() does,
+    //! from the histogram collected by dcraw_process()
+    //! \return false if there is no histogram to build the curve from
+    bool buildOutputCurve();
+};
+
+//! \brief develops a camera RAW file into X, Y and Z channels
+//! The "raw.half_size" (bool) parameter skips the demosaicing and returns
+//! an image of half the size: fast enough for previews.
 class RAWReader : public FrameReader {
    public:
     RAWReader(const std::string &filename);
@@ -54,7 +66,7 @@ class RAWReader : public FrameReader {
     void read(Frame &frame, const Params &params);
 
    private:
-    LibRaw m_processor;
+    RAWProcessor m_processor;
 };
 
 }  // io
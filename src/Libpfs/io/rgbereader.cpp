@@ -21,16 +21,26 @@
  * ----------------------------------------------------------------------
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <Libpfs/array2d.h>
 #include <Libpfs/colorspace/colorspace.h>
 #include <Libpfs/frame.h>
 #include <Libpfs/io/rgbecommon.h>
 #include <Libpfs/io/rgbereader.h>
+#include <Libpfs/utils/trace.h>
 
 using namespace std;
 
@@ -128,105 +138,180 @@ void readRadianceHeader(FILE *file, int &width, int &height, float &exposure,
     // DEBUG_STR << "RGBE: image size " << width << "x" << height << endl;
 }
 
-void RLERead(FILE *file, Trgbe *scanline, int size) {
+//! \brief decode an RLE encoded channel of \a size elements from \a data
+//! \param scanline destination, or NULL to only skip the channel
+//! \return the number of bytes of the channel
+size_t RLEDecode(const Trgbe *data, size_t available, Trgbe *scanline,
+                 int size) {
+    size_t pos = 0;
     int peek = 0;
     while (peek < size) {
-        Trgbe p[2];
-        if (fread(p, sizeof(p), 1, file) == 0) {
+        if (available - pos < 2) {
             throw pfs::io::ReadException("RGBE: Invalid data size");
         }
-        if (p[0] > 128) {
+        int count;
+        size_t bytes;
+        if (data[pos] > 128) {
             // a run
-            int run_len = p[0] - 128;
-
-            while (run_len > 0) {
-                scanline[peek++] = p[1];
-                run_len--;
-            }
+            count = data[pos] - 128;
+            bytes = 2;
         } else {
             // a non-run
-            scanline[peek++] = p[1];
-
-            int nonrun_len = p[0] - 1;
-            if (nonrun_len > 0) {
-                if (fread(scanline + peek, sizeof(*scanline), nonrun_len,
-                          file) == 0) {
-                    throw pfs::io::ReadException("RGBE: Invalid data size");
-                } else {
-                    peek += nonrun_len;
-                }
+            count = std::max<int>(data[pos], 1);
+            bytes = count + 1;
+            if (available - pos < bytes) {
+                throw pfs::io::ReadException("RGBE: Invalid data size");
             }
         }
+        if (count > size - peek) {
+            throw pfs::io::ReadException(
+                "RGBE: difference in size while reading RLE scanline");
+        }
+        if (scanline) {
+            if (bytes == 2) {
+                memset(scanline + peek, data[pos + 1], count);
+            } else {
+                memcpy(scanline + peek, data + pos + 1, count);
+            }
+        }
+        peek += count;
+        pos += bytes;
     }
-    if (peek != size) {
-        throw pfs::io::ReadException(
-            "RGBE: difference in size while reading RLE scanline");
-    }
+    return pos;
 }
 
-void readRadiance(FILE *file, int width, int height, float exposure,
-                  pfs::Array2Df &X, pfs::Array2Df &Y, pfs::Array2Df &Z) {
-    // read image
-    // depending on format read either rle or normal (note: only rle supported)
-    std::vector<Trgbe> scanline(width * 4);
-
-    for (int y = 0; y < height; ++y) {
-        // read rle header
-        Trgbe header[4];
-        if (fread(header, sizeof(header), 1, file) == sizeof(header)) {
-            throw pfs::io::ReadException("RGBE: invalid data size");
+//! \brief decode a flat scanline, where the pixels are interleaved, into
+//! the planar \a scanline. As in the original Radiance format, a (1, 1, 1, n)
+//! pixel repeats the previous one n times, shifted by 8 bits for each
+//! consecutive repeat pixel
+//! \return the number of bytes of the scanline
+size_t decodeFlatScanline(const Trgbe *data, size_t available, int width,
+                          Trgbe *scanline) {
+    size_t pos = 0;
+    int x = 0;
+    int shift = 0;
+    while (x < width) {
+        if (available - pos < 4) {
+            throw pfs::io::ReadException(
+                "RGBE: not enough data to read in the simple format.");
         }
-        if (header[0] != 2 || header[1] != 2 ||
-            (header[2] << 8) + header[3] != width) {
-            //--- simple scanline (not rle)
-            size_t rez =
-                fread(scanline.data() + 4, sizeof(Trgbe), 4 * width - 4, file);
-            if (rez != (size_t)4 * width - 4) {
-                //     DEBUG_STR << "RGBE: scanline " << y
-                //           << "(" << (int)rez << "/" << width << ")" <<endl;
-                throw pfs::Exception(
-                    "RGBE: not enough data to read "
-                    "in the simple format.");
+        const Trgbe *pixel = data + pos;
+        pos += 4;
+        if (pixel[0] == 1 && pixel[1] == 1 && pixel[2] == 1) {
+            const size_t count = size_t(pixel[3]) << shift;
+            if (x == 0 || shift > 16 || count > size_t(width - x)) {
+                throw pfs::io::ReadException(
+                    "RGBE: invalid run in the simple format.");
             }
-            //--- yes, we've read one pixel as a header
-            scanline[0] = header[0];
-            scanline[1] = header[1];
-            scanline[2] = header[2];
-            scanline[3] = header[3];
-
-            //--- write scanline to the image
-            for (int x = 0; x < width; ++x) {
-                Trgbe_pixel rgbe;
-                rgbe.r = scanline[4 * x + 0];
-                rgbe.g = scanline[4 * x + 1];
-                rgbe.b = scanline[4 * x + 2];
-                rgbe.e = scanline[4 * x + 3];
-
-                rgbe2rgb(rgbe, exposure, X(x, y), Y(x, y), Z(x, y));
+            if (scanline) {
+                for (int ch = 0; ch < 4; ++ch) {
+                    Trgbe *channel = scanline + width * ch;
+                    memset(channel + x, channel[x - 1], count);
+                }
             }
+            x += static_cast<int>(count);
+            shift += 8;
         } else {
-            //--- rle scanline
-            //--- each channel is encoded separately
-            for (int ch = 0; ch < 4; ++ch) {
-                RLERead(file, scanline.data() + width * ch, width);
+            if (scanline) {
+                for (int ch = 0; ch < 4; ++ch) {
+                    scanline[x + width * ch] = pixel[ch];
+                }
             }
+            ++x;
+            shift = 0;
+        }
+    }
+    return pos;
+}
 
-            //--- write scanline to the image
-            for (int x = 0; x < width; ++x) {
-                Trgbe_pixel rgbe;
-                rgbe.r = scanline[x + width * 0];
-                rgbe.g = scanline[x + width * 1];
-                rgbe.b = scanline[x + width * 2];
-                rgbe.e = scanline[x + width * 3];
+//! \brief decode the scanline at \a data into the planar \a scanline: all
+//! the red values, then the green, blue and exponent ones
+//! \param scanline 4 * \a width elements, or NULL to only skip the scanline
+//! \return the number of bytes of the scanline
+size_t decodeScanline(const Trgbe *data, size_t available, int width,
+                      Trgbe *scanline) {
+    if (available < 4) {
+        throw pfs::io::ReadException("RGBE: invalid data size");
+    }
+    // scanlines narrower than 8 pixels are never run length encoded by
+    // channel; wider than 0x7fff pixels they should not be either, but the
+    // earlier versions of our writer did so
+    if (width < 8 || data[0] != 2 || data[1] != 2 ||
+        (data[2] << 8) + data[3] != width) {
+        return decodeFlatScanline(data, available, width, scanline);
+    }
 
-                rgbe2rgb(rgbe, exposure, X(x, y), Y(x, y), Z(x, y));
+    //--- rle scanline
+    //--- each channel is encoded separately
+    size_t pos = 4;
+    for (int ch = 0; ch < 4; ++ch) {
+        pos += RLEDecode(data + pos, available - pos,
+                         scanline ? scanline + width * ch : NULL, width);
+    }
+    return pos;
+}
+
+#ifdef __SSE2__
+//! \brief widen 4 bytes to 32 bit integers
+inline __m128i loadTrgbe4(const Trgbe *data) {
+    int32_t bytes;
+    memcpy(&bytes, data, sizeof(bytes));
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(
+        _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+}
+#endif
+
+//! \brief convert the planar \a scanline of \a width pixels into floats
+void rgbe2rgb(const Trgbe *scanline, int width, float exposure, float *X,
+              float *Y, float *Z) {
+    const Trgbe *r = scanline;
+    const Trgbe *g = r + width;
+    const Trgbe *b = g + width;
+    const Trgbe *e = b + width;
+
+    int x = 0;
+#ifdef __SSE2__
+    if (exposure == 1.f) {
+        // for 10 <= e, 2^(e - 136) is a normal float: the mantissas (at most
+        // 8 bits) are scaled exactly and the result matches the scalar code
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ten = _mm_set1_epi32(10);
+        const __m128i bias = _mm_set1_epi32(128 + 8 - 127);
+        for (; x + 4 <= width; x += 4) {
+            const __m128i ev = loadTrgbe4(e + x);
+            if (_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi32(ev, zero),
+                                                _mm_cmplt_epi32(ev, ten)))) {
+                for (int i = x; i < x + 4; ++i) {
+                    Trgbe_pixel rgbe = {r[i], g[i], b[i], e[i]};
+                    rgbe2rgb(rgbe, exposure, X[i], Y[i], Z[i]);
+                }
+                continue;
             }
+            const __m128 f = _mm_andnot_ps(
+                _mm_castsi128_ps(_mm_cmpeq_epi32(ev, zero)),
+                _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(ev, bias), 23)));
+            const __m128 rv = _mm_cvtepi32_ps(loadTrgbe4(r + x));
+            const __m128 gv = _mm_cvtepi32_ps(loadTrgbe4(g + x));
+            const __m128 bv = _mm_cvtepi32_ps(loadTrgbe4(b + x));
+            _mm_storeu_ps(X + x, _mm_mul_ps(rv, f));
+            _mm_storeu_ps(Y + x, _mm_mul_ps(gv, f));
+            _mm_storeu_ps(Z + x, _mm_mul_ps(bv, f));
         }
     }
+#endif
+    for (; x < width; ++x) {
+        Trgbe_pixel rgbe = {r[x], g[x], b[x], e[x]};
+        rgbe2rgb(rgbe, exposure, X[x], Y[x], Z[x]);
+    }
 }
 
 RGBEReader::RGBEReader(const string &filename)
-    : FrameReader(filename), m_exposure(0.0) {
+    : FrameReader(filename),
+      m_data(NULL),
+      m_dataSize(0),
+      m_exposure(0.0),
+      m_dataOffset(0) {
     RGBEReader::open();
 }
 
@@ -245,21 +330,100 @@ void RGBEReader::open() {
     readRadianceHeader(m_file.data(), width, height, exposure, colorspace);
 
     m_colorspace = colorspace;
+    m_dataOffset = ftell(m_file.data());
 
     setWidth(width);
     setHeight(height);
     m_exposure = exposure;
+
+    loadData();
+}
+
+void RGBEReader::loadData() {
+    m_offsets.assign(1, 0);
+    m_buffer.clear();
+    if (m_mapped.map(fileno(m_file.data())) &&
+        m_mapped.contains(m_dataOffset, 0)) {
+        m_data =
+            reinterpret_cast<const Trgbe *>(m_mapped.data()) + m_dataOffset;
+        m_dataSize = m_mapped.size() - m_dataOffset;
+        return;
+    }
+    m_mapped.unmap();
+
+    // no mmap(): read all the scanlines at once
+    if (fseek(m_file.data(), 0, SEEK_END) != 0) {
+        throw ReadException("RGBE: cannot seek in " + filename());
+    }
+    const long end = ftell(m_file.data());
+    if (end < m_dataOffset ||
+        fseek(m_file.data(), m_dataOffset, SEEK_SET) != 0) {
+        throw ReadException("RGBE: cannot seek in " + filename());
+    }
+    m_buffer.resize(end - m_dataOffset);
+    if (fread(m_buffer.data(), 1, m_buffer.size(), m_file.data()) !=
+        m_buffer.size()) {
+        throw ReadException("RGBE: cannot read " + filename());
+    }
+    m_data = m_buffer.data();
+    m_dataSize = m_buffer.size();
 }
 
 void RGBEReader::close() {
     m_file.reset();
+    m_mapped.unmap();
+    std::vector<Trgbe>().swap(m_buffer);
+    m_offsets.clear();
+    m_data = NULL;
+    m_dataSize = 0;
     m_exposure = 0.f;
 
     setWidth(0);
     setHeight(0);
 }
 
+void RGBEReader::buildIndex(size_t numRows) {
+    // walks the RLE codes without writing any pixel
+    while (m_offsets.size() <= numRows) {
+        const size_t offset = m_offsets.back();
+        m_offsets.push_back(offset + decodeScanline(m_data + offset,
+                                                    m_dataSize - offset,
+                                                    width(), NULL));
+    }
+}
+
+void RGBEReader::decodeRows(size_t firstRow, size_t numRows, float *X,
+                            float *Y, float *Z) const {
+    const int w = width();
+    const int rows = static_cast<int>(numRows);
+    bool failed = false;
+    std::string error;
+
+#pragma omp parallel
+    {
+        std::vector<Trgbe> scanline(4 * w);
+#pragma omp for
+        for (int y = 0; y < rows; ++y) {
+            try {
+                const size_t offset = m_offsets[firstRow + y];
+                decodeScanline(m_data + offset, m_dataSize - offset, w,
+                               scanline.data());
+                rgbe2rgb(scanline.data(), w, m_exposure, X + y * w,
+                         Y + y * w, Z + y * w);
+            } catch (const pfs::io::ReadException &ex) {
+#pragma omp critical
+                {
+                    failed = true;
+                    error = ex.what();
+                }
+            }
+        }
+    }
+    if (failed) throw pfs::io::ReadException(error);
+}
+
 void RGBEReader::read(Frame &frame, const Params & /*params*/) {
+    pfs::utils::TraceSpan trace_span("RGBEReader::read");
     if (!isOpen()) open();
 
     Frame tempFrame(width(), height());
@@ -267,15 +431,36 @@ void RGBEReader::read(Frame &frame, const Params & /*params*/) {
     pfs::Channel *X, *Y, *Z;
     tempFrame.createXYZChannels(X, Y, Z);
 
-    readRadiance(m_file.data(), width(), height(), m_exposure, *X, *Y, *Z);
+    buildIndex(height());
+    decodeRows(0, height(), X->data(), Y->data(), Z->data());
 
     if (m_colorspace == XYZ) pfs::transformXYZ2RGB(X, Y, Z, X, Y, Z);
 
     tempFrame.getTags().setTag("LUMINANCE", "RELATIVE");
     tempFrame.getTags().setTag("FILE_NAME", filename());
 
+    trace_span.setBytes(
+        tempFrame.size() * tempFrame.getChannels().size() * sizeof(float));
     frame.swap(tempFrame);
 }
 
+void RGBEReader::readRows(Frame &band, size_t firstRow, size_t numRows,
+                          const Params & /*params*/) {
+    if (!isOpen()) open();
+
+    assert(firstRow + numRows <= height());
+
+    Frame tempFrame(width(), numRows);
+    pfs::Channel *X, *Y, *Z;
+    tempFrame.createXYZChannels(X, Y, Z);
+
+    buildIndex(firstRow + numRows);
+    decodeRows(firstRow, numRows, X->data(), Y->data(), Z->data());
+
+    if (m_colorspace == XYZ) pfs::transformXYZ2RGB(X, Y, Z, X, Y, Z);
+
+    band.swap(tempFrame);
+}
+
 }  // io
 }  // pfs
@@ -34,8 +34,12 @@
 #include <Libpfs/array2d_fwd.h>
 #include <Libpfs/io/framereader.h>
 #include <Libpfs/io/ioexception.h>
+#include <Libpfs/io/rgbecommon.h>
+#include <Libpfs/utils/mappedfile.h>
 #include <Libpfs/utils/resourcehandlerstdio.h>
 
+#include <vector>
+
 namespace pfs {
 namespace io {
 
@@ -51,10 +55,30 @@ class RGBEReader : public FrameReader {
     void close();
     void read(pfs::Frame &frame, const pfs::Params &params);
 
+    bool supportsRows() const { return true; }
+    void readRows(pfs::Frame &band, size_t firstRow, size_t numRows,
+                  const pfs::Params &params);
+
    private:
+    //! \brief bring the scanlines in memory, mapping the file if possible
+    void loadData();
+    //! \brief find where the first \a numRows scanlines start
+    void buildIndex(size_t numRows);
+    //! \brief decode \a numRows scanlines from \a firstRow in parallel
+    void decodeRows(size_t firstRow, size_t numRows, float *X, float *Y,
+                    float *Z) const;
+
     utils::ScopedStdIoFile m_file;
+    utils::MappedFile m_mapped;
+    std::vector<Trgbe> m_buffer;  // the scanlines, if the file is not mapped
+    const Trgbe *m_data;          // first scanline
+    size_t m_dataSize;            // bytes from the first scanline to the end
     float m_exposure;
     Colorspace m_colorspace;
+    long m_dataOffset;  // offset of the first scanline
+    //! scanlines are RLE encoded and the format stores no index: the offset
+    //! of each one (and the end of the last one) is found on demand
+    std::vector<size_t> m_offsets;
 };
 }
 }
@@ -21,6 +21,7 @@
  * ----------------------------------------------------------------------
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <vector>
@@ -31,14 +32,17 @@
 #include <Libpfs/io/rgbecommon.h>
 #include <Libpfs/io/rgbewriter.h>
 #include <Libpfs/utils/resourcehandlerstdio.h>
+#include <Libpfs/utils/trace.h>
 
 using namespace std;
 
 namespace pfs {
 namespace io {
 
-int RLEWrite(FILE *file, Trgbe *scanline, int size) {
-    Trgbe *scanend = scanline + size;
+//! \brief append the RLE encoding of the \a size elements of \a scanline
+//! to \a out
+void RLEEncode(const Trgbe *scanline, int size, std::vector<Trgbe> &out) {
+    const Trgbe *scanend = scanline + size;
     while (scanline < scanend) {
         int run_start = 0;
         int peek = 0;
@@ -57,39 +61,20 @@ int RLEWrite(FILE *file, Trgbe *scanline, int size) {
         if (run_len > 4) {
             // write a non run: scanline[0] to scanline[run_start]
             if (run_start > 0) {
-                std::vector<Trgbe> buf(run_start + 1);
-
-                buf[0] = run_start;
-                for (int i = 0; i < run_start; i++) {
-                    buf[i + 1] = scanline[i];
-                }
-                fwrite(buf.data(), sizeof(Trgbe), run_start + 1, file);
+                out.push_back(run_start);
+                out.insert(out.end(), scanline, scanline + run_start);
             }
 
             // write a run: scanline[run_start], run_len
-            Trgbe buf[2];
-            buf[0] = 128 + run_len;
-            buf[1] = scanline[run_start];
-            fwrite(buf, sizeof(*buf), 2, file);
+            out.push_back(128 + run_len);
+            out.push_back(scanline[run_start]);
         } else {
             // write a non run: scanline[0] to scanline[peek]
-            std::vector<Trgbe> buf(peek + 1);
-
-            buf[0] = peek;
-            for (int i = 0; i < peek; i++) {
-                buf[i + 1] = scanline[i];
-            }
-            fwrite(buf.data(), sizeof(Trgbe), peek + 1, file);
+            out.push_back(peek);
+            out.insert(out.end(), scanline, scanline + peek);
         }
         scanline += peek;
     }
-
-    if (scanline != scanend) {
-        throw pfs::io::WriteException(
-            "RGBE: difference in size while writing RLE scanline");
-    }
-
-    return 0;
 }
 
 void rgb2rgbe(float r, float g, float b, Trgbe_pixel &rgbe) {
@@ -141,41 +126,75 @@ void writeRadiance(FILE *file, const pfs::Array2Df &X, const pfs::Array2Df &Y,
     // image size
     fprintf(file, "-Y %d +X %d\n", (int)height, (int)width);
 
-    // image run length encoded
-    std::vector<Trgbe> scanlineR(width);
-    std::vector<Trgbe> scanlineG(width);
-    std::vector<Trgbe> scanlineB(width);
-    std::vector<Trgbe> scanlineE(width);
-
-    for (size_t y = 0; y < height; ++y) {
-        // write rle header
-        unsigned char header[4];
-        header[0] = 2;
-        header[1] = 2;
-        header[2] = width >> 8;
-        ;
-        header[3] = width & 0xFF;
-        fwrite(header, sizeof(header), 1, file);
-
-        // each channel is encoded separately
-        for (size_t x = 0; x < width; x++) {
-            Trgbe_pixel p;
-            rgb2rgbe(X(x, y), Y(x, y), Z(x, y), p);
-            scanlineR[x] = p.r;
-            scanlineG[x] = p.g;
-            scanlineB[x] = p.b;
-            scanlineE[x] = p.e;
+    // image run length encoded: batches of scanlines are encoded in
+    // parallel in memory, then written in order. Scanlines narrower than 8
+    // or wider than 0x7fff pixels cannot be run length encoded by channel
+    const bool rle = width >= 8 && width <= 0x7fff;
+    const int batchSize = 64;
+    std::vector<std::vector<Trgbe> > encoded(batchSize);
+
+    for (size_t y0 = 0; y0 < height; y0 += batchSize) {
+        const int rows = static_cast<int>(
+            std::min<size_t>(batchSize, height - y0));
+#pragma omp parallel
+        {
+            std::vector<Trgbe> scanline(rle ? 4 * width : 0);
+#pragma omp for
+            for (int i = 0; i < rows; ++i) {
+                const size_t y = y0 + i;
+                std::vector<Trgbe> &out = encoded[i];
+                out.clear();
+
+                if (!rle) {
+                    // flat scanline, the pixels are interleaved
+                    out.resize(4 * width);
+                    for (size_t x = 0; x < width; x++) {
+                        Trgbe_pixel p;
+                        rgb2rgbe(X(x, y), Y(x, y), Z(x, y), p);
+                        out[4 * x + 0] = p.r;
+                        out[4 * x + 1] = p.g;
+                        out[4 * x + 2] = p.b;
+                        out[4 * x + 3] = p.e;
+                    }
+                    continue;
+                }
+
+                // rle header
+                out.push_back(2);
+                out.push_back(2);
+                out.push_back(width >> 8);
+                out.push_back(width & 0xFF);
+
+                // each channel is encoded separately
+                for (size_t x = 0; x < width; x++) {
+                    Trgbe_pixel p;
+                    rgb2rgbe(X(x, y), Y(x, y), Z(x, y), p);
+                    scanline[x + width * 0] = p.r;
+                    scanline[x + width * 1] = p.g;
+                    scanline[x + width * 2] = p.b;
+                    scanline[x + width * 3] = p.e;
+                }
+                for (int ch = 0; ch < 4; ++ch) {
+                    RLEEncode(scanline.data() + width * ch, width, out);
+                }
+            }
+        }
+
+        for (int i = 0; i < rows; ++i) {
+            if (fwrite(encoded[i].data(), sizeof(Trgbe), encoded[i].size(),
+                       file) != encoded[i].size()) {
+                throw pfs::io::WriteException("RGBE: cannot write scanline");
+            }
         }
-        RLEWrite(file, scanlineR.data(), width);
-        RLEWrite(file, scanlineG.data(), width);
-        RLEWrite(file, scanlineB.data(), width);
-        RLEWrite(file, scanlineE.data(), width);
     }
 }
 
 RGBEWriter::RGBEWriter(const std::string &filename) : FrameWriter(filename) {}
 
 bool RGBEWriter::write(const Frame &frame, const Params & /*params*/) {
+    pfs::utils::TraceSpan trace_span(
+        "RGBEWriter::write",
+        frame.size() * frame.getChannels().size() * sizeof(float));
     utils::ScopedStdIoFile outputStream(fopen(filename().c_str(), "wb"));
     if (!outputStream) {
         throw pfs::io::InvalidFile("RGBEWriter: cannot open " + filename());
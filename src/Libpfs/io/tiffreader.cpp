@@ -31,11 +31,14 @@
 #include <Libpfs/colorspace/lcms.h>
 #include <Libpfs/colorspace/xyz.h>
 
+#include <Libpfs/utils/mappedfile.h>
 #include <Libpfs/utils/resourcehandlerlcms.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/transform.h>
 
 #include <tiffio.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
@@ -49,6 +52,10 @@
 #include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace pfs;
 using namespace pfs::utils;
 using namespace boost::assign;
@@ -147,7 +154,14 @@ static cmsHPROFILE GetTIFFProfile(TIFF *in, uint16 bps) {
 namespace pfs {
 namespace io {
 
-struct TiffReaderParams {};
+//! \brief rows [firstRow_, firstRow_ + numRows_) to be decoded
+struct TiffReaderParams {
+    TiffReaderParams(uint32 firstRow, uint32 numRows)
+        : firstRow_(firstRow), numRows_(numRows) {}
+
+    uint32 firstRow_;
+    uint32 numRows_;
+};
 
 struct TiffReaderData {
     // < photometric type, bits per sample >
@@ -159,10 +173,13 @@ struct TiffReaderData {
         : hasAlpha_(false),
           stonits_(1.0),
           currentCallback_(boost::bind(&TiffReaderData::doNothing, _1, _2, _3)),
-          hsRGB_(cmsCreate_sRGBProfile()) {}
+          hsRGB_(cmsCreate_sRGBProfile()),
+          rowsPerStrip_(0) {}
 
     // public members...
     ScopedTiffFile file_;
+    // to open more handles, for the decoding threads
+    std::string fileName_;
 
     uint32 height_;
     uint32 width_;
@@ -182,11 +199,27 @@ struct TiffReaderData {
     ScopedCmsProfile hsRGB_;  // (  );
     ScopedCmsProfile hIn_;    // ( GetTIFFProfile(tif) );
 
+    // uncompressed float data, mapped in memory (see prepareMapping())
+    MappedFile mapped_;
+    std::vector<toff_t> stripOffsets_;
+    uint32 rowsPerStrip_;
+
     // public functions
     inline TIFF *handle() { return file_.data(); }
 
+    //! \brief settings that every handle on the file needs
+    void setupHandle(TIFF *tif) const {
+        if (photometricType_ == PHOTOMETRIC_LOGLUV) {
+            TIFFSetField(tif, TIFFTAG_SGILOGDATAFMT, SGILOGDATAFMT_FLOAT);
+        }
+    }
+
     void read(Frame &frame, const Params & /*params*/) {
-        currentCallback_(this, frame, TiffReaderParams());
+        currentCallback_(this, frame, TiffReaderParams(0, height_));
+    }
+
+    void readRows(Frame &band, uint32 firstRow, uint32 numRows) {
+        currentCallback_(this, band, TiffReaderParams(firstRow, numRows));
     }
 
     void initReader() {
@@ -225,18 +258,64 @@ struct TiffReaderData {
         currentCallback_ = it->second;
     }
 
+    //! \brief map the file in memory if it holds uncompressed, native-endian
+    //! float RGB strips: scanlines are then deinterleaved straight from the
+    //! file rather than copied through libtiff's buffers first
+    void prepareMapping() {
+        mapped_.unmap();
+
+        uint16 sampleFormat = SAMPLEFORMAT_UINT;
+        uint16 planarConfig = PLANARCONFIG_CONTIG;
+        TIFFGetFieldDefaulted(handle(), TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+        TIFFGetFieldDefaulted(handle(), TIFFTAG_PLANARCONFIG, &planarConfig);
+        // strips are deinterleaved as they are: samples must be interleaved
+        if (planarConfig != PLANARCONFIG_CONTIG ||
+            photometricType_ != PHOTOMETRIC_RGB || bitsPerSample_ != 32 ||
+            sampleFormat != SAMPLEFORMAT_IEEEFP ||
+            compressionType_ != COMPRESSION_NONE || TIFFIsTiled(handle()) ||
+            TIFFIsByteSwapped(handle())) {
+            return;
+        }
+
+        uint32 rowsPerStrip = height_;
+        toff_t *offsets = NULL;
+        TIFFGetFieldDefaulted(handle(), TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+        if (!TIFFGetField(handle(), TIFFTAG_STRIPOFFSETS, &offsets) ||
+            offsets == NULL || rowsPerStrip == 0) {
+            return;
+        }
+        rowsPerStrip = std::min(rowsPerStrip, height_);
+
+        if (!mapped_.map(TIFFFileno(handle()))) return;
+
+        const size_t rowBytes = (size_t)width_ * samplesPerPixel_ * sizeof(float);
+        const tstrip_t numStrips = TIFFNumberOfStrips(handle());
+        for (tstrip_t strip = 0; strip < numStrips; ++strip) {
+            const size_t rows =
+                std::min(rowsPerStrip, height_ - strip * rowsPerStrip);
+            if (offsets[strip] % sizeof(float) != 0 ||
+                !mapped_.contains(offsets[strip], rows * rowBytes)) {
+                mapped_.unmap();
+                return;
+            }
+        }
+        stripOffsets_.assign(offsets, offsets + numStrips);
+        rowsPerStrip_ = rowsPerStrip;
+    }
+
     // private stuff...
    private:
-    cmsHTRANSFORM getColorSpaceTransform() {
+    //! \brief transform of the profile of the file to sRGB, planar float out
+    colorspace::CmsTransformPtr getColorSpaceTransform() {
         if (!hIn_) {
             PRINT_DEBUG("No available input profile");
-            return NULL;
+            return colorspace::CmsTransformPtr();
         }
 
         PRINT_DEBUG("Available ICC Profile, building LCMS Transform");
 
         cmsUInt32Number cmsInputFormat = TYPE_RGB_8;
-        cmsUInt32Number cmsOutputFormat = TYPE_RGB_FLT;
+        cmsUInt32Number cmsOutputFormat = TYPE_RGB_FLT_PLANAR;
         cmsUInt32Number cmsIntent = INTENT_PERCEPTUAL;
 
         switch (photometricType_) {
@@ -282,72 +361,341 @@ struct TiffReaderData {
             } break;
         }
 
-        return cmsCreateTransform(hIn_.data(), cmsInputFormat, hsRGB_.data(),
-                                  cmsOutputFormat, cmsIntent, 0);
+        return colorspace::getCmsTransform(hIn_.data(), cmsInputFormat,
+                                           hsRGB_.data(), cmsOutputFormat,
+                                           cmsIntent);
     }
 
     void doNothing(Frame & /*frame*/, const TiffReaderParams & /*params*/) {}
 
+    void readMapped(Frame &frame, const TiffReaderParams &params) {
+        assert(mapped_.isMapped());
+        assert(params.firstRow_ + params.numRows_ <= height_);
+        Frame tempFrame(width_, params.numRows_);
+
+        pfs::Channel *Xc;
+        pfs::Channel *Yc;
+        pfs::Channel *Zc;
+        tempFrame.createXYZChannels(Xc, Yc, Zc);
+
+        const size_t rowBytes = (size_t)width_ * samplesPerPixel_ * sizeof(float);
+#pragma omp parallel for
+        for (int row = 0; row < (int)params.numRows_; row++) {
+            const uint32 fileRow = params.firstRow_ + row;
+            const float *data = reinterpret_cast<const float *>(
+                mapped_.data() + stripOffsets_[fileRow / rowsPerStrip_] +
+                (fileRow % rowsPerStrip_) * rowBytes);
+
+            utils::transform(
+                StrideIterator<const float *>(data, samplesPerPixel_),
+                StrideIterator<const float *>(data + width_ * samplesPerPixel_,
+                                              samplesPerPixel_),
+                StrideIterator<const float *>(data + 1, samplesPerPixel_),
+                StrideIterator<const float *>(data + 2, samplesPerPixel_),
+                Xc->row_begin(row), Yc->row_begin(row), Zc->row_begin(row),
+                colorspace::Copy());
+        }
+
+        tempFrame.swap(frame);
+    }
+
+    //! \brief decode the rows [firstRow_, firstRow_ + numRows_) and hand
+    //! each of them to \a convert, with its index in the output
+    //! Strips are decoded in parallel, each thread converting the rows of its
+    //! own strip; tiles are decoded a band at a time, that is then converted
+    //! in parallel. Every thread has its own handle on the file, as libtiff
+    //! handles cannot be shared.
+    template <typename InputDataType, typename RowConverter>
+    void decodeRows(const TiffReaderParams &params,
+                    const RowConverter &convert) {
+        assert(params.firstRow_ + params.numRows_ <= height_);
+
+        const size_t rowSamples = (size_t)width_ * samplesPerPixel_;
+        const size_t rowBytes = rowSamples * sizeof(InputDataType);
+        const bool tiled = TIFFIsTiled(handle());
+
+        uint32 unitRows = height_;
+        uint32 unitCols = width_;
+        bool contiguous = false;
+        if (tiled) {
+            TIFFGetField(handle(), TIFFTAG_TILEWIDTH, &unitCols);
+            TIFFGetField(handle(), TIFFTAG_TILELENGTH, &unitRows);
+            contiguous =
+                unitRows > 0 && unitCols > 0 &&
+                (size_t)TIFFTileRowSize(handle()) ==
+                    (size_t)unitCols * samplesPerPixel_ * sizeof(InputDataType);
+        } else {
+            TIFFGetFieldDefaulted(handle(), TIFFTAG_ROWSPERSTRIP, &unitRows);
+            unitRows = std::min(unitRows, height_);
+            contiguous =
+                unitRows > 0 && (size_t)TIFFScanlineSize(handle()) == rowBytes;
+        }
+        if (!contiguous) {
+            // subsampled or packed data, only libtiff can make scanlines
+            // out of it
+            decodeScanlines<InputDataType>(params, convert);
+            return;
+        }
+
+        int numThreads = 1;
+#ifdef _OPENMP
+        numThreads = omp_get_max_threads();
+#endif
+        if (!tiled) {
+            if ((size_t)2 * numThreads * unitRows >= height_) {
+                // a single strip, or so few that the strips being decoded
+                // would take as much memory as the image: let libtiff
+                // stream the rows instead
+                decodeScanlines<InputDataType>(params, convert);
+            } else {
+                decodeStrips<InputDataType>(params, unitRows, numThreads,
+                                            convert);
+            }
+            return;
+        }
+
+        // the first thread uses the handle of the reader
+        std::vector<ScopedTiffFile> handles(numThreads);
+        std::vector<std::vector<InputDataType>> tiles(numThreads);
+
+        const uint32 bandRows = std::min(2 * numThreads * unitRows,
+                                         (height_ / unitRows + 1) * unitRows);
+        std::vector<InputDataType> band((size_t)bandRows * rowSamples);
+
+        const uint32 lastRow = params.firstRow_ + params.numRows_;
+        bool failed = false;
+        for (uint32 bandStart = params.firstRow_ / unitRows * unitRows;
+             bandStart < lastRow && !failed; bandStart += bandRows) {
+            const uint32 bandEnd = std::min(bandStart + bandRows, height_);
+            const int unitsDown =
+                (bandEnd - bandStart + unitRows - 1) / unitRows;
+            const int unitsAcross = (width_ + unitCols - 1) / unitCols;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(|| : failed)
+#endif
+            for (int unit = 0; unit < unitsDown * unitsAcross; unit++) {
+                int thread = 0;
+#ifdef _OPENMP
+                thread = omp_get_thread_num();
+#endif
+                TIFF *tif = threadHandle(handles, thread);
+                if (!tif) {
+                    failed = true;
+                    continue;
+                }
+
+                const uint32 y = bandStart + (unit / unitsAcross) * unitRows;
+                const uint32 rows = std::min(unitRows, bandEnd - y);
+                const uint32 x = (unit % unitsAcross) * unitCols;
+                const size_t tileRowSamples =
+                    (size_t)unitCols * samplesPerPixel_;
+                std::vector<InputDataType> &tile = tiles[thread];
+                tile.resize(tileRowSamples * unitRows);
+                if (TIFFReadEncodedTile(tif, TIFFComputeTile(tif, x, y, 0, 0),
+                                        tile.data(),
+                                        tile.size() * sizeof(InputDataType)) <
+                    0) {
+                    failed = true;
+                    continue;
+                }
+                const size_t cols =
+                    (size_t)std::min(unitCols, width_ - x) * samplesPerPixel_;
+                InputDataType *dst = band.data() +
+                                     (size_t)(y - bandStart) * rowSamples +
+                                     (size_t)x * samplesPerPixel_;
+                for (uint32 r = 0; r < rows; r++) {
+                    std::copy(tile.begin() + r * tileRowSamples,
+                              tile.begin() + r * tileRowSamples + cols,
+                              dst + r * rowSamples);
+                }
+            }
+            if (failed) break;
+
+            const int from = std::max(bandStart, params.firstRow_);
+            const int to = std::min(bandEnd, lastRow);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (int row = from; row < to; row++) {
+                convert(band.data() + (size_t)(row - bandStart) * rowSamples,
+                        row - params.firstRow_);
+            }
+        }
+
+        if (failed) {
+            throw pfs::io::ReadException("TiffReader: cannot decode " +
+                                         fileName_);
+        }
+    }
+
+    //! \brief handle on the file for the decoding thread \a thread, opened
+    //! on first use: the first thread uses the handle of the reader
+    TIFF *threadHandle(std::vector<ScopedTiffFile> &handles, int thread) {
+        if (thread == 0) return handle();
+        if (!handles[thread]) {
+            TIFF *tif = TIFFOpen(fileName_.c_str(), "r");
+            if (tif) setupHandle(tif);
+            handles[thread].reset(tif);
+        }
+        return handles[thread].data();
+    }
+
+    //! \brief decode the strips of the rows in \a params in parallel, each
+    //! into a buffer of its thread, and convert their rows from there
+    template <typename InputDataType, typename RowConverter>
+    void decodeStrips(const TiffReaderParams &params, uint32 rowsPerStrip,
+                      int numThreads, const RowConverter &convert) {
+        const size_t rowSamples = (size_t)width_ * samplesPerPixel_;
+        const size_t rowBytes = rowSamples * sizeof(InputDataType);
+
+        std::vector<ScopedTiffFile> handles(numThreads);
+        std::vector<std::vector<InputDataType>> strips(numThreads);
+
+        const uint32 lastRow = params.firstRow_ + params.numRows_;
+        const int firstStrip = params.firstRow_ / rowsPerStrip;
+        const int lastStrip = (lastRow + rowsPerStrip - 1) / rowsPerStrip;
+        bool failed = false;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(|| : failed)
+#endif
+        for (int strip = firstStrip; strip < lastStrip; strip++) {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            TIFF *tif = threadHandle(handles, thread);
+            if (!tif) {
+                failed = true;
+                continue;
+            }
+
+            const uint32 y = strip * rowsPerStrip;
+            const uint32 rows = std::min(rowsPerStrip, height_ - y);
+            std::vector<InputDataType> &buffer = strips[thread];
+            buffer.resize((size_t)rowsPerStrip * rowSamples);
+            if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, y, 0),
+                                     buffer.data(), rows * rowBytes) < 0) {
+                failed = true;
+                continue;
+            }
+
+            const uint32 from = std::max(y, params.firstRow_);
+            const uint32 to = std::min(y + rows, lastRow);
+            for (uint32 row = from; row < to; row++) {
+                convert(buffer.data() + (size_t)(row - y) * rowSamples,
+                        row - params.firstRow_);
+            }
+        }
+
+        if (failed) {
+            throw pfs::io::ReadException("TiffReader: cannot decode " +
+                                         fileName_);
+        }
+    }
+
+    //! \brief rows decoded in order by libtiff, a few at a time: only these
+    //! are held in memory, and they are converted in parallel
+    template <typename InputDataType, typename RowConverter>
+    void decodeScanlines(const TiffReaderParams &params,
+                         const RowConverter &convert) {
+        int numThreads = 1;
+#ifdef _OPENMP
+        numThreads = omp_get_max_threads();
+#endif
+        const size_t rowSamples = (size_t)width_ * samplesPerPixel_;
+        const uint32 chunkRows =
+            std::min<uint32>(16 * numThreads, params.numRows_);
+        std::vector<InputDataType> chunk((size_t)chunkRows * rowSamples);
+
+        for (uint32 start = 0; start < params.numRows_; start += chunkRows) {
+            const uint32 rows = std::min(chunkRows, params.numRows_ - start);
+            for (uint32 r = 0; r < rows; r++) {
+                if (TIFFReadScanline(handle(), chunk.data() + r * rowSamples,
+                                     params.firstRow_ + start + r) < 0) {
+                    throw pfs::io::ReadException("TiffReader: cannot decode " +
+                                                 fileName_);
+                }
+            }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (int r = 0; r < static_cast<int>(rows); r++) {
+                convert(chunk.data() + r * rowSamples, start + r);
+            }
+        }
+    }
+
     template <typename InputDataType, typename Converter>
-    void read3Components(Frame &frame, const TiffReaderParams & /*params*/,
+    void read3Components(Frame &frame, const TiffReaderParams &params,
                          const Converter &conv) {
         assert(samplesPerPixel_ >= 3);
-        Frame tempFrame(width_, height_);
+        Frame tempFrame(width_, params.numRows_);
 
         pfs::Channel *Xc;
         pfs::Channel *Yc;
         pfs::Channel *Zc;
         tempFrame.createXYZChannels(Xc, Yc, Zc);
 
-        std::vector<InputDataType> tempBuffer((size_t) width_ * samplesPerPixel_);
-        for (uint32 row = 0; row < height_; row++) {
-            TIFFReadScanline(handle(), tempBuffer.data(), row);
-
-            utils::transform(StrideIterator<InputDataType *>(tempBuffer.data(),
-                                                             samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + width_ * samplesPerPixel_,
-                                 samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + 1, samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + 2, samplesPerPixel_),
-                             Xc->row_begin(row), Yc->row_begin(row),
-                             Zc->row_begin(row), conv);
-        }
+        const size_t spp = samplesPerPixel_;
+        const size_t rowSamples = (size_t)width_ * spp;
+        decodeRows<InputDataType>(
+            params, [&](const InputDataType *data, uint32 row) {
+                typedef StrideIterator<const InputDataType *> Iterator;
+                utils::transform(Iterator(data, spp),
+                                 Iterator(data + rowSamples, spp),
+                                 Iterator(data + 1, spp),
+                                 Iterator(data + 2, spp), Xc->row_begin(row),
+                                 Yc->row_begin(row), Zc->row_begin(row), conv);
+            });
 
         tempFrame.swap(frame);
     }
 
     template <typename InputDataType, typename Converter>
-    void read4Components(Frame &frame, const TiffReaderParams & /*params*/,
+    void read4Components(Frame &frame, const TiffReaderParams &params,
                          const Converter &conv) {
         assert(samplesPerPixel_ >= 4);
-        Frame tempFrame(width_, height_);
+        Frame tempFrame(width_, params.numRows_);
 
         pfs::Channel *Xc;
         pfs::Channel *Yc;
         pfs::Channel *Zc;
         tempFrame.createXYZChannels(Xc, Yc, Zc);
 
-        std::vector<InputDataType> tempBuffer((size_t) width_ * samplesPerPixel_);
-        for (uint32 row = 0; row < height_; row++) {
-            TIFFReadScanline(handle(), tempBuffer.data(), row);
-
-            utils::transform(StrideIterator<InputDataType *>(tempBuffer.data(),
-                                                             samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + width_ * samplesPerPixel_,
-                                 samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + 1, samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + 2, samplesPerPixel_),
-                             StrideIterator<InputDataType *>(
-                                 tempBuffer.data() + 3, samplesPerPixel_),
-                             Xc->row_begin(row), Yc->row_begin(row),
-                             Zc->row_begin(row), conv);
-        }
+        const size_t spp = samplesPerPixel_;
+        const size_t rowSamples = (size_t)width_ * spp;
+        decodeRows<InputDataType>(
+            params, [&](const InputDataType *data, uint32 row) {
+                typedef StrideIterator<const InputDataType *> Iterator;
+                utils::transform(
+                    Iterator(data, spp), Iterator(data + rowSamples, spp),
+                    Iterator(data + 1, spp), Iterator(data + 2, spp),
+                    Iterator(data + 3, spp), Xc->row_begin(row),
+                    Yc->row_begin(row), Zc->row_begin(row), conv);
+            });
+
+        tempFrame.swap(frame);
+    }
+
+    //! \brief ICC conversion, a whole row per call to LCMS: the input format
+    //! of \a xform matches the samples of the file, alpha included
+    template <typename InputDataType>
+    void readLCMS(Frame &frame, const TiffReaderParams &params,
+                  const colorspace::RowTransform &xform) {
+        Frame tempFrame(width_, params.numRows_);
+
+        pfs::Channel *Xc;
+        pfs::Channel *Yc;
+        pfs::Channel *Zc;
+        tempFrame.createXYZChannels(Xc, Yc, Zc);
+
+        const size_t width = width_;
+        decodeRows<InputDataType>(
+            params, [&](const InputDataType *data, uint32 row) {
+                xform(data, Xc->data() + row * width, Yc->data() + row * width,
+                      Zc->data() + row * width, width);
+            });
 
         tempFrame.swap(frame);
     }
@@ -360,16 +708,13 @@ struct TiffReaderData {
         assert(samplesPerPixel_ >= 3);
 #endif
 
-        ScopedCmsTransform xform(getColorSpaceTransform());
-        if (xform) {
+        colorspace::RowTransform xform(getColorSpaceTransform());
+        if (xform.isValid()) {
             PRINT_DEBUG("ICC Profile Available");
-            if (hasAlpha_) {
-                read4Components<InputDataType>(
-                    frame, params, colorspace::Convert4LCMS3(xform.data()));
-            } else {
-                read3Components<InputDataType>(
-                    frame, params, colorspace::Convert3LCMS3(xform.data()));
-            }
+            readLCMS<InputDataType>(frame, params, xform);
+        } else if (mapped_.isMapped()) {
+            // only ever true for 32 bit float data
+            readMapped(frame, params);
         } else {
             read3Components<InputDataType>(frame, params, colorspace::Copy());
         }
@@ -392,12 +737,11 @@ struct TiffReaderData {
         assert(samplesPerPixel_ == 4);
 #endif
 
-        ScopedCmsTransform xform(getColorSpaceTransform());
-        if (xform) {
+        colorspace::RowTransform xform(getColorSpaceTransform());
+        if (xform.isValid()) {
             PRINT_DEBUG("ICC Profile Available");
 
-            read4Components<InputDataType>(
-                frame, params, colorspace::Convert4LCMS3(xform.data()));
+            readLCMS<InputDataType>(frame, params, xform);
 
         } else {
             read4Components<InputDataType>(frame, params,
@@ -419,6 +763,7 @@ void TiffReader::close() { m_data.reset(new TiffReaderData); }
 
 void TiffReader::open() {
     m_data->file_.reset(TIFFOpen(filename().c_str(), "r"));
+    m_data->fileName_ = filename();
     if (!m_data->file_) {
         throw pfs::io::InvalidFile("TiffReader: cannot open file " +
                                    filename());
@@ -485,8 +830,6 @@ void TiffReader::open() {
                 throw pfs::io::InvalidHeader(
                     "TiffReader: only support SGILOG compressed LogLuv data");
             }
-            TIFFSetField(m_data->handle(), TIFFTAG_SGILOGDATAFMT,
-                         SGILOGDATAFMT_FLOAT);
         } break;
         case PHOTOMETRIC_RGB: {
             uint16 *extraSamplesTypes = 0;
@@ -522,20 +865,33 @@ void TiffReader::open() {
     // ...based on photometric type and bits per samples, will make ready the
     // right callback to read the data
     m_data->initReader();
+    m_data->setupHandle(m_data->handle());
     m_data->hIn_.reset(
         GetTIFFProfile(m_data->handle(), m_data->bitsPerSample_));
+    m_data->prepareMapping();
 }
 
 #define CALL_MEMBER_FN(object, ptrToMember) ((object).*(ptrToMember))
 
 void TiffReader::read(Frame &frame, const Params &params) {
+    pfs::utils::TraceSpan trace_span("TiffReader::read");
     if (!isOpen()) {
         open();
     }
 
     m_data->read(frame, params);
+    trace_span.setBytes(frame.size() * frame.getChannels().size() * sizeof(float));
     FrameReader::read(frame, params);
 }
 
+void TiffReader::readRows(Frame &band, size_t firstRow, size_t numRows,
+                          const Params & /*params*/) {
+    if (!isOpen()) {
+        open();
+    }
+
+    m_data->readRows(band, firstRow, numRows);
+}
+
 }  // io
 }  // pfs
@@ -45,6 +45,10 @@ class TiffReader : public FrameReader {
 
     void read(Frame &frame, const Params &params);
 
+    bool supportsRows() const { return true; }
+    void readRows(Frame &band, size_t firstRow, size_t numRows,
+                  const Params &params);
+
    private:
     std::unique_ptr<TiffReaderData> m_data;
 };
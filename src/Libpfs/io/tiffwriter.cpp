@@ -59,6 +59,7 @@
 #include <Libpfs/utils/chain.h>
 #include <Libpfs/utils/clamp.h>
 #include <Libpfs/utils/resourcehandlerlcms.h>
+#include <Libpfs/utils/trace.h>
 
 using namespace std;
 using namespace boost;
@@ -162,249 +163,174 @@ void writeSRGBProfile(TIFF *tif) {
 //    TIFFSetField (tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)4);
 //    TIFFSetField (tif, TIFFTAG_EXTRASAMPLES, (uint16_t)1, &extras);
 
-bool writeUint8(TIFF *tif, const Frame &frame, const TiffWriterParams &params) {
+//! \brief write the tags of a \a width x \a height image in the format
+//! selected by \c params.tiffWriterMode_
+void writeHeader(TIFF *tif, uint32_t width, uint32_t height,
+                 const TiffWriterParams &params) {
 #ifndef NDEBUG
     cout << BOOST_CURRENT_FUNCTION << endl;
 #endif
-
     assert(tif != NULL);
 
-    uint32_t width = frame.getWidth();
-    uint32_t height = frame.getHeight();
-
     writeCommonHeader(tif, width, height);
-    writeSRGBProfile(tif);
-
-    if (params.deflateCompression_)
-        TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
-    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-    TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
-    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
-                 (uint16_t)8 * (uint16_t)sizeof(uint8_t));
-    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
-
-    tsize_t stripSize = TIFFStripSize(tif);
-    assert(width * 3 == stripSize);
-    tstrip_t stripsNum = TIFFNumberOfStrips(tif);
 
-    const Channel *rChannel;
-    const Channel *gChannel;
-    const Channel *bChannel;
-    frame.getXYZChannels(rChannel, gChannel, bChannel);
+    switch (params.tiffWriterMode_) {
+        case 1: {
+            writeSRGBProfile(tif);
 
-    std::vector<uint8_t> stripBuffer(stripSize);
-    for (tstrip_t s = 0; s < stripsNum; s++) {
-        utils::transform(
-            rChannel->row_begin(s), rChannel->row_end(s),
-            gChannel->row_begin(s), bChannel->row_begin(s),
-            FixedStrideIterator<uint8_t *, 3>(stripBuffer.data()),
-            FixedStrideIterator<uint8_t *, 3>(stripBuffer.data() + 1),
-            FixedStrideIterator<uint8_t *, 3>(stripBuffer.data() + 2),
-            utils::chain(colorspace::Normalizer(params.minLuminance_,
-                                                params.maxLuminance_),
-                         utils::CLAMP_F32,
-                         Remapper<uint8_t>(params.luminanceMapping_)));
-
-        if (TIFFWriteEncodedStrip(tif, s, stripBuffer.data(), stripSize) !=
-            stripSize) {
-            throw pfs::io::WriteException("TiffWriter: Error writing strip " +
-                                          boost::lexical_cast<std::string>(s));
-            return false;
-        }
+            if (params.deflateCompression_) {
+                TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
+            }
+            TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+            TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
+            TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
+                         (uint16_t)8 * (uint16_t)sizeof(uint16_t));
+            TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
+
+            assert(width * 3 * 2 == TIFFStripSize(tif));
+        } break;
+        case 2: {
+            // writeSRGBProfile(tif);
+
+            if (params.deflateCompression_) {
+                TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
+            }
+            TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+            TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+            TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
+                         (uint16_t)8 * (uint16_t)sizeof(float));
+            TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
+
+            assert((tsize_t)sizeof(float) * width * 3 == TIFFStripSize(tif));
+        } break;
+        case 3: {
+            TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_SGILOG);
+            TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_LOGLUV);
+            TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+            TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
+                         (uint16_t)8 * (uint16_t)sizeof(float));
+            TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
+            TIFFSetField(tif, TIFFTAG_SGILOGDATAFMT, SGILOGDATAFMT_FLOAT);
+            TIFFSetField(tif, TIFFTAG_STONITS, 1.); /* not known */
+
+            assert((tsize_t)sizeof(float) * width * 3 == TIFFStripSize(tif));
+        } break;
+        case 0:
+        default: {
+            writeSRGBProfile(tif);
+
+            if (params.deflateCompression_)
+                TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
+            TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+            TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
+            TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
+                         (uint16_t)8 * (uint16_t)sizeof(uint8_t));
+            TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
+
+            assert(width * 3 == TIFFStripSize(tif));
+        } break;
     }
-    return true;
 }
 
-bool writeUint16(TIFF *tif, const Frame &frame,
-                 const TiffWriterParams &params) {
-#ifndef NDEBUG
-    cout << BOOST_CURRENT_FUNCTION << endl;
-#endif
+//! \brief encode every row of \a band as a strip, starting at strip
+//! \a firstStrip (every strip holds exactly one row, see
+//! \c writeCommonHeader())
+template <typename OutputDataType, typename Remapper>
+void writeStrips(TIFF *tif, const Frame &band, tstrip_t firstStrip,
+                 const Remapper &remapper) {
     assert(tif != NULL);
 
-    uint32_t width = frame.getWidth();
-    uint32_t height = frame.getHeight();
-
-    writeCommonHeader(tif, width, height);
-    writeSRGBProfile(tif);
-
-    if (params.deflateCompression_) {
-        TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
-    }
-    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-    TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
-    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
-                 (uint16_t)8 * (uint16_t)sizeof(uint16_t));
-    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
-
     tsize_t stripSize = TIFFStripSize(tif);
-    assert(width * 3 * 2 == stripSize);
     tstrip_t stripsNum = TIFFNumberOfStrips(tif);
 
     const Channel *rChannel;
     const Channel *gChannel;
     const Channel *bChannel;
-    frame.getXYZChannels(rChannel, gChannel, bChannel);
-
-    std::vector<uint16_t> stripBuffer(width * 3);
-
-    typedef utils::Chain<colorspace::Normalizer,
-                         utils::Chain<utils::Clamp<float>, Remapper<uint16_t>>>
-        TiffRemapper;
+    band.getXYZChannels(rChannel, gChannel, bChannel);
+
+    std::vector<OutputDataType> stripBuffer(band.getWidth() * 3);
+    for (size_t row = 0; row < band.getHeight(); ++row) {
+        tstrip_t s = firstStrip + row;
+        if (s >= stripsNum) {
+            throw pfs::io::WriteException(
+                "TiffWriter: too many rows, strip " +
+                boost::lexical_cast<std::string>(s) + " does not exist");
+        }
 
-    TiffRemapper remapper(
-        colorspace::Normalizer(params.minLuminance_, params.maxLuminance_),
-        utils::Chain<utils::Clamp<float>, Remapper<uint16_t>>(
-            utils::Clamp<float>(0.f, 1.f),
-            Remapper<uint16_t>(params.luminanceMapping_)));
-    for (tstrip_t s = 0; s < stripsNum; s++) {
         utils::transform(
-            rChannel->row_begin(s), rChannel->row_end(s),
-            gChannel->row_begin(s), bChannel->row_begin(s),
-            FixedStrideIterator<uint16_t *, 3>(stripBuffer.data()),
-            FixedStrideIterator<uint16_t *, 3>(stripBuffer.data() + 1),
-            FixedStrideIterator<uint16_t *, 3>(stripBuffer.data() + 2),
+            rChannel->row_begin(row), rChannel->row_end(row),
+            gChannel->row_begin(row), bChannel->row_begin(row),
+            FixedStrideIterator<OutputDataType *, 3>(stripBuffer.data()),
+            FixedStrideIterator<OutputDataType *, 3>(stripBuffer.data() + 1),
+            FixedStrideIterator<OutputDataType *, 3>(stripBuffer.data() + 2),
             remapper);
+
         if (TIFFWriteEncodedStrip(tif, s, stripBuffer.data(), stripSize) !=
             stripSize) {
             throw pfs::io::WriteException("TiffWriter: Error writing strip " +
                                           boost::lexical_cast<std::string>(s));
-            return false;
         }
     }
-
-    return true;
 }
 
-// write 32 bit float Tiff from pfs::Frame ... to finish!
-bool writeFloat32(TIFF *tif, const Frame &frame,
-                  const TiffWriterParams &params) {
-#ifndef NDEBUG
-    cout << BOOST_CURRENT_FUNCTION << endl;
-#endif
-    assert(tif != NULL);
-
-    uint32_t width = frame.getWidth();
-    uint32_t height = frame.getHeight();
-
-    writeCommonHeader(tif, width, height);
-    // writeSRGBProfile(tif);
-
-    if (params.deflateCompression_) {
-        TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
-    }
-    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-    TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
-    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
-                 (uint16_t)8 * (uint16_t)sizeof(float));
-    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
-
-    tsize_t stripSize = TIFFStripSize(tif);
-    assert((tsize_t)sizeof(float) * width * 3 == stripSize);
-    tstrip_t stripsNum = TIFFNumberOfStrips(tif);
-
-    const Channel *rChannel;
-    const Channel *gChannel;
-    const Channel *bChannel;
-    frame.getXYZChannels(rChannel, gChannel, bChannel);
-
-    PRINT_DEBUG(params.minLuminance_);
-    PRINT_DEBUG(params.maxLuminance_);
-
-    std::vector<float> stripBuffer(width * 3);
-    typedef utils::Chain<colorspace::Normalizer, utils::Clamp<float>>
-        TiffRemapper;
-    // Mapping is linear, so I avoid to call the Remapper class
-    TiffRemapper remapper(
-        colorspace::Normalizer(params.minLuminance_, params.maxLuminance_),
-        utils::Clamp<float>(0.f, 1.f));
-    for (tstrip_t s = 0; s < stripsNum; s++) {
-        utils::transform(
-            rChannel->row_begin(s), rChannel->row_end(s),
-            gChannel->row_begin(s), bChannel->row_begin(s),
-            FixedStrideIterator<float *, 3>(stripBuffer.data()),
-            FixedStrideIterator<float *, 3>(stripBuffer.data() + 1),
-            FixedStrideIterator<float *, 3>(stripBuffer.data() + 2), remapper);
-        if (TIFFWriteEncodedStrip(tif, s, stripBuffer.data(), stripSize) == 0) {
-            throw pfs::io::WriteException("TiffWriter: Error writing strip " +
-                                          boost::lexical_cast<std::string>(s));
-
-            return -1;
-        }
+//! \brief encode the rows of \a band in the format selected by
+//! \c params.tiffWriterMode_
+void writeBand(TIFF *tif, const Frame &band, tstrip_t firstStrip,
+               const TiffWriterParams &params) {
+    colorspace::Normalizer normalizer(params.minLuminance_,
+                                      params.maxLuminance_);
+
+    switch (params.tiffWriterMode_) {
+        case 1: {
+            writeStrips<uint16_t>(
+                tif, band, firstStrip,
+                utils::chain(normalizer, utils::Clamp<float>(0.f, 1.f),
+                             Remapper<uint16_t>(params.luminanceMapping_)));
+        } break;
+        case 2: {
+            PRINT_DEBUG(params.minLuminance_);
+            PRINT_DEBUG(params.maxLuminance_);
+
+            // Mapping is linear, so I avoid to call the Remapper class
+            writeStrips<float>(
+                tif, band, firstStrip,
+                utils::chain(normalizer, utils::Clamp<float>(0.f, 1.f)));
+        } break;
+        case 3: {
+            // remap to [0, 1] + transform to colorspace XYZ
+            // no gamma curve applied
+            writeStrips<float>(
+                tif, band, firstStrip,
+                utils::chain(normalizer, utils::Clamp<float>(0.f, 1.f),
+                             colorspace::ConvertRGB2XYZ()));
+        } break;
+        case 0:
+        default: {
+            writeStrips<uint8_t>(
+                tif, band, firstStrip,
+                utils::chain(normalizer, utils::CLAMP_F32,
+                             Remapper<uint8_t>(params.luminanceMapping_)));
+        } break;
     }
-
-    return true;
 }
 
-// write LogLUv Tiff from pfs::Frame
-bool writeLogLuv(TIFF *tif, const Frame &frame,
-                 const TiffWriterParams &params) {
-#ifndef NDEBUG
-    cout << BOOST_CURRENT_FUNCTION << endl;
-#endif
-    assert(tif != NULL);
-
-    uint32_t width = frame.getWidth();
-    uint32_t height = frame.getHeight();
-
-    writeCommonHeader(tif, width, height);
-
-    TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_SGILOG);
-    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_LOGLUV);
-    TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
-    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE,
-                 (uint16_t)8 * (uint16_t)sizeof(float));
-    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16_t)3);
-    TIFFSetField(tif, TIFFTAG_SGILOGDATAFMT, SGILOGDATAFMT_FLOAT);
-    TIFFSetField(tif, TIFFTAG_STONITS, 1.); /* not known */
-
-    tsize_t stripSize = TIFFStripSize(tif);
-    assert((tsize_t)sizeof(float) * width * 3 == stripSize);
-    tstrip_t stripsNum = TIFFNumberOfStrips(tif);
-
-    const Channel *rChannel;
-    const Channel *gChannel;
-    const Channel *bChannel;
-    frame.getXYZChannels(rChannel, gChannel, bChannel);
-
-    std::vector<float> stripBuffer(width * 3);
-
-    // remap to [0, 1] + transform to colorspace XYZ
-    // no gamma curve applied
-    typedef utils::Chain<
-        colorspace::Normalizer,
-        utils::Chain<utils::Clamp<float>, colorspace::ConvertRGB2XYZ>>
-        TiffRemapper;
-
-    TiffRemapper remapper(
-        colorspace::Normalizer(params.minLuminance_, params.maxLuminance_),
-        utils::Chain<utils::Clamp<float>, colorspace::ConvertRGB2XYZ>(
-            utils::Clamp<float>(0.f, 1.f), colorspace::ConvertRGB2XYZ()));
-
-    for (tstrip_t s = 0; s < stripsNum; s++) {
-        utils::transform(
-            rChannel->row_begin(s), rChannel->row_end(s),
-            gChannel->row_begin(s), bChannel->row_begin(s),
-            FixedStrideIterator<float *, 3>(stripBuffer.data()),
-            FixedStrideIterator<float *, 3>(stripBuffer.data() + 1),
-            FixedStrideIterator<float *, 3>(stripBuffer.data() + 2), remapper);
-        if (TIFFWriteEncodedStrip(tif, s, stripBuffer.data(), stripSize) !=
-            stripSize) {
-            throw pfs::io::WriteException("TiffWriter: Error writing strip " +
-                                          boost::lexical_cast<std::string>(s));
-
-            return false;
-        }
-    }
+//! \brief state of an image being written one band at a time
+struct TiffWriterData {
+    TiffWriterData() : nextStrip_(0) {}
 
-    return true;
-}
+    ScopedTiffFile file_;
+    TiffWriterParams params_;
+    tstrip_t nextStrip_;
+};
 
 TiffWriter::TiffWriter(const std::string &filename) : FrameWriter(filename) {}
 
 TiffWriter::~TiffWriter() {}
 
 bool TiffWriter::write(const pfs::Frame &frame, const pfs::Params &params) {
+    pfs::utils::TraceSpan trace_span(
+        "TiffWriter::write",
+        frame.size() * frame.getChannels().size() * sizeof(float));
     TiffWriterParams p;
     p.parse(params);
 
@@ -417,24 +343,45 @@ bool TiffWriter::write(const pfs::Frame &frame, const pfs::Params &params) {
         throw pfs::io::InvalidFile("TiffWriter: cannot open " + filename());
     }
 
-    bool status = true;
-    switch (p.tiffWriterMode_) {
-        case 1:
-            status = writeUint16(tif.data(), frame, p);
-            break;
-        case 2:
-            status = writeFloat32(tif.data(), frame, p);
-            break;
-        case 3:
-            status = writeLogLuv(tif.data(), frame, p);
-            break;
-        case 0:
-        default:
-            status = writeUint8(tif.data(), frame, p);
-            break;
+    writeHeader(tif.data(), frame.getWidth(), frame.getHeight(), p);
+    writeBand(tif.data(), frame, 0, p);
+
+    return true;
+}
+
+void TiffWriter::beginRows(size_t width, size_t height,
+                           const pfs::Params &params) {
+    m_data.reset(new TiffWriterData);
+    m_data->params_.parse(params);
+
+#ifndef NDEBUG
+    cout << m_data->params_ << endl;
+#endif
+
+    m_data->file_.reset(TIFFOpen(filename().c_str(), "w"));
+    if (!m_data->file_) {
+        m_data.reset();
+        throw pfs::io::InvalidFile("TiffWriter: cannot open " + filename());
     }
 
-    return status;
+    writeHeader(m_data->file_.data(), width, height, m_data->params_);
+}
+
+void TiffWriter::writeRows(const pfs::Frame &band) {
+    if (!m_data) {
+        throw pfs::io::WriteException("TiffWriter: beginRows() not called");
+    }
+
+    writeBand(m_data->file_.data(), band, m_data->nextStrip_, m_data->params_);
+    m_data->nextStrip_ += band.getHeight();
+}
+
+bool TiffWriter::endRows() {
+    if (!m_data) return false;
+
+    // closing the file flushes the directory
+    m_data.reset();
+    return true;
 }
 
 }  // io
@@ -36,11 +36,14 @@
 
 #include <Libpfs/io/framewriter.h>
 #include <Libpfs/params.h>
+#include <memory>
 #include <string>
 
 namespace pfs {
 namespace io {
 
+struct TiffWriterData;
+
 //! \brief Writer class for TIFF files
 class TiffWriter : public FrameWriter {
    public:
@@ -56,6 +59,15 @@ class TiffWriter : public FrameWriter {
     //!   mapping_method (int): RGB mapping methodo choosen between
     //!   RGBMappingType in rgbremapper.h
     bool write(const pfs::Frame &frame, const pfs::Params &params);
+
+    //! \brief band by band version of \c write(), same \c params
+    bool supportsRows() const { return true; }
+    void beginRows(size_t width, size_t height, const pfs::Params &params);
+    void writeRows(const pfs::Frame &band);
+    bool endRows();
+
+   private:
+    std::unique_ptr<TiffWriterData> m_data;
 };
 
 }  // io
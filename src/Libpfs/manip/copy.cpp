@@ -25,7 +25,7 @@
 #include "copy.h"
 
 #include "Libpfs/frame.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 #include <algorithm>
 
@@ -33,10 +33,9 @@ namespace pfs {
 using namespace utils;
 
 pfs::Frame *copy(const pfs::Frame *inFrame) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "pfscopy",
+        inFrame->size() * inFrame->getChannels().size() * sizeof(float));
 
     const int outWidth = inFrame->getWidth();
     const int outHeight = inFrame->getHeight();
@@ -56,11 +55,6 @@ pfs::Frame *copy(const pfs::Frame *inFrame) {
 
     pfs::copyTags(inFrame, outFrame);
 
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "pfscopy() = " << f_timer.get_time() << " msec" << std::endl;
-#endif
-
     return outFrame;
 }
 }
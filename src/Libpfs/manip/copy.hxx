@@ -30,6 +30,8 @@
 #include <algorithm>
 #include <cassert>
 
+#include "Libpfs/utils/tiles.h"
+
 namespace pfs {
 
 template <typename Type>
@@ -37,7 +39,10 @@ void copy(const Array2D<Type> *from, Array2D<Type> *to) {
     assert(from->getRows() == to->getRows());
     assert(from->getCols() == to->getCols());
 
-    std::copy(from->begin(), from->end(), to->begin());
+    utils::forEachRowBlock(from->getRows(), [=](size_t first, size_t last) {
+        std::copy(from->row_begin(first), from->row_begin(last),
+                  to->row_begin(first));
+    });
 }
 }
 
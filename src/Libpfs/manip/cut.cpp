@@ -36,16 +36,15 @@
 #include <iostream>
 
 #include "Libpfs/frame.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 namespace pfs {
 
 pfs::Frame *cut(const pfs::Frame *inFrame, size_t x_ul, size_t y_ul,
                 size_t x_br, size_t y_br) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "pfscut",
+        inFrame->size() * inFrame->getChannels().size() * sizeof(float));
 
     // ----  Boundary Check!
     // if (x_ul < 0) x_ul = 0;
@@ -69,14 +68,6 @@ pfs::Frame *cut(const pfs::Frame *inFrame, size_t x_ul, size_t y_ul,
 
     pfs::copyTags(inFrame, outFrame);
 
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "pfscut(";
-    std::cout << "[" << x_ul << ", " << y_ul << "],";
-    std::cout << "[" << x_br << ", " << y_br << "]";
-    std::cout << ") = " << f_timer.get_time() << " msec" << std::endl;
-#endif
-
     return outFrame;
 }
 
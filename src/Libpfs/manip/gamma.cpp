@@ -33,7 +33,7 @@
 #include "Libpfs/array2d.h"
 #include "Libpfs/colorspace/colorspace.h"
 #include "Libpfs/frame.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "opthelper.h"
 #include "sleef.c"
 #define pow_F(a,b) (xexpf(b*xlogf(a)))
@@ -54,10 +54,8 @@ void applyGamma(pfs::Frame *frame, float gamma) {
 
 void applyGamma(pfs::Array2Df *array, const float exponent) {
 
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "applyGamma", array->size() * sizeof(float));
 
     const int h = array->getRows();
     const int w = array->getCols();
@@ -84,11 +82,5 @@ void applyGamma(pfs::Array2Df *array, const float exponent) {
             }
         }
     }
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "applyGamma() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 }
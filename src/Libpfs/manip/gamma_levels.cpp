@@ -27,7 +27,7 @@
 
 #include "Libpfs/channel.h"
 #include "Libpfs/frame.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 namespace {
 
@@ -86,10 +86,9 @@ namespace pfs {
 
 void gammaAndLevels(pfs::Frame *inFrame, float black_in, float white_in,
                     float black_out, float white_out, float gamma) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "gamma_levels",
+        inFrame->size() * inFrame->getChannels().size() * sizeof(float));
 
 #ifndef NDEBUG
     std::cerr << "Black in = " << black_in << ", Black out = " << black_out
@@ -137,11 +136,5 @@ void gammaAndLevels(pfs::Frame *inFrame, float black_in, float white_in,
         G_o[idx] = clamp(black_out + green * (white_out - black_out), 0.f, 1.f);
         B_o[idx] = clamp(black_out + blue * (white_out - black_out), 0.f, 1.f);
     }
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "gamma_levels() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 }
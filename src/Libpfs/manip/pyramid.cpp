@@ -0,0 +1,541 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include "pyramid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "Libpfs/utils/numeric.h"
+#include "sleef.c"
+#include "opthelper.h"
+#include "gauss.h"
+
+namespace pfs {
+
+namespace {
+// below this many output pixels, filters run on the calling thread only
+const size_t PARALLEL_PIXELS = 64 * 64;
+// extra samples at the end of the scratch row, read (not used) by the
+// vectorized loops of the horizontal pass
+const int LINE_SLACK = 8;
+
+//! \brief weights of a 1-D filter: output i is the sum over t of
+//! weights[i * taps + t] times the input at first[i] + t, indices out of the
+//! input being resolved by the boundary mode
+struct Taps {
+    Taps() : size(0), taps(0), uniform(false), stride(1), offset(0),
+             before(0), after(0) {}
+
+    size_t size;
+    int taps;
+    std::vector<int> first;
+    std::vector<float> weights;
+    //! \brief same weights for every output, and first[i] = stride * i +
+    //! offset
+    bool uniform;
+    int stride;
+    int offset;
+    //! \brief how far the taps reach before the first and past the last
+    //! input
+    int before;
+    int after;
+};
+
+void finish(Taps &taps, size_t inSize) {
+    for (size_t i = 0; i < taps.size; ++i) {
+        taps.before = std::max(taps.before, -taps.first[i]);
+        taps.after = std::max(taps.after, taps.first[i] + taps.taps -
+                                              static_cast<int>(inSize));
+    }
+}
+
+Taps uniformTaps(size_t inSize, size_t outSize, int stride, int offset,
+                 const float *weights, int count) {
+    Taps taps;
+    taps.size = outSize;
+    taps.taps = count;
+    taps.uniform = true;
+    taps.stride = stride;
+    taps.offset = offset;
+    taps.first.resize(outSize);
+    taps.weights.resize(outSize * count);
+    for (size_t i = 0; i < outSize; ++i) {
+        taps.first[i] = stride * static_cast<int>(i) + offset;
+        std::copy(weights, weights + count, &taps.weights[i * count]);
+    }
+    finish(taps, inSize);
+    return taps;
+}
+
+//! \brief taps of the average over the area of each output pixel, as
+//! matrixDownsampleFull() of Mantiuk06: fractions of pixels at both ends
+Taps areaTaps(size_t inSize, size_t outSize) {
+    const float d = static_cast<float>(inSize) / outSize;
+
+    std::vector<std::vector<float> > weights(outSize);
+    Taps taps;
+    taps.size = outSize;
+    taps.first.resize(outSize);
+    for (size_t i = 0; i < outSize; ++i) {
+        const size_t i1 = (i * inSize) / outSize;
+        const size_t i2 = ((i + 1) * inSize) / outSize;
+        const float f1 = (i1 + 1) - i * d;
+        const float f2 = (i + 1) * d - i2;
+        for (size_t j = i1; j <= i2 && j < inSize; ++j) {
+            const float w = j == i1 ? f1 : (j == i2 ? f2 : 1.f);
+            weights[i].push_back(w / d);
+        }
+        // drop the pixel of the next output, when it is not covered
+        while (!weights[i].empty() && weights[i].back() == 0.f) {
+            weights[i].pop_back();
+        }
+        taps.first[i] = static_cast<int>(i1);
+        taps.taps = std::max(taps.taps, static_cast<int>(weights[i].size()));
+    }
+    taps.weights.assign(outSize * taps.taps, 0.f);
+    for (size_t i = 0; i < outSize; ++i) {
+        std::copy(weights[i].begin(), weights[i].end(),
+                  &taps.weights[i * taps.taps]);
+    }
+    finish(taps, inSize);
+    return taps;
+}
+
+Taps reduceTaps(size_t inSize, PyramidKernel kernel) {
+    static const float BINOMIAL[] = {0.125f, 0.375f, 0.375f, 0.125f};
+    static const float BURT_ADELSON[] = {0.05f, 0.25f, 0.4f, 0.25f, 0.05f};
+    static const float BOX[] = {0.5f, 0.5f};
+
+    const size_t outSize = inSize / 2;
+    switch (kernel) {
+        case PYRAMID_BINOMIAL:
+            return uniformTaps(inSize, outSize, 2, -1, BINOMIAL, 4);
+        case PYRAMID_BURT_ADELSON:
+            return uniformTaps(inSize, outSize, 2, -2, BURT_ADELSON, 5);
+        case PYRAMID_BOX:
+        default:
+            if (inSize % 2 == 0) {
+                return uniformTaps(inSize, outSize, 2, 0, BOX, 2);
+            }
+            return areaTaps(inSize, outSize);
+    }
+}
+
+//! \brief transpose of the taps of reduce() from \a outSize samples,
+//! normalized
+Taps expandTaps(size_t inSize, size_t outSize, PyramidKernel kernel) {
+    const Taps reduced = reduceTaps(outSize, kernel);
+    assert(reduced.size == inSize);
+
+    std::vector<std::vector<std::pair<int, float> > > sources(outSize);
+    for (size_t k = 0; k < reduced.size; ++k) {
+        for (int t = 0; t < reduced.taps; ++t) {
+            const int x = reduced.first[k] + t;
+            const float w = reduced.weights[k * reduced.taps + t];
+            if (x >= 0 && x < static_cast<int>(outSize) && w != 0.f) {
+                sources[x].push_back(std::make_pair(static_cast<int>(k), w));
+            }
+        }
+    }
+
+    Taps taps;
+    taps.size = outSize;
+    taps.first.resize(outSize);
+    for (size_t x = 0; x < outSize; ++x) {
+        if (sources[x].empty()) {
+            // past the reach of the last output of reduce(): nearest
+            const int k = std::min(static_cast<int>(x / 2),
+                                   static_cast<int>(inSize) - 1);
+            sources[x].push_back(std::make_pair(k, 1.f));
+        }
+        taps.first[x] = sources[x].front().first;
+        taps.taps = std::max(
+            taps.taps, sources[x].back().first - taps.first[x] + 1);
+    }
+    taps.weights.assign(outSize * taps.taps, 0.f);
+    for (size_t x = 0; x < outSize; ++x) {
+        float sum = 0.f;
+        for (size_t s = 0; s < sources[x].size(); ++s) {
+            sum += sources[x][s].second;
+        }
+        for (size_t s = 0; s < sources[x].size(); ++s) {
+            taps.weights[x * taps.taps + sources[x][s].first -
+                         taps.first[x]] = sources[x][s].second / sum;
+        }
+    }
+    finish(taps, inSize);
+    return taps;
+}
+
+inline int mapIndex(int i, int n, PyramidBoundary boundary) {
+    if (i >= 0 && i < n) return i;
+    if (boundary == PYRAMID_REFLECT && n > 1) {
+        i = i < 0 ? -i : 2 * (n - 1) - i;
+    }
+    return std::min(std::max(i, 0), n - 1);
+}
+
+inline void scaleRow(const float *src, float w, float *dst, int n) {
+    int x = 0;
+#ifdef __SSE2__
+    const vfloat wv = F2V(w);
+    for (; x < n - 3; x += 4) {
+        STVFU(dst[x], wv * LVFU(src[x]));
+    }
+#endif
+    for (; x < n; ++x) {
+        dst[x] = w * src[x];
+    }
+}
+
+inline void addScaledRow(const float *src, float w, float *dst, int n) {
+    int x = 0;
+#ifdef __SSE2__
+    const vfloat wv = F2V(w);
+    for (; x < n - 3; x += 4) {
+        STVFU(dst[x], LVFU(dst[x]) + wv * LVFU(src[x]));
+    }
+#endif
+    for (; x < n; ++x) {
+        dst[x] += w * src[x];
+    }
+}
+
+//! \brief horizontal pass of uniform taps over \a line, extended past its
+//! edges
+void filterUniform(const float *line, const Taps &taps, float *dst) {
+    const int n = static_cast<int>(taps.size);
+    const float *c = taps.weights.data();
+    const float *src = line + taps.offset;
+    int x = 0;
+#ifdef __SSE2__
+    if (taps.stride == 1) {
+        for (; x < n - 3; x += 4) {
+            vfloat v = ZEROV;
+            for (int t = 0; t < taps.taps; ++t) {
+                v += F2V(c[t]) * LVFU(src[x + t]);
+            }
+            STVFU(dst[x], v);
+        }
+    } else if (taps.stride == 2) {
+        // even lanes of two loads: the taps of four outputs at once
+        for (; x < n - 3; x += 4) {
+            vfloat v = ZEROV;
+            for (int t = 0; t < taps.taps; ++t) {
+                const vfloat lo = LVFU(src[2 * x + t]);
+                const vfloat hi = LVFU(src[2 * x + t + 4]);
+                v += F2V(c[t]) *
+                     _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            }
+            STVFU(dst[x], v);
+        }
+    }
+#endif
+    for (; x < n; ++x) {
+        const float *p = src + taps.stride * x;
+        float v = 0.f;
+        for (int t = 0; t < taps.taps; ++t) {
+            v += c[t] * p[t];
+        }
+        dst[x] = v;
+    }
+}
+
+void filterTable(const float *line, const Taps &taps, float *dst) {
+    const int n = static_cast<int>(taps.size);
+    for (int x = 0; x < n; ++x) {
+        const float *p = line + taps.first[x];
+        const float *c = &taps.weights[x * taps.taps];
+        float v = 0.f;
+        for (int t = 0; t < taps.taps; ++t) {
+            v += c[t] * p[t];
+        }
+        dst[x] = v;
+    }
+}
+
+//! \brief \a out = \a in filtered by \a cols along the rows and by \a rows
+//! along the columns. Each thread takes a band of output rows: it sums the
+//! input rows of the taps of an output row in a scratch row (so the input
+//! rows are read while they are in the cache), extends it past its edges,
+//! then filters it along the row into the output.
+void separable(const float *in, int inCols, int inRows, float *out,
+               const Taps &cols, const Taps &rows,
+               PyramidBoundary boundary) {
+    const int outCols = static_cast<int>(cols.size);
+    const int outRows = static_cast<int>(rows.size);
+    const size_t pixels = static_cast<size_t>(outCols) * outRows;
+
+#pragma omp parallel if (pixels >= PARALLEL_PIXELS)
+    {
+        std::vector<float> buffer(cols.before + inCols + cols.after +
+                                  LINE_SLACK);
+        float *const line = buffer.data() + cols.before;
+
+#pragma omp for schedule(static)
+        for (int y = 0; y < outRows; ++y) {
+            const float *w = &rows.weights[y * rows.taps];
+            bool empty = true;
+            for (int t = 0; t < rows.taps; ++t) {
+                if (w[t] == 0.f) continue;
+                const int r = mapIndex(rows.first[y] + t, inRows, boundary);
+                const float *src = in + static_cast<size_t>(r) * inCols;
+                if (empty) {
+                    scaleRow(src, w[t], line, inCols);
+                } else {
+                    addScaledRow(src, w[t], line, inCols);
+                }
+                empty = false;
+            }
+            if (empty) std::fill(line, line + inCols, 0.f);
+
+            for (int i = 1; i <= cols.before; ++i) {
+                line[-i] = line[mapIndex(-i, inCols, boundary)];
+            }
+            for (int i = 0; i < cols.after; ++i) {
+                line[inCols + i] =
+                    line[mapIndex(inCols + i, inCols, boundary)];
+            }
+
+            float *dst = out + static_cast<size_t>(y) * outCols;
+            if (cols.uniform) {
+                filterUniform(line, cols, dst);
+            } else {
+                filterTable(line, cols, dst);
+            }
+        }
+    }
+}
+
+struct Pool {
+    Pool() : bytes(0) {}
+
+    std::mutex mutex;
+    std::multimap<std::pair<size_t, size_t>, Array2Df *> arrays;
+    size_t bytes;
+};
+
+// never destroyed: arrays may be released after the static objects are gone
+Pool &pool() {
+    static Pool *instance = new Pool;
+    return *instance;
+}
+}
+
+void reduce(const float *in, size_t inCols, size_t inRows, float *out,
+            PyramidKernel kernel, PyramidBoundary boundary) {
+    const Taps cols = reduceTaps(inCols, kernel);
+    const Taps rows = reduceTaps(inRows, kernel);
+    separable(in, static_cast<int>(inCols), static_cast<int>(inRows), out,
+              cols, rows, boundary);
+}
+
+void reduce(const Array2Df &in, Array2Df &out, PyramidKernel kernel,
+            PyramidBoundary boundary) {
+    assert(out.getCols() == in.getCols() / 2);
+    assert(out.getRows() == in.getRows() / 2);
+    reduce(in.data(), in.getCols(), in.getRows(), out.data(), kernel,
+           boundary);
+}
+
+void expand(const Array2Df &in, Array2Df &out, PyramidKernel kernel) {
+    const Taps cols = expandTaps(in.getCols(), out.getCols(), kernel);
+    const Taps rows = expandTaps(in.getRows(), out.getRows(), kernel);
+    separable(in.data(), static_cast<int>(in.getCols()),
+              static_cast<int>(in.getRows()), out.data(), cols, rows,
+              PYRAMID_CLAMP);
+}
+
+void binomialBlur(const Array2Df &in, Array2Df &out,
+                  PyramidBoundary boundary) {
+    static const float BINOMIAL[] = {0.25f, 0.5f, 0.25f};
+
+    assert(out.getCols() == in.getCols() && out.getRows() == in.getRows());
+    const Taps cols =
+        uniformTaps(in.getCols(), in.getCols(), 1, -1, BINOMIAL, 3);
+    const Taps rows =
+        uniformTaps(in.getRows(), in.getRows(), 1, -1, BINOMIAL, 3);
+
+    if (&in != &out) {
+        separable(in.data(), in.getCols(), in.getRows(), out.data(), cols,
+                  rows, boundary);
+        return;
+    }
+    // the rows of the taps of an output row must not be overwritten yet
+    Array2Df copy;
+    PyramidPool::acquire(in.getCols(), in.getRows(), copy);
+    std::copy(in.begin(), in.end(), copy.begin());
+    separable(copy.data(), copy.getCols(), copy.getRows(), out.data(), cols,
+              rows, boundary);
+    PyramidPool::release(copy);
+}
+
+void gaussianBlur(const Array2Df &in, Array2Df &out, float sigma) {
+    assert(out.getCols() == in.getCols() && out.getRows() == in.getRows());
+    const int width = static_cast<int>(in.getCols());
+    const int height = static_cast<int>(in.getRows());
+    if (&in != &out) {
+        std::copy(in.begin(), in.end(), out.begin());
+    }
+    // the recursive filter needs 3 pixels of history along each side
+    if (width < 3 || height < 3) return;
+
+    std::vector<float *> rows(height);
+    for (int y = 0; y < height; ++y) {
+        rows[y] = out.data() + static_cast<size_t>(y) * width;
+    }
+    // the passes of gauss.h share their loops among the threads of the
+    // enclosing parallel region
+#pragma omp parallel
+    ::gaussianBlur(rows.data(), rows.data(), width, height, sigma);
+}
+
+void PyramidPool::acquire(size_t cols, size_t rows, Array2Df &array) {
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        std::multimap<std::pair<size_t, size_t>, Array2Df *>::iterator it =
+            p.arrays.find(std::make_pair(cols, rows));
+        if (it != p.arrays.end()) {
+            array.swap(*it->second);
+            delete it->second;
+            p.arrays.erase(it);
+            p.bytes -= cols * rows * sizeof(float);
+            return;
+        }
+    }
+    Array2Df fresh(cols, rows);
+    array.swap(fresh);
+}
+
+void PyramidPool::release(Array2Df &array) {
+    const size_t bytes = array.size() * sizeof(float);
+    if (bytes == 0) return;
+
+    Array2Df *stored = new Array2Df;
+    stored->swap(array);
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.bytes + bytes <= MAX_BYTES) {
+            p.arrays.insert(std::make_pair(
+                std::make_pair(stored->getCols(), stored->getRows()), stored));
+            p.bytes += bytes;
+            return;
+        }
+    }
+    delete stored;
+}
+
+void PyramidPool::clear() {
+    std::multimap<std::pair<size_t, size_t>, Array2Df *> arrays;
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        arrays.swap(p.arrays);
+        p.bytes = 0;
+    }
+    for (std::multimap<std::pair<size_t, size_t>, Array2Df *>::iterator it =
+             arrays.begin();
+         it != arrays.end(); ++it) {
+        delete it->second;
+    }
+}
+
+GaussianPyramid::GaussianPyramid(const Array2Df &image, size_t maxLevels,
+                                 PyramidKernel kernel, size_t minSize,
+                                 PyramidBoundary boundary)
+    : m_image(&image), m_kernel(kernel) {
+    minSize = std::max(minSize, size_t(1));
+    // levels are never moved: the vector must not grow past its capacity
+    m_levels.reserve(maxLevels > 1 ? maxLevels - 1 : 0);
+
+    const Array2Df *previous = &image;
+    while (m_levels.size() + 1 < maxLevels) {
+        const size_t cols = previous->getCols() / 2;
+        const size_t rows = previous->getRows() / 2;
+        if (std::min(cols, rows) < minSize) break;
+
+        m_levels.push_back(Array2Df());
+        Array2Df &next = m_levels.back();
+        PyramidPool::acquire(cols, rows, next);
+        reduce(*previous, next, kernel, boundary);
+        previous = &next;
+    }
+}
+
+GaussianPyramid::~GaussianPyramid() {
+    for (size_t k = 0; k < m_levels.size(); ++k) {
+        PyramidPool::release(m_levels[k]);
+    }
+}
+
+LaplacianPyramid::LaplacianPyramid(const GaussianPyramid &gaussian)
+    : m_kernel(gaussian.kernel()), m_levels(gaussian.numLevels()) {
+    const size_t last = m_levels.size() - 1;
+    for (size_t k = 0; k < last; ++k) {
+        const Array2Df &fine = gaussian.level(k);
+        Array2Df &level = m_levels[k];
+        PyramidPool::acquire(fine.getCols(), fine.getRows(), level);
+        expand(gaussian.level(k + 1), level, m_kernel);
+        utils::vsub(fine.data(), level.data(), level.data(), level.size());
+    }
+    const Array2Df &coarsest = gaussian.level(last);
+    PyramidPool::acquire(coarsest.getCols(), coarsest.getRows(),
+                         m_levels[last]);
+    std::copy(coarsest.begin(), coarsest.end(), m_levels[last].begin());
+}
+
+LaplacianPyramid::~LaplacianPyramid() {
+    for (size_t k = 0; k < m_levels.size(); ++k) {
+        PyramidPool::release(m_levels[k]);
+    }
+}
+
+void LaplacianPyramid::collapse(Array2Df &out) const {
+    const size_t last = m_levels.size() - 1;
+    Array2Df current;
+    PyramidPool::acquire(m_levels[last].getCols(), m_levels[last].getRows(),
+                         current);
+    std::copy(m_levels[last].begin(), m_levels[last].end(), current.begin());
+
+    for (size_t k = last; k-- > 0;) {
+        Array2Df finer;
+        PyramidPool::acquire(m_levels[k].getCols(), m_levels[k].getRows(),
+                             finer);
+        expand(current, finer, m_kernel);
+        utils::vadd(finer.data(), m_levels[k].data(), finer.data(),
+                    finer.size());
+        PyramidPool::release(current);
+        current.swap(finer);
+    }
+
+    assert(out.getCols() == current.getCols());
+    assert(out.getRows() == current.getRows());
+    std::copy(current.begin(), current.end(), out.begin());
+    PyramidPool::release(current);
+}
+
+}  // pfs
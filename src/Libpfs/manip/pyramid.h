@@ -0,0 +1,159 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \file pyramid.h
+//! \brief Blurs, Gaussian and Laplacian pyramids shared by the tone mapping
+//! operators
+
+#ifndef PFS_PYRAMID_H
+#define PFS_PYRAMID_H
+
+#include <cstddef>
+#include <vector>
+
+#include <Libpfs/array2d.h>
+
+namespace pfs {
+
+//! \brief How the filters extend an image past its edges
+enum PyramidBoundary {
+    //! \brief repeat the pixels of the edge: a a | a b c
+    PYRAMID_CLAMP,
+    //! \brief mirror the image about the pixels of the edge: c b | a b c
+    PYRAMID_REFLECT
+};
+
+//! \brief Filter taking a level of a pyramid to the next, coarser one.
+//! Every kernel maps a cols x rows level to a (cols / 2) x (rows / 2) one.
+enum PyramidKernel {
+    //! \brief [1 2 1] / 4 blur, then average of each 2x2 block: [1 3 3 1] / 8
+    //! on every other pixel (Fattal02)
+    PYRAMID_BINOMIAL,
+    //! \brief 5 taps kernel of Burt and Adelson with a = 0.4,
+    //! [0.05 0.25 0.4 0.25 0.05], on every other pixel (Ashikhmin02)
+    PYRAMID_BURT_ADELSON,
+    //! \brief average over the area of each pixel of the coarser level, which
+    //! covers fractions of pixels when a side is odd (Mantiuk06)
+    PYRAMID_BOX
+};
+
+//! \brief \a out = \a in, \a inCols x \a inRows, filtered by \a kernel
+//! \note the filter runs by bands of rows, one row of the output at a time
+//! with a single row of scratch per thread, and is vectorized along the rows
+void reduce(const float *in, size_t inCols, size_t inRows, float *out,
+            PyramidKernel kernel, PyramidBoundary boundary = PYRAMID_CLAMP);
+
+//! \brief \a out = \a in filtered by \a kernel: \a out must be
+//! (cols / 2) x (rows / 2)
+void reduce(const Array2Df &in, Array2Df &out, PyramidKernel kernel,
+            PyramidBoundary boundary = PYRAMID_CLAMP);
+
+//! \brief \a out interpolated from \a in with the transpose of \a kernel:
+//! each pixel of \a out takes the pixels of \a in it contributes to in
+//! \c reduce(), with the same weights, normalized. \a out must be a size
+//! that \c reduce() takes to the size of \a in.
+void expand(const Array2Df &in, Array2Df &out, PyramidKernel kernel);
+
+//! \brief [1 2 1] / 4 blur of both dimensions. \a out may be \a in.
+void binomialBlur(const Array2Df &in, Array2Df &out,
+                  PyramidBoundary boundary = PYRAMID_CLAMP);
+
+//! \brief Gaussian blur of standard deviation \a sigma, by recursive
+//! filtering (Young and van Vliet) whose cost does not depend on \a sigma.
+//! \a out may be \a in. Images under 3 pixels on a side are copied as
+//! they are.
+void gaussianBlur(const Array2Df &in, Array2Df &out, float sigma);
+
+//! \brief Process-wide pool of the buffers of the levels of the pyramids
+//!
+//! Operators build pyramids of the same image, hence of the same sizes,
+//! over and over: released levels are kept, up to \c MAX_BYTES, and handed
+//! out again to requests of the same size.
+class PyramidPool {
+   public:
+    static const size_t MAX_BYTES = 256 * 1024 * 1024;
+
+    //! \brief make \a array a cols x rows array, whose content is undefined
+    static void acquire(size_t cols, size_t rows, Array2Df &array);
+    //! \brief give the buffer of \a array back to the pool; \a array is left
+    //! empty
+    static void release(Array2Df &array);
+    //! \brief free the buffers of the pool, once the image they were kept
+    //! for is closed
+    static void clear();
+};
+
+//! \brief Gaussian pyramid: level 0 is the image, level k + 1 is level k
+//! reduced by the kernel of the pyramid
+class GaussianPyramid {
+   public:
+    //! \brief build up to \a maxLevels levels from \a image, stopping before
+    //! the first level whose smaller side would be under \a minSize
+    //! \note \a image is level 0: it must outlive the pyramid
+    GaussianPyramid(const Array2Df &image, size_t maxLevels,
+                    PyramidKernel kernel, size_t minSize = 1,
+                    PyramidBoundary boundary = PYRAMID_CLAMP);
+    //! \brief levels go back to the \c PyramidPool
+    ~GaussianPyramid();
+
+    size_t numLevels() const { return m_levels.size() + 1; }
+    const Array2Df &level(size_t k) const {
+        return k ? m_levels[k - 1] : *m_image;
+    }
+    PyramidKernel kernel() const { return m_kernel; }
+
+   private:
+    GaussianPyramid(const GaussianPyramid &);
+    GaussianPyramid &operator=(const GaussianPyramid &);
+
+    const Array2Df *m_image;
+    PyramidKernel m_kernel;
+    std::vector<Array2Df> m_levels;
+};
+
+//! \brief Laplacian pyramid: level k is level k of the Gaussian pyramid
+//! minus level k + 1 expanded, and the last level is the last level of the
+//! Gaussian pyramid
+class LaplacianPyramid {
+   public:
+    explicit LaplacianPyramid(const GaussianPyramid &gaussian);
+    //! \brief levels go back to the \c PyramidPool
+    ~LaplacianPyramid();
+
+    size_t numLevels() const { return m_levels.size(); }
+    Array2Df &level(size_t k) { return m_levels[k]; }
+    const Array2Df &level(size_t k) const { return m_levels[k]; }
+
+    //! \brief sum of the levels, each expanded to the size of the finer
+    //! one: the image, for an unmodified pyramid
+    void collapse(Array2Df &out) const;
+
+   private:
+    LaplacianPyramid(const LaplacianPyramid &);
+    LaplacianPyramid &operator=(const LaplacianPyramid &);
+
+    PyramidKernel m_kernel;
+    std::vector<Array2Df> m_levels;
+};
+
+}  // pfs
+
+#endif  // PFS_PYRAMID_H
@@ -32,17 +32,16 @@
 
 #include "resize.h"
 
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 #include "Libpfs/frame.h"
 
 namespace pfs {
 
-Frame *resize(Frame *frame, int xSize, InterpolationMethod m) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+Frame *resize(const Frame *frame, int xSize, InterpolationMethod m) {
+    pfs::utils::TraceSpan trace_span(
+        "resizeFrame",
+        frame->size() * frame->getChannels().size() * sizeof(float));
 
     int new_x = xSize;
     int new_y = (int)((float)frame->getHeight() * (float)xSize /
@@ -59,12 +58,6 @@ Frame *resize(Frame *frame, int xSize, InterpolationMethod m) {
     }
     pfs::copyTags(frame, resizedFrame);
 
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "resizeFrame() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
-
     return resizedFrame;
 }
 
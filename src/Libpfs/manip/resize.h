@@ -35,7 +35,7 @@ namespace pfs {
 // forward declaration
 class Frame;
 
-Frame *resize(Frame *frame, int xSize, InterpolationMethod m);
+Frame *resize(const Frame *frame, int xSize, InterpolationMethod m);
 
 template <typename Type>
 void resize(const Array2D<Type> *from, Array2D<Type> *to,
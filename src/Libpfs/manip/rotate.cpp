@@ -34,15 +34,14 @@
 #include "Libpfs/array2d.h"
 #include "Libpfs/frame.h"
 
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 namespace pfs {
 
 pfs::Frame *rotate(const pfs::Frame *frame, bool clock_wise) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "rotateFrame",
+        frame->size() * frame->getChannels().size() * sizeof(float));
 
     pfs::Frame *resizedFrame =
         new pfs::Frame(frame->getHeight(), frame->getWidth());
@@ -58,12 +57,6 @@ pfs::Frame *rotate(const pfs::Frame *frame, bool clock_wise) {
 
     pfs::copyTags(frame, resizedFrame);
 
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "rotateFrame() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
-
     return resizedFrame;
 }
 
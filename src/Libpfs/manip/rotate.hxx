@@ -24,6 +24,8 @@
 
 #include "rotate.h"
 
+#include "Libpfs/utils/tiles.h"
+
 namespace pfs {
 
 template <typename Type>
@@ -38,21 +40,25 @@ void rotate(const pfs::Array2D<Type> *in, pfs::Array2D<Type> *out,
     // const int O_ROWS = out->getRows();
     const int O_COLS = out->getCols();
 
-    if (clockwise) {
-#pragma omp parallel for
-        for (int j = 0; j < I_ROWS; j++) {
-            for (int i = 0; i < I_COLS; i++) {
-                Vout[(i + 1) * O_COLS - 1 - j] = Vin[j * I_COLS + i];
+    // rotate tile by tile: reading rows and writing columns of a full
+    // image at once would stride through the whole output for every row
+    utils::forEachTile(I_COLS, I_ROWS, [=](const utils::Tile &t) {
+        const int jEnd = static_cast<int>(t.row + t.rows);
+        const int iEnd = static_cast<int>(t.col + t.cols);
+        if (clockwise) {
+            for (int j = t.row; j < jEnd; j++) {
+                for (int i = t.col; i < iEnd; i++) {
+                    Vout[(i + 1) * O_COLS - 1 - j] = Vin[j * I_COLS + i];
+                }
             }
-        }
-    } else {
-#pragma omp parallel for
-        for (int j = 0; j < I_ROWS; j++) {
-            for (int i = 0; i < I_COLS; i++) {
-                Vout[(I_COLS - i - 1) * O_COLS + j] = Vin[j * I_COLS + i];
+        } else {
+            for (int j = t.row; j < jEnd; j++) {
+                for (int i = t.col; i < iEnd; i++) {
+                    Vout[(I_COLS - i - 1) * O_COLS + j] = Vin[j * I_COLS + i];
+                }
             }
         }
-    }
+    }, 64);
 }
 }
 
@@ -35,7 +35,7 @@
 #include "Libpfs/colorspace/saturation.h"
 #include "Libpfs/utils/transform.h"
 #include "Libpfs/frame.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 
 using namespace pfs;
 using namespace colorspace;
@@ -55,17 +55,9 @@ void applySaturation(pfs::Frame *frame, float multiplier) {
 
 void applySaturation(pfs::Array2Df *R, pfs::Array2Df *G, pfs::Array2Df *B,
                 const float multiplier) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "applySaturation", 3 * R->size() * sizeof(float));
 
     utils::transform(R->begin(), R->end(), G->begin(), B->begin(), R->begin(), G->begin(), B->begin(), ChangeSaturation(multiplier));
-
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "applySaturation() = " << f_timer.get_time() << " msec"
-              << std::endl;
-#endif
 }
 }
@@ -24,10 +24,9 @@
 namespace pfs {
 
 Frame *shift(const Frame &frame, int dx, int dy) {
-#ifdef TIMER_PROFILING
-    msec_timer f_timer;
-    f_timer.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "shift",
+        frame.size() * frame.getChannels().size() * sizeof(float));
 
     pfs::Frame *shiftedFrame =
         new pfs::Frame(frame.getWidth(), frame.getHeight());
@@ -43,11 +42,6 @@ Frame *shift(const Frame &frame, int dx, int dy) {
 
     pfs::copyTags(&frame, shiftedFrame);
 
-#ifdef TIMER_PROFILING
-    f_timer.stop_and_update();
-    std::cout << "shift() = " << f_timer.get_time() << " msec" << std::endl;
-#endif
-
     return shiftedFrame;
 }
 }
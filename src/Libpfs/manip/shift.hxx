@@ -24,7 +24,7 @@
 
 #include <Libpfs/array2d.h>
 #include <Libpfs/manip/shift.h>
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 
 #include <algorithm>
 #include <iostream>
@@ -39,10 +39,7 @@ void shift(const Array2D<Type> &in, int dx, int dy, Array2D<Type> &out) {
 
     using namespace std;
 
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("shift Array2D", in.size() * sizeof(Type));
 
     // fill first row... if any!
     for (int idx = 0; idx < -dy; idx++) {
@@ -86,12 +83,6 @@ void shift(const Array2D<Type> &in, int dx, int dy, Array2D<Type> &out) {
         fill(out.row_begin(out.getRows() - idx),
              out.row_end(out.getRows() - idx), Type());
     }
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << "shift Array2D = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 
 }  // pfs
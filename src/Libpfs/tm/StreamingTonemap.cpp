@@ -0,0 +1,134 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include "Libpfs/tm/StreamingTonemap.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "Libpfs/frame.h"
+#include "Libpfs/io/framereader.h"
+#include "Libpfs/io/framewriter.h"
+#include "Libpfs/io/ioexception.h"
+#include "Libpfs/manip/gamma.h"
+#include "Libpfs/manip/saturation.h"
+#include "Libpfs/params.h"
+#include "Libpfs/progress.h"
+#include "TonemappingOperators/pfstmo.h"
+
+bool canTonemapStreaming(const TonemappingOptions &opts) {
+    switch (opts.tmoperator) {
+        case drago:
+        case reinhard05:
+        case vanhateren:
+            break;
+        default:
+            return false;
+    }
+    return !opts.tonemapSelection && opts.xsize == opts.origxsize;
+}
+
+StreamingTmo *createStreamingTmo(const TonemappingOptions &opts) {
+    switch (opts.tmoperator) {
+        case drago:
+            return pfstmo_drago03_stream(
+                opts.operator_options.dragooptions.bias);
+        case reinhard05:
+            return pfstmo_reinhard05_stream(
+                opts.operator_options.reinhard05options.brightness,
+                opts.operator_options.reinhard05options.chromaticAdaptation,
+                opts.operator_options.reinhard05options.lightAdaptation);
+        case vanhateren:
+            return pfstmo_vanhateren06_stream(
+                opts.operator_options.vanhaterenoptions.pupil_area);
+        default:
+            return NULL;
+    }
+}
+
+namespace {
+void readBand(pfs::io::FrameReader &reader, pfs::Frame &band, size_t firstRow,
+              size_t numRows, float pregamma) {
+    reader.readRows(band, firstRow, numRows, pfs::Params());
+    if (pregamma != 1.0f) {
+        pfs::applyGamma(&band, pregamma);
+    }
+}
+}
+
+bool tonemapStreaming(pfs::io::FrameReader &reader,
+                      pfs::io::FrameWriter &writer,
+                      const TonemappingOptions &opts,
+                      const pfs::Params &params, pfs::Progress &ph,
+                      size_t bandRows) {
+    if (!reader.supportsRows() || !writer.supportsRows()) {
+        throw pfs::io::UnsupportedFormat(
+            "Streaming tone mapping is not supported for this file format");
+    }
+    std::unique_ptr<StreamingTmo> tmo(createStreamingTmo(opts));
+    if (!tmo) {
+        throw pfs::io::UnsupportedFormat(
+            "Streaming tone mapping is not supported for this operator");
+    }
+
+    const size_t width = reader.width();
+    const size_t height = reader.height();
+    const size_t numBands = (height + bandRows - 1) / bandRows;
+    const size_t passes = tmo->statisticsPasses();
+
+    ph.setValue(0);
+    ph.setMaximum(static_cast<int>((passes + 1) * numBands));
+
+    pfs::Frame band(width, bandRows);
+    int progress = 0;
+
+    for (size_t pass = 0; pass < passes; ++pass) {
+        for (size_t row = 0; row < height; row += bandRows) {
+            if (ph.canceled()) return false;
+
+            readBand(reader, band, row, std::min(bandRows, height - row),
+                     opts.pregamma);
+            tmo->accumulate(pass, band);
+            ph.setValue(++progress);
+        }
+    }
+
+    writer.beginRows(width, height, params);
+    for (size_t row = 0; row < height; row += bandRows) {
+        if (ph.canceled()) {
+            writer.endRows();
+            return false;
+        }
+
+        readBand(reader, band, row, std::min(bandRows, height - row),
+                 opts.pregamma);
+        tmo->map(band);
+        if (opts.postsaturation != 1.0f) {
+            pfs::applySaturation(&band, opts.postsaturation);
+        }
+        if (opts.postgamma != 1.0f) {
+            pfs::applyGamma(&band, opts.postgamma);
+        }
+        writer.writeRows(band);
+        ph.setValue(++progress);
+    }
+    return writer.endRows();
+}
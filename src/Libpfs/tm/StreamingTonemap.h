@@ -0,0 +1,72 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#ifndef STREAMINGTONEMAP_H
+#define STREAMINGTONEMAP_H
+
+//! \file StreamingTonemap.h
+//! \brief Tone map a file into another one band of scanlines at a time
+//!
+//! Global operators only need a few image-wide statistics (log average,
+//! maximum, ...) before mapping every pixel independently. The image is
+//! therefore read once per statistics pass and once more to be mapped and
+//! written, and only a band of \c STREAMING_BAND_ROWS rows is ever held in
+//! memory.
+
+#include <cstddef>
+
+#include "Core/TonemappingOptions.h"
+
+namespace pfs {
+class Params;
+class Progress;
+namespace io {
+class FrameReader;
+class FrameWriter;
+}
+}
+
+class StreamingTmo;
+
+//! \brief default number of rows of a band
+const size_t STREAMING_BAND_ROWS = 64;
+
+//! \brief true when \a opts can be honoured by \c tonemapStreaming(): global
+//! operator (Drago, Reinhard05, VanHateren), no selection, no resize
+bool canTonemapStreaming(const TonemappingOptions &opts);
+
+//! \brief create the streaming implementation of the operator in \a opts
+//! \return NULL if the operator cannot be streamed
+StreamingTmo *createStreamingTmo(const TonemappingOptions &opts);
+
+//! \brief tone map the content of \a reader into \a writer
+//! Pre-gamma, post-saturation and post-gamma are applied as in \c TMWorker.
+//! \return false if the operation was canceled through \a ph
+//! \throws pfs::io::UnsupportedFormat if either side cannot work on bands, or
+//! the operator cannot be streamed
+//! \throws pfs::io::ReadException, pfs::io::WriteException on I/O errors
+bool tonemapStreaming(pfs::io::FrameReader &reader,
+                      pfs::io::FrameWriter &writer,
+                      const TonemappingOptions &opts,
+                      const pfs::Params &params, pfs::Progress &ph,
+                      size_t bandRows = STREAMING_BAND_ROWS);
+
+#endif  // STREAMINGTONEMAP_H
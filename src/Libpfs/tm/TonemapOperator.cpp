@@ -65,7 +65,7 @@ class TonemapOperatorMantiuk06
                 opts->operator_options.mantiuk06options.saturationfactor,
                 opts->operator_options.mantiuk06options.detailfactor,
                 opts->operator_options.mantiuk06options.contrastequalization,
-                ph);
+                opts->operator_options.mantiuk06options.multigrid, ph);
         } catch (...) {
             throw std::runtime_error("Mantiuk06: Tonemap Failed");
         }
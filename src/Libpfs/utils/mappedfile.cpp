@@ -0,0 +1,67 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Libpfs/utils/mappedfile.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define PFS_HAVE_MMAP
+#endif
+
+namespace pfs {
+namespace utils {
+
+MappedFile::MappedFile() : m_data(NULL), m_size(0) {}
+
+MappedFile::~MappedFile() { unmap(); }
+
+bool MappedFile::map(int fd) {
+    unmap();
+#ifdef PFS_HAVE_MMAP
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) return false;
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    void *p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+
+    m_data = static_cast<const char *>(p);
+    m_size = size;
+    return true;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+void MappedFile::unmap() {
+#ifdef PFS_HAVE_MMAP
+    if (m_data) {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+    m_data = NULL;
+    m_size = 0;
+}
+
+}  // utils
+}  // pfs
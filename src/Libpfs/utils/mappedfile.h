@@ -0,0 +1,68 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#ifndef PFS_UTILS_MAPPEDFILE_H
+#define PFS_UTILS_MAPPEDFILE_H
+
+//! \file mappedfile.h
+//! \brief Read-only memory mapping of a whole file
+
+#include <cstddef>
+
+namespace pfs {
+namespace utils {
+
+//! \brief Map the file open on a descriptor read-only in memory
+//! \note On platforms without mmap() nothing is ever mapped: callers are
+//! expected to fall back on regular reads when \c isMapped() is false.
+class MappedFile {
+   public:
+    MappedFile();
+    ~MappedFile();
+
+    //! \brief map the whole file open on \a fd (which is not closed by
+    //! \c MappedFile, and may be closed once the file is mapped)
+    //! \return false if the file cannot be mapped
+    bool map(int fd);
+    void unmap();
+
+    bool isMapped() const { return m_data != NULL; }
+
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    //! \brief true if [\a offset, \a offset + \a bytes) lies within the file
+    bool contains(size_t offset, size_t bytes) const {
+        return offset <= m_size && bytes <= m_size - offset;
+    }
+
+   private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const char *m_data;
+    size_t m_size;
+};
+
+}  // utils
+}  // pfs
+
+#endif  // PFS_UTILS_MAPPEDFILE_H
@@ -30,14 +30,6 @@
 #define WIN_TIMER
 #endif
 
-/*
- * this define enables the timing profile
- * You should comment this define if you want to disable this feature
- */
-#ifndef NDEBUG
-#define TIMER_PROFILING
-#endif
-
 #include <stdio.h>
 //#include <iostream>
 
@@ -0,0 +1,188 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Libpfs/utils/scratchallocator.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PFS_HAVE_MMAP
+#endif
+
+namespace pfs {
+namespace utils {
+
+namespace {
+std::atomic<size_t> s_threshold(0);
+std::atomic<size_t> s_mappedBytes(0);
+
+struct Mapping {
+    void *base;     // start of the mapping, page aligned
+    size_t length;  // length of the mapping
+    size_t bytes;   // size of the buffer handed out
+    bool adopted;   // maps a file region rather than a scratch file
+};
+
+std::mutex s_mutex;
+std::string s_directory;
+// buffer address -> mapping of every live file-backed buffer
+std::map<void *, Mapping> s_mappings;
+
+void registerMapping(void *p, const Mapping &mapping) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_mappings[p] = mapping;
+    s_mappedBytes += mapping.bytes;
+}
+
+#ifdef PFS_HAVE_MMAP
+std::string defaultDirectory() {
+    const char *tmp = getenv("TMPDIR");
+    return (tmp && *tmp) ? std::string(tmp) : std::string("/tmp");
+}
+
+void *mapScratchFile(const std::string &directory, size_t bytes) {
+    std::string pattern = directory + "/luminance-scratch-XXXXXX";
+    std::vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+
+    int fd = mkstemp(name.data());
+    if (fd < 0) return NULL;
+    // the file disappears from the file system immediately and its blocks are
+    // released as soon as the mapping goes away (or the process dies)
+    unlink(name.data());
+
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (p == MAP_FAILED) return NULL;
+    return p;
+}
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+#endif
+}
+
+void ScratchStorage::setThreshold(size_t bytes) { s_threshold = bytes; }
+
+size_t ScratchStorage::threshold() { return s_threshold; }
+
+void ScratchStorage::setDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_directory = directory;
+}
+
+std::string ScratchStorage::directory() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+#ifdef PFS_HAVE_MMAP
+    if (s_directory.empty()) return defaultDirectory();
+#endif
+    return s_directory;
+}
+
+size_t ScratchStorage::mappedBytes() { return s_mappedBytes; }
+
+void *ScratchStorage::adopt(const FileRegion &region) {
+#ifdef PFS_HAVE_MMAP
+    struct stat info;
+    if (region.bytes == 0 || fstat(region.fd, &info) != 0 ||
+        static_cast<size_t>(info.st_size) < region.offset + region.bytes) {
+        // mapping past the end of the file would fault on access
+        return NULL;
+    }
+
+    const size_t delta = region.offset % pageSize();
+    const size_t length = region.bytes + delta;
+    void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                      region.fd, static_cast<off_t>(region.offset - delta));
+    if (base == MAP_FAILED) return NULL;
+
+    void *p = static_cast<char *>(base) + delta;
+    const Mapping mapping = {base, length, region.bytes, true};
+    registerMapping(p, mapping);
+    return p;
+#else
+    (void)region;
+    return NULL;
+#endif
+}
+
+bool ScratchStorage::isAdopted(const void *p) {
+    if (!p || s_mappedBytes == 0) return false;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    std::map<void *, Mapping>::const_iterator it =
+        s_mappings.find(const_cast<void *>(p));
+    return it != s_mappings.end() && it->second.adopted;
+}
+
+void *ScratchStorage::allocate(size_t bytes) {
+#ifdef PFS_HAVE_MMAP
+    const size_t threshold = s_threshold;
+    if (threshold > 0 && bytes >= threshold) {
+        void *p = mapScratchFile(directory(), bytes);
+        if (p) {
+            const Mapping mapping = {p, bytes, bytes, false};
+            registerMapping(p, mapping);
+            return p;
+        }
+        // no space left on the scratch device: fall back on the heap
+    }
+#endif
+    return ::operator new(bytes);
+}
+
+void ScratchStorage::deallocate(void *p, size_t bytes) {
+    if (!p) return;
+#ifdef PFS_HAVE_MMAP
+    if (s_mappedBytes > 0) {
+        std::unique_lock<std::mutex> lock(s_mutex);
+        std::map<void *, Mapping>::iterator it = s_mappings.find(p);
+        if (it != s_mappings.end()) {
+            const Mapping mapped = it->second;
+            s_mappings.erase(it);
+            s_mappedBytes -= mapped.bytes;
+            lock.unlock();
+
+            munmap(mapped.base, mapped.length);
+            return;
+        }
+    }
+#endif
+    (void)bytes;
+    ::operator delete(p);
+}
+
+}  // utils
+}  // pfs
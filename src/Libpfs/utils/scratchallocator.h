@@ -0,0 +1,154 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#ifndef PFS_UTILS_SCRATCHALLOCATOR_H
+#define PFS_UTILS_SCRATCHALLOCATOR_H
+
+//! \file scratchallocator.h
+//! \brief Out-of-core backing store for large \c Array2D buffers
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace pfs {
+namespace utils {
+
+//! \brief Region of an open file, mapped in memory by \c ScratchAllocator
+//! in place of its first allocation
+struct FileRegion {
+    FileRegion() : fd(-1), offset(0), bytes(0) {}
+    FileRegion(int fd_, size_t offset_, size_t bytes_)
+        : fd(fd_), offset(offset_), bytes(bytes_) {}
+
+    int fd;
+    size_t offset;
+    size_t bytes;
+};
+
+//! \brief Process-wide policy for the storage of large pixel buffers
+//!
+//! Buffers of at least \c threshold() bytes are backed by an unlinked,
+//! memory-mapped scratch file created in \c directory(), so that under memory
+//! pressure the kernel writes them back to that file instead of pushing the
+//! whole process into swap. Smaller buffers (and every buffer when the
+//! threshold is zero, which is the default) live on the heap as usual.
+//! The memory layout seen by the caller is unchanged: a contiguous,
+//! row-major block of memory.
+//! \note On platforms without mmap() the policy is ignored.
+class ScratchStorage {
+   public:
+    //! \brief set the minimum size (in bytes) of a buffer to be file-backed
+    //! \param bytes 0 disables file-backed storage
+    static void setThreshold(size_t bytes);
+    static size_t threshold();
+
+    //! \brief set the directory where scratch files are created
+    static void setDirectory(const std::string &directory);
+    static std::string directory();
+
+    //! \brief number of bytes currently held in file-backed buffers
+    static size_t mappedBytes();
+
+    //! \brief private, copy-on-write mapping of \a region: the buffer shows
+    //! the content of the file without it being read, and pages are only
+    //! copied in memory when written to. The buffer is released by
+    //! \c deallocate() like any other.
+    //! \return NULL if the region cannot be mapped (too short a file, or no
+    //! mmap() support)
+    static void *adopt(const FileRegion &region);
+    //! \brief true if \a p is a buffer returned by \c adopt()
+    static bool isAdopted(const void *p);
+
+    static void *allocate(size_t bytes);
+    static void deallocate(void *p, size_t bytes);
+};
+
+//! \brief Standard allocator routing its requests through \c ScratchStorage
+template <typename T>
+class ScratchAllocator {
+   public:
+    typedef T value_type;
+
+    ScratchAllocator() {}
+
+    //! \brief allocator whose first allocation, if it is of exactly
+    //! \a region.bytes bytes, maps \a region (see
+    //! \c ScratchStorage::adopt()) rather than allocating
+    explicit ScratchAllocator(const FileRegion &region) : m_region(region) {}
+
+    template <typename U>
+    ScratchAllocator(const ScratchAllocator<U> &) {}
+
+    //! \brief copies of a container do not map the file again
+    ScratchAllocator select_on_container_copy_construction() const {
+        return ScratchAllocator();
+    }
+
+    T *allocate(size_t n) {
+        if (m_region.bytes != 0) {
+            const FileRegion region = m_region;
+            m_region = FileRegion();
+            if (region.bytes == n * sizeof(T)) {
+                void *p = ScratchStorage::adopt(region);
+                if (p) return static_cast<T *>(p);
+            }
+        }
+        return static_cast<T *>(ScratchStorage::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        ScratchStorage::deallocate(p, n * sizeof(T));
+    }
+
+    //! \brief default-initialise new elements: zeroing is left to the owner
+    //! of the buffer, so that a buffer adopted from a file is never written
+    template <typename U>
+    void construct(U *p) {
+        ::new (static_cast<void *>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&... args) {
+        ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+
+   private:
+    FileRegion m_region;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ScratchAllocator<T> &,
+                       const ScratchAllocator<U> &) {
+    return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ScratchAllocator<T> &,
+                       const ScratchAllocator<U> &) {
+    return false;
+}
+
+}  // utils
+}  // pfs
+
+#endif  // PFS_UTILS_SCRATCHALLOCATOR_H
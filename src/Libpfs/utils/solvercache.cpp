@@ -0,0 +1,128 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Libpfs/utils/solvercache.h>
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <mutex>
+
+namespace pfs {
+namespace utils {
+
+namespace {
+struct Entry {
+    std::string name;
+    uint64_t key;
+    SolverCache::ArraysPtr arrays;
+};
+
+thread_local bool s_enabled = false;
+std::mutex s_mutex;
+// most recently used first
+std::list<Entry> s_entries;
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+// words hashed by each thread at a time
+const size_t CHUNK = 1 << 20;
+
+inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+}
+
+void SolverCache::setEnabled(bool enabled) { s_enabled = enabled; }
+
+bool SolverCache::isEnabled() { return s_enabled; }
+
+uint64_t SolverCache::fingerprint(const pfs::Array2Df &data) {
+    const size_t size = data.size();
+    const float *values = data.data();
+    const int chunks = static_cast<int>((size + CHUNK - 1) / CHUNK);
+
+    // FNV-1a over the bits of the values, by chunks hashed in parallel
+    std::vector<uint64_t> hashes(chunks);
+#pragma omp parallel for
+    for (int c = 0; c < chunks; ++c) {
+        const size_t end = std::min(size, (c + 1) * CHUNK);
+        uint64_t h = FNV_OFFSET;
+        for (size_t i = c * CHUNK; i < end; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, values + i, sizeof(bits));
+            h = (h ^ bits) * FNV_PRIME;
+        }
+        hashes[c] = h;
+    }
+
+    uint64_t h = mix(data.getCols() * FNV_PRIME + data.getRows());
+    for (int c = 0; c < chunks; ++c) {
+        h = mix(h ^ hashes[c]);
+    }
+    return h;
+}
+
+SolverCache::ArraysPtr SolverCache::lookup(const std::string &name,
+                                           uint64_t key) {
+    if (!s_enabled) return ArraysPtr();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (std::list<Entry>::iterator it = s_entries.begin();
+         it != s_entries.end(); ++it) {
+        if (it->key == key && it->name == name) {
+            s_entries.splice(s_entries.begin(), s_entries, it);
+            return it->arrays;
+        }
+    }
+    return ArraysPtr();
+}
+
+void SolverCache::store(const std::string &name, uint64_t key,
+                        const ArraysPtr &arrays) {
+    if (!s_enabled) return;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (std::list<Entry>::iterator it = s_entries.begin();
+         it != s_entries.end(); ++it) {
+        if (it->key == key && it->name == name) {
+            s_entries.erase(it);
+            break;
+        }
+    }
+
+    Entry entry = {name, key, arrays};
+    s_entries.push_front(entry);
+    if (s_entries.size() > MAX_ENTRIES) s_entries.pop_back();
+}
+
+void SolverCache::clear() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.clear();
+}
+
+}  // utils
+}  // pfs
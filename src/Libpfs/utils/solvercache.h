@@ -0,0 +1,96 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \file solvercache.h
+//! \brief Reuse of the work of the previous runs of a tone mapping operator
+//! on the same image
+
+#ifndef PFS_UTILS_SOLVERCACHE_H
+#define PFS_UTILS_SOLVERCACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <Libpfs/array2d.h>
+
+namespace pfs {
+namespace utils {
+
+//! \brief Process-wide store of what an operator computed for an image and
+//! does not depend on its parameters (pyramids, gradients), and of the
+//! solution of its iterative solver, used as the starting point of the next
+//! run with slightly different parameters.
+//!
+//! Entries are keyed by the name of the operator and the fingerprint of its
+//! input. The store keeps the \c MAX_ENTRIES most recently used entries.
+//! It is enabled per thread: lookups fail and stores are dropped on the
+//! threads that did not call \c setEnabled(). Results then depend on the
+//! previous runs, within the tolerance of the solvers, which suits the
+//! interactive tone mapping but not batch processing.
+class SolverCache {
+   public:
+    typedef std::vector<pfs::Array2Df> Arrays;
+    typedef std::shared_ptr<const Arrays> ArraysPtr;
+
+    static const size_t MAX_ENTRIES = 4;
+
+    //! \brief enable or disable the store for the calling thread
+    static void setEnabled(bool enabled);
+    //! \return whether the store is enabled for the calling thread
+    static bool isEnabled();
+
+    //! \brief enables (or disables) the store for the calling thread during
+    //! its lifetime
+    class ScopedEnable {
+       public:
+        explicit ScopedEnable(bool enabled = true) : m_previous(isEnabled()) {
+            setEnabled(enabled);
+        }
+        ~ScopedEnable() { setEnabled(m_previous); }
+
+       private:
+        ScopedEnable(const ScopedEnable &);
+        ScopedEnable &operator=(const ScopedEnable &);
+
+        bool m_previous;
+    };
+
+    //! \brief hash of the size and the content of \a data, that identifies
+    //! an image
+    static uint64_t fingerprint(const pfs::Array2Df &data);
+
+    //! \brief arrays stored by the last \c store() of \a name for \a key
+    //! \return null if there are none
+    static ArraysPtr lookup(const std::string &name, uint64_t key);
+    //! \brief replace the arrays of \a name for \a key
+    static void store(const std::string &name, uint64_t key,
+                      const ArraysPtr &arrays);
+    static void clear();
+};
+
+}  // utils
+}  // pfs
+
+#endif  // PFS_UTILS_SOLVERCACHE_H
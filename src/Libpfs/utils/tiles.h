@@ -0,0 +1,87 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#ifndef PFS_UTILS_TILES_H
+#define PFS_UTILS_TILES_H
+
+//! \file tiles.h
+//! \brief Tile and row-block traversal of 2D arrays
+//! \note Walking an image one tile (or one band of rows) at a time keeps the
+//! working set small, which matters both for the caches and for buffers
+//! backed by a scratch file (see \c ScratchStorage)
+
+#include <algorithm>
+#include <cstddef>
+
+namespace pfs {
+namespace utils {
+
+//! \brief Default edge of a square tile, in pixels
+const size_t TILE_SIZE = 256;
+
+//! \brief Rectangular region [col, col + cols) x [row, row + rows)
+struct Tile {
+    size_t col;
+    size_t row;
+    size_t cols;
+    size_t rows;
+};
+
+//! \brief Call \a func on every tile of a \a width x \a height array.
+//! Tiles are handed out in row-major order, so that consecutive tiles share
+//! the same band of rows. \a func must be safe to call concurrently on
+//! different tiles.
+template <typename Func>
+void forEachTile(size_t width, size_t height, Func func,
+                 size_t tileSize = TILE_SIZE) {
+    const size_t tilesX = (width + tileSize - 1) / tileSize;
+    const size_t tilesY = (height + tileSize - 1) / tileSize;
+    const int numTiles = static_cast<int>(tilesX * tilesY);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < numTiles; ++t) {
+        Tile tile;
+        tile.col = (t % tilesX) * tileSize;
+        tile.row = (t / tilesX) * tileSize;
+        tile.cols = std::min(tileSize, width - tile.col);
+        tile.rows = std::min(tileSize, height - tile.row);
+
+        func(tile);
+    }
+}
+
+//! \brief Call \a func(firstRow, lastRow) on every band of \a blockRows rows
+//! of an array with \a height rows, [firstRow, lastRow) being half-open.
+template <typename Func>
+void forEachRowBlock(size_t height, Func func, size_t blockRows = TILE_SIZE) {
+    const int numBlocks = static_cast<int>((height + blockRows - 1) / blockRows);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < numBlocks; ++b) {
+        const size_t first = b * blockRows;
+        func(first, std::min(first + blockRows, height));
+    }
+}
+
+}  // utils
+}  // pfs
+
+#endif  // PFS_UTILS_TILES_H
@@ -0,0 +1,171 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <Libpfs/utils/trace.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace pfs {
+namespace utils {
+
+namespace {
+struct Span {
+    const char *name;
+    long long begin;
+    long long duration;
+    size_t bytes;
+    int thread;
+};
+
+struct TraceState {
+    TraceState() : epoch(std::chrono::steady_clock::now()), threads(0) {}
+
+    const std::chrono::steady_clock::time_point epoch;
+    std::mutex mutex;
+    std::vector<Span> spans;
+    // written at exit, empty for none
+    std::string fileName;
+    int threads;
+};
+
+std::atomic<bool> s_enabled(false);
+
+TraceState &state() {
+    static TraceState s;
+    return s;
+}
+
+// small and stable ids read better than the native ones in the viewers
+int threadId() {
+    thread_local int id = -1;
+    if (id < 0) {
+        TraceState &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        id = ++s.threads;
+    }
+    return id;
+}
+
+void writeAtExit() {
+    std::string fileName;
+    {
+        TraceState &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        fileName = s.fileName;
+    }
+    if (!fileName.empty()) Trace::write(fileName);
+}
+
+void writeEscaped(FILE *out, const char *str) {
+    for (; *str; ++str) {
+        const unsigned char c = static_cast<unsigned char>(*str);
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+}
+
+struct EnvironmentInit {
+    EnvironmentInit() {
+        const char *fileName = getenv("LUMINANCE_HDR_TRACE");
+        if (fileName && *fileName) Trace::start(fileName);
+    }
+};
+EnvironmentInit s_environmentInit;
+}
+
+void Trace::start(const std::string &fileName) {
+    TraceState &s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.fileName.empty() && !fileName.empty()) {
+            // after state(), so that it runs before its destruction
+            atexit(writeAtExit);
+        }
+        if (!fileName.empty()) s.fileName = fileName;
+    }
+    s_enabled = true;
+}
+
+void Trace::stop() { s_enabled = false; }
+
+bool Trace::isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+bool Trace::write(const std::string &fileName) {
+    std::vector<Span> spans;
+    {
+        TraceState &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        spans = s.spans;
+    }
+
+    FILE *out = fopen(fileName.c_str(), "w");
+    if (!out) return false;
+
+    fprintf(out, "{\"traceEvents\":[");
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const Span &span = spans[i];
+        fprintf(out, "%s\n{\"name\":\"", i ? "," : "");
+        writeEscaped(out, span.name);
+        fprintf(out,
+                "\",\"cat\":\"pfs\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                "\"pid\":1,\"tid\":%d,\"args\":{\"bytes\":%llu}}",
+                span.begin, span.duration, span.thread,
+                static_cast<unsigned long long>(span.bytes));
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    return fclose(out) == 0;
+}
+
+void Trace::clear() {
+    TraceState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.spans.clear();
+}
+
+void Trace::record(const char *name, long long begin, long long duration,
+                   size_t bytes) {
+    const int thread = threadId();
+    Span span = {name, begin, duration, bytes, thread};
+
+    TraceState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.spans.push_back(span);
+}
+
+long long Trace::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - state().epoch)
+        .count();
+}
+
+}  // utils
+}  // pfs
@@ -0,0 +1,91 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Runtime tracing of the hot paths
+//!
+//! Tracing is off unless Trace::start() is called, or the environment
+//! variable LUMINANCE_HDR_TRACE names the output file. While off, a TraceSpan
+//! costs one atomic load. The spans are saved in the Chrome trace event
+//! format, to be opened with chrome://tracing or https://ui.perfetto.dev
+
+#ifndef PFS_UTILS_TRACE_H
+#define PFS_UTILS_TRACE_H
+
+#include <cstddef>
+#include <string>
+
+namespace pfs {
+namespace utils {
+
+class Trace {
+   public:
+    //! \brief record spans from now on, and write them to \a fileName when
+    //! the process exits
+    static void start(const std::string &fileName);
+    //! \brief stop recording, the spans recorded are kept
+    static void stop();
+    static bool isEnabled();
+
+    //! \brief write the spans recorded so far in Chrome trace JSON
+    static bool write(const std::string &fileName);
+    static void clear();
+
+    //! \brief record a span of \a duration microseconds started at \a begin
+    //! on the calling thread
+    static void record(const char *name, long long begin, long long duration,
+                       size_t bytes);
+    //! \brief microseconds since the first use of the trace
+    static long long now();
+};
+
+//! \brief Span from construction to destruction (or end())
+//! \note \a name must outlive the trace: use a string literal
+class TraceSpan {
+   public:
+    explicit TraceSpan(const char *name, size_t bytes = 0)
+        : m_name(name), m_bytes(bytes), m_begin(-1) {
+        if (Trace::isEnabled()) m_begin = Trace::now();
+    }
+    ~TraceSpan() { end(); }
+
+    //! \brief bytes processed by the span, when known only later
+    void setBytes(size_t bytes) { m_bytes = bytes; }
+
+    void end() {
+        if (m_begin >= 0) {
+            Trace::record(m_name, m_begin, Trace::now() - m_begin, m_bytes);
+            m_begin = -1;
+        }
+    }
+
+   private:
+    TraceSpan(const TraceSpan &);
+    TraceSpan &operator=(const TraceSpan &);
+
+    const char *m_name;
+    size_t m_bytes;
+    long long m_begin;
+};
+
+}  // utils
+}  // pfs
+
+#endif  // PFS_UTILS_TRACE_H
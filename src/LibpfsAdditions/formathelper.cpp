@@ -26,6 +26,7 @@
 #include "Common/config.h"
 
 #include <UI/ImageQualityDialog.h>
+#include "UI/ExrOptionsDialog.h"
 #include "UI/TiffModeDialog.h"
 
 namespace pfsadditions {
@@ -121,10 +122,12 @@ pfs::Params FormatHelper::getParamsForFormat(int format) {
         case 21:
             params.set("format", std::string("jpg"));
             params.set("quality", 100);
+            params.set("jpeg_threads", 1);
             break;
         case 22:
             params.set("format", std::string("png"));
             params.set("quality", 100);
+            params.set("png_threads", 1);
             break;
         case 23:
         case 24:
@@ -147,6 +150,12 @@ void FormatHelper::comboBoxIndexChanged(int idx) {
 void FormatHelper::buttonPressed() {
     int format = m_comboBox->currentData().toInt();
     switch (format) {
+        case 1: {
+            ExrOptionsDialog e(m_params, m_settingsButton);
+            if (e.exec() == QDialog::Accepted) {
+                e.applyTo(m_params);
+            }
+        } break;
         case 2:
         case 20: {
             int tiffMode;
@@ -180,7 +189,8 @@ void FormatHelper::buttonPressed() {
 }
 
 void FormatHelper::updateButton(int format) {
-    bool enabled = format == 2       // tiff
+    bool enabled = format == 1       // exr
+                   || format == 2    // tiff
                    || format == 20   // tiff-dr
                    || format == 21   // jpg
                    || format == 22;  // png
@@ -210,6 +220,26 @@ void FormatHelper::writeSettings(const QString prefix) {
         int qual = quality;
         LuminanceOptions().setValue(prefix + "/" + KEY_EXPORT_QUALITY, qual);
     }
+    std::string exrCompression;
+    if (m_params.get("exr_compression", exrCompression)) {
+        LuminanceOptions().setValue(prefix + "/" + KEY_EXPORT_EXR_COMPRESSION,
+                                    QString::fromStdString(exrCompression));
+    }
+    float exrDwaLevel;
+    if (m_params.get("exr_dwa_level", exrDwaLevel)) {
+        LuminanceOptions().setValue(prefix + "/" + KEY_EXPORT_EXR_DWA_LEVEL,
+                                    exrDwaLevel);
+    }
+    bool exrHalf;
+    if (m_params.get("exr_half", exrHalf)) {
+        LuminanceOptions().setValue(prefix + "/" + KEY_EXPORT_EXR_HALF,
+                                    exrHalf);
+    }
+    int exrThreads;
+    if (m_params.get("exr_threads", exrThreads)) {
+        LuminanceOptions().setValue(prefix + "/" + KEY_EXPORT_EXR_THREADS,
+                                    exrThreads);
+    }
 }
 
 pfs::Params FormatHelper::getParamsFromSettings(const QString prefix,
@@ -229,6 +259,23 @@ pfs::Params FormatHelper::getParamsFromSettings(const QString prefix,
         size_t qual = quality;
         params.set("quality", qual);
     }
+
+    const QVariant exrCompression =
+        LuminanceOptions().value(prefix + "/" + KEY_EXPORT_EXR_COMPRESSION);
+    if (exrCompression.isValid()) {
+        params.set("exr_compression", exrCompression.toString().toStdString());
+    }
+    const QVariant exrDwaLevel =
+        LuminanceOptions().value(prefix + "/" + KEY_EXPORT_EXR_DWA_LEVEL);
+    if (exrDwaLevel.isValid()) {
+        params.set("exr_dwa_level", exrDwaLevel.toFloat());
+    }
+    const QVariant exrHalf =
+        LuminanceOptions().value(prefix + "/" + KEY_EXPORT_EXR_HALF);
+    if (exrHalf.isValid()) params.set("exr_half", exrHalf.toBool());
+    const QVariant exrThreads =
+        LuminanceOptions().value(prefix + "/" + KEY_EXPORT_EXR_THREADS);
+    if (exrThreads.isValid()) params.set("exr_threads", exrThreads.toInt());
     return params;
 }
 }
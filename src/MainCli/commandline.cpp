@@ -25,7 +25,10 @@
  *
  */
 
+#include <QCoreApplication>
 #include <QDebug>
+#include <QFile>
+#include <QTextStream>
 #include <QTimer>
 #include <boost/program_options.hpp>
 #include <iostream>
@@ -33,6 +36,7 @@
 #include <Common/CommonFunctions.h>
 #include <Common/GitSHA1.h>
 #include <Common/LuminanceOptions.h>
+#include <Common/ProgressHelper.h>
 #include <Common/config.h>
 #include <Core/IOWorker.h>
 #include <Core/TMWorker.h>
@@ -40,7 +44,13 @@
 #include <Fileformat/pfsoutldrimage.h>
 #include <HdrHTML/pfsouthdrhtml.h>
 #include <Libpfs/manip/gamma_levels.h>
+#include <Libpfs/io/exrcommon.h>
+#include <Libpfs/io/framereaderfactory.h>
+#include <Libpfs/io/framewriterfactory.h>
+#include <Libpfs/tm/StreamingTonemap.h>
 #include <Libpfs/tm/TonemapOperator.h>
+#include <Libpfs/utils/scratchallocator.h>
+#include <Libpfs/utils/trace.h>
 #include "commandline.h"
 
 #if defined(_MSC_VER)
@@ -78,6 +88,38 @@ float toFloatWithErrMsg(const QString &str) {
     }
     return ret;
 }
+
+//! \brief expand %b (input base name), %d (input directory), %p (tone mapping
+//! postfix), %n (index of the options in the manifest) and %% in \a pattern
+QString expandOutputTemplate(const QString &pattern, const QString &input,
+                             TonemappingOptions &opts, int index) {
+    const QFileInfo fi(input);
+    QString result;
+    for (int i = 0; i < pattern.size(); ++i) {
+        if (pattern.at(i) != QLatin1Char('%') || i + 1 == pattern.size()) {
+            result += pattern.at(i);
+            continue;
+        }
+        switch (pattern.at(++i).toLatin1()) {
+            case 'b':
+                result += fi.completeBaseName();
+                break;
+            case 'd':
+                result += fi.absolutePath();
+                break;
+            case 'p':
+                result += opts.getPostfix();
+                break;
+            case 'n':
+                result += QString::number(index);
+                break;
+            default:
+                result += pattern.at(i);
+                break;
+        }
+    }
+    return result;
+}
 }
 
 CommandLineInterfaceManager::CommandLineInterfaceManager(const int argc,
@@ -88,6 +130,7 @@ CommandLineInterfaceManager::CommandLineInterfaceManager(const int argc,
       alignMode(NO_ALIGN),
       tmopts(TMOptionsOperations::getDefaultTMOptions()),
       tmofileparams(new pfs::Params()),
+      hdrfileparams(new pfs::Params()),
       verbose(false),
       oldValue(0),
       maximum(100),
@@ -96,6 +139,10 @@ CommandLineInterfaceManager::CommandLineInterfaceManager(const int argc,
       isAutolevels(false),
       isHtml(false),
       isHtmlDone(false),
+      isStreaming(false),
+      batchJobs(0),
+      batchMemory(-1),
+      batchProgress(0),
       htmlQuality(2),
       isProposedLdrName(false),
       isProposedHdrName(false),
@@ -105,6 +152,8 @@ CommandLineInterfaceManager::CommandLineInterfaceManager(const int argc,
     hdrcreationconfig.weightFunction = WEIGHT_TRIANGULAR;
     hdrcreationconfig.responseCurve = RESPONSE_LINEAR;
     hdrcreationconfig.fusionOperator = DEBEVEC;
+    hdrcreationconfig.responseSamples = 0;
+    hdrcreationconfig.responseSeed = 0;
 
     tmofileparams->set("quality", (size_t)100);
     validLdrExtensions << "jpg"
@@ -137,8 +186,8 @@ int CommandLineInterfaceManager::execCommandLineParams() {
         ("version,V", tr("Display program version.").toUtf8().constData())
         ("verbose,v", tr("Print more messages during execution.").toUtf8().constData())
         ("cameras,c", tr("Print a list of all supported cameras.").toUtf8().constData())
-        ("align,a", po::value<std::string>(), tr("[AIS|MTB]   Align Engine to use during HDR creation (default: no "
-           "alignment).").toUtf8().constData())
+        ("align,a", po::value<std::string>(), tr("[AIS|MTB|FEATURES]   Align Engine to use during HDR creation "
+           "(default: no alignment).").toUtf8().constData())
         ("ev,e", po::value<std::string>(), tr("EV1,EV2,... Specify numerical EV values (as many as INPUTFILES).")
             .toUtf8().constData())
         ("savealigned,d", po::value<std::string>(), tr("prefix Save aligned images to files which names start with prefix")
@@ -166,7 +215,42 @@ int CommandLineInterfaceManager::execCommandLineParams() {
             tr("FILE_EXTENSION   Save LDR file with a name of the form "
             "first-last_tmparameters.extension.").toUtf8().constData())
         ("proposedhdrname,z", po::value<std::string>(&hdrExtension), tr("FILE_EXTENSION   Save HDR file with a name of the form "
-            "first-last_HdrCreationModel.extension.").toUtf8().constData());
+            "first-last_HdrCreationModel.extension.").toUtf8().constData())
+        ("scratch", po::value<int>(), tr("MB   Keep images bigger than MB megabytes in a scratch file inside the temporary "
+            "directory instead of memory (default: 0, disabled)").toUtf8().constData())
+        ("streaming", tr("Tone map the HDR file given with -l into -o a band of scanlines at a time, without loading it "
+            "whole (drago, reinhard05 and vanhateren only; ignored with resize, autolevels, webpage or HDR output)")
+            .toUtf8().constData())
+        ("trace", po::value<std::string>(), tr("FILE   Save the time spent in each stage (HDR creation, tone mapping, "
+            "loading, saving...) to FILE in Chrome trace format").toUtf8().constData());
+
+    po::options_description batch_desc(
+        tr("Batch tone mapping parameters  - a manifest is a text file of "
+           "KEY=VALUE lines, '#' starts a comment. INPUT=HDR_FILE queues a "
+           "file, tone mapped once for each TMOFILE=SETTING_FILE preceding it "
+           "(the tone mapping parameters below if none) and saved to the "
+           "OUTPUT=TEMPLATE preceding it (default: -o, or %b_%p.jpg), where %b "
+           "is the input base name, %d its directory, %p the tone mapping "
+           "postfix and %n the index of the setting file. RESIZE=PERCENT "
+           "scales the following inputs. Relative paths are relative to the "
+           "manifest.")
+            .toUtf8()
+            .constData());
+    batch_desc.add_options()(
+        "batch", po::value<std::string>(),
+        tr("MANIFEST   Tone map all the files listed in MANIFEST")
+            .toUtf8()
+            .constData())(
+        "jobs,j", po::value<int>(&batchJobs),
+        tr("VALUE      Number of files tone mapped in parallel (default: "
+           "number of threads of the batch tone mapping preferences)")
+            .toUtf8()
+            .constData())(
+        "batchMemory", po::value<int>(&batchMemory),
+        tr("MB         Size of the frames kept in memory at once, 0 for no "
+           "limit (default: batch tone mapping preferences)")
+            .toUtf8()
+            .constData());
 
     po::options_description hdr_desc(
         tr("HDR creation parameters  - you must either load an existing HDR "
@@ -189,7 +273,42 @@ int CommandLineInterfaceManager::execCommandLineParams() {
             .toUtf8()
             .constData())(
         "hdrCurveFilename", po::value<std::string>(),
-        tr("curve filename = your_file_here.m").toUtf8().constData());
+        tr("curve filename = your_file_here.m").toUtf8().constData())(
+        "hdrResponseSamples", po::value<int>(),
+        tr("VALUE      Number of pixels, spread over the whole image, the "
+           "robertsonauto model estimates the response curve on (Default is "
+           "0, all the pixels)")
+            .toUtf8()
+            .constData())(
+        "hdrResponseSeed", po::value<unsigned int>(),
+        tr("VALUE      Seed of the position of the pixels used by "
+           "--hdrResponseSamples (Default is 0)")
+            .toUtf8()
+            .constData());
+
+    po::options_description hdrout_desc(
+        tr("HDR output parameters").toUtf8().constData());
+    hdrout_desc.add_options()(
+        "hdrExrCompression", po::value<std::string>(),
+        tr("OpenEXR compression. Legal values are "
+           "[none|rle|zips|zip|piz|pxr24|b44|b44a|dwaa|dwab] (Default is piz)")
+            .toUtf8()
+            .constData())(
+        "hdrExrDwaLevel", po::value<float>(),
+        tr("VALUE      Level of the dwaa and dwab compressions, higher is "
+           "smaller and lossier (Default is 45)")
+            .toUtf8()
+            .constData())(
+        "hdrExrHalf", po::value<bool>(),
+        tr("Save OpenEXR files with 16 bit half float channels. true|false "
+           "(Default is false)")
+            .toUtf8()
+            .constData())(
+        "hdrExrThreads", po::value<int>(),
+        tr("VALUE      Number of threads compressing OpenEXR files (Default "
+           "is 0, one per core)")
+            .toUtf8()
+            .constData());
 
     po::options_description ldr_desc(
         tr("LDR output parameters").toUtf8().constData());
@@ -204,6 +323,11 @@ int CommandLineInterfaceManager::execCommandLineParams() {
             .constData())(
         "ldrTiffDeflate", po::value<bool>(),
         tr("Tiff deflate compression. true|false (Default is true)")
+            .toUtf8()
+            .constData())(
+        "ldrThreads", po::value<int>(),
+        tr("VALUE      Number of threads encoding JPEG and PNG files, 0 for "
+           "one per core (Default is 1)")
             .toUtf8()
             .constData());
 
@@ -312,7 +436,12 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
         "tmoM06ContrastEqual",
         po::value<bool>(
             &tmopts->operator_options.mantiuk06options.contrastequalization),
-        tr("equalization true|false").toUtf8().constData());
+        tr("equalization true|false").toUtf8().constData())(
+        "tmoM06Multigrid",
+        po::value<bool>(&tmopts->operator_options.mantiuk06options.multigrid),
+        tr("multigrid preconditioned solver true|false")
+            .toUtf8()
+            .constData());
     po::options_description tmo_mantiuk08(
         tr(" Mantiuk 08").toUtf8().constData());
     tmo_mantiuk08.add_options()(
@@ -451,15 +580,22 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
 
     po::options_description cmdline_options;
     cmdline_options.add(desc)
+        .add(batch_desc)
         .add(hdr_desc)
+        .add(hdrout_desc)
         .add(ldr_desc)
         .add(html_desc)
         .add(tmo_desc)
         .add(hidden);
 
     po::options_description cmdvisible_options;
-    cmdvisible_options.add(desc).add(hdr_desc).add(ldr_desc).add(html_desc).add(
-        tmo_desc);
+    cmdvisible_options.add(desc)
+        .add(batch_desc)
+        .add(hdr_desc)
+        .add(hdrout_desc)
+        .add(ldr_desc)
+        .add(html_desc)
+        .add(tmo_desc);
 
     try {
         po::store(po::command_line_parser(argc, argv)
@@ -496,6 +632,30 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
         if (vm.count("autolevels")) {
             isAutolevels = true;
         }
+        if (vm.count("scratch")) {
+            int scratch = vm["scratch"].as<int>();
+            if (scratch < 0)
+                printErrorAndExit(
+                    tr("Error: Scratch threshold must be positive."));
+            pfs::utils::ScratchStorage::setThreshold(
+                static_cast<size_t>(scratch) << 20);
+        }
+        if (vm.count("streaming")) {
+            isStreaming = true;
+        }
+        if (vm.count("trace")) {
+            pfs::utils::Trace::start(vm["trace"].as<std::string>());
+        }
+        if (vm.count("batch")) {
+            batchManifest =
+                QString::fromStdString(vm["batch"].as<std::string>());
+        }
+        if (vm.count("jobs") && batchJobs < 1) {
+            printErrorAndExit(tr("Error: Number of jobs must be positive."));
+        }
+        if (vm.count("batchMemory") && batchMemory < 0) {
+            printErrorAndExit(tr("Error: Batch memory must be positive."));
+        }
         if (vm.count("createwebpage")) {
             isHtml = true;
         }
@@ -529,6 +689,8 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
                 alignMode = AIS_ALIGN;
             else if (strcmp(value, "MTB") == 0)
                 alignMode = MTB_ALIGN;
+            else if (strcmp(value, "FEATURES") == 0)
+                alignMode = FEATURES_ALIGN;
             else
                 printErrorAndExit(
                     tr("Error: Alignment engine not recognized."));
@@ -587,6 +749,17 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
             hdrcreationconfig.inputResponseCurveFilename =
                 QString::fromStdString(
                     vm["hdrCurveFilename"].as<std::string>());
+        if (vm.count("hdrResponseSamples")) {
+            int samples = vm["hdrResponseSamples"].as<int>();
+            if (samples < 0)
+                printErrorAndExit(
+                    tr("Error: Number of response samples must be positive."));
+            hdrcreationconfig.responseSamples = samples;
+        }
+        if (vm.count("hdrResponseSeed")) {
+            hdrcreationconfig.responseSeed =
+                vm["hdrResponseSeed"].as<unsigned int>();
+        }
         if (vm.count("tmo")) {
             const char *value = vm["tmo"].as<std::string>().c_str();
             if (strcmp(value, "ashikhmin") == 0)
@@ -675,6 +848,28 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
         if (vm.count("ldrTiffDeflate"))
             tmofileparams->set("deflateCompression",
                                vm["ldrTiffDeflate"].as<bool>());
+        if (vm.count("ldrThreads")) {
+            tmofileparams->set("jpeg_threads", vm["ldrThreads"].as<int>());
+            tmofileparams->set("png_threads", vm["ldrThreads"].as<int>());
+        }
+        if (vm.count("hdrExrCompression")) {
+            const std::string value = vm["hdrExrCompression"].as<std::string>();
+            Imf::Compression compression;
+            if (!pfs::io::exrCompressionFromName(value, compression))
+                printErrorAndExit(tr("Error: Unknown OpenEXR compression."));
+            hdrfileparams->set("exr_compression", value);
+        }
+        if (vm.count("hdrExrDwaLevel")) {
+            float level = vm["hdrExrDwaLevel"].as<float>();
+            if (level <= 0.f)
+                printErrorAndExit(
+                    tr("Error: The dwa compression level must be positive."));
+            hdrfileparams->set("exr_dwa_level", level);
+        }
+        if (vm.count("hdrExrHalf"))
+            hdrfileparams->set("exr_half", vm["hdrExrHalf"].as<bool>());
+        if (vm.count("hdrExrThreads"))
+            hdrfileparams->set("exr_threads", vm["hdrExrThreads"].as<int>());
 
         if (vm.count("load"))
             loadHdrFilename =
@@ -725,7 +920,8 @@ reinhard02|\nreinhard05|mai|mantiuk06|mantiuk08|\nvanhateren|lischinski] (Defaul
         }
     }
 
-    if (loadHdrFilename.isEmpty() && inputFiles.size() == 0) {
+    if (loadHdrFilename.isEmpty() && inputFiles.size() == 0 &&
+        batchManifest.isEmpty()) {
         cout << cmdvisible_options << endl;
         exit(0); // Exit here instead of returning to main complicating main code
     }
@@ -742,7 +938,18 @@ void CommandLineInterfaceManager::execCommandLineParamsSlot() {
                "number of input files."));
     }
     // now validate operation mode.
-    if (inputFiles.size() != 0 && loadHdrFilename.isEmpty()) {
+    if (!batchManifest.isEmpty()) {
+        if (inputFiles.size() != 0 || !loadHdrFilename.isEmpty()) {
+            printErrorAndExit(tr(
+                "Error: A batch manifest cannot be combined with -l or "
+                "INPUTFILES."));
+        }
+        operationMode = BATCH_MODE;
+
+        printIfVerbose(QObject::tr("Running in batch mode."), verbose);
+        startBatchTonemap();
+        return;
+    } else if (inputFiles.size() != 0 && loadHdrFilename.isEmpty()) {
         operationMode = CREATE_HDR_MODE;
 
         printIfVerbose(QObject::tr("Running in HDR-creation mode."), verbose);
@@ -789,6 +996,11 @@ void CommandLineInterfaceManager::execCommandLineParamsSlot() {
             printErrorAndExit(QStringLiteral("Catched unhandled exception"));
         }
     } else {
+        if (isStreaming && startStreamingTonemap()) {
+            emit finishedParsing();
+            return;
+        }
+
         printIfVerbose(QObject::tr("Loading file %1").arg(loadHdrFilename),
                        verbose);
 
@@ -829,6 +1041,9 @@ void CommandLineInterfaceManager::finishedLoadingInputFiles() {
     } else if (alignMode == MTB_ALIGN) {
         printIfVerbose(tr("Starting aligning..."), verbose);
         hdrCreationManager->align_with_mtb();
+    } else if (alignMode == FEATURES_ALIGN) {
+        printIfVerbose(tr("Starting aligning..."), verbose);
+        hdrCreationManager->align_with_features();
     } else if (alignMode == NO_ALIGN) {
         createHDR(0);
     }
@@ -913,7 +1128,8 @@ void CommandLineInterfaceManager::saveHDR() {
         // write_hdr_frame by default saves to EXR, if it doesn't find a
         // supported
         // file type
-        if (IOWorker().write_hdr_frame(HDR.data(), saveHdrFilename)) {
+        if (IOWorker().write_hdr_frame(HDR.data(), saveHdrFilename,
+                                       *hdrfileparams)) {
             printIfVerbose(
                 tr("Image %1 saved successfully").arg(saveHdrFilename),
                 verbose);
@@ -1059,6 +1275,219 @@ void CommandLineInterfaceManager::startTonemap() {
     }
 }
 
+bool CommandLineInterfaceManager::startStreamingTonemap() {
+    // everything else needs the whole frame in memory
+    if (saveLdrFilename.isEmpty() || isProposedLdrName || isAutolevels ||
+        isHtml || !saveHdrFilename.isEmpty() || isProposedHdrName ||
+        tmopts->xsize != -2) {
+        printIfVerbose(tr("Streaming not possible with the requested options."),
+                       verbose);
+        return false;
+    }
+
+    // the fallback paths tonemap with the options as the caller passed them
+    const int xsize = tmopts->xsize;
+    const int origxsize = tmopts->origxsize;
+    try {
+        pfs::io::FrameReaderPtr reader(pfs::io::FrameReaderFactory::open(
+            QFile::encodeName(loadHdrFilename).constData()));
+        pfs::io::FrameWriterPtr writer(pfs::io::FrameWriterFactory::open(
+            QFile::encodeName(saveLdrFilename).constData(), *tmofileparams));
+
+        tmopts->origxsize = tmopts->xsize = reader->width();
+        if (!canTonemapStreaming(*tmopts) || !reader->supportsRows() ||
+            !writer->supportsRows()) {
+            tmopts->xsize = xsize;
+            tmopts->origxsize = origxsize;
+            printIfVerbose(
+                tr("Streaming not supported for this operator or file format."),
+                verbose);
+            return false;
+        }
+
+        printIfVerbose(tr("Tonemapping %1 in bands, saving to file %2.")
+                           .arg(loadHdrFilename, saveLdrFilename),
+                       verbose);
+
+        ProgressHelper ph;
+        connect(&ph, &ProgressHelper::qtSetMaximum, this,
+                &CommandLineInterfaceManager::setProgressBar);
+        connect(&ph, &ProgressHelper::qtSetValue, this,
+                &CommandLineInterfaceManager::updateProgressBar);
+
+        if (!tonemapStreaming(*reader, *writer, *tmopts, *tmofileparams, ph)) {
+            printErrorAndExit(
+                tr("\nERROR: Cannot save to file: %1").arg(saveLdrFilename));
+        }
+    } catch (pfs::io::UnsupportedFormat &) {
+        // opening a format without band support is not an error
+        tmopts->xsize = xsize;
+        tmopts->origxsize = origxsize;
+        printIfVerbose(tr("Streaming not supported for this file format."),
+                       verbose);
+        return false;
+    } catch (std::runtime_error &e) {
+        printErrorAndExit(e.what());
+    }
+
+    // as IOWorker::write_ldr_frame() does for frames loaded from a HDR file
+    ExifOperations::copyExifData(
+        "", QFile::encodeName(saveLdrFilename).constData(), false,
+        tmopts->getExifComment().toStdString(), true, false);
+
+    printIfVerbose(tr("\nImage %1 successfully saved").arg(saveLdrFilename),
+                   verbose);
+    return true;
+}
+
+void CommandLineInterfaceManager::startBatchTonemap() {
+    QFile file(batchManifest);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        printErrorAndExit(
+            tr("Error: Cannot open batch manifest %1").arg(batchManifest));
+    }
+    const QDir manifestDir = QFileInfo(batchManifest).absoluteDir();
+
+    LuminanceOptions luminance_options;
+    batchScheduler.reset(new BatchTMScheduler);
+    batchScheduler->setNumThreads(batchJobs > 0
+                                      ? batchJobs
+                                      : luminance_options.getBatchTmNumThreads());
+    batchScheduler->setMemoryLimit(
+        static_cast<size_t>(batchMemory >= 0
+                                ? batchMemory
+                                : qMax(luminance_options.getBatchTmMemoryLimit(), 0))
+        << 20);
+
+    // state of the manifest, applied to the following INPUT lines
+    QList<TonemappingOptions> optionSets;
+    bool optionSetsUsed = false;
+    QString outputTemplate = saveLdrFilename.isEmpty()
+                                 ? QStringLiteral("%b_%p.jpg")
+                                 : saveLdrFilename;
+    int resizePercent = 100;
+    int numFiles = 0;
+
+    QTextStream in(&file);
+    for (int lineNumber = 1; !in.atEnd(); ++lineNumber) {
+        const QString line = in.readLine().trimmed();
+        // skip comments
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        const QString field = line.section('=', 0, 0).trimmed().toUpper();
+        const QString value = line.section('=', 1).trimmed();
+        const QString where =
+            QStringLiteral("%1:%2: ").arg(batchManifest).arg(lineNumber);
+
+        if (field == QLatin1String("TMOFILE")) {
+            // a TMOFILE after an INPUT starts a new list of settings
+            if (optionSetsUsed) {
+                optionSets.clear();
+                optionSetsUsed = false;
+            }
+            try {
+                QScopedPointer<TonemappingOptions> options(
+                    TMOptionsOperations::parseFile(
+                        manifestDir.absoluteFilePath(value)));
+                optionSets.append(*options);
+            } catch (QString &error) {
+                printErrorAndExit(where + error);
+            }
+        } else if (field == QLatin1String("OUTPUT")) {
+            const QString fileExtension =
+                value.section('.', value.count('.'));
+            if (!validLdrExtensions.contains(fileExtension,
+                                             Qt::CaseInsensitive))
+                printErrorAndExit(where + tr("Unsupported LDR file type."));
+            outputTemplate = value;
+        } else if (field == QLatin1String("RESIZE")) {
+            bool ok;
+            resizePercent = value.toInt(&ok);
+            if (!ok || resizePercent < 1 || resizePercent > 100)
+                printErrorAndExit(
+                    where + tr("Resize must be in the range [1..100]."));
+        } else if (field == QLatin1String("INPUT")) {
+            QList<TonemappingOptions> sets = optionSets;
+            if (sets.isEmpty()) sets.append(*tmopts);
+            if (sets.size() > 1 &&
+                !outputTemplate.contains(QLatin1String("%p")) &&
+                !outputTemplate.contains(QLatin1String("%n")))
+                printErrorAndExit(
+                    where + tr("OUTPUT needs %p or %n with several TMOFILE."));
+
+            const QString input = manifestDir.absoluteFilePath(value);
+            QList<BatchTMOutput> outputs;
+            for (int idx = 0; idx < sets.size(); ++idx) {
+                TonemappingOptions opts(sets.at(idx));
+                opts.xsize_percent = resizePercent;
+                outputs.append(BatchTMOutput(
+                    opts,
+                    manifestDir.absoluteFilePath(expandOutputTemplate(
+                        outputTemplate, input, opts, idx + 1)),
+                    *tmofileparams));
+            }
+            batchScheduler->addFile(input, outputs);
+            optionSetsUsed = true;
+            ++numFiles;
+        } else {
+            printErrorAndExit(where + tr("Unknown key %1.").arg(field));
+        }
+    }
+
+    printIfVerbose(tr("Tone mapping %1 file(s) into %2 image(s) using %n "
+                      "job(s).",
+                      "", batchJobs > 0 ? batchJobs
+                                        : luminance_options.getBatchTmNumThreads())
+                       .arg(numFiles)
+                       .arg(batchScheduler->numTasks()),
+                   verbose);
+
+    connect(batchScheduler.data(), &BatchTMScheduler::add_log_message, this,
+            &CommandLineInterfaceManager::batchLogMessage);
+    connect(batchScheduler.data(), &BatchTMScheduler::increment_progress_bar,
+            this, &CommandLineInterfaceManager::batchIncrementProgress);
+    connect(batchScheduler.data(), &BatchTMScheduler::task_failed, this,
+            &CommandLineInterfaceManager::batchTaskFailed);
+    connect(batchScheduler.data(), &BatchTMScheduler::finished, this,
+            &CommandLineInterfaceManager::batchFinished);
+
+    // one step per file loaded and one per image saved
+    setProgressBar(numFiles + batchScheduler->numTasks());
+    batchScheduler->start();
+}
+
+void CommandLineInterfaceManager::batchLogMessage(const QString &message) {
+    printIfVerbose(message, verbose);
+}
+
+void CommandLineInterfaceManager::batchIncrementProgress(int inc) {
+    batchProgress += inc;
+    updateProgressBar(batchProgress);
+}
+
+void CommandLineInterfaceManager::batchTaskFailed(const QString &hdrFile,
+                                                  const QString &outputFile) {
+    // failures are reported even if not verbose, the batch goes on
+    if (outputFile.isEmpty())
+        printIfVerbose(tr("ERROR: Load file %1 failed").arg(hdrFile), true);
+    else
+        printIfVerbose(tr("ERROR: Cannot tone map %1 to file: %2")
+                           .arg(hdrFile, outputFile),
+                       true);
+}
+
+void CommandLineInterfaceManager::batchFinished() {
+    batchScheduler->wait();
+
+    const int failed = batchScheduler->numFailed();
+    if (failed != 0) {
+        printIfVerbose(tr("\nBatch done, %n job(s) failed.", "", failed), true);
+    } else {
+        printIfVerbose(tr("\nBatch done."), verbose);
+    }
+    QCoreApplication::exit(failed != 0 ? 1 : 0);
+}
+
 void CommandLineInterfaceManager::errorWhileLoading(
     const QString &errormessage) {
     printErrorAndExit(tr("Failed loading images: %1").arg(errormessage));
@@ -34,6 +34,7 @@
 #include <QString>
 #include <QStringList>
 
+#include <Core/BatchTMScheduler.h>
 #include <Core/TonemappingOptions.h>
 #include <HdrWizard/HdrCreationManager.h>
 #include <Libpfs/frame.h>
@@ -53,10 +54,16 @@ class CommandLineInterfaceManager : public QObject {
     enum operation_mode {
         CREATE_HDR_MODE,
         LOAD_HDR_MODE,
+        BATCH_MODE,
         UNKNOWN_MODE
     } operationMode;
 
-    enum align_mode { AIS_ALIGN, MTB_ALIGN, NO_ALIGN } alignMode;
+    enum align_mode {
+        AIS_ALIGN,
+        MTB_ALIGN,
+        FEATURES_ALIGN,
+        NO_ALIGN
+    } alignMode;
 
     QList<float> ev;
     QScopedPointer<HdrCreationManager> hdrCreationManager;
@@ -67,6 +74,7 @@ class CommandLineInterfaceManager : public QObject {
     void printHelp(char *progname);
     QScopedPointer<TonemappingOptions> tmopts;
     QScopedPointer<pfs::Params> tmofileparams;
+    QScopedPointer<pfs::Params> hdrfileparams;
     bool verbose;
     FusionOperatorConfig hdrcreationconfig;
     QString loadHdrFilename;
@@ -79,6 +87,12 @@ class CommandLineInterfaceManager : public QObject {
     bool isAutolevels;
     bool isHtml;
     bool isHtmlDone;
+    bool isStreaming;
+    QString batchManifest;
+    int batchJobs;
+    int batchMemory;
+    int batchProgress;
+    QScopedPointer<BatchTMScheduler> batchScheduler;
     int htmlQuality;
     bool isProposedLdrName;
     bool isProposedHdrName;
@@ -92,6 +106,8 @@ class CommandLineInterfaceManager : public QObject {
 
     void generateHTML();
     void startTonemap();
+    bool startStreamingTonemap();
+    void startBatchTonemap();
 
    private slots:
     void finishedLoadingInputFiles();
@@ -103,6 +119,10 @@ class CommandLineInterfaceManager : public QObject {
     void updateProgressBar(int);
     void readData(const QByteArray &);
     void tonemapFailed(const QString &);
+    void batchLogMessage(const QString &);
+    void batchIncrementProgress(int);
+    void batchTaskFailed(const QString &, const QString &);
+    void batchFinished();
 
    signals:
     void finishedParsing();
@@ -38,6 +38,7 @@
 #include "Common/TranslatorManager.h"
 #include "Common/config.h"
 #include "Common/global.h"
+#include "Libpfs/utils/trace.h"
 #include "MainWindow/DonationDialog.h"
 #include "MainWindow/MainWindow.h"
 
@@ -50,6 +51,11 @@ QStringList getCliFiles(const QStringList &arguments) {
     // I skip the first value of the list because it is the name of the
     // executable
     for (int i = 1; i < arguments.size(); ++i) {
+        // the trace file is an output
+        if (arguments.at(i) == QLatin1String("--trace")) {
+            ++i;
+            continue;
+        }
         QFile file(arguments.at(i).toLocal8Bit());
 
         if (file.exists()) {
@@ -156,6 +162,7 @@ int main(int argc, char **argv) {
     TranslatorManager::setLanguage(LuminanceOptions().getGuiLang());
 
     LuminanceOptions().applyTheme(true);
+    LuminanceOptions().applyScratchStorage();
 
     QStringList arguments = application.arguments();
 
@@ -164,9 +171,17 @@ int main(int argc, char **argv) {
     bool isBatchHDR = false;
     bool isBatchTM = false;
 
-    foreach (QString arg, arguments) {
+    for (int i = 0; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
         if (arg.startsWith("--batchhdr")) isBatchHDR = true;
         if (arg.startsWith("--batchtm")) isBatchTM = true;
+        if (arg.startsWith("--trace=")) {
+            pfs::utils::Trace::start(
+                QFile::encodeName(arg.mid(8)).constData());
+        } else if (arg == "--trace" && i + 1 < arguments.size()) {
+            pfs::utils::Trace::start(
+                QFile::encodeName(arguments.at(++i)).constData());
+        }
     }
 
     if (appname.contains("luminance-hdr") && (!isBatchHDR) && (!isBatchTM)) {
@@ -63,12 +63,14 @@
 #include <Libpfs/manip/copy.h>
 #include <Libpfs/manip/cut.h>
 #include <Libpfs/manip/gamma_levels.h>
+#include <Libpfs/manip/pyramid.h>
 #include <Libpfs/manip/rotate.h>
 #include <Libpfs/params.h>
 
 #include <Common/CommonFunctions.h>
 #include <Common/archs.h>
 #include <Common/config.h>
+#include <Common/fftw_plans.h>
 #include <Common/global.h>
 
 #include <OsIntegration/osintegration.h>
@@ -85,6 +87,7 @@
 #include <UI/GammaAndLevels.h>
 #include <UI/ImageQualityDialog.h>
 #include <UI/SupportedCamerasDialog.h>
+#include <UI/ExrOptionsDialog.h>
 #include <UI/TiffModeDialog.h>
 #include <UI/UMessageBox.h>
 
@@ -681,6 +684,12 @@ void MainWindow::on_fileSaveAsAction_triggered() {
 
             p.set("tiff_mode", t.getTiffWriterMode());
         }
+        if (format == QLatin1String("exr")) {
+            ExrOptionsDialog e(pfs::Params(), this);
+            if (e.exec() == QDialog::Rejected) return;
+
+            e.applyTo(p);
+        }
 
         // CALL m_IOWorker->write_hdr_frame(qobject_cast<HdrViewer*>(g_v),
         // fname);
@@ -823,9 +832,12 @@ void MainWindow::updateActions(int w) {
 #ifdef QT_DEBUG
     qDebug() << "MainWindow::updateActions(" << w << ")";
 #endif
-    bool hasImage = w >= 0;
-    GenericViewer *g_v = hasImage ? qobject_cast<GenericViewer *>(m_tabwidget->widget(w)) : 0;
-    bool isHdr = g_v ? g_v->isHDR() : false;
+    GenericViewer *g_v =
+        w >= 0 ? qobject_cast<GenericViewer *>(m_tabwidget->widget(w)) : 0;
+    // the cached preview shown while the HDR file is read can only be viewed
+    bool isLoading = g_v && g_v == m_loadingViewer.data();
+    bool hasImage = w >= 0 && !isLoading;
+    bool isHdr = g_v && !isLoading ? g_v->isHDR() : false;
     bool isLdr = g_v ? !g_v->isHDR() : false;
     LuminanceOptions luminance_opts;
     bool hasPrinterProfile =
@@ -883,6 +895,7 @@ void MainWindow::dispatchrotate(bool clockwise) {
     pfs::Frame *rotated = pfs::rotate(curr_g_v->getFrame(), clockwise);
 
     curr_g_v->setFrame(rotated);
+    setHdrPreview(HdrPreviewPtr());
     if (!curr_g_v->needsSaving()) {
         curr_g_v->setNeedsSaving(true);
 
@@ -909,6 +922,7 @@ void MainWindow::on_actionResizeHDR_triggered() {
         QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
 
         curr_g_v->setFrame(resizedialog->getResizedFrame());
+        setHdrPreview(HdrPreviewPtr());
         if (!curr_g_v->needsSaving()) {
             curr_g_v->setNeedsSaving(true);
 
@@ -953,6 +967,7 @@ void MainWindow::on_action_Projective_Transformation_triggered() {
         QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
 
         curr_g_v->setFrame(projTranfsDialog->getTranformedFrame());
+        setHdrPreview(HdrPreviewPtr());
         if (!curr_g_v->needsSaving()) {
             curr_g_v->setNeedsSaving(true);
 
@@ -1102,6 +1117,7 @@ void MainWindow::setupIO() {
     m_IOWorker = new IOWorker;
 
     m_IOWorker->moveToThread(m_IOThread);
+    m_IOWorker->setPreviewCacheEnabled(true);
 
     // Memory Management
     connect(this, &QObject::destroyed, m_IOWorker, &QObject::deleteLater);
@@ -1112,6 +1128,9 @@ void MainWindow::setupIO() {
             this, SLOT(load_success(pfs::Frame *, const QString &)));
     connect(m_IOWorker, &IOWorker::read_hdr_failed, this,
             &MainWindow::load_failed);
+    qRegisterMetaType<HdrPreviewPtr>();
+    connect(m_IOWorker, &IOWorker::read_hdr_preview, this,
+            &MainWindow::load_preview);
 
     // Save HDR
     connect(m_IOWorker,
@@ -1164,11 +1183,39 @@ void MainWindow::load_failed(const QString &errorMessage) {
 
     QApplication::restoreOverrideCursor();
 
+    closeLoadingViewer();
+
     // TODO: use unified style?
     QMessageBox::critical(this, tr("Aborting..."), errorMessage,
                           QMessageBox::Ok, QMessageBox::NoButton);
 }
 
+void MainWindow::load_preview(const HdrPreviewPtr &preview,
+                              const QString &fname) {
+    // a new window is opened for the file once it is read
+    if (tm_status.is_hdr_ready || m_loadingViewer) return;
+    if (preview->levels.isEmpty()) return;
+
+    HdrViewer *viewer = new HdrViewer(
+        pfs::copy(preview->levels.front().data()), this, false, preview);
+    viewer->setAttribute(Qt::WA_DeleteOnClose);
+    viewer->setViewerMode(getCurrentViewerMode(*m_tabwidget));
+    viewer->setFileName(fname);
+
+    m_loadingViewer = viewer;
+    m_tabwidget->addTab(viewer, QFileInfo(fname).fileName());
+    m_tabwidget->setCurrentWidget(viewer);
+}
+
+void MainWindow::closeLoadingViewer() {
+    if (!m_loadingViewer) return;
+
+    int index = m_tabwidget->indexOf(m_loadingViewer);
+    if (index >= 0) m_tabwidget->removeTab(index);
+    m_loadingViewer->deleteLater();
+    m_loadingViewer.clear();
+}
+
 void MainWindow::load_success(pfs::Frame *new_hdr_frame,
                               const QString &new_fname,
                               const QStringList &inputFileNames,
@@ -1182,9 +1229,22 @@ void MainWindow::load_success(pfs::Frame *new_hdr_frame,
 #ifdef QT_DEBUG
         qDebug() << "Filename: " << new_fname;
 #endif
-        HdrViewer *newhdr = new HdrViewer(new_hdr_frame, this, needSaving);
+        // the preview stored by the IOWorker when it read the file
+        HdrPreviewPtr preview;
+        if (!needSaving) preview = PreviewCache::lookup(new_fname);
+
+        HdrViewer *newhdr = m_loadingViewer;
+        if (newhdr && m_tabwidget->indexOf(newhdr) >= 0 && !needSaving &&
+            newhdr->getFileName() == new_fname) {
+            // the viewer of the cached preview shown while the file was read
+            m_loadingViewer.clear();
+            newhdr->setFrame(new_hdr_frame);
+        } else {
+            closeLoadingViewer();
+            newhdr = new HdrViewer(new_hdr_frame, this, needSaving, preview);
 
-        newhdr->setAttribute(Qt::WA_DeleteOnClose);
+            newhdr->setAttribute(Qt::WA_DeleteOnClose);
+        }
 
         connect(newhdr, &GenericViewer::selectionReady, this,
                 &MainWindow::enableCrop);
@@ -1230,7 +1290,9 @@ void MainWindow::load_success(pfs::Frame *new_hdr_frame,
             // the new file exists on the file system, so I can use this value
             // to set captions and so on
             newhdr->setFileName(new_fname);
-            m_tabwidget->addTab(newhdr, qfileinfo.fileName());
+            if (m_tabwidget->indexOf(newhdr) < 0) {
+                m_tabwidget->addTab(newhdr, qfileinfo.fileName());
+            }
 
             setCurrentFile(new_fname);
             setWindowModified(needSaving);
@@ -1240,8 +1302,10 @@ void MainWindow::load_success(pfs::Frame *new_hdr_frame,
         tm_status.curr_tm_frame = newhdr;
 
         m_tabwidget->setCurrentWidget(newhdr);
+        updateActions(m_tabwidget->currentIndex());
 
         m_tonemapPanel->setEnabled(true);
+        setHdrPreview(preview);
         m_tonemapPanel->updatedHDR(new_hdr_frame);
         m_Ui->actionShowPreviewPanel->setEnabled(true);
 
@@ -1252,6 +1316,11 @@ void MainWindow::load_success(pfs::Frame *new_hdr_frame,
     }
 }
 
+void MainWindow::setHdrPreview(const HdrPreviewPtr &preview) {
+    m_tonemapPanel->setHdrPreview(preview);
+    m_PreviewPanel->setHdrPreview(preview);
+}
+
 void MainWindow::on_OptionsAction_triggered() {
     PreferencesDialog *opts = new PreferencesDialog(this);
     opts->setAttribute(Qt::WA_DeleteOnClose);
@@ -1578,6 +1647,10 @@ void MainWindow::setupTM() {
     m_TMWorker = new TMWorker;
     m_TMThread = new QThread;
 
+    // previewing and retuning an operator on the same image restarts from
+    // its last run
+    m_TMWorker->setSolverCacheEnabled(true);
+
     m_TMWorker->moveToThread(m_TMThread);
 
     // Memory Management
@@ -1955,6 +2028,7 @@ void MainWindow::removeTab(int t) {
             tm_status.is_hdr_ready = false;
             tm_status.curr_tm_frame = nullptr;
             tm_status.curr_tm_options = nullptr;
+            setHdrPreview(HdrPreviewPtr());
 
             m_tonemapPanel->setEnabled(false);
 
@@ -1962,6 +2036,11 @@ void MainWindow::removeTab(int t) {
             m_inputExpoTimes.clear();
 
             m_PreviewscrollArea->hide();
+
+            // the buffers and plans kept for the tone mapping of the image
+            pfs::PyramidPool::clear();
+            FftwBuffer::trim();
+            FftwPlans::clear();
         }
     } else {
         curr_num_ldr_open--;
@@ -2115,6 +2194,7 @@ void MainWindow::whiteBalanceDone() {
     m_viewerToProcess->updatePixmap();
     if (m_viewerToProcess->isHDR()) {
         m_viewerToProcess->setNeedsSaving(true);
+        setHdrPreview(HdrPreviewPtr());
         m_PreviewPanel->updatePreviews(tm_status.curr_tm_frame->getFrame());
     }
 }
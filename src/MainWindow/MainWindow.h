@@ -38,6 +38,7 @@
 #include <QFutureWatcher>
 #include <QMainWindow>
 #include <QMap>
+#include <QPointer>
 #include <QProgressBar>
 #include <QScopedPointer>
 #include <QScrollArea>
@@ -50,6 +51,7 @@
 
 #include "Common/LuminanceOptions.h"
 #include "Common/global.h"
+#include "Core/PreviewCache.h"
 
 #define MAX_RECENT_FILES (5)
 
@@ -96,6 +98,8 @@ class MainWindow : public QMainWindow {
     void save_ldr_failed(const QString &fname);
 
     void load_failed(const QString &);
+    //! \brief show the cached preview of \a fname while it is read
+    void load_preview(const HdrPreviewPtr &preview, const QString &fname);
     void load_success(pfs::Frame *new_hdr_frame, const QString &new_fname,
                       const QStringList &inputFileNames = QStringList(),
                       bool needSaving = false);
@@ -310,6 +314,11 @@ class MainWindow : public QMainWindow {
 
     void setRealtimePreviewsActive(bool);
     void setPreviewPanelActive(bool b);
+    //! \brief hand the cached preview of the HDR frame to the previews,
+    //! null when the frame has been modified
+    void setHdrPreview(const HdrPreviewPtr &preview);
+    //! \brief remove the viewer of the cached preview of the file being read
+    void closeLoadingViewer();
 
     // Preview Panel
     QScrollArea *m_PreviewscrollArea;
@@ -332,6 +341,8 @@ class MainWindow : public QMainWindow {
     QThread *m_IOThread;
     IOWorker *m_IOWorker;
     QProgressBar *m_ProgressBar;
+    //! \brief viewer of the cached preview of the HDR file being read
+    QPointer<HdrViewer> m_loadingViewer;
 
     // TM thread
     QThread *m_TMThread;
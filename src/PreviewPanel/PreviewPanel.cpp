@@ -362,9 +362,14 @@ void PreviewPanel::updatePreviews(pfs::Frame *frame, int index) {
         float ratio = ((float)frame_width) / frame_height;
         resized_width = PREVIEW_HEIGHT * ratio;
     }
-    // 1. make a resized copy
+    // 1. make a resized copy, from the cached pyramid if it is the one of
+    // this frame
+    const pfs::Frame *source = frame;
+    if (m_hdrPreview && m_hdrPreview->matches(*frame)) {
+        source = m_hdrPreview->level(qMax(resized_width, PREVIEW_HEIGHT));
+    }
     QSharedPointer<pfs::Frame> current_frame(
-        pfs::resize(frame, resized_width, BilinearInterp));
+        pfs::resize(source, resized_width, BilinearInterp));
 
     // 2. (non concurrent) for each PreviewLabel, call
     // PreviewLabelUpdater::operator()
@@ -385,6 +390,10 @@ void PreviewPanel::updatePreviews(pfs::Frame *frame, int index) {
     // );
 }
 
+void PreviewPanel::setHdrPreview(const HdrPreviewPtr &preview) {
+    m_hdrPreview = preview;
+}
+
 void PreviewPanel::tonemapPreview(TonemappingOptions *opts) {
 #ifdef QT_DEBUG
     qDebug() << "void PreviewPanel::tonemapPreview()";
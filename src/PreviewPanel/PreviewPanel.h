@@ -26,6 +26,8 @@
 
 #include <QWidget>
 
+#include "Core/PreviewCache.h"
+
 // forward declaration
 namespace pfs {
 class Frame;  // #include "Libpfs/frame.h"
@@ -47,6 +49,10 @@ class PreviewPanel : public QWidget {
     QSize getLabelSize();
     PreviewLabel *getLabel(int);
 
+    //! \brief use \a preview, the cached preview of the frames to come, to
+    //! build the small copy they are tonemapped from
+    void setHdrPreview(const HdrPreviewPtr &preview);
+
    public Q_SLOTS:
     void updatePreviews(pfs::Frame *frame, int index = -1);
     void setAutolevels(bool, float);
@@ -62,5 +68,6 @@ class PreviewPanel : public QWidget {
     bool m_doAutolevels;
     float m_autolevelThreshold;
     QVector<PreviewLabel *> m_ListPreviewLabel;
+    HdrPreviewPtr m_hdrPreview;
 };
 #endif
@@ -157,9 +157,14 @@ void PreviewSettings::updatePreviews(pfs::Frame *frame) {
         float ratio = ((float)frame_width) / frame_height;
         resized_width = PREVIEW_HEIGHT * ratio;
     }
-    // 1. make a resized copy
+    // 1. make a resized copy, from the cached pyramid if it is the one of
+    // this frame
+    const pfs::Frame *source = frame;
+    if (m_hdrPreview && m_hdrPreview->matches(*frame)) {
+        source = m_hdrPreview->level(qMax(resized_width, PREVIEW_HEIGHT));
+    }
     QSharedPointer<pfs::Frame> current_frame(
-        pfs::resize(frame, resized_width, BilinearInterp));
+        pfs::resize(source, resized_width, BilinearInterp));
 
     // 2. (non concurrent) for each PreviewLabel, call
     // PreviewLabelUpdater::operator()
@@ -173,6 +178,10 @@ void PreviewSettings::updatePreviews(pfs::Frame *frame) {
     // );
 }
 
+void PreviewSettings::setHdrPreview(const HdrPreviewPtr &preview) {
+    m_hdrPreview = preview;
+}
+
 void PreviewSettings::tonemapPreview(TonemappingOptions *opts) {
 #ifdef QT_DEBUG
     qDebug() << "void PreviewSettings::tonemapPreview()";
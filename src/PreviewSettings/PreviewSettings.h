@@ -26,6 +26,7 @@
 
 #include <QWidget>
 
+#include "Core/PreviewCache.h"
 #include "UI/FlowLayout.h"
 
 // forward declaration
@@ -47,6 +48,9 @@ class PreviewSettings : public QWidget {
     QSize getLabelSize();
     int getSize() { return m_ListPreviewLabel.size(); }
     void clear();
+    //! \brief use \a preview, the cached preview of the frames to come, to
+    //! build the small copy they are tonemapped from
+    void setHdrPreview(const HdrPreviewPtr &preview);
 
    protected:
     virtual void changeEvent(QEvent *event);
@@ -66,5 +70,6 @@ class PreviewSettings : public QWidget {
     int m_original_width_frame;
     QList<PreviewLabel *> m_ListPreviewLabel;
     FlowLayout *m_flowLayout;
+    HdrPreviewPtr m_hdrPreview;
 };
 #endif
@@ -32,8 +32,7 @@
 
 #include <Libpfs/array2d.h>
 #include <Libpfs/array2d_fwd.h>
-
-using namespace pfs;
+#include <Libpfs/manip/pyramid.h>
 
 class Pyramid {  // each level of a Gaussian pyramid
    public:
@@ -66,35 +65,15 @@ class GaussianPyramid {
     GaussianPyramid() {}
 
     GaussianPyramid(pfs::Array2Df *lum_map, int im_height, int im_width) {
-        // set a=0.4 (considered by Burt and Adelson, 1983).
-        // obtained by Outer((0.05, 0.25, 0.4, 0.25, 0.05),(0.05, 0.25, 0.4,
-        // 0.25,
-        // 0.05))
-        g_weights[0][0] = g_weights[0][4] = 0.0025;
-        g_weights[0][1] = g_weights[0][3] = 0.0125;
-        g_weights[0][2] = 0.0200;
-
-        g_weights[1][0] = g_weights[1][4] = 0.0125;
-        g_weights[1][1] = g_weights[1][3] = 0.0625;
-        g_weights[1][2] = 0.1000;
-
-        g_weights[2][0] = g_weights[2][4] = 0.0200;
-        g_weights[2][1] = g_weights[2][3] = 0.1000;
-        g_weights[2][2] = 0.1600;
-
-        g_weights[3][0] = g_weights[3][4] = 0.0125;
-        g_weights[3][1] = g_weights[3][3] = 0.0625;
-        g_weights[3][2] = 0.1000;
-
-        g_weights[4][0] = g_weights[4][4] = 0.0025;
-        g_weights[4][1] = g_weights[4][3] = 0.0125;
-        g_weights[4][2] = 0.0200;
-
         constructPyramid(lum_map, im_width, im_height);
     }
 
     ~GaussianPyramid() {
-        for (int i = 0; i < PYRAMID; i++) delete p[i].GP;
+        for (int i = 0; i < PYRAMID; i++) {
+            if (!p[i].GP) continue;
+            pfs::PyramidPool::release(*p[i].GP);
+            delete p[i].GP;
+        }
     }
 
     double NoInterpolateLum(int newX, int newY, Pyramid *pl) {
@@ -216,40 +195,9 @@ class GaussianPyramid {
         double new_lambda = p[current_index].lambda * 0.5;
         initializeNewLevel(next_index, w, h, k_size, new_lambda);
 
-        // apply 5*5 kernel
-        int X, Y;
-#ifdef _OPENMP
-        #pragma omp parallel for private(X,Y)
-#endif
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                double sum = 0.0;
-                for (int n = -2; n < 3; n++) {
-                    for (int m = -2; m < 3; m++) {
-                        if (2 * x + m >= 0 &&
-                            2 * x + m < p[current_index].width)
-                            X = 2 * x + m;
-                        else if (2 * x + m < 0)
-                            X = 0;
-                        else
-                            X = p[current_index].width - 1;
-
-                        if (2 * y + n >= 0 &&
-                            2 * y + n < p[current_index].height)
-                            Y = 2 * y + n;
-                        else if (2 * y + n < 0)
-                            Y = 0;
-                        else
-                            Y = p[current_index].height - 1;
-
-                        sum += g_weights[m + 2][n + 2] *
-                               p[current_index].getPixel(X, Y);
-                    }
-                }
-
-                p[next_index].setPixel(x, y, sum);
-            }
-        }
+        // 5x5 kernel of Burt and Adelson with a = 0.4, by rows then columns
+        pfs::reduce(*p[current_index].GP, *p[next_index].GP,
+                    pfs::PYRAMID_BURT_ADELSON);
         return next_index;
     }
 
@@ -268,7 +216,8 @@ class GaussianPyramid {
         p[index].size = w * h;
         p[index].kernel_size = k_size;
         p[index].lambda = lambda;
-        p[index].GP = new pfs::Array2Df(w, h);
+        p[index].GP = new pfs::Array2Df;
+        pfs::PyramidPool::acquire(w, h, *p[index].GP);
         p[index].flag = 1;
     }
 
@@ -289,7 +238,6 @@ class GaussianPyramid {
 
     static const int PYRAMID = 20;
     Pyramid p[PYRAMID];
-    double g_weights[5][5];
 };
 
 #endif
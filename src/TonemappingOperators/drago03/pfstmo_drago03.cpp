@@ -29,6 +29,8 @@
  * $Id: pfstmo_drago03.cpp,v 1.3 2008/09/04 12:46:48 julians37 Exp $
  */
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <iostream>
 
@@ -38,8 +40,91 @@
 #include "Libpfs/frame.h"
 #include "Libpfs/progress.h"
 #include "tmo_drago03.h"
+#include "TonemappingOperators/pfstmo.h"
 #include "../../opthelper.h"
 
+namespace {
+//! \brief scale X, Y and Z by the ratio between the tone mapped luminance
+//! \a L and the original luminance Y
+void scaleByLuminance(pfs::Array2Df &Xr, pfs::Array2Df &Yr, pfs::Array2Df &Zr,
+                      const pfs::Array2Df &L) {
+    int w = Yr.getCols();
+    int h = Yr.getRows();
+
+#pragma omp parallel for
+    for (int y = 0; y < h; y++) {
+        int x = 0;
+#ifdef __SSE2__
+        for (; x < w - 3; x+=4) {
+            vfloat yrv = LVFU(Yr(x, y));
+            vfloat scalev = vselfnotzero(vmaskf_eq(yrv, ZEROV), LVFU(L(x,y)) / yrv);
+
+            STVFU(Yr(x, y), yrv * scalev);
+            STVFU(Xr(x, y), LVFU(Xr(x, y)) * scalev);
+            STVFU(Zr(x, y), LVFU(Zr(x, y)) * scalev);
+        }
+#endif
+        for (; x < w; x++) {
+            float yr = Yr(x, y);
+            float scale = yr != 0.f ? L(x, y) / yr : 0.f;
+
+            assert(!boost::math::isnan(scale));
+
+            Yr(x, y) = Yr(x, y) * scale;
+            Xr(x, y) = Xr(x, y) * scale;
+            Zr(x, y) = Zr(x, y) * scale;
+        }
+    }
+}
+
+class Drago03Stream : public StreamingTmo {
+   public:
+    explicit Drago03Stream(float biasValue)
+        : m_bias(biasValue), m_logSum(0.0), m_maxLum(0.f), m_size(0) {}
+
+    size_t statisticsPasses() const { return 1; }
+
+    void accumulate(size_t /*pass*/, const pfs::Frame &band) {
+        const pfs::Channel *X, *Y, *Z;
+        band.getXYZChannels(X, Y, Z);
+        if (!X || !Y || !Z) {
+            throw pfs::Exception("Missing X, Y, Z channels in the PFS stream");
+        }
+
+        float logSum;
+        float maxLum;
+        accumulateLuminance(Y->getCols(), Y->getRows(), Y->data(), logSum,
+                            maxLum);
+
+        m_logSum += logSum;
+        m_maxLum = std::max(m_maxLum, maxLum);
+        m_size += Y->size();
+    }
+
+    void map(pfs::Frame &band) {
+        pfs::Channel *X, *Y, *Z;
+        band.getXYZChannels(X, Y, Z);
+        if (!X || !Y || !Z) {
+            throw pfs::Exception("Missing X, Y, Z channels in the PFS stream");
+        }
+
+        const float avLum = std::exp(m_logSum / m_size);
+
+        pfs::Progress ph;
+        pfs::Array2Df L(Y->getCols(), Y->getRows());
+        tmo_drago03(*Y, L, m_maxLum, avLum, m_bias, ph);
+
+        scaleByLuminance(*X, *Y, *Z, L);
+    }
+
+   private:
+    float m_bias;
+    double m_logSum;
+    float m_maxLum;
+    size_t m_size;
+};
+}
+
 void pfstmo_drago03(pfs::Frame &frame, float opt_biasValue, pfs::Progress &ph) {
 #ifndef NDEBUG
     std::stringstream ss;
@@ -79,31 +164,12 @@ void pfstmo_drago03(pfs::Frame &frame, float opt_biasValue, pfs::Progress &ph) {
     }
 
     if (!ph.canceled()) {
-#pragma omp parallel for
-        for (int y = 0; y < h; y++) {
-            int x = 0;
-#ifdef __SSE2__
-            for (; x < w - 3; x+=4) {
-                vfloat yrv = LVFU(Yr(x, y));
-                vfloat scalev = vselfnotzero(vmaskf_eq(yrv, ZEROV), LVFU(L(x,y)) / yrv);
-
-                STVFU(Yr(x, y), yrv * scalev);
-                STVFU(Xr(x, y), LVFU(Xr(x, y)) * scalev);
-                STVFU(Zr(x, y), LVFU(Zr(x, y)) * scalev);
-            }
-#endif
-            for (; x < w; x++) {
-                float yr = Yr(x, y);
-                float scale = yr != 0.f ? L(x, y) / yr : 0.f;
-
-                assert(!boost::math::isnan(scale));
-
-                Yr(x, y) = Yr(x, y) * scale;
-                Xr(x, y) = Xr(x, y) * scale;
-                Zr(x, y) = Zr(x, y) * scale;
-            }
-        }
+        scaleByLuminance(Xr, Yr, Zr, L);
 
         ph.setValue(100);
     }
 }
+
+StreamingTmo *pfstmo_drago03_stream(float biasValue) {
+    return new Drago03Stream(biasValue);
+}
@@ -36,7 +36,7 @@
 
 #include <boost/math/special_functions/fpclassify.hpp>
 
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "Libpfs/frame.h"
 #include "Libpfs/progress.h"
 #include "TonemappingOperators/pfstmo.h"
@@ -53,13 +53,11 @@ inline float biasFunc(float b, float x) {
 const float LOG05 = -0.693147f;  // log(0.5)
 }
 
-void calculateLuminance(unsigned int width, unsigned int height, const float *Y,
-                        float &avLum, float &maxLum) {
-    avLum = 0.0f;
+void accumulateLuminance(unsigned int width, unsigned int height,
+                         const float *Y, float &logSum, float &maxLum) {
+    float avLum = 0.0f;
     maxLum = 0.0f;
 
-    int size = width * height;
-
 #ifdef __SSE2__
     vfloat maxLumv = ZEROV;
     vfloat avLumv = ZEROV;
@@ -105,17 +103,23 @@ void calculateLuminance(unsigned int width, unsigned int height, const float *Y,
     avLum += vhadd(avLumv);
     maxLum = std::max(maxLum, vhmax(maxLumv));
 #endif
-    avLum = exp(avLum / size);
+    logSum = avLum;
+}
+
+void calculateLuminance(unsigned int width, unsigned int height, const float *Y,
+                        float &avLum, float &maxLum) {
+    int size = width * height;
+
+    float logSum;
+    accumulateLuminance(width, height, Y, logSum, maxLum);
+    avLum = exp(logSum / size);
 }
 
 void tmo_drago03(const pfs::Array2Df &Y, pfs::Array2Df &L, float maxLum,
                  float avLum, float bias, pfs::Progress &ph) {
     assert(Y.getRows() == L.getRows());
     assert(Y.getCols() == L.getCols());
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span("tmo_drago03", Y.size() * sizeof(float));
 
     // normalize maximum luminance by average luminance
     maxLum /= avLum;
@@ -157,10 +161,5 @@ void tmo_drago03(const pfs::Array2Df &Y, pfs::Array2Df &L, float maxLum,
         }
     }
     }
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_drago03 = " << stop_watch.get_time() << " msec" << endl;
-#endif
 
 }
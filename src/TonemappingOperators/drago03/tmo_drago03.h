@@ -59,4 +59,14 @@ void tmo_drago03(const pfs::Array2Df &Y, pfs::Array2Df &L, float maxLum,
 void calculateLuminance(unsigned int width, unsigned int height, const float *Y,
                         float &avLum, float &maxLum);
 
+//! \brief Building block of calculateLuminance, for images processed one band
+//! at a time: the average luminance of the image is exp(sum(logSum) / size)
+//!
+//! \param Y [in] luminance values of the band
+//! \param logSum [out] sum of the logarithm of the luminance in the band
+//! \param maxLum [out] maximum luminance in the band
+//!
+void accumulateLuminance(unsigned int width, unsigned int height,
+                         const float *Y, float &logSum, float &maxLum);
+
 #endif
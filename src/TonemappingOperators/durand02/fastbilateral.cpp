@@ -30,6 +30,7 @@
 #include <cmath>
 
 #include <Libpfs/array2d.h>
+#include <Libpfs/manip/pyramid.h>
 #include <Libpfs/progress.h>
 #include "fastbilateral.h"
 
@@ -42,7 +43,6 @@
 #endif
 #include "../../sleef.c"
 #include "../../opthelper.h"
-#include "../../gauss.h"
 
 using namespace std;
 
@@ -218,23 +218,8 @@ void fastBilateralFilter(const pfs::Array2Df &I, pfs::Array2Df &J,
             }
         }
 }
-        float* gaussRows[h];
-
-        gaussRows[0] = jG.data();
-        for(int i = 1; i < h; ++i)
-            gaussRows[i] = gaussRows[i - 1] + w;
-#ifdef _OPENMP
-        #pragma omp parallel
-#endif
-        gaussianBlur(gaussRows, gaussRows, w, h, sigma_s);
-
-        gaussRows[0] = jH.data();
-        for(int i = 1; i < h; ++i)
-            gaussRows[i] = gaussRows[i - 1] + w;
-#ifdef _OPENMP
-        #pragma omp parallel
-#endif
-        gaussianBlur(gaussRows, gaussRows, w, h, sigma_s);
+        pfs::gaussianBlur(jG, jG, sigma_s);
+        pfs::gaussianBlur(jH, jH, sigma_s);
 
 #ifdef _OPENMP
         #pragma omp parallel for
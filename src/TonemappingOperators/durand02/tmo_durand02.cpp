@@ -37,7 +37,7 @@
 #include <iostream>
 #include <vector>
 
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "Libpfs/array2d.h"
 #include "Libpfs/rt_algo.h"
 #include "Libpfs/progress.h"
@@ -100,10 +100,8 @@ R output = r*exp(log(output intensity)), etc.
 void tmo_durand02(pfs::Array2Df &R, pfs::Array2Df &G, pfs::Array2Df &B,
                   float sigma_s, float sigma_r, float baseContrast,
                   int downsample, bool color_correction, pfs::Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_durand02", 3 * R.size() * sizeof(float));
 
     size_t w = R.getCols();
     size_t h = R.getRows();
@@ -293,11 +291,4 @@ void tmo_durand02(pfs::Array2Df &R, pfs::Array2Df &G, pfs::Array2Df &B,
     }
 
     ph.setValue(99);
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_durand02 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
 }
@@ -40,9 +40,11 @@
 #include <math.h>
 
 #include "Libpfs/array2d.h"
+#include "Libpfs/manip/pyramid.h"
 #include "Libpfs/rt_algo.h"
 #include "Libpfs/progress.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/solvercache.h"
+#include "Libpfs/utils/trace.h"
 #include "TonemappingOperators/pfstmo.h"
 #include "../../sleef.c"
 #ifdef _OPENMP
@@ -57,117 +59,9 @@ using namespace std;
 using namespace pfs;
 using namespace utils;
 
-void downSample(const pfs::Array2Df &A, pfs::Array2Df &B) {
-
-    const int width = B.getCols();
-    const int height = B.getRows();
-
-    // Note, I've uncommented all omp directives. They are all ok but are
-    // applied to too small problems and in total don't lead to noticable
-    // speed improvements. The main issue is the pde solver and in case of the
-    // fft solver uses optimised threaded fftw routines.
-    // Note from Ingo Weyrich. The above statement is wrong. There are some very expensive loops (exp, log, pow) which got a really good speedup by parallelized and vectorized code.
-    //#pragma omp parallel for
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            float p = A(2 * x, 2 * y);
-            p += A(2 * x + 1, 2 * y);
-            p += A(2 * x, 2 * y + 1);
-            p += A(2 * x + 1, 2 * y + 1);
-            B(x, y) = p * 0.25f;  // p / 4.0f;
-        }
-    }
-}
-
-void gaussianBlur(const pfs::Array2Df &I, pfs::Array2Df &L) {
-    const int width = I.getCols();
-    const int height = I.getRows();
-
-    if (width < 3 || height < 3) {
-        if (&I != &L) {
-            for (int i = 0, n = width * height; i < n; ++i) {
-                L (i) = I (i);
-            }
-        }
-
-        return;
-    }
-
-    pfs::Array2Df T(width, height);
-
-    //--- X blur
-    #pragma omp parallel for
-
-    for ( int y = 0 ; y < height ; y++ ) {
-        for ( int x = 1 ; x < width - 1 ; x++ ) {
-            float t = 2.f * I (x, y);
-            t += I (x - 1, y);
-            t += I (x + 1, y);
-            T (x, y) = t * 0.25f; // t / 4.f;
-        }
-
-        T (0, y) = ( 3.f * I (0, y) + I (1, y) ) * 0.25f; // / 4.f;
-        T (width - 1, y) = ( 3.f * I (width - 1, y) + I (width - 2, y) ) * 0.25f; // / 4.f;
-    }
-
-    //--- Y blur
-    #pragma omp parallel for
-
-    for ( int x = 0 ; x < width - 7 ; x += 8 ) {
-        for ( int y = 1 ; y < height - 1 ; y++ ) {
-            for (int xx = 0; xx < 8; ++xx) {
-                float t = 2.f * T (x + xx, y);
-                t += T (x + xx, y - 1);
-                t += T (x + xx, y + 1);
-                L (x + xx, y) = t * 0.25f; // t/4.0f;
-            }
-        }
-
-        for (int xx = 0; xx < 8; ++xx) {
-            L (x + xx, 0) = ( 3.f * T (x + xx, 0) + T (x + xx, 1) ) * 0.25f; // / 4.0f;
-            L (x + xx, height - 1) = ( 3.f * T (x + xx, height - 1) + T (x + xx, height - 2) ) * 0.25f; // / 4.0f;
-        }
-    }
-
-    for ( int x = width - (width % 8) ; x < width ; x++ ) {
-        for ( int y = 1 ; y < height - 1 ; y++ ) {
-            float t = 2.f * T (x, y);
-            t += T (x, y - 1);
-            t += T (x, y + 1);
-            L (x, y) = t * 0.25f; // t/4.0f;
-        }
-
-        L (x, 0) = ( 3.f * T (x, 0) + T (x, 1) ) * 0.25f; // / 4.0f;
-        L (x, height - 1) = ( 3.f * T (x, height - 1) + T (x, height - 2) ) * 0.25f; // / 4.0f;
-    }
-}
-
-void createGaussianPyramids(pfs::Array2Df &H, pfs::Array2Df **pyramids,
-                            int nlevels) {
-
-    int width = H.getCols();
-    int height = H.getRows();
-
-    pfs::Array2Df *L = new pfs::Array2Df(width, height);
-    gaussianBlur(*pyramids[0], *L);
-
-    for (int k = 1; k < nlevels; k++) {
-        width /= 2;
-        height /= 2;
-        pyramids[k] = new pfs::Array2Df(width, height);
-        downSample(*L, *pyramids[k]);
-        if(k < nlevels - 1) {
-            delete L;
-            L = new pfs::Array2Df(width, height);
-            gaussianBlur(*pyramids[k], *L);
-        }
-    }
-    delete L;
-}
-
 //--------------------------------------------------------------------
 
-float calculateGradients(pfs::Array2Df &H, pfs::Array2Df &G, int k) {
+float calculateGradients(const pfs::Array2Df &H, pfs::Array2Df &G, int k) {
 
     const int width = H.getCols();
     const int height = H.getRows();
@@ -222,8 +116,9 @@ void upSample(const pfs::Array2Df &A, pfs::Array2Df &B) {
     }
 }
 
-void calculateFiMatrix(pfs::Array2Df &FI, pfs::Array2Df *gradients[],
-                       float avgGrad[], int nlevels, int detail_level,
+void calculateFiMatrix(pfs::Array2Df &FI,
+                       const pfs::Array2Df *const gradients[],
+                       const float avgGrad[], int nlevels, int detail_level,
                        float alfa, float beta, float noise, bool newfattal) {
 
     int width = gradients[nlevels - 1]->getCols();
@@ -272,7 +167,7 @@ void calculateFiMatrix(pfs::Array2Df &FI, pfs::Array2Df *gradients[],
 
         if (k > 0 && newfattal) {
             upSample(*fi[k], *fi[k - 1]);  // upsample to next level
-            gaussianBlur(*fi[k - 1], *fi[k - 1]);
+            binomialBlur(*fi[k - 1], *fi[k - 1]);
         }
     }
 
@@ -286,10 +181,8 @@ void tmo_fattal02(size_t width, size_t height, const pfs::Array2Df &Y,
                   pfs::Array2Df &L, float alfa, float beta, float noise,
                   bool newfattal, bool fftsolver, int detail_level,
                   pfs::Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_fattal02", width * height * sizeof(float));
     static const float black_point = 0.1f;
     static const float white_point = 0.5f;
     static const float gamma = 1.0f;  // 0.8f;
@@ -353,32 +246,52 @@ void tmo_fattal02(size_t width, size_t height, const pfs::Array2Df &Y,
     // The following lines solves a bug with images particularly small
     if (nlevels == 0) nlevels = 1;
 
-    pfs::Array2Df **pyramids = new pfs::Array2Df *[nlevels];
-    pyramids[0] = &H;
-    createGaussianPyramids(H, pyramids, nlevels);
-    ph.setValue(8);
+    // the gradient pyramid depends on the image only: reuse the one of the
+    // last run on the same image, if any (the gradients of each level, then
+    // their averages)
+    const char *pyramidName =
+        fftsolver ? "fattal02-gradients-fft" : "fattal02-gradients";
+    uint64_t key = 0;
+    SolverCache::ArraysPtr invariants;
+    if (SolverCache::isEnabled()) {
+        key = SolverCache::fingerprint(Y);
+        invariants = SolverCache::lookup(pyramidName, key);
+    }
 
-    // calculate gradients and its average values on pyramid levels
-    pfs::Array2Df **gradients = new pfs::Array2Df *[nlevels];
-    float avgGrad[nlevels];
-    for (int k = 0; k < nlevels; k++) {
-        gradients[k] = new pfs::Array2Df(pyramids[k]->getCols(), pyramids[k]->getRows());
-        avgGrad[k] = calculateGradients(*pyramids[k], *gradients[k], k);
+    if (!invariants) {
+        std::shared_ptr<SolverCache::Arrays> arrays =
+            std::make_shared<SolverCache::Arrays>();
+        arrays->reserve(nlevels + 1);
+
+        // each level is the previous one blurred by [1 2 1] / 4 and
+        // averaged over 2x2 blocks
+        const GaussianPyramid pyramid(H, nlevels, PYRAMID_BINOMIAL);
+        ph.setValue(8);
+
+        // calculate gradients and its average values on pyramid levels
+        pfs::Array2Df avgGrad(nlevels, 1);
+        for (int k = 0; k < nlevels; k++) {
+            const pfs::Array2Df &level = pyramid.level(k);
+            arrays->push_back(
+                pfs::Array2Df(level.getCols(), level.getRows()));
+            avgGrad(k) = calculateGradients(level, arrays->back(), k);
+        }
+        arrays->push_back(avgGrad);
+
+        invariants = arrays;
+        SolverCache::store(pyramidName, key, invariants);
     }
     ph.setValue(12);
 
     // calculate fi matrix
+    std::vector<const pfs::Array2Df *> gradients(nlevels);
+    for (int k = 0; k < nlevels; k++) {
+        gradients[k] = &(*invariants)[k];
+    }
     pfs::Array2Df FI(width, height);
-    calculateFiMatrix(FI, gradients, avgGrad, nlevels, detail_level, alfa, beta,
-                      noise, newfattal);
+    calculateFiMatrix(FI, gradients.data(), (*invariants)[nlevels].data(),
+                      nlevels, detail_level, alfa, beta, noise, newfattal);
 
-    for (int i = 0; i < nlevels; i++) {
-        if(i != 0) // pyramids[0] is H. Will be deleted later
-            delete pyramids[i];
-        delete gradients[i];
-    }
-    delete[] pyramids;
-    delete[] gradients;
     ph.setValue(16);
     if (ph.canceled()) {
         return;
@@ -492,10 +405,4 @@ void tmo_fattal02(size_t width, size_t height, const pfs::Array2Df &Y,
     }
 
     ph.setValue(96);
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_fattal02 = " << stop_watch.get_time() << " msec" << endl;
-#endif
 }
@@ -41,6 +41,7 @@
 #include <math.h>
 
 #include <cstring>
+#include <vector>
 
 #include <stdlib.h>
 #ifdef _OPENMP
@@ -48,16 +49,14 @@
 #endif
 
 #include <boost/math/constants/constants.hpp>
-#include <boost/thread/mutex.hpp>
 
-#include <Common/init_fftw.h>
+#include <Common/fftw_plans.h>
 #include <Libpfs/array2d.h>
 #include <Libpfs/progress.h>
 #include "Libpfs/rt_algo.h"
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 #include <Libpfs/utils/numeric.h>
 #include <TonemappingOperators/pfstmo.h>
-#include "Common/LuminanceOptions.h"
 #include "tmo_ferradans11.h"
 #include "../../sleef.c"
 #define pow_F(a,b) (xexpf(b*xlogf(a)))
@@ -278,12 +277,8 @@ void fftshift(float a[], int fil, int col) {
 void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
                      float rho, float invalpha, pfs::Progress &ph) {
 
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
-
-    init_fftw();
+    pfs::utils::TraceSpan trace_span(
+        "tmo_ferradans11", 3 * imR.size() * sizeof(float));
 
     int fil = imR.getRows();
     int col = imR.getCols();
@@ -409,79 +404,35 @@ void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
         med[color] = medval(RGB[color], length, false);
     }
 
-    FFTW_MUTEX::fftw_mutex_alloc.lock();
-    float *RGB0 = fftwf_alloc_real(length);
-    float *u0 = fftwf_alloc_real(length);
-    float *u2 = fftwf_alloc_real(length);
-    float *u3 = fftwf_alloc_real(length);
-    float *u4 = fftwf_alloc_real(length);
-    float *u5 = fftwf_alloc_real(length);
-    float *u6 = fftwf_alloc_real(length);
-    float *u7 = fftwf_alloc_real(length);
-    FFTW_MUTEX::fftw_mutex_alloc.unlock();
-
-    FFTW_MUTEX::fftw_mutex_plan.lock();
-    fftwf_complex *U = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-
-    // test for available wisdom
-    fftwf_plan pU = fftwf_plan_dft_r2c_2d(fil, col, u0, U, FFTW_WISDOM_ONLY);
-    if(!pU) {
-        // no wisdom available, load wisdom from file
-        fftwf_import_wisdom_from_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-        // test again for wisdom
-        pU = fftwf_plan_dft_r2c_2d(fil, col, u0, U, FFTW_WISDOM_ONLY);
-        if(!pU) {
-            // build plan with FFTW_MEASURE
-            pU = fftwf_plan_dft_r2c_2d(fil, col, u0, U, FFTW_MEASURE);
-            // save the wisdom
-            fftwf_export_wisdom_to_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-        }
-    }
-
-    fftwf_complex *U2 = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pU2 = fftwf_plan_dft_r2c_2d(fil, col, u2, U2, FFTW_WISDOM_ONLY);
-
-    fftwf_complex *U3 = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pU3 = fftwf_plan_dft_r2c_2d(fil, col, u3, U3, FFTW_WISDOM_ONLY);
-
-    fftwf_complex *U4 = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pU4 = fftwf_plan_dft_r2c_2d(fil, col, u4, U4, FFTW_WISDOM_ONLY);
-
-    fftwf_complex *U5 = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pU5 = fftwf_plan_dft_r2c_2d(fil, col, u5, U5, FFTW_WISDOM_ONLY);
-
-    fftwf_complex *U6 = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pU6 = fftwf_plan_dft_r2c_2d(fil, col, u6, U6, FFTW_WISDOM_ONLY);
-
-    fftwf_complex *U7 = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pU7 = fftwf_plan_dft_r2c_2d(fil, col, u7, U7, FFTW_WISDOM_ONLY);
-
-
-    float *iu = fftwf_alloc_real(length);
-    fftwf_plan pinvU = fftwf_plan_dft_c2r_2d(fil, col, U, iu, FFTW_WISDOM_ONLY);
-    if(!pinvU) {
-        // no wisdom available. Makes no sense to load wisdom from file because we just did that a few lines above.
-        // build plan with FFTW_MEASURE
-        pinvU = fftwf_plan_dft_c2r_2d(fil, col, U, iu, FFTW_MEASURE);
-        // save the wisdom
-        fftwf_export_wisdom_to_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
+    // powers 1 to POWERS of the channel, their transforms and the inverse
+    // transform of the first one. Buffers come from the pool of FftwBuffer,
+    // hence all have the alignment the shared plans are built for
+    const int POWERS = 7;
+    const int spectrum = fil * (col / 2 + 1);
+    FftwBuffer RGB0buffer = FftwBuffer::allocReal(length);
+    FftwBuffer iuBuffer = FftwBuffer::allocReal(length);
+    std::vector<FftwBuffer> uBuffers;
+    std::vector<FftwBuffer> UBuffers;
+    float *u[POWERS];
+    fftwf_complex *U[POWERS];
+    for (int k = 0; k < POWERS; k++) {
+        uBuffers.push_back(FftwBuffer::allocReal(length));
+        UBuffers.push_back(FftwBuffer::allocComplex(spectrum));
+        u[k] = uBuffers.back().real();
+        U[k] = UBuffers.back().complex();
     }
+    float *RGB0 = RGB0buffer.real();
+    float *u0 = u[0];
+    float *iu = iuBuffer.real();
 
-    fftwf_plan pinvU2 = fftwf_plan_dft_c2r_2d(fil, col, U2, u2, FFTW_WISDOM_ONLY);
-
-    fftwf_plan pinvU3 = fftwf_plan_dft_c2r_2d(fil, col, U3, u3, FFTW_WISDOM_ONLY);
-
-    fftwf_plan pinvU4 = fftwf_plan_dft_c2r_2d(fil, col, U4, u4, FFTW_WISDOM_ONLY);
-
-    fftwf_plan pinvU5 = fftwf_plan_dft_c2r_2d(fil, col, U5, u5, FFTW_WISDOM_ONLY);
-
-    fftwf_plan pinvU6 = fftwf_plan_dft_c2r_2d(fil, col, U6, u6, FFTW_WISDOM_ONLY);
-
-    fftwf_plan pinvU7 = fftwf_plan_dft_c2r_2d(fil, col, U7, u7, FFTW_WISDOM_ONLY);
+    const FftwPlans::Plan forward =
+        FftwPlans::get(FftwPlans::R2C_2D, fil, col, u0, U[0]);
+    const FftwPlans::Plan backward =
+        FftwPlans::get(FftwPlans::C2R_2D, fil, col, U[0], iu);
 
     float alpha = min(col, fil) / invalpha;
-    float *g = fftwf_alloc_real(length);
-    FFTW_MUTEX::fftw_mutex_plan.unlock();
+    FftwBuffer gBuffer = FftwBuffer::allocReal(length);
+    float *g = gBuffer.real();
 
     nucleo_gaussiano(g, fil, col, alpha);
     escala(g, length, 1.f, 0.f);
@@ -493,17 +444,9 @@ void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
     float w = (1.0f / suma);
     vsmul(g, w, g, length);
 
-    FFTW_MUTEX::fftw_mutex_plan.lock();
-    fftwf_complex *G =
-        (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * length);
-    fftwf_plan pG = fftwf_plan_dft_r2c_2d(fil, col, g, G, FFTW_WISDOM_ONLY);
-    FFTW_MUTEX::fftw_mutex_plan.unlock();
-    fftwf_execute(pG);
-    FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-    fftwf_destroy_plan(pG);
-
-    fftwf_free(g);
-    FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
+    FftwBuffer GBuffer = FftwBuffer::allocComplex(spectrum);
+    fftwf_complex *G = GBuffer.complex();
+    fftwf_execute_dft_r2c(forward.get(), g, G);
 
     ph.setValue(30);
     if (ph.canceled()) {
@@ -513,43 +456,6 @@ void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
         delete[] RGB[0];
         delete[] RGB[1];
         delete[] RGB[2];
-        FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-        fftwf_destroy_plan(pU);
-        fftwf_destroy_plan(pU2);
-        fftwf_destroy_plan(pU3);
-        fftwf_destroy_plan(pU4);
-        fftwf_destroy_plan(pU5);
-        fftwf_destroy_plan(pU6);
-        fftwf_destroy_plan(pU7);
-
-        fftwf_destroy_plan(pinvU);
-        fftwf_destroy_plan(pinvU2);
-        fftwf_destroy_plan(pinvU3);
-        fftwf_destroy_plan(pinvU4);
-        fftwf_destroy_plan(pinvU5);
-        fftwf_destroy_plan(pinvU6);
-        fftwf_destroy_plan(pinvU7);
-
-        fftwf_free(RGB0);
-        fftwf_free(u0);
-        fftwf_free(u2);
-        fftwf_free(u3);
-        fftwf_free(u4);
-        fftwf_free(u5);
-        fftwf_free(u6);
-        fftwf_free(u7);
-
-        fftwf_free(iu);
-
-        fftwf_free(U);
-        fftwf_free(U2);
-        fftwf_free(U3);
-        fftwf_free(U4);
-        fftwf_free(U5);
-        fftwf_free(U6);
-        fftwf_free(U7);
-
-        FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
         return;
     }
     float delta = 0.f, oldDifference = 0.f;
@@ -567,46 +473,26 @@ void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
             copy(RGB[color], RGB[color] + length, u0);
             copy(RGB[color], RGB[color] + length, RGB0);
 
-            transform(u0, u0 + length, u0, u2, multiplies<float>());
-            transform(u2, u2 + length, u0, u3, multiplies<float>());
-            transform(u3, u3 + length, u0, u4, multiplies<float>());
-            transform(u4, u4 + length, u0, u5, multiplies<float>());
-            transform(u5, u5 + length, u0, u6, multiplies<float>());
-            transform(u6, u6 + length, u0, u7, multiplies<float>());
-
-            fftwf_execute(pU);
-            producto(U, G, fil, col);
-            fftwf_execute(pinvU);
-
-            fftwf_execute(pU2);
-            producto(U2, G, fil, col);
-            fftwf_execute(pinvU2);
-
-            fftwf_execute(pU3);
-            producto(U3, G, fil, col);
-            fftwf_execute(pinvU3);
-
-            fftwf_execute(pU4);
-            producto(U4, G, fil, col);
-            fftwf_execute(pinvU4);
-
-            fftwf_execute(pU5);
-            producto(U5, G, fil, col);
-            fftwf_execute(pinvU5);
-
-            fftwf_execute(pU6);
-            producto(U6, G, fil, col);
-            fftwf_execute(pinvU6);
+            for (int k = 1; k < POWERS; k++) {
+                transform(u[k - 1], u[k - 1] + length, u0, u[k],
+                          multiplies<float>());
+            }
 
-            fftwf_execute(pU7);
-            producto(U7, G, fil, col);
-            fftwf_execute(pinvU7);
+            // the inverse transform of the channel goes to iu, u0 is still
+            // needed; the transforms of the higher powers replace them
+            for (int k = 0; k < POWERS; k++) {
+                fftwf_execute_dft_r2c(forward.get(), u[k], U[k]);
+                producto(U[k], G, fil, col / 2 + 1);
+                fftwf_execute_dft_c2r(backward.get(), U[k], k ? u[k] : iu);
+            }
 
 #pragma omp parallel for
             for (int i = 0; i < length; i++) {
                 // compute contrast component
-                u0[i] = apply_arctg_slope10(u0[i], norm * iu[i], norm * u2[i], norm * u3[i],
-                                            norm * u4[i], norm * u5[i], norm * u6[i], norm * u7[i]);
+                u0[i] = apply_arctg_slope10(u0[i], norm * iu[i], norm * u[1][i],
+                                            norm * u[2][i], norm * u[3][i],
+                                            norm * u[4][i], norm * u[5][i],
+                                            norm * u[6][i]);
 
                 // project onto the interval [-1,1]
                 u0[i] = max(min(u0[i], 1.f), -1.f);
@@ -636,44 +522,6 @@ void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
         if (iteration > 1) ph.setValue(30 + 69 / (steps + 1));
     }
 
-    FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-    fftwf_destroy_plan(pU);
-    fftwf_destroy_plan(pU2);
-    fftwf_destroy_plan(pU3);
-    fftwf_destroy_plan(pU4);
-    fftwf_destroy_plan(pU5);
-    fftwf_destroy_plan(pU6);
-    fftwf_destroy_plan(pU7);
-
-    fftwf_destroy_plan(pinvU);
-    fftwf_destroy_plan(pinvU2);
-    fftwf_destroy_plan(pinvU3);
-    fftwf_destroy_plan(pinvU4);
-    fftwf_destroy_plan(pinvU5);
-    fftwf_destroy_plan(pinvU6);
-    fftwf_destroy_plan(pinvU7);
-
-    fftwf_free(RGB0);
-    fftwf_free(u0);
-    fftwf_free(u2);
-    fftwf_free(u3);
-    fftwf_free(u4);
-    fftwf_free(u5);
-    fftwf_free(u6);
-    fftwf_free(u7);
-
-    fftwf_free(iu);
-
-    fftwf_free(U);
-    fftwf_free(U2);
-    fftwf_free(U3);
-    fftwf_free(U4);
-    fftwf_free(U5);
-    fftwf_free(U6);
-    fftwf_free(U7);
-
-    FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
-
     ph.setValue(90);
 
     for (int c = 0; c < 3; c++)
@@ -690,12 +538,4 @@ void tmo_ferradans11(pfs::Array2Df &imR, pfs::Array2Df &imG, pfs::Array2Df &imB,
     delete[] RGB[0];
     delete[] RGB[1];
     delete[] RGB[2];
-    FFTW_MUTEX::fftw_mutex_free.lock();
-    fftwf_free(G);
-    FFTW_MUTEX::fftw_mutex_free.unlock();
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_ferradans11 = " << stop_watch.get_time() << " msec" << endl;
-#endif
 }
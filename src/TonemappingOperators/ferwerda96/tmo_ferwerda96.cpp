@@ -34,7 +34,7 @@
 #include "Libpfs/array2d.h"
 #include "Libpfs/frame.h"
 #include "Libpfs/progress.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "tmo_ferwerda96.h"
 
 namespace {
@@ -86,10 +86,8 @@ using namespace std;
 int tmo_ferwerda96(Array2Df *X, Array2Df *Y, Array2Df *Z, Array2Df *L,
                     float mul1, float mul2,
                     Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_ferwerda96", 3 * X->size() * sizeof(float));
     assert(X != NULL);
     assert(Y != NULL);
     assert(Z != NULL);
@@ -131,11 +129,5 @@ int tmo_ferwerda96(Array2Df *X, Array2Df *Y, Array2Df *Z, Array2Df *L,
                   [mC, mR, k, vec, c, scale](float a, float L) { return (mC * a + vec[c] * mR * k * L) * scale; } );
     }
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_ferwerda96 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
     return 0;
 }
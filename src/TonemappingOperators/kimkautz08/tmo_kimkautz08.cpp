@@ -40,7 +40,7 @@
 #include "Libpfs/progress.h"
 #include "Libpfs/rt_algo.h"
 #include <Libpfs/colorspace/normalizer.h>
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "tmo_kimkautz08.h"
 #include "sleef.c"
 #include "opthelper.h"
@@ -52,10 +52,8 @@ using namespace pfs::colorspace;
 int tmo_kimkautz08(Array2Df &L,
                     float KK_c1, float KK_c2,
                     Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_kimkautz08", L.size() * sizeof(float));
 
     ph.setValue(5);
 
@@ -219,11 +217,5 @@ int tmo_kimkautz08(Array2Df &L,
 
     ph.setValue(99);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_kimkautz08 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
     return 0;
 }
@@ -37,130 +37,520 @@
  *
  */
 
-#include <Eigen/Sparse>
-#include <Eigen/src/SparseCore/SparseMatrix.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
-#include "Libpfs/exception.h"
+#include "Libpfs/array2d.h"
 #include "Libpfs/manip/resize.h"
+#include "Libpfs/utils/dotproduct.h"
+#include "Libpfs/utils/numeric.h"
+#include "Libpfs/utils/trace.h"
 #include "lischinski_minimization.h"
-#include "sleef.c"
-#include "opthelper.h"
+
+#ifndef NDEBUG
+#include <iostream>
+#define PRINT_DEBUG(str) std::cerr << "lischinski06: " << str << std::endl
+#else
+#define PRINT_DEBUG(str)
+#endif
 
 using namespace std;
 using namespace pfs;
 
-inline float LischinskiFunction(float Lcur, float Lref, float param[2],
-                                float LISCHINSKI_EPSILON = 0.0001f) {
-    return -param[1] / (powf(fabsf(Lcur - Lref), param[0]) + LISCHINSKI_EPSILON);
+namespace {
+//! \brief relative residual at which the conjugate gradient stops
+const float TOLERANCE = 1e-3f;
+const int MAX_ITERATIONS = 200;
+//! \brief the multigrid stops coarsening at this size
+const int COARSEST_SIZE = 8;
+//! \brief symmetric Gauss-Seidel sweeps on the coarsest level
+const int COARSE_SWEEPS = 20;
+//! \brief width of the range kernel of the upsampling, in stops
+const float UPSAMPLE_SIGMA = 0.5f;
+
+//! \brief A = omega I + sum over the edges ij of w_ij (e_i - e_j)(e_i - e_j)^T,
+//! the system of the minimization, and its Galerkin coarsenings
+struct Level {
+    Level(size_t cols, size_t rows)
+        : wx(cols, rows), wy(cols, rows), diag(cols, rows) {}
+
+    //! \brief weight of the edge to the right and below of each node, zero
+    //! on the last column and row
+    Array2Df wx;
+    Array2Df wy;
+    Array2Df diag;
+
+    //! \brief right hand side, solution and residual of the V-cycle, the
+    //! ones of the finest level are the conjugate gradient's
+    Array2Df r;
+    Array2Df z;
+    Array2Df t;
+};
+
+//! \brief sum of w_ij x_j over the neighbours j of the node (k, y)
+inline float neighbours(const Level &A, const Array2Df &x, int k, int y) {
+    const int cols = x.getCols();
+    const int rows = x.getRows();
+    float s = 0.f;
+    if (k + 1 < cols) s += A.wx(k, y) * x(k + 1, y);
+    if (k > 0) s += A.wx(k - 1, y) * x(k - 1, y);
+    if (y + 1 < rows) s += A.wy(k, y) * x(k, y + 1);
+    if (y > 0) s += A.wy(k, y - 1) * x(k, y - 1);
+    return s;
+}
+
+//! \brief out = A x
+void multiplyA(const Level &A, const Array2Df &x, Array2Df &out) {
+    const int cols = x.getCols();
+    const int rows = x.getRows();
+
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        if (y == 0 || y + 1 == rows || cols < 3) {
+            for (int k = 0; k < cols; ++k) {
+                out(k, y) = A.diag(k, y) * x(k, y) - neighbours(A, x, k, y);
+            }
+            continue;
+        }
+        // inner nodes have the four neighbours
+        const float *xr = x.data() + y * cols;
+        const float *wx = A.wx.data() + y * cols;
+        const float *wy = A.wy.data() + y * cols;
+        const float *diag = A.diag.data() + y * cols;
+        float *o = out.data() + y * cols;
+        o[0] = diag[0] * xr[0] - neighbours(A, x, 0, y);
+        for (int k = 1; k < cols - 1; ++k) {
+            o[k] = diag[k] * xr[k] - wx[k] * xr[k + 1] - wx[k - 1] * xr[k - 1] -
+                   wy[k] * xr[k + cols] - wy[k - cols] * xr[k - cols];
+        }
+        o[cols - 1] = diag[cols - 1] * xr[cols - 1] -
+                      neighbours(A, x, cols - 1, y);
+    }
 }
 
-void LischinskiMinimization(Array2Df &L_orig, Array2Df &g_orig, Array2Df &F,
-                            float alpha, float lambda, float LISCHINSKI_EPSILON, float omega) {
+//! \brief red-black Gauss-Seidel sweep on A z = r: red nodes first if
+//! \a redFirst, black nodes first otherwise, so that the two orders are
+//! the adjoint of each other
+void gaussSeidel(const Level &A, const Array2Df &r, Array2Df &z,
+                 bool redFirst) {
+    const int cols = z.getCols();
+    const int rows = z.getRows();
 
-    const int orig_width = L_orig.getCols();
-    const int orig_height = L_orig.getRows();
+    for (int color = 0; color < 2; ++color) {
+        const int parity = redFirst ? color : 1 - color;
+#pragma omp parallel for
+        for (int y = 0; y < rows; ++y) {
+            const int first = (y + parity) & 1;
+            if (y == 0 || y + 1 == rows || cols < 3) {
+                for (int k = first; k < cols; k += 2) {
+                    z(k, y) = (r(k, y) + neighbours(A, z, k, y)) /
+                              A.diag(k, y);
+                }
+                continue;
+            }
+            float *zr = z.data() + y * cols;
+            const float *rr = r.data() + y * cols;
+            const float *wx = A.wx.data() + y * cols;
+            const float *wy = A.wy.data() + y * cols;
+            const float *diag = A.diag.data() + y * cols;
+            int k = first;
+            if (k == 0) {
+                zr[0] = (rr[0] + neighbours(A, z, 0, y)) / diag[0];
+                k = 2;
+            }
+            for (; k < cols - 1; k += 2) {
+                zr[k] = (rr[k] + wx[k] * zr[k + 1] + wx[k - 1] * zr[k - 1] +
+                         wy[k] * zr[k + cols] + wy[k - cols] * zr[k - cols]) /
+                        diag[k];
+            }
+            if (k == cols - 1) {
+                zr[k] = (rr[k] + neighbours(A, z, k, y)) / diag[k];
+            }
+        }
+    }
+}
 
-    int xSize = 512;
+//! \brief P^T A P, with P the prolongation that copies each node of the
+//! coarse level to a 2x2 block: an edge between two blocks weighs the sum
+//! of the edges that cross it, and the edges inside a block drop out
+void coarsen(const Level &fine, Level &coarse) {
+    const int fineCols = fine.diag.getCols();
+    const int fineRows = fine.diag.getRows();
+    const int cols = coarse.diag.getCols();
+    const int rows = coarse.diag.getRows();
 
-    if (orig_width < 2*xSize)
-        xSize = 256;
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            float wx = 0.f;
+            float wy = 0.f;
+            float diag = 0.f;
+            for (int fy = 2 * y; fy < std::min(2 * y + 2, fineRows); ++fy) {
+                for (int fx = 2 * x; fx < std::min(2 * x + 2, fineCols);
+                     ++fx) {
+                    diag += fine.diag(fx, fy);
+                    if (fx == 2 * x) {
+                        diag -= 2.f * fine.wx(fx, fy);
+                    } else {
+                        wx += fine.wx(fx, fy);
+                    }
+                    if (fy == 2 * y) {
+                        diag -= 2.f * fine.wy(fx, fy);
+                    } else {
+                        wy += fine.wy(fx, fy);
+                    }
+                }
+            }
+            coarse.wx(x, y) = wx;
+            coarse.wy(x, y) = wy;
+            coarse.diag(x, y) = diag;
+        }
+    }
+}
 
-    const int width = xSize;
-    const int height = (int)(orig_height * (float)xSize /
-                      (float)orig_width);
+//! \brief coarse = P^T fine, the sum of each 2x2 block
+void restrictSum(const Array2Df &fine, Array2Df &coarse) {
+    const int fineCols = fine.getCols();
+    const int fineRows = fine.getRows();
+    const int cols = coarse.getCols();
+    const int rows = coarse.getRows();
 
-    const int size = height * width;
-    Array2Df L(width, height);
-    Array2Df g(width, height);
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            float s = 0.f;
+            for (int fy = 2 * y; fy < std::min(2 * y + 2, fineRows); ++fy) {
+                for (int fx = 2 * x; fx < std::min(2 * x + 2, fineCols);
+                     ++fx) {
+                    s += fine(fx, fy);
+                }
+            }
+            coarse(x, y) = s;
+        }
+    }
+}
 
-    resize(&L_orig, &L, BilinearInterp);
-    resize(&g_orig, &g, BilinearInterp);
+//! \brief fine += P coarse
+void prolongAdd(const Array2Df &coarse, Array2Df &fine) {
+    const int cols = fine.getCols();
+    const int rows = fine.getRows();
 
-    Eigen::VectorXf b, x;
-    b = Eigen::VectorXf::Zero(size);
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            fine(x, y) += coarse(x / 2, y / 2);
+        }
+    }
+}
 
-    std::vector< Eigen::Triplet< float > > tL;
+//! \brief Conjugate gradient on A x = b, preconditioned by a symmetric
+//! V-cycle over the aggregation (2x2 blocks) of the nodes of A
+class Solver {
+   public:
+    //! \brief A of the minimization over \a L, with the weights of the edges
+    //! multiplied by \a scale
+    Solver(const Array2Df &L, float alpha, float lambda, float epsilon,
+           float omega, float scale);
 
-    float param[2];
-    param[0] = alpha;
-    param[1] = lambda;
+    //! \brief solve A x = omega g, x may be g
+    //! \return the number of iterations
+    int solve(const Array2Df &g, Array2Df &x);
 
-    for(int i = 0; i < height; i++) {
-        int tmpInd = i * width;
+    //! \brief relative residual of the last solve
+    float residual() const { return m_residual; }
+    //! \brief bytes held by the solver
+    size_t bytes() const;
 
-        for(int j = 0; j < width; j++) {
+   private:
+    //! \brief conjugate gradient on A_level x = r, r is left with the
+    //! residual
+    //! \return the number of iterations
+    int pcg(size_t level, Array2Df &r, Array2Df &x);
 
-            float sum = 0.0;
-            float tmp;
-            int indJ;
-            int indI = tmpInd + j;
-            float Lref = L(indI);
+    void vcycle(size_t level, const Array2Df &r, Array2Df &z, Array2Df &t);
 
-            b[indI] = omega * g(indI);
+    float m_omega;
+    float m_residual;
+    std::vector<Level> m_levels;
+};
 
-            if((i - 1) >= 0) {
-                indJ = indI - width;
-                tmp = LischinskiFunction(L(indJ), Lref, param, LISCHINSKI_EPSILON);
-                tL.push_back(Eigen::Triplet< float > (indI, indJ, tmp));
-                sum += tmp;
-            }
+Solver::Solver(const Array2Df &L, float alpha, float lambda, float epsilon,
+               float omega, float scale)
+    : m_omega(omega), m_residual(0.f) {
+    const int cols = L.getCols();
+    const int rows = L.getRows();
 
-            if((i + 1) < height) {
-                indJ = indI + width;
-                tmp = LischinskiFunction(L(indJ), Lref, param, LISCHINSKI_EPSILON);
-                tL.push_back(Eigen::Triplet< float > (indI, indJ, tmp));
+    m_levels.emplace_back(cols, rows);
+    Level &A = m_levels.front();
 
-                sum += tmp;
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            float wx = 0.f;
+            float wy = 0.f;
+            if (x + 1 < cols) {
+                const float d = std::fabs(L(x + 1, y) - L(x, y));
+                wx = scale * lambda /
+                     ((alpha == 1.f ? d : std::pow(d, alpha)) + epsilon);
             }
-
-            if((j - 1) >= 0) {
-                indJ = indI - 1;
-                tmp = LischinskiFunction(L(indJ), Lref, param, LISCHINSKI_EPSILON);
-                tL.push_back(Eigen::Triplet< float > (indI, indJ, tmp));
-                sum += tmp;
+            if (y + 1 < rows) {
+                const float d = std::fabs(L(x, y + 1) - L(x, y));
+                wy = scale * lambda /
+                     ((alpha == 1.f ? d : std::pow(d, alpha)) + epsilon);
             }
+            A.wx(x, y) = wx;
+            A.wy(x, y) = wy;
+        }
+    }
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            float d = omega + A.wx(x, y) + A.wy(x, y);
+            if (x > 0) d += A.wx(x - 1, y);
+            if (y > 0) d += A.wy(x, y - 1);
+            A.diag(x, y) = d;
+        }
+    }
 
-            if((j + 1) < width) {
-                indJ = indI + 1;
-                tmp = LischinskiFunction(L(indJ), Lref, param, LISCHINSKI_EPSILON);
-                tL.push_back(Eigen::Triplet< float > (indI, indJ, tmp));
-                sum += tmp;
-            }
+    for (size_t c = cols, r = rows; c > COARSEST_SIZE || r > COARSEST_SIZE;) {
+        c = (c + 1) / 2;
+        r = (r + 1) / 2;
+        m_levels.emplace_back(c, r);
+        Level &coarse = m_levels.back();
+        coarsen(m_levels[m_levels.size() - 2], coarse);
+        coarse.r.resize(c, r);
+        coarse.z.resize(c, r);
+        coarse.t.resize(c, r);
+    }
+}
 
-            tL.push_back(Eigen::Triplet< float >{indI, indI, omega - sum});
+size_t Solver::bytes() const {
+    size_t floats = 0;
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        const Level &l = m_levels[i];
+        floats += 3 * l.diag.size() + l.r.size() + l.z.size() + l.t.size();
+    }
+    // r, z, p and Ap of the conjugate gradient
+    floats += 4 * m_levels.front().diag.size();
+    return floats * sizeof(float);
+}
+
+void Solver::vcycle(size_t level, const Array2Df &r, Array2Df &z,
+                    Array2Df &t) {
+    const Level &A = m_levels[level];
+
+    z.fill(0.f);
+    if (level + 1 == m_levels.size()) {
+        for (int i = 0; i < COARSE_SWEEPS; ++i) {
+            gaussSeidel(A, r, z, true);
+            gaussSeidel(A, r, z, false);
         }
+        return;
+    }
+
+    gaussSeidel(A, r, z, true);
+
+    // t = r - A z
+    multiplyA(A, z, t);
+    utils::vsub(r.data(), t.data(), t.data(), t.size());
+
+    Level &coarse = m_levels[level + 1];
+    restrictSum(t, coarse.r);
+    vcycle(level + 1, coarse.r, coarse.z, coarse.t);
+    prolongAdd(coarse.z, z);
+
+    gaussSeidel(A, r, z, false);
+}
+
+int Solver::solve(const Array2Df &g, Array2Df &x) {
+    // r = b = omega g
+    Array2Df r(g.getCols(), g.getRows());
+    utils::vsmul(g.data(), m_omega, r.data(), r.size());
+
+    const float bnrm2 = utils::dotProduct(r.data(), r.size());
+    const int iter = pcg(0, r, x);
+
+    m_residual =
+        bnrm2 > 0.f ? std::sqrt(utils::dotProduct(r.data(), r.size()) / bnrm2)
+                    : 0.f;
+    // callers get the residual through LischinskiStats
+    if (m_residual > TOLERANCE) {
+        PRINT_DEBUG("not converged, error = " << m_residual
+                                              << " (should be below "
+                                              << TOLERANCE << ")");
     }
+    return iter;
+}
 
-    Eigen::SparseMatrix<float> A = Eigen::SparseMatrix<float>(size, size);
-    A.setFromTriplets(tL.begin(), tL.end());
+int Solver::pcg(size_t level, Array2Df &r, Array2Df &x) {
+    const Level &A = m_levels[level];
+    const size_t cols = r.getCols();
+    const size_t rows = r.getRows();
+    const size_t n = cols * rows;
 
-    Eigen::SimplicialCholesky<Eigen::SparseMatrix<float> > solver(A);
-    x = solver.solve(b);
+    const float bnrm2 = utils::dotProduct(r.data(), n);
+    const float tol2 = TOLERANCE * TOLERANCE * bnrm2;
 
-    if(solver.info() != Eigen::Success) {
-        #ifndef NDDEBUG
-            printf("SOLVER FAILED!\n");
-        #endif
-        throw pfs::Exception("SOLVER FAILED");
+    // start from the solution of the next level, prolonged: the conjugate
+    // gradient is then left with the details of this level
+    x.fill(0.f);
+    if (level + 1 < m_levels.size()) {
+        const Level &coarse = m_levels[level + 1];
+        Array2Df coarseR(coarse.diag.getCols(), coarse.diag.getRows());
+        Array2Df coarseX(coarse.diag.getCols(), coarse.diag.getRows());
+        restrictSum(r, coarseR);
+        pcg(level + 1, coarseR, coarseX);
+        prolongAdd(coarseX, x);
     }
 
-    Array2Df F_res(width, height);
+    Array2Df z(cols, rows);
+    Array2Df p(cols, rows);
+    Array2Df Ap(cols, rows);
 
-#ifdef _OPENMP
-    #pragma omp parallel for
-#endif
-    for (int i = 0; i < height; ++i) {
-        int j = 0;
-        int counter = i * width;
-#ifdef __SSE2__
-        for (; j < width - 3; j += 4) {
-             STVFU(F_res(j, i), LVFU(x(counter + j)));
+    // r = b - A x
+    multiplyA(A, x, Ap);
+    utils::vsub(r.data(), Ap.data(), r.data(), n);
+
+    // Ap is free outside of the product: it is the scratch of the V-cycle
+    vcycle(level, r, z, Ap);
+    std::copy(z.begin(), z.end(), p.begin());
+    float rdotz = utils::dotProduct(r.data(), z.data(), n);
+    float rdotr = utils::dotProduct(r.data(), n);
+
+    int iter = 0;
+    for (; iter < MAX_ITERATIONS && rdotr > tol2; ++iter) {
+        multiplyA(A, p, Ap);
+        const float alpha = rdotz / utils::dotProduct(p.data(), Ap.data(), n);
+
+        utils::vadds(x.data(), alpha, p.data(), x.data(), n);
+        utils::vsubs(r.data(), alpha, Ap.data(), r.data(), n);
+        rdotr = utils::dotProduct(r.data(), n);
+
+        vcycle(level, r, z, Ap);
+        const float rdotzPrev = rdotz;
+        rdotz = utils::dotProduct(r.data(), z.data(), n);
+
+        // p = z + beta p
+        utils::vadds(z.data(), rdotz / rdotzPrev, p.data(), p.data(), n);
+    }
+    return iter;
+}
+
+//! \brief F = joint bilateral upsampling of \a lowF, guided by \a L at full
+//! resolution and \a lowL at the resolution of \a lowF. F may be L.
+void upsample(const Array2Df &lowF, const Array2Df &lowL, const Array2Df &L,
+              Array2Df &F) {
+    const int lowCols = lowF.getCols();
+    const int lowRows = lowF.getRows();
+    const int cols = L.getCols();
+    const int rows = L.getRows();
+    const float sx = float(lowCols) / cols;
+    const float sy = float(lowRows) / rows;
+    const float invLog2 = 1.f / std::log(2.f);
+    const float rangeScale = -0.5f / (UPSAMPLE_SIGMA * UPSAMPLE_SIGMA);
+
+    // stops of the guide at low resolution
+    Array2Df lowStops(lowCols, lowRows);
+#pragma omp parallel for
+    for (int y = 0; y < lowRows; ++y) {
+        for (int x = 0; x < lowCols; ++x) {
+            lowStops(x, y) = std::log(lowL(x, y) + 1e-6f) * invLog2;
         }
-#endif
-        for (; j < width; ++j) {
-            F_res(j, i) =  x(counter + j);
+    }
+
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        const float v = (y + 0.5f) * sy - 0.5f;
+        const int y0 = int(std::floor(v));
+        for (int x = 0; x < cols; ++x) {
+            const float u = (x + 0.5f) * sx - 0.5f;
+            const int x0 = int(std::floor(u));
+            const float stops = std::log(L(x, y) + 1e-6f) * invLog2;
+
+            // 4x4 taps around (u, v): gaussian of one low resolution pixel
+            // in space, of UPSAMPLE_SIGMA stops in range
+            float sum = 0.f;
+            float weights = 0.f;
+            float nearest = 0.f;
+            float nearestDist = 1e30f;
+            for (int j = y0 - 1; j <= y0 + 2; ++j) {
+                const int ly = std::min(std::max(j, 0), lowRows - 1);
+                const float dy = j - v;
+                for (int i = x0 - 1; i <= x0 + 2; ++i) {
+                    const int lx = std::min(std::max(i, 0), lowCols - 1);
+                    const float dx = i - u;
+                    const float dr = stops - lowStops(lx, ly);
+                    const float w = std::exp(-0.5f * (dx * dx + dy * dy) +
+                                             rangeScale * dr * dr);
+                    sum += w * lowF(lx, ly);
+                    weights += w;
+                    if (dx * dx + dy * dy < nearestDist) {
+                        nearestDist = dx * dx + dy * dy;
+                        nearest = lowF(lx, ly);
+                    }
+                }
+            }
+            // no neighbour in range: a detail smaller than a low resolution
+            // pixel takes the exposure of the nearest one
+            F(x, y) = weights > 1e-20f ? sum / weights : nearest;
         }
     }
+}
+}
+
+void LischinskiMinimization(Array2Df &L, Array2Df &g, Array2Df &F,
+                            float alpha, float lambda,
+                            float LISCHINSKI_EPSILON, float omega,
+                            size_t maxPixels, LischinskiStats *stats) {
+    pfs::utils::TraceSpan trace_span("LischinskiMinimization");
+
+    const size_t orig_width = L.getCols();
+    const size_t orig_height = L.getRows();
+
+    // the weights of the edges are defined at a reference width of 256 or
+    // 512 pixels: scale them by the square of the zoom, so that the
+    // exposure map is as smooth at any resolution
+    const float xSize = orig_width < 1024 ? 256.f : 512.f;
+
+    size_t width = orig_width;
+    size_t height = orig_height;
+    if (width * height > maxPixels) {
+        const double zoom =
+            std::sqrt(double(maxPixels) / (orig_width * orig_height));
+        width = std::max<size_t>(1, size_t(orig_width * zoom));
+        height = std::max<size_t>(1, size_t(orig_height * zoom));
+    }
+    const float scale = (width / xSize) * (width / xSize);
+
+    int iterations;
+    size_t bytes;
+    float residual;
+    if (width == orig_width && height == orig_height) {
+        Solver solver(L, alpha, lambda, LISCHINSKI_EPSILON, omega, scale);
+        // L is not needed after the solver is built: F may be L
+        iterations = solver.solve(g, F);
+        bytes = solver.bytes();
+        residual = solver.residual();
+    } else {
+        Array2Df lowL(width, height);
+        Array2Df lowF(width, height);
+        resize(&L, &lowL, BilinearInterp);
+        resize(&g, &lowF, BilinearInterp);
 
-    resize(&F_res, &F, BilinearInterp);
+        Solver solver(lowL, alpha, lambda, LISCHINSKI_EPSILON, omega, scale);
+        iterations = solver.solve(lowF, lowF);
+        upsample(lowF, lowL, L, F);
+        bytes = solver.bytes() + 3 * lowF.size() * sizeof(float);
+        residual = solver.residual();
+    }
+
+    trace_span.setBytes(bytes);
+    if (stats) {
+        stats->width = width;
+        stats->height = height;
+        stats->iterations = iterations;
+        stats->residual = residual;
+        stats->bytes = bytes;
+    }
 }
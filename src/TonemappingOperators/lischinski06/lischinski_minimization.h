@@ -40,14 +40,38 @@
 #ifndef LISCHINSKI_MINIMIZATION_H
 #define LISCHINSKI_MINIMIZATION_H
 
+#include <cstddef>
+
 #include "Libpfs/array2d_fwd.h"
 
+//! \brief the minimization runs at full resolution up to this many pixels
+//! (about 36 bytes each), larger images are solved at this size and the
+//! exposure map is upsampled guided by the luminance
+const size_t LISCHINSKI_MAX_SOLVE_PIXELS = 8 * 1024 * 1024;
+
+//! \brief statistics of a minimization
+struct LischinskiStats {
+    //! \brief resolution of the solve
+    size_t width;
+    size_t height;
+    int iterations;
+    //! \brief relative residual of the solution
+    float residual;
+    //! \brief memory of the solver
+    size_t bytes;
+};
+
+//! \brief F = exposure map that minimizes the distance to the target
+//! exposure g, smooth except across the edges of the luminance L
+//! \note F has the size of L and may be L or g
 void LischinskiMinimization(pfs::Array2Df &L,
                             pfs::Array2Df &g,
                             pfs::Array2Df &F,
                             float alpha = 1.0f,
                             float lambda = 0.4f,
                             float LISCHINSKI_EPSILON = 1e-4f,
-                            float omega = 0.07f);
+                            float omega = 0.07f,
+                            size_t maxPixels = LISCHINSKI_MAX_SOLVE_PIXELS,
+                            LischinskiStats *stats = NULL);
 
 #endif // LISCHINSKI_MINIMIZATION_H
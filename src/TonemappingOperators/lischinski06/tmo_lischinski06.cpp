@@ -42,7 +42,7 @@
 #include "Libpfs/array2d.h"
 #include "Libpfs/progress.h"
 #include "Libpfs/rt_algo.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "tmo_lischinski06.h"
 #include "lischinski_minimization.h"
 #include "sleef.c"
@@ -106,10 +106,8 @@ float LogMeanVal(const Array2Df &L) {
 int tmo_lischinski06(Array2Df &L,Array2Df &inX, Array2Df &inY, Array2Df &inZ,
                      const float alpha_mul,
                      Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_lischinski06", 3 * inX.size() * sizeof(float));
 
     ph.setValue(5);
 
@@ -268,11 +266,5 @@ int tmo_lischinski06(Array2Df &L,Array2Df &inX, Array2Df &inY, Array2Df &inZ,
 
     ph.setValue(99);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_lischinski06 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
     return 0;
 }
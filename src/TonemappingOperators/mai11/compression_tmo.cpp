@@ -42,7 +42,7 @@
 #include <algorithm>
 #include <iostream>
 
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "compression_tmo.h"
 
 #ifdef BRANCH_PREDICTION
@@ -193,10 +193,8 @@ void CompressionTMO::tonemap(const float *R_in, const float *G_in, float *B_in,
                              size_t width, size_t height, float *R_out, float *G_out,
                              float *B_out, const float *L_in,
                              pfs::Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_mai11", 3 * width * height * sizeof(float));
     const size_t pix_count = width * height;
 
     ph.setValue(2);
@@ -293,12 +291,5 @@ void CompressionTMO::tonemap(const float *R_in, const float *G_in, float *B_in,
     ph.setValue(99);
     delete[] s;
     delete[] logL;
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    std::cout << std::endl;
-    std::cout << "tmo_mai11 = " << stop_watch.get_time() << " msec"
-              << std::endl;
-#endif
 }
 }
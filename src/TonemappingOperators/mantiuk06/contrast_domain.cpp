@@ -80,12 +80,14 @@
 #include "arch/math.h"
 #include "contrast_domain.h"
 
+#include "multigrid.h"
 #include "pyramid.h"
 
 #include "Libpfs/progress.h"
 #include "Libpfs/utils/dotproduct.h"
 #include "Libpfs/utils/minmax.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/solvercache.h"
+#include "Libpfs/utils/trace.h"
 #include "Libpfs/utils/numeric.h"
 #include "Libpfs/utils/sse.h"
 #include "Libpfs/rt_algo.h"
@@ -114,8 +116,8 @@ namespace {
 const int NUM_BACKWARDS_CEILING = 3;
 }
 
-void lincg(PyramidT &pyramid, PyramidT &pC, const Array2Df &b, Array2Df &x,
-           const int itmax, const float tol, Progress &ph) {
+int lincg(PyramidT &pyramid, PyramidT &pC, const Array2Df &b, Array2Df &x,
+          const int itmax, const float tol, Progress &ph) {
 
     float rdotr_curr;
     float rdotr_prev;
@@ -242,10 +244,97 @@ void lincg(PyramidT &pyramid, PyramidT &pC, const Array2Df &b, Array2Df &x,
                       << tol << ")" << std::endl;
         }
     }
+    return iter;
 }
 
-void transformToLuminance(PyramidT &pp, Array2Df &Y, const int itmax,
-                          const float tol, Progress &ph) {
+// conjugate gradient solver preconditioned by one multigrid V-cycle
+// overwrites pyramid!
+//
+// The residual r.r is no longer monotonic, so there is no restart: the
+// stopping criterion is the same as lincg
+int linpcg(PyramidT &pyramid, PyramidT &pC, const Array2Df &b, Array2Df &x,
+           const int itmax, const float tol, Progress &ph) {
+    const size_t rows = pyramid.getRows();
+    const size_t cols = pyramid.getCols();
+    const size_t n = rows * cols;
+    const float tol2 = tol * tol;
+
+    MultigridPreconditioner precond(pC);
+
+    Array2Df r(cols, rows);
+    Array2Df z(cols, rows);
+    Array2Df p(cols, rows);
+    Array2Df Ap(cols, rows);
+
+    // bnrm2 = ||b||
+    const float bnrm2 = utils::dotProduct(b.data(), n);
+
+    // r = b - Ax
+    multiplyA(pyramid, pC, x, r);
+    utils::vsub(b.data(), r.data(), r.data(), n);
+
+    // z = M^-1 r
+    precond.apply(r, z);
+
+    float rdotr = utils::dotProduct(r.data(), n);
+    float rdotz = utils::dotProduct(r.data(), z.data(), n);
+    std::copy(z.begin(), z.end(), p.begin());  // p = z
+
+    const float irdotr = rdotr;
+    const int phvalue = ph.value() + 8;
+    const float percent_sf =
+        (100.0f - phvalue) / std::log(tol2 * bnrm2 / irdotr);
+
+    int iter = 0;
+    for (; iter < itmax; ++iter) {
+        if (rdotr / bnrm2 < tol2) break;
+
+        ph.setValue(static_cast<int>(
+            phvalue + std::max(std::log(rdotr / irdotr) * percent_sf, 0.f)));
+        // User requested abort
+        if (ph.canceled() && iter > 0) {
+            break;
+        }
+
+        // Ap = A p
+        multiplyA(pyramid, pC, p, Ap);
+
+        // alpha = r.z / (p . Ap)
+        const float alpha = rdotz / utils::dotProduct(p.data(), Ap.data(), n);
+
+        // x = x + alpha * p, r = r - alpha Ap
+        utils::vadds(x.data(), alpha, p.data(), x.data(), n);
+        utils::vsubs(r.data(), alpha, Ap.data(), r.data(), n);
+
+        rdotr = utils::dotProduct(r.data(), n);
+
+        const float rdotz_prev = rdotz;
+        precond.apply(r, z);
+        rdotz = utils::dotProduct(r.data(), z.data(), n);
+
+        // the V-cycle is not exactly symmetric: Polak-Ribiere keeps the
+        // directions conjugate anyway (flexible CG). With the new z,
+        // (r_new - r_old) . z = -alpha Ap . z
+        const float beta =
+            -alpha * utils::dotProduct(Ap.data(), z.data(), n) / rdotz_prev;
+
+        // p = z + beta * p
+        utils::vadds(z.data(), beta, p.data(), p.data(), n);
+    }
+
+    if (rdotr / bnrm2 > tol2 && !ph.canceled()) {
+        std::cerr << std::endl
+                  << "pfstmo_mantiuk06: Warning: Not "
+                     "converged (hit maximum iterations), error = "
+                  << std::sqrt(rdotr / bnrm2) << " (should be below " << tol
+                  << ")" << std::endl;
+    }
+    return iter;
+}
+
+int transformToLuminance(PyramidT &pp, Array2Df &Y, const int itmax,
+                         const float tol, bool multigrid,
+                         const Array2Df *previous, Progress &ph) {
     PyramidT pC = pp;  // copy ctor
 
     pp.computeScaleFactors(pC);
@@ -259,8 +348,35 @@ void transformToLuminance(PyramidT &pp, Array2Df &Y, const int itmax,
     // calculate the sum of divergences (equal to b)
     pp.computeSumOfDivergence(b);
 
+    if (previous) {
+        // previous solves the same image with other parameters: scale it to
+        // the best fit along its direction, as contrast mapping scales all
+        // the gradients alike (the solution is defined up to a constant,
+        // which A ignores), and start from it if it is closer than Y
+        const size_t n = Y.size();
+        Array2Df x(*previous);
+        Array2Df r(pp.getCols(), pp.getRows());
+        multiplyA(pp, pC, x, r);
+        const float alpha = utils::dotProduct(x.data(), b.data(), n) /
+                            utils::dotProduct(x.data(), r.data(), n);
+        if (alpha > 0.f && std::isfinite(alpha)) {
+            utils::vsmul(x.data(), alpha, x.data(), n);
+            utils::vsmul(r.data(), alpha, r.data(), n);
+            utils::vsub(b.data(), r.data(), r.data(), n);
+            const float warm = utils::dotProduct(r.data(), n);
+
+            multiplyA(pp, pC, Y, r);
+            utils::vsub(b.data(), r.data(), r.data(), n);
+            if (warm < utils::dotProduct(r.data(), n)) Y.swap(x);
+        }
+    }
+
     // calculate luminances from gradients
-    lincg(pp, pC, b, Y, itmax, tol, ph);
+    // (images smaller than 3 pixels have no pyramid to cycle over)
+    if (multigrid && pp.numLevels() > 0) {
+        return linpcg(pp, pC, b, Y, itmax, tol, ph);
+    }
+    return lincg(pp, pC, b, Y, itmax, tol, ph);
 }
 
 struct HistData {
@@ -439,11 +555,10 @@ void denormalizeRGB(Array2Df &R, Array2Df &G, Array2Df &B, const Array2Df &Y,
 int tmo_mantiuk06_contmap(Array2Df &R, Array2Df &G, Array2Df &B, Array2Df &Y,
                           const float contrastFactor,
                           const float saturationFactor, float detailfactor,
-                          const int itmax, const float tol, Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+                          const int itmax, const float tol, bool multigrid,
+                          Progress &ph) {
+    pfs::utils::TraceSpan trace_span(
+        "tmo_mantiuk06", 3 * R.size() * sizeof(float));
     assert(R.getCols() == G.getCols());
     assert(G.getCols() == B.getCols());
     assert(B.getCols() == Y.getCols());
@@ -465,6 +580,14 @@ int tmo_mantiuk06_contmap(Array2Df &R, Array2Df &G, Array2Df &B, Array2Df &Y,
     // calculate gradients for pyramid (Y won't be changed)
     pp.computeGradients(Y);
 
+    // solution of the last run on this image, if any
+    uint64_t key = 0;
+    utils::SolverCache::ArraysPtr last;
+    if (utils::SolverCache::isEnabled()) {
+        key = utils::SolverCache::fingerprint(Y);
+        last = utils::SolverCache::lookup("mantiuk06", key);
+    }
+
     // transform gradients to R
     pp.transformToR(detailfactor);
     ph.setValue(13);
@@ -483,15 +606,15 @@ int tmo_mantiuk06_contmap(Array2Df &R, Array2Df &G, Array2Df &B, Array2Df &Y,
     ph.setValue(40);
 
     // transform gradients to luminance Y (pp -> Y)
-    transformToLuminance(pp, Y, itmax, tol, ph);
+    transformToLuminance(pp, Y, itmax, tol, multigrid,
+                         last ? &last->front() : NULL, ph);
+    if (utils::SolverCache::isEnabled() && !ph.canceled()) {
+        utils::SolverCache::store(
+            "mantiuk06", key, std::make_shared<utils::SolverCache::Arrays>(
+                                  1, Y));
+    }
     denormalizeLuminance(Y);
     denormalizeRGB(R, G, B, Y, saturationFactor);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_mantiuk06 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
     return PFSTMO_OK;
 }
@@ -40,6 +40,8 @@
 #include <Libpfs/array2d_fwd.h>
 #include "TonemappingOperators/pfstmo.h"
 
+class PyramidT;
+
 //! \brief: Tone mapping algorithm [Mantiuk2006]
 //!
 //! \param R red channel
@@ -50,6 +52,8 @@
 //! \param saturationFactor color desaturation (in 0-1 range)
 //! \param itmax maximum number of iterations for convergence (typically 50)
 //! \param tol tolerence to get within for convergence (typically 1e-3)
+//! \param multigrid precondition the conjugate gradient solver with a
+//! multigrid V-cycle: fewer iterations, each about three times as costly
 //! \param ph callback class that reports progress
 //! \return PFSTMO_OK if tone-mapping was sucessful, PFSTMO_ABORTED if
 //! it was stopped from a callback function and PFSTMO_ERROR if an
@@ -59,6 +63,16 @@ int tmo_mantiuk06_contmap(pfs::Array2Df &R, pfs::Array2Df &G, pfs::Array2Df &B,
                           pfs::Array2Df &Y, float contrastFactor,
                           float saturationFactor, float detailFactor,
                           int itmax /*= 200*/, float tol /*= 1e-3*/,
-                          pfs::Progress &ph);
+                          bool multigrid, pfs::Progress &ph);
+
+//! \brief solve for the luminance \a Y whose gradient pyramid is closest to
+//! \a pp (which is overwritten), starting from the values in \a Y
+//! \param previous solution of a previous run on the same image (or NULL),
+//! rescaled to fit \a pp and used as the starting point if it is closer than
+//! \a Y
+//! \return number of iterations of the solver
+int transformToLuminance(PyramidT &pp, pfs::Array2Df &Y, int itmax, float tol,
+                         bool multigrid, const pfs::Array2Df *previous,
+                         pfs::Progress &ph);
 
 #endif
@@ -0,0 +1,272 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include "multigrid.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Libpfs/utils/numeric.h"
+
+using namespace pfs;
+
+namespace {
+//! \brief damping of the Jacobi smoother
+const float OMEGA = 0.7f;
+//! \brief Jacobi sweeps on the coarsest level
+const int COARSE_SWEEPS = 4;
+
+//! \brief sum of the weights of the edges of each node, with \a wx and
+//! \a wy the weights of the edges to the right and below
+void edgeSum(const Array2Df &wx, const Array2Df &wy, Array2Df &diag) {
+    const int cols = wx.getCols();
+    const int rows = wx.getRows();
+
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            float d = 0.f;
+            if (x + 1 < cols) d += wx(x, y);
+            if (x > 0) d += wx(x - 1, y);
+            if (y + 1 < rows) d += wy(x, y);
+            if (y > 0) d += wy(x, y - 1);
+            diag(x, y) = d;
+        }
+    }
+}
+
+//! \brief out = L x, with L the Laplacian whose edges to the right and
+//! below of each node weigh \a wx and \a wy
+void laplacian(const Array2Df &wx, const Array2Df &wy, const Array2Df &x,
+               Array2Df &out) {
+    const int cols = x.getCols();
+    const int rows = x.getRows();
+
+#pragma omp parallel for
+    for (int y = 0; y < rows; ++y) {
+        for (int k = 0; k < cols; ++k) {
+            const float v = x(k, y);
+            float s = 0.f;
+            if (k + 1 < cols) s += wx(k, y) * (v - x(k + 1, y));
+            if (k > 0) s += wx(k - 1, y) * (v - x(k - 1, y));
+            if (y + 1 < rows) s += wy(k, y) * (v - x(k, y + 1));
+            if (y > 0) s += wy(k, y - 1) * (v - x(k, y - 1));
+            out(k, y) = s;
+        }
+    }
+}
+
+//! \brief split the scale factors \a C in the weights of the edges to the
+//! right and below of each node
+void splitScaleFactors(const PyramidS &C, Array2Df &cx, Array2Df &cy) {
+    for (size_t i = 0; i < C.size(); ++i) {
+        cx(i) = C(i).gX();
+        cy(i) = C(i).gY();
+    }
+}
+}
+
+MultigridPreconditioner::Level::Level(const PyramidS &scaleFactors,
+                                      float scale)
+    : C(&scaleFactors),
+      scale(scale),
+      wx(scaleFactors.getCols(), scaleFactors.getRows()),
+      wy(scaleFactors.getCols(), scaleFactors.getRows()),
+      invDiag(scaleFactors.getCols(), scaleFactors.getRows()),
+      r(scaleFactors.getCols(), scaleFactors.getRows()),
+      z(scaleFactors.getCols(), scaleFactors.getRows()),
+      t(scaleFactors.getCols(), scaleFactors.getRows()),
+      down(scaleFactors.getCols(), scaleFactors.getRows()),
+      divG(scaleFactors.getCols(), scaleFactors.getRows()),
+      gradient(scaleFactors.getCols(), scaleFactors.getRows()) {}
+
+MultigridPreconditioner::MultigridPreconditioner(const PyramidT &pC) {
+    assert(pC.numLevels() > 0);
+
+    m_levels.reserve(pC.numLevels());
+    float scale = 1.f;
+    for (PyramidT::const_iterator it = pC.begin(); it != pC.end(); ++it) {
+        m_levels.emplace_back(*it, scale);
+        scale *= 4.f;
+    }
+    const size_t numLevels = m_levels.size();
+
+    // Laplacian of the finer levels, aggregated level by level: an edge
+    // between two blocks weighs the sum of the fine edges that cross it
+    m_levels[0].wx.fill(0.f);
+    m_levels[0].wy.fill(0.f);
+    for (size_t j = 0; j + 1 < numLevels; ++j) {
+        const Level &fine = m_levels[j];
+        Level &coarse = m_levels[j + 1];
+        const int fineCols = fine.wx.getCols();
+        const int fineRows = fine.wx.getRows();
+        const int cols = coarse.wx.getCols();
+        const int rows = coarse.wx.getRows();
+
+#pragma omp parallel for
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+                float sx = 0.f;
+                float sy = 0.f;
+                for (int k = 0; k < 2; ++k) {
+                    const int fx = 2 * x + 1;
+                    const int fy = 2 * y + k;
+                    if (fx + 1 < fineCols && fy < fineRows) {
+                        sx += fine.wx(fx, fy) +
+                              fine.scale * (*fine.C)(fx, fy).gX();
+                    }
+                    const int gx = 2 * x + k;
+                    const int gy = 2 * y + 1;
+                    if (gy + 1 < fineRows && gx < fineCols) {
+                        sy += fine.wy(gx, gy) +
+                              fine.scale * (*fine.C)(gx, gy).gY();
+                    }
+                }
+                coarse.wx(x, y) = sx;
+                coarse.wy(x, y) = sy;
+            }
+        }
+    }
+
+    // diagonal of the Jacobi smoother, from the coarsest level. The terms of
+    // the coarser levels couple whole blocks of nodes: their diagonal is
+    // tiny, but not their largest eigenvalues, and plain Jacobi diverges.
+    // Each node takes instead half the sum of the absolute values of its row
+    // (the diagonal of the Laplacians of the blocks it belongs to)
+    Array2Df coarser;
+    for (size_t j = numLevels; j-- > 0;) {
+        Level &level = m_levels[j];
+        const size_t cols = level.t.getCols();
+        const size_t rows = level.t.getRows();
+
+        // level.r, level.z and level.t are free until the first cycle
+        Array2Df &diagL = level.r;
+        splitScaleFactors(*level.C, level.z, level.t);
+        edgeSum(level.z, level.t, diagL);
+        edgeSum(level.wx, level.wy, level.t);
+
+        if (j + 1 < numLevels) {
+            Array2Df &above = m_levels[j + 1].r;
+            utils::vadd(coarser.data(), above.data(), above.data(),
+                        above.size());
+            matrixUpsample(cols, rows, above.data(), level.z.data());
+        } else {
+            level.z.fill(0.f);
+        }
+        // coarser = half the row sums of the levels above j
+        coarser = level.z;
+
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(level.t.size()); ++i) {
+            const float d =
+                level.t(i) + level.scale * (diagL(i) + coarser(i));
+            level.invDiag(i) = d > 0.f ? 1.f / d : 0.f;
+        }
+    }
+}
+
+void MultigridPreconditioner::applyOperator(size_t level, const Array2Df &x,
+                                            Array2Df &out) {
+    const size_t numLevels = m_levels.size();
+
+    // gradients of x downsampled up to each level, scaled by C
+    const float *src = x.data();
+    for (size_t k = level; k < numLevels; ++k) {
+        Level &curr = m_levels[k];
+        if (k > level) {
+            const Level &prev = m_levels[k - 1];
+            matrixDownsample(prev.t.getCols(), prev.t.getRows(), src,
+                             curr.down.data());
+            src = curr.down.data();
+        }
+        calculateGradients(src, curr.gradient);
+        const int size = curr.gradient.size();
+#pragma omp parallel for
+        for (int i = 0; i < size; ++i) {
+            curr.gradient(i) *= (*curr.C)(i);
+        }
+    }
+
+    // sum of the divergences, from the coarsest level
+    m_levels.back().divG.fill(0.f);
+    calculateAndAddDivergence(m_levels.back().gradient,
+                              m_levels.back().divG.data());
+    for (size_t k = numLevels - 1; k-- > level;) {
+        Level &curr = m_levels[k];
+        matrixUpsample(curr.t.getCols(), curr.t.getRows(),
+                       m_levels[k + 1].divG.data(), curr.divG.data());
+        calculateAndAddDivergence(curr.gradient, curr.divG.data());
+    }
+
+    // the divergence is negative semidefinite: out = S x - 4^j divG
+    Level &curr = m_levels[level];
+    if (level > 0) {
+        laplacian(curr.wx, curr.wy, x, out);
+        utils::vsubs(out.data(), curr.scale, curr.divG.data(), out.data(),
+                     out.size());
+    } else {
+        utils::vsmul(curr.divG.data(), -1.f, out.data(), out.size());
+    }
+}
+
+void MultigridPreconditioner::smooth(size_t level) {
+    Level &curr = m_levels[level];
+    applyOperator(level, curr.z, curr.t);
+
+    const int size = curr.z.size();
+#pragma omp parallel for
+    for (int i = 0; i < size; ++i) {
+        curr.z(i) += OMEGA * curr.invDiag(i) * (curr.r(i) - curr.t(i));
+    }
+}
+
+void MultigridPreconditioner::vcycle(size_t level) {
+    Level &curr = m_levels[level];
+
+    if (level + 1 == m_levels.size()) {
+        curr.z.fill(0.f);
+        for (int i = 0; i < COARSE_SWEEPS; ++i) {
+            smooth(level);
+        }
+        return;
+    }
+
+    // restrict with P^T, four times the (average) downsample
+    Level &next = m_levels[level + 1];
+    matrixDownsample(curr.r.getCols(), curr.r.getRows(), curr.r.data(),
+                     next.r.data());
+    utils::vsmul(next.r.data(), 4.f, next.r.data(), next.r.size());
+
+    vcycle(level + 1);
+
+    // prolong with P and smooth
+    matrixUpsample(curr.z.getCols(), curr.z.getRows(), next.z.data(),
+                   curr.z.data());
+    smooth(level);
+}
+
+void MultigridPreconditioner::apply(const Array2Df &r, Array2Df &z) {
+    // the cycle solves for -A, which is positive semidefinite
+    Level &first = m_levels.front();
+    utils::vsmul(r.data(), -1.f, first.r.data(), r.size());
+    vcycle(0);
+    std::copy(first.z.begin(), first.z.end(), z.begin());
+}
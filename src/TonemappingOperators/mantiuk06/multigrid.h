@@ -0,0 +1,99 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Multigrid preconditioner for the conjugate gradient solver of the
+//! Mantiuk06 tonemapping operator
+
+#ifndef MANTIUK06_MULTIGRID_H
+#define MANTIUK06_MULTIGRID_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Libpfs/array2d.h"
+#include "pyramid.h"
+
+//! \brief One V-cycle over the levels of the pyramid, as an approximate
+//! inverse of the operator A of lincg
+//!
+//! A x sums, over every level k of the pyramid, the divergence of the
+//! gradients of x downsampled k times, weighted by the scale factors C_k and
+//! upsampled back. With P the upsampling of PyramidT (which copies each
+//! pixel to a 2x2 block) and P^T four times its downsampling (which averages
+//! the block), the coarse operator of level j is the Galerkin product
+//! P^T A_(j-1) P, that is:
+//!  - a 5-point Laplacian that collects the levels finer than j, whose edges
+//!    between two blocks weigh the sum of the edges that cross them;
+//!  - plus 4^j times the terms of A for the levels from j up, applied as
+//!    lincg does.
+//! The cycle restricts the residual down to the coarsest level, and on the
+//! way up prolongs the correction and smooths it with damped Jacobi.
+class MultigridPreconditioner {
+   public:
+    //! \brief build the levels from the scale factors \a pC, which must
+    //! outlive the preconditioner
+    explicit MultigridPreconditioner(const PyramidT &pC);
+
+    //! \brief z ~= A^-1 r
+    void apply(const pfs::Array2Df &r, pfs::Array2Df &z);
+
+    inline size_t numLevels() const { return m_levels.size(); }
+
+   private:
+    struct Level {
+        Level(const PyramidS &scaleFactors, float scale);
+
+        //! \brief scale factors C_j of this level of the pyramid
+        const PyramidS *C;
+        //! \brief 4^j
+        float scale;
+
+        //! \brief Laplacian of the finer levels: weight of the edge to the
+        //! right and below of each node
+        pfs::Array2Df wx;
+        pfs::Array2Df wy;
+        //! \brief inverse of the diagonal of the smoother
+        pfs::Array2Df invDiag;
+
+        //! \brief right hand side, solution and residual of the cycle
+        pfs::Array2Df r;
+        pfs::Array2Df z;
+        pfs::Array2Df t;
+
+        //! \brief scratch of the operator
+        pfs::Array2Df down;
+        pfs::Array2Df divG;
+        PyramidS gradient;
+    };
+
+    //! \brief out = -A_level x, the (positive) operator of \a level
+    void applyOperator(size_t level, const pfs::Array2Df &x,
+                       pfs::Array2Df &out);
+
+    //! \brief z += omega D^-1 (r - A z) on \a level
+    void smooth(size_t level);
+
+    void vcycle(size_t level);
+
+    std::vector<Level> m_levels;
+};
+
+#endif  // MANTIUK06_MULTIGRID_H
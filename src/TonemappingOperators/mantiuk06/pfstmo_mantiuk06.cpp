@@ -60,7 +60,7 @@ const float tol = 5e-3f;
 
 void pfstmo_mantiuk06(pfs::Frame &frame, float scaleFactor,
                       float saturationFactor, float detailFactor, bool cont_eq,
-                      pfs::Progress &ph) {
+                      bool multigrid, pfs::Progress &ph) {
 
 #ifndef NDEBUG
     std::stringstream ss;
@@ -75,7 +75,8 @@ void pfstmo_mantiuk06(pfs::Frame &frame, float scaleFactor,
 
     ss << "scaleFactor: " << scaleFactor;
     ss << ", saturationFactor: " << saturationFactor;
-    ss << ", detailFactor: " << detailFactor << ")" << std::endl;
+    ss << ", detailFactor: " << detailFactor;
+    ss << ", multigrid: " << multigrid << ")" << std::endl;
 
     std::cout << ss.str();
 #endif
@@ -98,7 +99,8 @@ void pfstmo_mantiuk06(pfs::Frame &frame, float scaleFactor,
 
     try {
         tmo_mantiuk06_contmap(*inRed, *inGreen, *inBlue, inY, scaleFactor,
-                              saturationFactor, detailFactor, itmax, tol, ph);
+                              saturationFactor, detailFactor, itmax, tol,
+                              multigrid, ph);
     } catch (...) {
         throw pfs::Exception("Tonemapping Failed!");
     }
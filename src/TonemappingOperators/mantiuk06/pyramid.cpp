@@ -40,6 +40,7 @@
 #endif
 
 #include "Libpfs/array2d.h"
+#include "Libpfs/manip/pyramid.h"
 #include "Libpfs/utils/numeric.h"
 #include "Libpfs/utils/sse.h"
 #include "../../sleef.c"
@@ -319,111 +320,14 @@ void PyramidT::multiply(const PyramidT &other) {
 }
 
 // downsample the matrix
-void matrixDownsampleFull(size_t inCols, size_t inRows, const float *inputData,
-                          float *outputData) {
-    const size_t outRows = inRows / 2;
-    const size_t outCols = inCols / 2;
-
-    const float dx = static_cast<float>(inCols) / outCols;
-    const float dy = static_cast<float>(inRows) / outRows;
-    const float normalize = 1.0f / (dx * dy);
-
-// New downsampling by Ed Brambley:
-// Experimental downsampling that assumes pixels are square and
-// integrates over each new pixel to find the average value of the
-// underlying pixels.
-//
-// Consider the original pixels laid out, and the new (larger)
-// pixels layed out over the top of them.  Then the new value for
-// the larger pixels is just the integral over that pixel of what
-// shows through; i.e., the values of the pixels underneath
-// multiplied by how much of that pixel is showing.
-//
-// (ix1, iy1) is the coordinate of the top left visible pixel.
-// (ix2, iy2) is the coordinate of the bottom right visible pixel.
-// (fx1, fy1) is the fraction of the top left pixel showing.
-// (fx2, fy2) is the fraction of the bottom right pixel showing.
-
-#pragma omp parallel for
-    for (int y = 0; y < static_cast<int>(outRows); y++) {
-        const size_t iy1 = (y * inRows) / outRows;
-        const size_t iy2 = ((y + 1) * inRows) / outRows;
-        const float fy1 = (iy1 + 1) - y * dy;
-        const float fy2 = (y + 1) * dy - iy2;
-
-        for (size_t x = 0; x < outCols; x++) {
-            const size_t ix1 = (x * inCols) / outCols;
-            const size_t ix2 = ((x + 1) * inCols) / outCols;
-            const float fx1 = (ix1 + 1) - x * dx;
-            const float fx2 = (x + 1) * dx - ix2;
-
-            float pixVal = 0.0f;
-            float factorx, factory;
-            for (size_t i = iy1; i <= iy2 && i < inRows; i++) {
-                if (i == iy1)
-                    factory = fy1;  // We're just getting the bottom edge of
-                                    // this pixel
-                else if (i == iy2)
-                    factory =
-                        fy2;  // We're just gettting the top edge of this pixel
-                else
-                    factory = 1.0f;  // We've got the full height of this pixel
-                for (size_t j = ix1; j <= ix2 && j < inCols; j++) {
-                    if (j == ix1)
-                        factorx =
-                            fx1;  // We've just got the right edge of this pixel
-                    else if (j == ix2)
-                        factorx =
-                            fx2;  // We've just got the left edge of this pixel
-                    else
-                        factorx =
-                            1.0f;  // We've got the full width of this pixel
-
-                    pixVal += inputData[j + i * inCols] * factorx * factory;
-                }
-            }
-
-            outputData[x + y * outCols] =
-                pixVal * normalize;  // Normalize by the area of the new pixel
-        }
-    }
-}
-
-void matrixDownsampleSimple(size_t inCols, size_t inRows,
-                            const float *inputData, float *outputData) {
-    const size_t outRows = inRows / 2;
-    const size_t outCols = inCols / 2;
-
-// Simplified downsampling by Bruce Guenter:
-//
-// Follows exactly the same math as the full downsampling above,
-// except that inRows and inCols are known to be even.  This allows
-// for all of the boundary cases to be eliminated, reducing the
-// sampling to a simple average.
-
-#pragma omp parallel for
-    for (int y = 0; y < static_cast<int>(outRows); y++) {
-        const int iy1 = y * 2;
-        const float *datap = inputData + iy1 * inCols;
-        float *resp = outputData + y * outCols;
-
-        for (size_t x = 0; x < outCols; x++) {
-            const size_t ix1 = x * 2;
-
-            resp[x] = (datap[ix1] + datap[(ix1 + 1)] + datap[ix1 + inCols] +
-                       datap[(ix1 + 1) + inCols]) *
-                      0.25f;  // / 4.0f;
-        }
-    }
-}
-
+// Downsampling by Ed Brambley: assumes pixels are square and integrates over
+// each new pixel to find the average value of the underlying pixels, i.e. the
+// values of the pixels underneath multiplied by how much of each pixel is
+// showing. When both sides are even this is the average of 2x2 blocks (Bruce
+// Guenter). Both run on the shared separable engine of Libpfs.
 void matrixDownsample(size_t inCols, size_t inRows, const float *inputData,
                       float *outputData) {
-    if (!(inCols % 2) && !(inRows % 2)) {
-        matrixDownsampleSimple(inCols, inRows, inputData, outputData);
-    } else {
-        matrixDownsampleFull(inCols, inRows, inputData, outputData);
-    }
+    pfs::reduce(inputData, inCols, inRows, outputData, pfs::PYRAMID_BOX);
 }
 
 // upsample the matrix
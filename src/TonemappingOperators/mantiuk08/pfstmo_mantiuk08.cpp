@@ -36,7 +36,7 @@
 #include <iostream>
 #include <memory>
 
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "Libpfs/colorspace/colorspace.h"
 #include "Libpfs/frame.h"
 #include "Libpfs/progress.h"
@@ -47,10 +47,9 @@ using namespace std;
 void pfstmo_mantiuk08(pfs::Frame &frame, float saturation_factor,
                       float contrast_enhance_factor, float white_y,
                       bool setluminance, pfs::Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_mantiuk08",
+        frame.size() * frame.getChannels().size() * sizeof(float));
 
     ph.setValue(0);
 
@@ -180,11 +179,4 @@ void pfstmo_mantiuk08(pfs::Frame &frame, float saturation_factor,
 
     delete df;
     delete ds;
-
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_mantiuk08 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
 }
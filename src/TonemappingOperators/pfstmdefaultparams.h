@@ -56,6 +56,7 @@
 #define MANTIUK06_SATURATION_FACTOR 0.8f
 #define MANTIUK06_DETAIL_FACTOR 0.8f
 #define MANTIUK06_CONTRAST_EQUALIZATION false
+#define MANTIUK06_MULTIGRID false
 
 // Mantiuk 08
 #define MANTIUK08_COLOR_SATURATION 1.0f
@@ -29,6 +29,8 @@
 #ifndef PFSTMO_H
 #define PFSTMO_H
 
+#include <cstddef>
+
 namespace pfs {
 class Frame;
 class Progress;
@@ -64,7 +66,7 @@ void pfstmo_kimkautz08(pfs::Frame &frame, float KK_c1, float KK_c2,
 void pfstmo_mai11(pfs::Frame &frame, pfs::Progress &ph);
 void pfstmo_mantiuk06(pfs::Frame &frame, float scaleFactor,
                       float saturationFactor, float detailFactor, bool cont_eq,
-                      pfs::Progress &ph);
+                      bool multigrid, pfs::Progress &ph);
 void pfstmo_mantiuk08(pfs::Frame &frame, float saturation_factor,
                       float contrast_enhance_factor, float white_y,
                       bool setluminance, pfs::Progress &ph);
@@ -81,4 +83,30 @@ void pfstmo_vanhateren06(pfs::Frame &frame, float pupil_area,
 
 void pfstmo_lischinski06(pfs::Frame &frame, float alpha,
                         pfs::Progress &ph);
+
+//! \brief Global operator applied one band of scanlines at a time
+//!
+//! The output of a global operator depends only on the input pixel and on a
+//! handful of image-wide statistics. Such an operator runs as one or more
+//! statistics passes followed by a mapping pass; every pass visits all the
+//! bands of the image, top to bottom, so that the whole image never needs to
+//! be in memory. Bands hold RGB data in the X, Y, Z channels, as the frames
+//! given to the pfstmo_* functions.
+class StreamingTmo {
+   public:
+    virtual ~StreamingTmo() {}
+
+    //! \brief number of statistics passes to run before \c map()
+    virtual size_t statisticsPasses() const = 0;
+    //! \brief gather the statistics of \a pass (0-based) on \a band
+    virtual void accumulate(size_t pass, const pfs::Frame &band) = 0;
+    //! \brief tone map \a band in place, once all the passes are complete
+    virtual void map(pfs::Frame &band) = 0;
+};
+
+StreamingTmo *pfstmo_drago03_stream(float biasValue);
+StreamingTmo *pfstmo_reinhard05_stream(float brightness,
+                                       float chromaticadaptation,
+                                       float lightadaptation);
+StreamingTmo *pfstmo_vanhateren06_stream(float pupil_area);
 #endif
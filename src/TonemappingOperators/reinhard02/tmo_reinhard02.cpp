@@ -45,41 +45,14 @@
 
 #include "tmo_reinhard02.h"
 
-#include <Common/init_fftw.h>
 #include <Libpfs/array2d.h>
 #include <Libpfs/array2d_fwd.h>
 #include <Libpfs/progress.h>
-#include <Libpfs/utils/msec_timer.h>
+#include <Libpfs/utils/trace.h>
 #include <TonemappingOperators/pfstmo.h>
-#include "Common/LuminanceOptions.h"
 #include "../../sleef.c"
 #include "../../opthelper.h"
-#ifdef TIMER_PROFILING
-#define BENCHMARK
-#endif
-#include "../../StopWatch.h"
 
-/*
-static int       width, height, scale;
-static COLOR   **image;
-static float ***convolved_image;
-static float    sigma_0, sigma_1;
-float         **luminance;
-
-static float    k                = 1. / (2. * 1.4142136);
-static float    key              = 0.18;
-static float    threshold        = 0.05;
-static float    phi              = 8.;
-static float    white            = 1e20;
-static int       scale_low        = 1;
-static int       scale_high       = 43;  // 1.6^8 = 43
-static int       range            = 8;
-static int       use_scales       = 0;
-static int       use_border       = 0;
-static CVTS      cvts             = {0, 0};
-
-static bool temporal_coherent;
-*/
 #define pow_F(a,b) (xexpf(b*xlogf(a)))
 #define V1(x, y, i) (m_convolved_image[i][y][x])
 
@@ -165,32 +138,13 @@ void Reinhard02::build_gaussian_fft() {
 #endif
 
         m_ph.setValue(30 + 40 * scale / m_range);
-        fftwf_plan p;
-        FFTW_MUTEX::fftw_mutex_plan.lock();
-        // test for available wisdom
-        p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, m_filter_fft[scale], m_filter_fft[scale], -1, FFTW_WISDOM_ONLY);
-        if(!p) {
-            // no wisdom available, load wisdom from file
-            fftwf_import_wisdom_from_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-            // test again for wisdom
-            p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, m_filter_fft[scale], m_filter_fft[scale], -1, FFTW_WISDOM_ONLY);
-            if(!p) {
-                // build plan with FFTW_MEASURE
-                p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, m_filter_fft[scale], m_filter_fft[scale], -1, FFTW_MEASURE);
-                // save the wisdom
-                fftwf_export_wisdom_to_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-            }
-        }
-        FFTW_MUTEX::fftw_mutex_plan.unlock();
 
         gaussian_filter(m_filter_fft[scale], S_I(scale), m_k);
 
-        fftwf_execute(p);
-
-        FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-        fftwf_destroy_plan(p);
-        FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
-
+        // every buffer comes from the pool of FftwBuffer, hence has the same
+        // alignment as the one the plan was built for
+        fftwf_execute_dft(m_forward_plan.get(), m_filter_fft[scale],
+                          m_filter_fft[scale]);
     }
 #ifndef NDEBUG
     fprintf(stderr, "\n");
@@ -202,22 +156,6 @@ void Reinhard02::build_image_fft() {
 #ifndef NDEBUG
     fprintf(stderr, "Computing image FFT\n");
 #endif
-    fftwf_plan p;
-    FFTW_MUTEX::fftw_mutex_plan.lock();
-    p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, m_image_fft, m_image_fft, -1, FFTW_WISDOM_ONLY);
-    if(!p) {
-        // no wisdom available, load wisdom from file
-        fftwf_import_wisdom_from_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-        // test again for wisdom
-        p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, m_image_fft, m_image_fft, -1, FFTW_WISDOM_ONLY);
-        if(!p) {
-            // build plan with FFTW_MEASURE
-            p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, m_image_fft, m_image_fft, -1, FFTW_MEASURE);
-            // save the wisdom
-            fftwf_export_wisdom_to_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-        }
-    }
-    FFTW_MUTEX::fftw_mutex_plan.unlock();
 
     #pragma omp parallel for
     for (size_t y = 0; y < m_cvts.ymax; y++) {
@@ -227,32 +165,11 @@ void Reinhard02::build_image_fft() {
         }
     }
 
-    fftwf_execute(p);
-
-    FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-    fftwf_destroy_plan(p);
-    FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
+    fftwf_execute_dft(m_forward_plan.get(), m_image_fft, m_image_fft);
 }
 
 void Reinhard02::convolve_filter(int scale, fftwf_complex *convolution_fft) {
 
-    fftwf_plan p;
-    FFTW_MUTEX::fftw_mutex_plan.lock();
-    p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, convolution_fft, convolution_fft, 1, FFTW_WISDOM_ONLY);
-    if(!p) {
-        // no wisdom available, load wisdom from file
-        fftwf_import_wisdom_from_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-        // test again for wisdom
-        p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, convolution_fft, convolution_fft, 1, FFTW_WISDOM_ONLY);
-        if(!p) {
-            // build plan with FFTW_MEASURE
-            p = fftwf_plan_dft_2d(m_cvts.ymax, m_cvts.xmax, convolution_fft, convolution_fft, 1, FFTW_MEASURE);
-            // save the wisdom
-            fftwf_export_wisdom_to_filename(LuminanceOptions().getFftwWisdomFileName().toStdString().c_str());
-        }
-    }
-    FFTW_MUTEX::fftw_mutex_plan.unlock();
-
     int length = m_cvts.xmax * m_cvts.ymax;
     float fft_scale = 1.f / (float)length;
 
@@ -264,11 +181,8 @@ void Reinhard02::convolve_filter(int scale, fftwf_complex *convolution_fft) {
                                              m_image_fft[i][1] * m_filter_fft[scale][i][0]);
     }
 
-    fftwf_execute(p);
-
-    FFTW_MUTEX::fftw_mutex_destroy_plan.lock();
-    fftwf_destroy_plan(p);
-    FFTW_MUTEX::fftw_mutex_destroy_plan.unlock();
+    fftwf_execute_dft(m_backward_plan.get(), convolution_fft,
+                      convolution_fft);
 
 #pragma omp parallel for
     for (size_t y = 0; y < m_cvts.ymax; y++)
@@ -278,9 +192,13 @@ void Reinhard02::convolve_filter(int scale, fftwf_complex *convolution_fft) {
 
 void Reinhard02::compute_fourier_convolution() {
 
-    // activate parallel execution of fft routines
-    init_fftw();
-    //initialise_fft(m_cvts.xmax, m_cvts.ymax);
+    // plans of the size of the image are shared by every instance
+    m_forward_plan = FftwPlans::get(FftwPlans::FORWARD_2D, m_cvts.ymax,
+                                    m_cvts.xmax, m_image_fft, m_image_fft);
+    m_backward_plan =
+        FftwPlans::get(FftwPlans::BACKWARD_2D, m_cvts.ymax, m_cvts.xmax,
+                       m_convolution_fft, m_convolution_fft);
+
     build_image_fft();
 
     build_gaussian_fft();
@@ -296,6 +214,9 @@ void Reinhard02::compute_fourier_convolution() {
 #ifndef NDEBUG
     fprintf(stderr, "\n");
 #endif
+
+    m_forward_plan.reset();
+    m_backward_plan.reset();
 }
 
 //
@@ -446,7 +367,10 @@ Reinhard02::Reinhard02(const pfs::Array2Df *Y, pfs::Array2Df *L,
       m_bbeta(0.f),
       m_threshold(0.05f),
       m_k(1.f / (2.f * 1.4142136f)),
-      m_ph(ph)
+      m_ph(ph),
+      m_image_fft(NULL),
+      m_convolution_fft(NULL),
+      m_convolved_image(NULL)
 {
 
     m_cvts.xmax = m_Y->getCols();
@@ -465,32 +389,26 @@ Reinhard02::Reinhard02(const pfs::Array2Df *Y, pfs::Array2Df *L,
     }
     if (use_scales) {
         m_convolved_image = (float ***)malloc(m_range * sizeof(float **));
-        FFTW_MUTEX::fftw_mutex_alloc.lock();
-        m_image_fft = (fftwf_complex *)fftwf_alloc_complex(length);
-        m_filter_fft = (fftwf_complex **)fftwf_alloc_complex(m_range);
+        m_fft_buffers.reserve(m_range + 2);
+        m_fft_buffers.push_back(FftwBuffer::allocComplex(length));
+        m_image_fft = m_fft_buffers.back().complex();
+        m_filter_fft.resize(m_range);
         for (int scale = 0; scale < m_range; scale++) {
-            m_filter_fft[scale] = (fftwf_complex *)fftwf_alloc_complex(length);
+            m_fft_buffers.push_back(FftwBuffer::allocComplex(length));
+            m_filter_fft[scale] = m_fft_buffers.back().complex();
             m_convolved_image[scale] = (float **)malloc(m_cvts.ymax * sizeof(float *));
             m_convolved_image[scale][0] = (float *)malloc(length * sizeof(float));
             for (size_t y = 1; y < m_cvts.ymax; y++)
                 m_convolved_image[scale][y] = m_convolved_image[scale][0] + y * m_cvts.xmax;
         }
-        m_convolution_fft = (fftwf_complex *)fftwf_alloc_complex(m_cvts.xmax * m_cvts.ymax);
-        FFTW_MUTEX::fftw_mutex_alloc.unlock();
+        m_fft_buffers.push_back(FftwBuffer::allocComplex(length));
+        m_convolution_fft = m_fft_buffers.back().complex();
     }
 }
 
 Reinhard02::~Reinhard02() {
     free(m_image);
     if (m_use_scales) {
-        FFTW_MUTEX::fftw_mutex_free.lock();
-        for (int scale = 0; scale < m_range; scale++) {
-            fftwf_free(m_filter_fft[scale]);
-        }
-        fftwf_free(m_filter_fft);
-        fftwf_free(m_convolution_fft);
-        fftwf_free(m_image_fft);
-        FFTW_MUTEX::fftw_mutex_free.unlock();
         for (int scale = 0; scale < m_range; scale++) {
             free(m_convolved_image[scale][0]);
             free(m_convolved_image[scale]);
@@ -500,10 +418,8 @@ Reinhard02::~Reinhard02() {
 }
 
 void Reinhard02::tmo_reinhard02() {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_reinhard02", size_t(m_width) * m_height * sizeof(float));
 
     m_ph.setValue(2);
 
@@ -529,11 +445,5 @@ void Reinhard02::tmo_reinhard02() {
 
     m_ph.setValue(99);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_reinhard02 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
 end:;
 }
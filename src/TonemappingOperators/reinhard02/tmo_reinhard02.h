@@ -33,8 +33,9 @@
 #define TMO_REINHARD02_H
 
 #include <fftw3.h>
-#include <boost/thread/mutex.hpp>
+#include <vector>
 
+#include <Common/fftw_plans.h>
 #include <Libpfs/array2d_fwd.h>
 
 namespace pfs {
@@ -89,10 +90,13 @@ class Reinhard02 {
     float m_k;
     pfs::Progress &m_ph;
 
-    fftwf_complex **m_filter_fft;
+    std::vector<FftwBuffer> m_fft_buffers;
+    std::vector<fftwf_complex *> m_filter_fft;
     fftwf_complex *m_image_fft;
     fftwf_complex *m_convolution_fft;
     float ***m_convolved_image;
+    FftwPlans::Plan m_forward_plan;
+    FftwPlans::Plan m_backward_plan;
 
     float bessel(float);
     float kaiserbessel(float, float, float);
@@ -41,6 +41,9 @@
 #include "Libpfs/exception.h"
 #include "Libpfs/frame.h"
 #include "Libpfs/progress.h"
+#include "TonemappingOperators/pfstmo.h"
+
+#include <limits>
 
 void pfstmo_reinhard05(pfs::Frame &frame, float brightness,
                        float chromaticadaptation, float lightadaptation,
@@ -94,3 +97,72 @@ void pfstmo_reinhard05(pfs::Frame &frame, float brightness,
         ph.setValue(100);
     }
 }
+
+namespace {
+
+class Reinhard05Stream : public StreamingTmo {
+   public:
+    explicit Reinhard05Stream(const Reinhard05Params &params)
+        : m_params(params),
+          m_minSample(std::numeric_limits<float>::max()),
+          m_maxSample(std::numeric_limits<float>::min()) {}
+
+    // pass 0: channel and luminance statistics
+    // pass 1: range of the output, used for the final normalization
+    size_t statisticsPasses() const { return 2; }
+
+    void accumulate(size_t pass, const pfs::Frame &band) {
+        const pfs::Channel *R, *G, *B;
+        band.getXYZChannels(R, G, B);
+        if (!R || !G || !B) {
+            throw pfs::Exception("Missing X, Y, Z channels in the PFS stream");
+        }
+
+        const size_t width = band.getWidth();
+        const size_t height = band.getHeight();
+
+        pfs::Array2Df Y(width, height);
+        pfs::transformRGB2Y(R, G, B, &Y);
+
+        if (pass == 0) {
+            m_stats.accumulate(width, height, R->data(), G->data(), B->data(),
+                               Y.data());
+        } else {
+            tmo_reinhard05_range(width, height, R->data(), G->data(),
+                                 B->data(), Y.data(), m_params, m_stats,
+                                 m_minSample, m_maxSample);
+        }
+    }
+
+    void map(pfs::Frame &band) {
+        pfs::Channel *R, *G, *B;
+        band.getXYZChannels(R, G, B);
+        if (!R || !G || !B) {
+            throw pfs::Exception("Missing X, Y, Z channels in the PFS stream");
+        }
+
+        const size_t width = band.getWidth();
+        const size_t height = band.getHeight();
+
+        pfs::Array2Df Y(width, height);
+        pfs::transformRGB2Y(R, G, B, &Y);
+
+        tmo_reinhard05_band(width, height, R->data(), G->data(), B->data(),
+                            Y.data(), m_params, m_stats, m_minSample,
+                            m_maxSample);
+    }
+
+   private:
+    Reinhard05Params m_params;
+    Reinhard05Stats m_stats;
+    float m_minSample;
+    float m_maxSample;
+};
+}
+
+StreamingTmo *pfstmo_reinhard05_stream(float brightness,
+                                       float chromaticadaptation,
+                                       float lightadaptation) {
+    return new Reinhard05Stream(
+        Reinhard05Params(brightness, chromaticadaptation, lightadaptation));
+}
@@ -32,7 +32,7 @@
 
 #include "tmo_reinhard05.h"
 #include "Libpfs/progress.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "TonemappingOperators/pfstmo.h"
 
 #include <assert.h>
@@ -41,6 +41,7 @@
 #include <iostream>
 #include <limits>
 #include <numeric>
+#include <vector>
 #include "../../opthelper.h"
 #include "../../sleef.c"
 #define pow_F(a,b) (xexpf(b*xlogf(a)))
@@ -73,13 +74,13 @@ struct LuminanceProperties {
     float imageBrightness;
 };
 
-void computeLuminanceProperties(const float *samples, size_t width, size_t height,
-                                LuminanceProperties &luminanceProperties,
-                                const Reinhard05Params &params) {
+//! \brief add min, max, sum and log-sum of a band of luminance samples
+void accumulateLuminance(const float *samples, size_t width, size_t height,
+                         Reinhard05Stats &stats) {
 
     // equalization parameters for the Luminance Channel
-    float min_lum = numeric_limits<float>::max();
-    float max_lum = -numeric_limits<float>::max();
+    float min_lum = stats.m_minLuminance;
+    float max_lum = stats.m_maxLuminance;
     float avg_lum = 0.f;
     float adapted_lum = 0.f;
 #ifdef _OPENMP
@@ -137,10 +138,20 @@ void computeLuminanceProperties(const float *samples, size_t width, size_t heigh
 }
 }
 
-    luminanceProperties.max = xlogf(max_lum);
-    luminanceProperties.min = xlogf(min_lum);
-    luminanceProperties.adaptedAverage = adapted_lum / (width * height);
-    luminanceProperties.average = avg_lum / (width * height);
+    stats.m_minLuminance = min_lum;
+    stats.m_maxLuminance = max_lum;
+    stats.m_luminanceSum += avg_lum;
+    stats.m_adaptedSum += adapted_lum;
+}
+
+void computeLuminanceProperties(const Reinhard05Stats &stats,
+                                LuminanceProperties &luminanceProperties,
+                                const Reinhard05Params &params) {
+
+    luminanceProperties.max = xlogf(stats.m_maxLuminance);
+    luminanceProperties.min = xlogf(stats.m_minLuminance);
+    luminanceProperties.adaptedAverage = stats.m_adaptedSum / stats.m_count;
+    luminanceProperties.average = stats.m_luminanceSum / stats.m_count;
 
     // image key (k)
     luminanceProperties.imageKey =
@@ -153,6 +164,16 @@ void computeLuminanceProperties(const float *samples, size_t width, size_t heigh
     luminanceProperties.imageBrightness = std::exp(-params.m_brightness);
 }
 
+void computeLuminanceProperties(const float *samples, size_t width, size_t height,
+                                LuminanceProperties &luminanceProperties,
+                                const Reinhard05Params &params) {
+    Reinhard05Stats stats;
+    accumulateLuminance(samples, width, height, stats);
+    stats.m_count = width * height;
+
+    computeLuminanceProperties(stats, luminanceProperties, params);
+}
+
 void transformChannel(const float *samplesChannel,
                              const float *samplesLuminance,
                              float *outputSamples, size_t width, size_t height,
@@ -265,10 +286,8 @@ void normalizeChannel(float *samples, size_t width, size_t height, float min, fl
 void tmo_reinhard05(size_t width, size_t height, float *nR, float *nG,
                     float *nB, const float *nY, const Reinhard05Params &params,
                     pfs::Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
+    pfs::utils::TraceSpan trace_span(
+        "tmo_reinhard05", 3 * width * height * sizeof(float));
 
     float Cav[] = {0.0f, 0.0f, 0.0f};
 
@@ -314,11 +333,67 @@ void tmo_reinhard05(size_t width, size_t height, float *nR, float *nG,
 
     // normalize BLUE channel
     normalizeChannel(nB, width, height, min_col, max_col);
+}
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_reinhard05 = " << stop_watch.get_time() << " msec" << endl;
-#endif
+Reinhard05Stats::Reinhard05Stats()
+    : m_luminanceSum(0.0),
+      m_adaptedSum(0.0),
+      m_minLuminance(numeric_limits<float>::max()),
+      m_maxLuminance(-numeric_limits<float>::max()),
+      m_count(0) {
+    m_channelSum[0] = m_channelSum[1] = m_channelSum[2] = 0.0;
+}
+
+void Reinhard05Stats::accumulate(size_t width, size_t height, const float *R,
+                                 const float *G, const float *B,
+                                 const float *Y) {
+    const float *channels[] = {R, G, B};
+    for (int c = 0; c < 3; ++c) {
+        float average;
+        computeAverage(channels[c], width, height, average);
+        m_channelSum[c] += static_cast<double>(average) * width * height;
+    }
+
+    accumulateLuminance(Y, width, height, *this);
+    m_count += width * height;
+}
 
+void tmo_reinhard05_range(size_t width, size_t height, const float *R,
+                          const float *G, const float *B, const float *Y,
+                          const Reinhard05Params &params,
+                          const Reinhard05Stats &stats, float &minSample,
+                          float &maxSample) {
+    LuminanceProperties luminanceProperties;
+    computeLuminanceProperties(stats, luminanceProperties, params);
+
+    // the transformed values are thrown away: only their range matters
+    std::vector<float> scratch(width * height);
+
+    const float *channels[] = {R, G, B};
+    for (int c = 0; c < 3; ++c) {
+        transformChannel(channels[c], Y, scratch.data(), width, height,
+                         stats.m_channelSum[c] / stats.m_count, params,
+                         luminanceProperties, minSample, maxSample);
+    }
+}
+
+void tmo_reinhard05_band(size_t width, size_t height, float *R, float *G,
+                         float *B, const float *Y,
+                         const Reinhard05Params &params,
+                         const Reinhard05Stats &stats, float minSample,
+                         float maxSample) {
+    LuminanceProperties luminanceProperties;
+    computeLuminanceProperties(stats, luminanceProperties, params);
+
+    float *channels[] = {R, G, B};
+    for (int c = 0; c < 3; ++c) {
+        // range already known from tmo_reinhard05_range()
+        float minCol = minSample;
+        float maxCol = maxSample;
+
+        transformChannel(channels[c], Y, channels[c], width, height,
+                         stats.m_channelSum[c] / stats.m_count, params,
+                         luminanceProperties, minCol, maxCol);
+        normalizeChannel(channels[c], width, height, minSample, maxSample);
+    }
 }
@@ -69,4 +69,38 @@ void tmo_reinhard05(size_t width, size_t height, float *R, float *G, float *B,
                     const float *Y, const Reinhard05Params &params,
                     pfs::Progress &ph);
 
+//! \brief Image-wide statistics of [Reinhard2005], which can be gathered one
+//! band of rows at a time
+struct Reinhard05Stats {
+    Reinhard05Stats();
+
+    //! \brief add the \a width x \a height pixels of a band to the statistics
+    void accumulate(size_t width, size_t height, const float *R,
+                    const float *G, const float *B, const float *Y);
+
+    double m_channelSum[3];
+    double m_luminanceSum;
+    double m_adaptedSum;  // sum of log(2.3e-5 + Y)
+    float m_minLuminance;
+    float m_maxLuminance;
+    size_t m_count;
+};
+
+//! \brief Range [minSample, maxSample] of the values of a band after the
+//! photoreceptor equation: the extremes of all the bands set the final
+//! normalization of \c tmo_reinhard05_band
+void tmo_reinhard05_range(size_t width, size_t height, const float *R,
+                          const float *G, const float *B, const float *Y,
+                          const Reinhard05Params &params,
+                          const Reinhard05Stats &stats, float &minSample,
+                          float &maxSample);
+
+//! \brief Tone map a band of rows in place, given the statistics and the
+//! output range of the whole image
+void tmo_reinhard05_band(size_t width, size_t height, float *R, float *G,
+                         float *B, const float *Y,
+                         const Reinhard05Params &params,
+                         const Reinhard05Stats &stats, float minSample,
+                         float maxSample);
+
 #endif  // TMO_REINHARD05_H
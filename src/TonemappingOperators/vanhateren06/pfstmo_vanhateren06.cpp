@@ -28,9 +28,12 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 #include "Libpfs/colorspace/colorspace.h"
 #include "Libpfs/manip/gamma.h"
@@ -38,11 +41,120 @@
 #include "Libpfs/progress.h"
 
 #include "tmo_vanhateren06.h"
+#include "TonemappingOperators/pfstmo.h"
 #include "../../sleef.c"
 #include "../../opthelper.h"
 
 using namespace pfs;
 
+namespace {
+//! \brief scale the channels by the ratio between the tone mapped luminance
+//! \a L and the original luminance \a Lold
+void scaleByLuminance(Array2Df &arrayRed, Array2Df &arrayGreen,
+                      Array2Df &arrayBlue, const Array2Df &L,
+                      const Array2Df &Lold) {
+    int w = L.getCols();
+    int h = L.getRows();
+
+    #pragma omp parallel for
+    for (int i = 0; i < h; ++i) {
+        int j = 0;
+#ifdef __SSE2__
+        for (; j < w - 3; j += 4) {
+            vfloat scalev = LVFU(L(j, i)) / LVFU(Lold(j, i));
+            STVFU(arrayRed(j, i), LVFU(arrayRed(j, i)) * scalev);
+            STVFU(arrayGreen(j, i), LVFU(arrayGreen(j, i)) * scalev);
+            STVFU(arrayBlue(j, i), LVFU(arrayBlue(j, i)) * scalev);
+        }
+#endif
+        for (; j < w; ++j) {
+            float scale = L(j, i) / Lold(j, i);
+            arrayRed(j, i) = arrayRed(j, i) * scale;
+            arrayGreen(j, i) = arrayGreen(j, i) * scale;
+            arrayBlue(j, i) = arrayBlue(j, i) * scale;
+        }
+    }
+}
+
+class VanHateren06Stream : public StreamingTmo {
+   public:
+    explicit VanHateren06Stream(float pupil_area)
+        : m_pupilArea(std::max(pupil_area, 0.f)),
+          m_minVal(std::numeric_limits<float>::max()),
+          m_maxVal(std::numeric_limits<float>::min()) {}
+
+    size_t statisticsPasses() const { return 1; }
+
+    void accumulate(size_t /*pass*/, const Frame &band) {
+        // the statistics are taken after the gamma of pfstmo_vanhateren06,
+        // which must not change the band yet
+        Frame gammaBand(band.getWidth(), band.getHeight());
+        Channel *X, *Y, *Z;
+        gammaBand.createXYZChannels(X, Y, Z);
+
+        const Channel *inX, *inY, *inZ;
+        band.getXYZChannels(inX, inY, inZ);
+        if (!inX || !inY || !inZ) {
+            throw Exception("Missing X, Y, Z channels in the PFS stream");
+        }
+        std::copy(inX->begin(), inX->end(), X->begin());
+        std::copy(inY->begin(), inY->end(), Y->begin());
+        std::copy(inZ->begin(), inZ->end(), Z->begin());
+
+        Array2Df L(band.getWidth(), band.getHeight());
+        luminance(gammaBand, L);
+
+        const size_t size = L.size();
+        for (size_t i = 0; i < size; ++i) {
+            const float val = vanhateren06_response(L(i), m_pupilArea);
+            m_minVal = std::min(m_minVal, val);
+            m_maxVal = std::max(m_maxVal, val);
+        }
+    }
+
+    void map(Frame &band) {
+        if (!m_lookup) {
+            m_lookup.reset(new VanHateren06Lut(m_minVal, m_maxVal));
+        }
+
+        Array2Df L(band.getWidth(), band.getHeight());
+        Array2Df Lold(band.getWidth(), band.getHeight());
+        Channel *inX, *inY, *inZ;
+        band.getXYZChannels(inY, inX, inZ);
+        if (!inX || !inY || !inZ) {
+            throw Exception("Missing X, Y, Z channels in the PFS stream");
+        }
+
+        luminance(band, L);
+        copy(L.begin(), L.end(), Lold.begin());
+
+        const size_t size = L.size();
+        #pragma omp parallel for
+        for (size_t i = 0; i < size; ++i) {
+            L(i) = (*m_lookup)(vanhateren06_response(L(i), m_pupilArea));
+        }
+
+        scaleByLuminance(*inX, *inY, *inZ, L, Lold);
+    }
+
+   private:
+    //! \brief apply the gamma of the operator to \a band and compute its
+    //! luminance, exactly as pfstmo_vanhateren06 does
+    static void luminance(Frame &band, Array2Df &L) {
+        applyGamma(&band, 1.8f);
+
+        Channel *inX, *inY, *inZ;
+        band.getXYZChannels(inY, inX, inZ);
+        transformRGB2Y(inX, inY, inZ, &L);
+    }
+
+    float m_pupilArea;
+    float m_minVal;
+    float m_maxVal;
+    std::unique_ptr<VanHateren06Lut> m_lookup;
+};
+}
+
 void pfstmo_vanhateren06(Frame &frame, float pupil_area, Progress &ph) {
 
 #ifndef NDEBUG
@@ -79,31 +191,14 @@ void pfstmo_vanhateren06(Frame &frame, float pupil_area, Progress &ph) {
     }
 
     if (!ph.canceled()) {
-        Array2Df &arrayRed = *inX;
-        Array2Df &arrayGreen = *inY;
-        Array2Df &arrayBlue = *inZ;
-
-        #pragma omp parallel for
-        for (int i = 0; i < h; ++i) {
-            int j = 0;
-#ifdef __SSE2__
-            for (; j < w - 3; j += 4) {
-                vfloat scalev = LVFU(L(j, i)) / LVFU(Lold(j, i));
-                STVFU(arrayRed(j, i), LVFU(arrayRed(j, i)) * scalev);
-                STVFU(arrayGreen(j, i), LVFU(arrayGreen(j, i)) * scalev);
-                STVFU(arrayBlue(j, i), LVFU(arrayBlue(j, i)) * scalev);
-            }
-#endif
-            for (; j < w; ++j) {
-                float scale = L(j, i) / Lold(j, i);
-                arrayRed(j, i) = arrayRed(j, i) * scale;
-                arrayGreen(j, i) = arrayGreen(j, i) * scale;
-                arrayBlue(j, i) = arrayBlue(j, i) * scale;
-            }
-        }
+        scaleByLuminance(*inX, *inY, *inZ, L, Lold);
     }
 
     frame.getTags().setTag("LUMINANCE", "DISPLAY");
 
     ph.setValue(100);
 }
+
+StreamingTmo *pfstmo_vanhateren06_stream(float pupil_area) {
+    return new VanHateren06Stream(pupil_area);
+}
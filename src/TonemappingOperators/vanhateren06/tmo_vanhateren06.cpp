@@ -35,7 +35,7 @@
 #include "Libpfs/array2d.h"
 #include "Libpfs/frame.h"
 #include "Libpfs/progress.h"
-#include "Libpfs/utils/msec_timer.h"
+#include "Libpfs/utils/trace.h"
 #include "Libpfs/utils/clamp.h"
 #include <Libpfs/colorspace/normalizer.h>
 #include "rt_math.h"
@@ -45,24 +45,22 @@ using namespace pfs;
 using namespace pfs::colorspace;
 using namespace std;
 
-int tmo_vanhateren06(Array2Df &L, float pupil_area, Progress &ph) {
-#ifdef TIMER_PROFILING
-    msec_timer stop_watch;
-    stop_watch.start();
-#endif
-
-    ph.setValue(5);
+namespace {
+const float k_beta = 1.6e-4; // td/ms
+const float a_C = 9e-2;
+const float C_beta = 2.8e-3; // 1/ms
 
-    pupil_area = std::max(pupil_area, 0.f);
-
-    const size_t w = L.getCols();
-    const size_t h = L.getRows();
-    const size_t size = w*h;
+constexpr int lutSize = 65536;
+}
 
-    const float k_beta = 1.6e-4; // td/ms
-    const float a_C = 9e-2;
-    const float C_beta = 2.8e-3; // 1/ms
+float vanhateren06_response(float L, float pupil_area) {
+    return -1.f / (C_beta + k_beta * L * pupil_area);
+}
 
+VanHateren06Lut::VanHateren06Lut(float minVal, float maxVal)
+    : m_minVal(minVal),
+      m_scale((lutSize - 1) / (maxVal - minVal)),
+      m_lookup(lutSize) {
     //Calculate Ios,max
     double polIosMax[] = {-1.0/C_beta, 0.0, 0.0, 0.0, 1.0, a_C};
     gsl_poly_complex_workspace* ws = gsl_poly_complex_workspace_alloc(6);
@@ -74,27 +72,7 @@ int tmo_vanhateren06(Array2Df &L, float pupil_area, Progress &ph) {
         roots[i>>1] = roots[i];
     }
 
-    const float maxIos = (float) *max_element(roots, roots + 5);
-
-    float minVal = std::numeric_limits<float>::max();
-    float maxVal = std::numeric_limits<float>::min();
-
-#ifdef _OPENMP
-    #pragma omp parallel for reduction(min:minVal) reduction(max:maxVal)
-#endif
-    for (size_t i = 0; i < size; ++i) {
-        const float val = -1.f / (C_beta + k_beta * L(i) * pupil_area);
-        minVal = std::min(minVal, val);
-        maxVal = std::max(maxVal, val);
-        L(i) = val;
-    }
-
-    ph.setValue(33);
-
-    constexpr int lutSize = 65536;
-    const float scale = (lutSize - 1) / (maxVal - minVal);
-
-    float lookup[lutSize];
+    m_maxIos = (float) *max_element(roots, roots + 5);
 
     const float lutscale = (maxVal - minVal) / (lutSize - 1);
 
@@ -115,10 +93,47 @@ int tmo_vanhateren06(Array2Df &L, float pupil_area, Progress &ph) {
             for (int k = 2; k < 10; k += 2) {
                 maxRoot = std::max(maxRoot, roots[k]);
             }
-            lookup[i] = maxRoot;
+            m_lookup[i] = maxRoot;
         }
         gsl_poly_complex_workspace_free (wsp);
     }
+}
+
+float VanHateren06Lut::operator()(float val) const {
+    const float index = lhdrengine::LIM((val - m_minVal) * m_scale, 0.f, static_cast<float>(lutSize - 1));
+    const int lowerIndex = index;
+    const int upperIndex = std::min(lowerIndex + 1, lutSize - 1);
+    return 1.f - lhdrengine::intp(index - lowerIndex, m_lookup[upperIndex], m_lookup[lowerIndex]) / m_maxIos;
+}
+
+int tmo_vanhateren06(Array2Df &L, float pupil_area, Progress &ph) {
+    pfs::utils::TraceSpan trace_span(
+        "tmo_vanhateren06", L.size() * sizeof(float));
+
+    ph.setValue(5);
+
+    pupil_area = std::max(pupil_area, 0.f);
+
+    const size_t w = L.getCols();
+    const size_t h = L.getRows();
+    const size_t size = w*h;
+
+    float minVal = std::numeric_limits<float>::max();
+    float maxVal = std::numeric_limits<float>::min();
+
+#ifdef _OPENMP
+    #pragma omp parallel for reduction(min:minVal) reduction(max:maxVal)
+#endif
+    for (size_t i = 0; i < size; ++i) {
+        const float val = vanhateren06_response(L(i), pupil_area);
+        minVal = std::min(minVal, val);
+        maxVal = std::max(maxVal, val);
+        L(i) = val;
+    }
+
+    ph.setValue(33);
+
+    const VanHateren06Lut lookup(minVal, maxVal);
 
     ph.setValue(66);
 
@@ -126,19 +141,10 @@ int tmo_vanhateren06(Array2Df &L, float pupil_area, Progress &ph) {
     #pragma omp parallel for schedule(dynamic, w * 16)
 #endif
     for (size_t i = 0; i < size; i++) {
-        const float index = lhdrengine::LIM((L(i) - minVal) * scale, 0.f, static_cast<float>(lutSize - 1));
-        const int lowerIndex = index;
-        const int upperIndex = std::min(lowerIndex + 1, lutSize - 1);
-        L(i) = 1.f - lhdrengine::intp(index - lowerIndex, lookup[upperIndex], lookup[lowerIndex]) / maxIos;
+        L(i) = lookup(L(i));
     }
 
     ph.setValue(99);
 
-#ifdef TIMER_PROFILING
-    stop_watch.stop_and_update();
-    cout << endl;
-    cout << "tmo_vanhateren06 = " << stop_watch.get_time() << " msec" << endl;
-#endif
-
     return 0;
 }
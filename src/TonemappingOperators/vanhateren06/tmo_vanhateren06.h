@@ -30,6 +30,8 @@
 #ifndef TMO_VANHATEREN_H
 #define TMO_VANHATEREN_H
 
+#include <vector>
+
 #include <Libpfs/array2d_fwd.h>
 
 namespace pfs {
@@ -44,4 +46,24 @@ class Progress;
 //!
 int tmo_vanhateren06(pfs::Array2Df &L, float pupil_area, pfs::Progress &ph);
 
+//! \brief Intermediate response of the cone model to luminance \a L
+//! \note the response grows with \a L
+float vanhateren06_response(float L, float pupil_area);
+
+//! \brief Tabulated output of the cone model over the range [minVal, maxVal]
+//! of the responses found in an image
+class VanHateren06Lut {
+   public:
+    VanHateren06Lut(float minVal, float maxVal);
+
+    //! \brief tone mapped value of the response \a val
+    float operator()(float val) const;
+
+   private:
+    float m_minVal;
+    float m_scale;
+    float m_maxIos;
+    std::vector<float> m_lookup;
+};
+
 #endif  // TMO_VANHATEREN_H
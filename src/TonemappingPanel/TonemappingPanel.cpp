@@ -1547,6 +1547,10 @@ void TonemappingPanel::updatedHDR(pfs::Frame *f) {
     m_currentFrame = f;
 }
 
+void TonemappingPanel::setHdrPreview(const HdrPreviewPtr &preview) {
+    m_hdrPreview = preview;
+}
+
 /*
  * This function should set the entire status.
  * Currently I'm only interested in changing the TM operator
@@ -1691,7 +1695,8 @@ void TonemappingPanel::saveParameters() {
 }
 
 void TonemappingPanel::loadParameters() {
-    TonemappingSettings dialog(this, m_currentFrame, m_databaseconnection);
+    TonemappingSettings dialog(this, m_currentFrame, m_databaseconnection,
+                               m_hdrPreview);
 
     if (dialog.exec()) {
         LuminanceOptions *luminance_options = new LuminanceOptions;
@@ -106,6 +106,7 @@ class TonemappingPanel : public QWidget {
     int m_mainWinNumber;
 
     pfs::Frame *m_currentFrame;
+    HdrPreviewPtr m_hdrPreview;
     float m_autolevelThreshold;
     QScopedPointer<ThresholdWidget> m_thd;
     QScopedPointer<Ui::TonemappingPanel> m_Ui;
@@ -170,6 +171,8 @@ class TonemappingPanel : public QWidget {
    public Q_SLOTS:
     void setEnabled(bool);
     void updatedHDR(pfs::Frame *);
+    //! \brief cached preview of the frames to come, if any
+    void setHdrPreview(const HdrPreviewPtr &preview);
     void updateTonemappingParams(TonemappingOptions *opts);
     void setRealtimePreviews(bool);
     void autoLevels(bool b);
@@ -54,7 +54,8 @@ bool compareByMostUsefulOperators(PreviewLabel *l1, PreviewLabel *l2) {
 }
 }
 
-TonemappingSettings::TonemappingSettings(QWidget *parent, pfs::Frame *frame, QString conn)
+TonemappingSettings::TonemappingSettings(QWidget *parent, pfs::Frame *frame, QString conn,
+                                         const HdrPreviewPtr &preview)
     : QDialog(parent),
       m_frame(frame),
       m_modelPreviews(new QSqlQueryModel()),
@@ -67,6 +68,7 @@ TonemappingSettings::TonemappingSettings(QWidget *parent, pfs::Frame *frame, QSt
     m_Ui->splitter->setStretchFactor(1, 10);
 
     m_previewSettings = new PreviewSettings(m_Ui->scrollArea);
+    m_previewSettings->setHdrPreview(preview);
 
     m_Ui->scrollArea->setWidgetResizable(true);
 
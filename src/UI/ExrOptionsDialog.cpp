@@ -0,0 +1,149 @@
+/**
+ * This file is a part of LuminanceHDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ *
+ */
+
+#include <QtGlobal>
+
+#include "UI/ExrOptionsDialog.h"
+#include "UI/ui_ExrOptionsDialog.h"
+
+namespace {
+const static QString EXR_COMPRESSION_KEY =
+    QStringLiteral("exroptionsdialog/compression");
+const static QString EXR_COMPRESSION_VALUE = QStringLiteral("piz");
+
+const static QString EXR_DWA_LEVEL_KEY =
+    QStringLiteral("exroptionsdialog/dwa_level");
+const static float EXR_DWA_LEVEL_VALUE = 45.f;
+
+const static QString EXR_HALF_KEY = QStringLiteral("exroptionsdialog/half");
+const static bool EXR_HALF_VALUE = false;
+
+const static QString EXR_THREADS_KEY =
+    QStringLiteral("exroptionsdialog/threads");
+const static int EXR_THREADS_VALUE = 0;
+
+// the names are the ones of the exr_compression parameter
+struct Compression {
+    const char *name;
+    const char *description;
+};
+
+const Compression COMPRESSIONS[] = {
+    {"none", QT_TRANSLATE_NOOP("ExrOptionsDialog", "None")},
+    {"rle", QT_TRANSLATE_NOOP("ExrOptionsDialog", "RLE (lossless)")},
+    {"zips", QT_TRANSLATE_NOOP("ExrOptionsDialog",
+                               "ZIP, single scanline (lossless)")},
+    {"zip", QT_TRANSLATE_NOOP("ExrOptionsDialog",
+                              "ZIP, 16 scanlines (lossless)")},
+    {"piz", QT_TRANSLATE_NOOP("ExrOptionsDialog", "PIZ wavelet (lossless)")},
+    {"pxr24", QT_TRANSLATE_NOOP("ExrOptionsDialog", "PXR24 (lossy)")},
+    {"b44", QT_TRANSLATE_NOOP("ExrOptionsDialog", "B44 (lossy)")},
+    {"b44a", QT_TRANSLATE_NOOP("ExrOptionsDialog", "B44A (lossy)")},
+    {"dwaa", QT_TRANSLATE_NOOP("ExrOptionsDialog",
+                               "DWAA, 32 scanlines (lossy)")},
+    {"dwab", QT_TRANSLATE_NOOP("ExrOptionsDialog",
+                               "DWAB, 256 scanlines (lossy)")}};
+}
+
+ExrOptionsDialog::ExrOptionsDialog(const pfs::Params &defaults,
+                                   QWidget *parent)
+    : QDialog(parent),
+      m_ui(new Ui::ExrOptionsDialog),
+      m_options(new LuminanceOptions()) {
+    m_ui->setupUi(this);
+
+    for (const Compression &c : COMPRESSIONS) {
+        m_ui->compressionComboBox->addItem(tr(c.description),
+                                           QString::fromLatin1(c.name));
+    }
+
+    std::string compression;
+    if (!defaults.get("exr_compression", compression)) {
+        compression = m_options->value(EXR_COMPRESSION_KEY,
+                                       EXR_COMPRESSION_VALUE)
+                          .toString()
+                          .toStdString();
+    }
+    int index = m_ui->compressionComboBox->findData(
+        QString::fromStdString(compression).toLower());
+    if (index < 0) {
+        index = m_ui->compressionComboBox->findData(EXR_COMPRESSION_VALUE);
+    }
+    m_ui->compressionComboBox->setCurrentIndex(index);
+
+    float dwaLevel;
+    if (!defaults.get("exr_dwa_level", dwaLevel)) {
+        dwaLevel =
+            m_options->value(EXR_DWA_LEVEL_KEY, EXR_DWA_LEVEL_VALUE).toFloat();
+    }
+    m_ui->dwaLevelSpinBox->setValue(dwaLevel);
+
+    bool half;
+    if (!defaults.get("exr_half", half)) {
+        half = m_options->value(EXR_HALF_KEY, EXR_HALF_VALUE).toBool();
+    }
+    m_ui->halfCheckBox->setChecked(half);
+
+    int threads;
+    if (!defaults.get("exr_threads", threads)) {
+        threads = m_options->value(EXR_THREADS_KEY, EXR_THREADS_VALUE).toInt();
+    }
+    m_ui->threadsSpinBox->setValue(threads);
+
+    connect(m_ui->compressionComboBox,
+            static_cast<void (QComboBox::*)(int)>(
+                &QComboBox::currentIndexChanged),
+            this, &ExrOptionsDialog::updateDwaLevel);
+    updateDwaLevel(m_ui->compressionComboBox->currentIndex());
+
+#ifdef Q_OS_MACOS
+    this->setWindowModality(
+        Qt::WindowModal);  // In OS X, the QMessageBox is modal to the window
+#endif
+}
+
+ExrOptionsDialog::~ExrOptionsDialog() {
+    if (result() != QDialog::Accepted) return;
+
+    m_options->setValue(EXR_COMPRESSION_KEY,
+                        m_ui->compressionComboBox->currentData().toString());
+    m_options->setValue(EXR_DWA_LEVEL_KEY, m_ui->dwaLevelSpinBox->value());
+    m_options->setValue(EXR_HALF_KEY, m_ui->halfCheckBox->isChecked());
+    m_options->setValue(EXR_THREADS_KEY, m_ui->threadsSpinBox->value());
+}
+
+void ExrOptionsDialog::applyTo(pfs::Params &params) const {
+    const QString compression =
+        m_ui->compressionComboBox->currentData().toString();
+    params.set("exr_compression", compression.toStdString());
+    params.set("exr_dwa_level",
+               static_cast<float>(m_ui->dwaLevelSpinBox->value()));
+    params.set("exr_half", m_ui->halfCheckBox->isChecked());
+    params.set("exr_threads", m_ui->threadsSpinBox->value());
+}
+
+void ExrOptionsDialog::updateDwaLevel(int index) {
+    const QString name =
+        m_ui->compressionComboBox->itemData(index).toString();
+    m_ui->dwaLevelSpinBox->setEnabled(name == QLatin1String("dwaa") ||
+                                      name == QLatin1String("dwab"));
+}
@@ -0,0 +1,58 @@
+/**
+ * This file is a part of LuminanceHDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ *
+ */
+#ifndef EXROPTIONSDIALOG_H
+#define EXROPTIONSDIALOG_H
+
+#include <QDialog>
+#include <QScopedPointer>
+
+#include "Common/LuminanceOptions.h"
+
+#include <Libpfs/params.h>
+
+namespace Ui {
+class ExrOptionsDialog;
+}
+
+//! \brief compression, pixel type and threads of a saved OpenEXR file
+class ExrOptionsDialog : public QDialog {
+    Q_OBJECT
+
+   public:
+    //! \brief \a defaults are taken from the exr_* keys, the last choices
+    //! of the user otherwise
+    explicit ExrOptionsDialog(const pfs::Params &defaults = pfs::Params(),
+                              QWidget *parent = 0);
+    ~ExrOptionsDialog();
+
+    //! \brief set the exr_* keys of \a params, as read by EXRWriter
+    void applyTo(pfs::Params &params) const;
+
+   protected slots:
+    void updateDwaLevel(int index);
+
+   private:
+    QScopedPointer<Ui::ExrOptionsDialog> m_ui;
+    QScopedPointer<LuminanceOptions> m_options;
+};
+
+#endif  // EXROPTIONSDIALOG_H
@@ -59,11 +59,14 @@ const pfs::Array2Df *getPrimaryChannel(const pfs::Frame &frame) {
 
 }  // end anonymous namespace
 
-HdrViewer::HdrViewer(pfs::Frame *frame, QWidget *parent, bool ns)
+HdrViewer::HdrViewer(pfs::Frame *frame, QWidget *parent, bool ns,
+                     const HdrPreviewPtr &preview)
     : GenericViewer(frame, parent, ns),
       m_mappingMethod(MAP_GAMMA2_2),
       m_minValue(0.f),
-      m_maxValue(1.f) {
+      m_maxValue(1.f),
+      m_preview(preview),
+      m_loading(frame != nullptr && preview && !preview->matches(*frame)) {
     initUi();
 
     if (frame != nullptr)
@@ -71,7 +74,7 @@ HdrViewer::HdrViewer(pfs::Frame *frame, QWidget *parent, bool ns)
     // I prefer to do everything by hand, so the flow of the calls is clear
     m_lumRange->blockSignals(true);
 
-    m_lumRange->setHistogramImage(getPrimaryChannel(*getFrame()));
+    updateHistogram();
     m_lumRange->fitToDynamicRange();
 
     m_mappingMethod =
@@ -152,12 +155,31 @@ void HdrViewer::updatePixmap() {
 
     refreshPixmap();
 
-    // I need to set the histogram again during the setFrame function
-    m_lumRange->setHistogramImage(getPrimaryChannel(*getFrame()));
-    m_lumRange->fitToDynamicRange();
+    if (m_loading && m_preview->matches(*getFrame())) {
+        // the full resolution frame of the preview shown so far
+        m_loading = false;
+    } else {
+        // I need to set the histogram again during the setFrame function
+        // (the frame has changed: its preview no longer applies)
+        m_loading = false;
+        m_preview.clear();
+        updateHistogram();
+        m_lumRange->fitToDynamicRange();
+    }
     m_lumRange->blockSignals(false);
 }
 
+void HdrViewer::updateHistogram() {
+    if (m_preview && (m_loading || m_preview->matches(*getFrame()))) {
+        m_lumRange->setHistogram(
+            m_preview->histogram, PreviewCache::HISTOGRAM_MIN,
+            PreviewCache::HISTOGRAM_MAX, m_preview->minLuminance,
+            m_preview->maxLuminance);
+    } else {
+        m_lumRange->setHistogramImage(getPrimaryChannel(*getFrame()));
+    }
+}
+
 LuminanceRangeWidget *HdrViewer::lumRange() { return m_lumRange; }
 
 void HdrViewer::updateRangeWindow() {
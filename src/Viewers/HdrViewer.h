@@ -38,6 +38,7 @@
 #include <QScopedPointer>
 #include <iostream>
 
+#include "Core/PreviewCache.h"
 #include "GenericViewer.h"
 
 // Forward declaration
@@ -51,9 +52,18 @@ class HdrViewer : public GenericViewer {
     Q_OBJECT
 
    public:
-    HdrViewer(pfs::Frame *frame, QWidget *parent = 0, bool ns = false);
+    //! \param preview cached preview of \a frame, if any: it spares the
+    //! scan of \a frame for its histogram and dynamic range. If \a frame is
+    //! one of its levels, it stands in for the full resolution frame until
+    //! this one is given to setFrame(), which then keeps the histogram and
+    //! the range window
+    HdrViewer(pfs::Frame *frame, QWidget *parent = 0, bool ns = false,
+              const HdrPreviewPtr &preview = HdrPreviewPtr());
     virtual ~HdrViewer();
 
+    //! \brief preview of the frame, null once the frame has been modified
+    const HdrPreviewPtr &hdrPreview() const { return m_preview; }
+
     LuminanceRangeWidget *lumRange();
 
     QString getFileNamePostFix();
@@ -94,10 +104,14 @@ class HdrViewer : public GenericViewer {
    private:
     void initUi();
     void refreshPixmap();
+    void updateHistogram();
 
     RGBMappingType m_mappingMethod;
     float m_minValue;
     float m_maxValue;
+    HdrPreviewPtr m_preview;
+    //! \brief the frame is a level of m_preview
+    bool m_loading;
 
     QImage *mapFrameToImage(pfs::Frame *in_frame);
 };
@@ -79,6 +79,21 @@ void Histogram::computeLog(const pfs::Array2Df *image, float min, float max) {
     for (int i = 0; i < bins; i++) P[i] /= (float)(count / accuracy);
 }
 
+void Histogram::resample(const float *srcP, int srcBins, float srcMin,
+                         float srcMax, float min, float max) {
+    for (int i = 0; i < bins; i++) P[i] = 0;
+
+    const float srcWidth = (srcMax - srcMin) / (float)srcBins;
+    const float binWidth = (max - min) / (float)bins;
+    for (int i = 0; i < srcBins; i++) {
+        // the center of the source bin
+        float v = srcMin + (i + 0.5f) * srcWidth;
+        int bin = (int)((v - min) / binWidth);
+        if (bin >= bins || bin < 0) continue;
+        P[bin] += srcP[i];
+    }
+}
+
 float Histogram::getMaxP() const {
     float maxP = -1;
     for (int i = 0; i < bins; i++) {
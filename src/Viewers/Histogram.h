@@ -42,6 +42,10 @@ class Histogram {
 
     void computeLog(const pfs::Array2Df *image);
     void computeLog(const pfs::Array2Df *image, float min, float max);
+    //! \brief redistribute the \a srcBins probabilities \a srcP, over
+    //! [\a srcMin, \a srcMax], to the bins of this histogram over [min, max]
+    void resample(const float *srcP, int srcBins, float srcMin, float srcMax,
+                  float min, float max);
 
     int getBins() const { return bins; }
 
@@ -38,6 +38,7 @@
 #include "Viewers/IGraphicsPixmapItem.h"
 #include "Viewers/LdrViewer.h"
 
+#include <Libpfs/colorspace/lcms.h>
 #include <Libpfs/frame.h>
 #include <Libpfs/utils/resourcehandlerlcms.h>
 
@@ -72,7 +73,7 @@ bool doCMSTransform(QImage &qImage, bool doProof, bool doGamutCheck) {
         QFile::encodeName(monitor_fname).constData(), "r"));
 
     utils::ScopedCmsProfile hProof;
-    utils::ScopedCmsTransform xform;
+    colorspace::CmsTransformPtr xform;
 
     // Check whether the output profile is open
     if (!hOut) {
@@ -109,17 +110,17 @@ bool doCMSTransform(QImage &qImage, bool doProof, bool doGamutCheck) {
         cmsUInt16Number alarmCodes[cmsMAXCHANNELS] = {0};
         alarmCodes[1] = 0xFFFF;
         cmsSetAlarmCodes(alarmCodes);
-        xform.reset(cmsCreateProofingTransform(
+        xform = colorspace::getCmsTransform(
             hsRGB.data(), TYPE_BGRA_8,  // TYPE_RGBA_8,
             hOut.data(), TYPE_BGRA_8,   // TYPE_RGBA_8,
-            hProof.data(), INTENT_PERCEPTUAL, INTENT_ABSOLUTE_COLORIMETRIC,
-            dwFlags));
+            INTENT_PERCEPTUAL, dwFlags, hProof.data(),
+            INTENT_ABSOLUTE_COLORIMETRIC);
     } else {
-        xform.reset(cmsCreateTransform(hsRGB.data(),
-                                       TYPE_BGRA_8,  // TYPE_RGBA_8,
-                                       hOut.data(),
-                                       TYPE_BGRA_8,  // TYPE_RGBA_8,
-                                       INTENT_PERCEPTUAL, 0));
+        xform = colorspace::getCmsTransform(hsRGB.data(),
+                                            TYPE_BGRA_8,  // TYPE_RGBA_8,
+                                            hOut.data(),
+                                            TYPE_BGRA_8,  // TYPE_RGBA_8,
+                                            INTENT_PERCEPTUAL);
     }
 
     if (!xform) {
@@ -132,8 +133,10 @@ bool doCMSTransform(QImage &qImage, bool doProof, bool doGamutCheck) {
         return false;
     }
 
-    cmsDoTransform(xform.data(), qImage.bits(), qImage.bits(),
-                   qImage.width() * qImage.height());
+    // in place, a scanline per call, spread over the threads
+    colorspace::RowTransform rowTransform(xform);
+    rowTransform(qImage.bits(), qImage.bytesPerLine(), qImage.bits(),
+                 qImage.bytesPerLine(), qImage.width(), qImage.height());
 
     return true;
 }
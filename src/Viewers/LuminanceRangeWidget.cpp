@@ -58,7 +58,11 @@ LuminanceRangeWidget::LuminanceRangeWidget(QWidget *parent)
       showVP(false),
       valuePointer(0.f),
       histogram(NULL),
-      histogramImage(NULL)
+      histogramImage(NULL),
+      histogramBinsMin(0.f),
+      histogramBinsMax(0.f),
+      imageMin(0.f),
+      imageMax(0.f)
 
 {
     setFrameStyle(QFrame::Panel | QFrame::Sunken);
@@ -102,16 +106,23 @@ void LuminanceRangeWidget::paintEvent(QPaintEvent * /*pe */) {
     }
 
     // Paint histogram
-    if (histogramImage != NULL) {
+    if (histogramImage != NULL || !histogramBins.isEmpty()) {
         if (histogram == NULL || histogram->getBins() != fRect.width()) {
             delete histogram;
-            // Build histogram from at least 5000 pixels
-            int accuracy =
-                histogramImage->getRows() * histogramImage->getCols() / 5000;
-            //       int accuracy =1;
-            if (accuracy < 1) accuracy = 1;
-            histogram = new Histogram(fRect.width(), accuracy);
-            histogram->computeLog(histogramImage, minValue, maxValue);
+            if (histogramImage != NULL) {
+                // Build histogram from at least 5000 pixels
+                int accuracy = histogramImage->getRows() *
+                               histogramImage->getCols() / 5000;
+                //       int accuracy =1;
+                if (accuracy < 1) accuracy = 1;
+                histogram = new Histogram(fRect.width(), accuracy);
+                histogram->computeLog(histogramImage, minValue, maxValue);
+            } else {
+                histogram = new Histogram(fRect.width());
+                histogram->resample(histogramBins.constData(),
+                                    histogramBins.size(), histogramBinsMin,
+                                    histogramBinsMax, minValue, maxValue);
+            }
         }
 
         float maxP = histogram->getMaxP();
@@ -256,23 +267,43 @@ void LuminanceRangeWidget::shrinkRange() {
 
 void LuminanceRangeWidget::setHistogramImage(const pfs::Array2Df *image) {
     histogramImage = image;
+    histogramBins.clear();
+    delete histogram;
+    histogram = NULL;
+    update();
+}
+
+void LuminanceRangeWidget::setHistogram(const QVector<float> &bins,
+                                        float binsMin, float binsMax,
+                                        float min, float max) {
+    histogramImage = NULL;
+    histogramBins = bins;
+    histogramBinsMin = binsMin;
+    histogramBinsMax = binsMax;
+    imageMin = min;
+    imageMax = max;
     delete histogram;
     histogram = NULL;
     update();
 }
 
 void LuminanceRangeWidget::fitToDynamicRange() {
-    if (histogramImage != NULL) {
-        float min = 99999999.0f;
-        float max = -99999999.0f;
-
-        int size = histogramImage->getRows() * histogramImage->getCols();
-        for (int i = 0; i < size; i++) {
-            float v = (*histogramImage)(i);
-            if (v > max)
-                max = v;
-            else if (v < min)
-                min = v;
+    if (histogramImage != NULL || !histogramBins.isEmpty()) {
+        float min = imageMin;
+        float max = imageMax;
+
+        if (histogramImage != NULL) {
+            min = 99999999.0f;
+            max = -99999999.0f;
+
+            int size = histogramImage->getRows() * histogramImage->getCols();
+            for (int i = 0; i < size; i++) {
+                float v = (*histogramImage)(i);
+                if (v > max)
+                    max = v;
+                else if (v < min)
+                    min = v;
+            }
         }
 
         if (min <= 0.000001f)
@@ -28,6 +28,7 @@
 #define LUMINANCERANGE_WIDGET_H
 
 #include <QFrame>
+#include <QVector>
 #include "Libpfs/array2d_fwd.h"
 #include "Viewers/Histogram.h"
 
@@ -77,6 +78,13 @@ class LuminanceRangeWidget : public QFrame {
     Histogram *histogram;
     const pfs::Array2Df *histogramImage;
 
+    // precomputed distribution of log10 values, used without an image
+    QVector<float> histogramBins;
+    float histogramBinsMin;
+    float histogramBinsMax;
+    float imageMin;
+    float imageMax;
+
     QRect getPaintRect() const;
 
    public:
@@ -86,6 +94,11 @@ class LuminanceRangeWidget : public QFrame {
     void setRangeWindowMinMax(float min, float max);
 
     void setHistogramImage(const pfs::Array2Df *image);
+    //! \brief show a precomputed histogram instead of one of an image
+    //! \param bins distribution of log10 values over [\a binsMin, \a binsMax]
+    //! \param min, max extrema of the values, used by fitToDynamicRange()
+    void setHistogram(const QVector<float> &bins, float binsMin, float binsMax,
+                      float min, float max);
 
     void showValuePointer(float value);
     void hideValuePointer();
@@ -0,0 +1,134 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include "BenchmarkCommon.h"
+
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <Libpfs/array2d.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/io/framereaderfactory.h>
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+namespace bench {
+
+float syntheticLuminance(float u, float v) {
+    const float illumination = std::pow(10.f, 5.f * u - 2.f);
+    const float texture =
+        0.6f + 0.4f * std::sin(40.f * u) * std::cos(27.f * v);
+    const float du = u - 0.8f;
+    const float dv = v - 0.3f;
+    const float highlight = 1e4f * std::exp(-(du * du + dv * dv) * 400.f);
+    return illumination * texture + highlight;
+}
+
+void createSynthetic(pfs::Array2Df &L) {
+    const size_t width = L.getCols();
+    const size_t height = L.getRows();
+
+#pragma omp parallel for
+    for (long r = 0; r < (long)height; ++r) {
+        const float v = float(r) / height;
+        for (size_t c = 0; c < width; ++c) {
+            L(c, r) = syntheticLuminance(float(c) / width, v);
+        }
+    }
+}
+
+pfs::Frame *createSynthetic(size_t width, size_t height) {
+    pfs::Frame *frame = new pfs::Frame(width, height);
+    pfs::Channel *X, *Y, *Z;
+    frame->createXYZChannels(X, Y, Z);
+    createSynthetic(*Y);
+
+#pragma omp parallel for
+    for (long r = 0; r < (long)height; ++r) {
+        const float v = float(r) / height;
+        for (size_t c = 0; c < width; ++c) {
+            (*X)(c, r) = (*Y)(c, r) * (0.9f + 0.1f * v);
+            (*Z)(c, r) = (*Y)(c, r) * (1.1f - 0.2f * v);
+        }
+    }
+    return frame;
+}
+
+void addCommonOptions(po::options_description &desc,
+                      vector<string> &inputFiles, const char *scaledTo) {
+    desc.add_options()("help,h", "display this help")(
+        "input,i", po::value<vector<string>>(&inputFiles),
+        (string("real HDR file, scaled to each ") + scaledTo +
+         " (repeatable)")
+            .c_str());
+}
+
+void addWidthOption(po::options_description &desc, vector<int> &widths) {
+    desc.add_options()(
+        "width,w", po::value<vector<int>>(&widths),
+        "width of the inputs, 3:2 for the synthetic scene (repeatable, "
+        "default 1024 and 2048)");
+}
+
+bool parseOptions(int argc, char **argv, const po::options_description &desc,
+                  int &exitCode) {
+    try {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help")) {
+            cout << desc << endl;
+            exitCode = 0;
+            return false;
+        }
+    } catch (std::exception &e) {
+        cerr << e.what() << endl << desc << endl;
+        exitCode = -1;
+        return false;
+    }
+    return true;
+}
+
+void defaultWidths(vector<int> &widths) {
+    if (widths.empty()) {
+        widths.push_back(1024);
+        widths.push_back(2048);
+    }
+}
+
+bool readFrame(const string &filename, pfs::Frame &frame) {
+    try {
+        pfs::io::FrameReaderPtr reader =
+            pfs::io::FrameReaderFactory::open(filename);
+        reader->read(frame, pfs::Params());
+        reader->close();
+    } catch (std::exception &e) {
+        cerr << "Cannot read " << filename << ": " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Scaffolding shared by the benchmarks in test/: synthetic scene,
+//! command line options, reading of the real inputs and timing
+
+#ifndef BENCHMARKCOMMON_H
+#define BENCHMARKCOMMON_H
+
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <Libpfs/array2d_fwd.h>
+#include <Libpfs/utils/msec_timer.h>
+
+namespace pfs {
+class Frame;
+}
+
+namespace bench {
+
+//! \brief luminance at (\a u, \a v) in [0, 1) of a smooth illumination over
+//! 5 decades, with texture and a highlight
+float syntheticLuminance(float u, float v);
+
+//! \brief fill \a L with the synthetic luminance
+void createSynthetic(pfs::Array2Df &L);
+
+//! \brief XYZ frame of the synthetic scene, slightly tinted along the rows
+pfs::Frame *createSynthetic(size_t width, size_t height);
+
+//! \brief add --help and the repeatable --input to \a desc
+void addCommonOptions(boost::program_options::options_description &desc,
+                      std::vector<std::string> &inputFiles,
+                      const char *scaledTo);
+
+//! \brief add the repeatable --width to \a desc
+void addWidthOption(boost::program_options::options_description &desc,
+                    std::vector<int> &widths);
+
+//! \brief parse the command line into \a desc
+//! \return false when the program must exit with \a exitCode (help or
+//! invalid options)
+bool parseOptions(int argc, char **argv,
+                  const boost::program_options::options_description &desc,
+                  int &exitCode);
+
+//! \brief widths used when --width is not given
+void defaultWidths(std::vector<int> &widths);
+
+//! \brief read \a filename into \a frame, reporting the failure on stderr
+bool readFrame(const std::string &filename, pfs::Frame &frame);
+
+//! \brief wall time of \a f in milliseconds
+template <typename F>
+double timeMs(F f) {
+    msec_timer timer;
+    timer.start();
+    f();
+    timer.stop_and_update();
+    return timer.get_time();
+}
+}
+
+#endif  // BENCHMARKCOMMON_H
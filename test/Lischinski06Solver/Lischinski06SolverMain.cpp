@@ -0,0 +1,184 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Time the minimization of Lischinski06 at full resolution and
+//! solved at reduced sizes then upsampled: iterations, wall time, memory of
+//! the solver and distance from the full resolution exposure map, over a
+//! synthetic scene and real HDR files
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <Libpfs/array2d.h>
+#include <Libpfs/colorspace/colorspace.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/manip/resize.h>
+#include <TonemappingOperators/lischinski06/lischinski_minimization.h>
+
+#include "BenchmarkCommon.h"
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+namespace {
+
+//! \brief exposure of each pixel, in stops, that the photographic operator
+//! gives to the middle of its zone (one stop wide), as tmo_lischinski06 does
+//! with the median of the zone
+void targetExposure(const pfs::Array2Df &L, pfs::Array2Df &g) {
+    const float eps = 1e-6f;
+    double logSum = 0.;
+    float minLog = std::numeric_limits<float>::max();
+    float maxLog = -std::numeric_limits<float>::max();
+    for (size_t i = 0; i < L.size(); ++i) {
+        const float stops = std::log2(L(i) + eps);
+        logSum += std::log(L(i) + eps);
+        minLog = std::min(minLog, stops);
+        maxLog = std::max(maxLog, stops);
+    }
+    const float average = std::exp(logSum / L.size());
+    const float white = 1.5f * std::pow(2.f, maxLog - minLog - 5.f);
+
+    for (size_t i = 0; i < L.size(); ++i) {
+        const float zone = std::ceil(std::log2(L(i) + eps) - minLog);
+        const float Rz = std::pow(2.f, minLog + zone - 0.5f);
+        const float Rz2 = Rz * 0.18f / average;
+        const float f = Rz2 * (1.f + Rz2 / (white * white)) / (1.f + Rz2);
+        g(i) = std::log2(f / Rz + eps);
+    }
+}
+
+struct Solve {
+    LischinskiStats stats;
+    double ms;
+    pfs::Array2Df F;
+};
+
+Solve solve(const pfs::Array2Df &L, const pfs::Array2Df &g,
+            size_t maxPixels) {
+    Solve result;
+    result.F = L;
+    pfs::Array2Df target(g);
+
+    result.ms = bench::timeMs([&] {
+        LischinskiMinimization(result.F, target, result.F, 1.0f, 0.4f, 1e-4f,
+                               0.07f, maxPixels, &result.stats);
+    });
+
+    return result;
+}
+
+void print(const string &mode, const Solve &solve, const Solve *full) {
+    cout << "  " << mode << ": solve " << solve.stats.width << "x"
+         << solve.stats.height << ", " << solve.stats.iterations
+         << " iterations, residual " << solve.stats.residual << ", "
+         << solve.ms << " msec, " << solve.stats.bytes / (1024. * 1024.)
+         << " MB";
+    if (full) {
+        double sum = 0.;
+        double maxDiff = 0.;
+        for (size_t i = 0; i < solve.F.size(); ++i) {
+            const double d = std::fabs(solve.F(i) - full->F(i));
+            sum += d * d;
+            maxDiff = std::max(maxDiff, d);
+        }
+        cout << ", difference from full resolution: rms "
+             << std::sqrt(sum / solve.F.size()) << " max " << maxDiff
+             << " stops";
+    }
+    cout << endl;
+}
+
+void compare(const string &name, const pfs::Array2Df &L,
+             const vector<float> &fractions) {
+    pfs::Array2Df g(L.getCols(), L.getRows());
+    targetExposure(L, g);
+
+    cout << name << " " << L.getCols() << "x" << L.getRows() << endl;
+    const Solve full = solve(L, g, std::numeric_limits<size_t>::max());
+    print("full resolution", full, NULL);
+
+    for (size_t f = 0; f < fractions.size(); ++f) {
+        const size_t maxPixels = size_t(L.size() * fractions[f]);
+        std::ostringstream mode;
+        mode << "upsampled from " << fractions[f];
+        print(mode.str(), solve(L, g, maxPixels), &full);
+    }
+}
+}
+
+int main(int argc, char **argv) {
+    vector<int> widths;
+    vector<float> fractions;
+    vector<string> inputFiles;
+
+    po::options_description desc("Allowed options: ");
+    bench::addCommonOptions(desc, inputFiles, "width");
+    bench::addWidthOption(desc, widths);
+    desc.add_options()(
+        "fraction,f", po::value<vector<float>>(&fractions),
+        "fraction of the pixels to solve for, then upsample (repeatable, "
+        "default 0.25 and 0.0625)");
+
+    int exitCode;
+    if (!bench::parseOptions(argc, argv, desc, exitCode)) {
+        return exitCode;
+    }
+    bench::defaultWidths(widths);
+    if (fractions.empty()) {
+        fractions.push_back(0.25f);
+        fractions.push_back(0.0625f);
+    }
+
+    for (size_t w = 0; w < widths.size(); ++w) {
+        pfs::Array2Df L(widths[w], widths[w] * 2 / 3);
+        bench::createSynthetic(L);
+        compare("synthetic", L, fractions);
+    }
+
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+        pfs::Frame frame(0, 0);
+        if (!bench::readFrame(inputFiles[i], frame)) {
+            return -1;
+        }
+
+        for (size_t w = 0; w < widths.size(); ++w) {
+            std::unique_ptr<pfs::Frame> resized(
+                pfs::resize(&frame, widths[w], BilinearInterp));
+            pfs::Channel *X, *Y, *Z;
+            resized->getXYZChannels(X, Y, Z);
+            pfs::Array2Df L(resized->getWidth(), resized->getHeight());
+            pfs::transformRGB2Y(X, Y, Z, &L);
+            compare(inputFiles[i], L, fractions);
+        }
+    }
+
+    return 0;
+}
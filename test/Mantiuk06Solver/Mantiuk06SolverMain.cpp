@@ -0,0 +1,191 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Compare the conjugate gradient solver of Mantiuk06 with and
+//! without the multigrid preconditioner: iterations, wall time and distance
+//! between the two solutions, over a synthetic scene and real HDR files.
+//! Also time the re-solve for a slightly higher contrast factor, started
+//! from the first solution as when retuning the operator in the editor
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <Libpfs/array2d.h>
+#include <Libpfs/colorspace/colorspace.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/manip/resize.h>
+#include <Libpfs/progress.h>
+#include <TonemappingOperators/mantiuk06/contrast_domain.h>
+#include <TonemappingOperators/mantiuk06/pyramid.h>
+
+#include "BenchmarkCommon.h"
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+namespace {
+
+struct Solve {
+    int iterations;
+    double ms;
+    pfs::Array2Df Y;
+};
+
+//! \brief log10 luminance of the synthetic scene
+void createSynthetic(pfs::Array2Df &logY) {
+    bench::createSynthetic(logY);
+    for (size_t i = 0; i < logY.size(); ++i) {
+        logY(i) = std::log10(logY(i));
+    }
+}
+
+//! \brief log10 luminance of \a frame, clipped as tmo_mantiuk06_contmap does
+void logLuminance(pfs::Frame &frame, pfs::Array2Df &logY) {
+    pfs::Channel *X, *Y, *Z;
+    frame.getXYZChannels(X, Y, Z);
+    pfs::transformRGB2Y(X, Y, Z, &logY);
+
+    const float clipMin =
+        1e-7f * *std::max_element(logY.begin(), logY.end());
+    for (size_t i = 0; i < logY.size(); ++i) {
+        logY(i) = std::log10(std::max(logY(i), clipMin));
+    }
+}
+
+//! \brief solve for the contrast mapping factor \a contrast and the default
+//! detail factor of the operator, starting from \a logY or \a previous
+Solve solve(const pfs::Array2Df &logY, int itmax, float tol, bool multigrid,
+            float contrast, const pfs::Array2Df *previous = NULL) {
+    PyramidT pp(logY.getRows(), logY.getCols());
+    pp.computeGradients(logY);
+    pp.transformToR(0.8f);
+    pp.scale(contrast);
+    pp.transformToG(0.8f);
+
+    Solve result;
+    result.Y = logY;
+
+    pfs::Progress ph;
+    result.ms = bench::timeMs([&] {
+        result.iterations = transformToLuminance(pp, result.Y, itmax, tol,
+                                                 multigrid, previous, ph);
+    });
+
+    return result;
+}
+
+//! \brief RMS of the difference of \a a and \a b, after removing their mean
+//! (the solution is defined up to a constant)
+double rmsDifference(const pfs::Array2Df &a, const pfs::Array2Df &b) {
+    double meanA = 0.;
+    double meanB = 0.;
+    for (size_t i = 0; i < a.size(); ++i) {
+        meanA += a(i);
+        meanB += b(i);
+    }
+    meanA /= a.size();
+    meanB /= b.size();
+
+    double sum = 0.;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const double d = (a(i) - meanA) - (b(i) - meanB);
+        sum += d * d;
+    }
+    return std::sqrt(sum / a.size());
+}
+
+void compare(const string &name, const pfs::Array2Df &logY, int itmax,
+             float tol) {
+    const Solve cg = solve(logY, itmax, tol, false, 0.1f);
+    const Solve mg = solve(logY, itmax, tol, true, 0.1f);
+    const Solve cgRetune = solve(logY, itmax, tol, false, 0.12f, &cg.Y);
+    const Solve mgRetune = solve(logY, itmax, tol, true, 0.12f, &mg.Y);
+
+    cout << name << " " << logY.getCols() << "x" << logY.getRows()
+         << " tol " << tol << ": cg " << cg.iterations << " iterations "
+         << cg.ms << " msec, multigrid " << mg.iterations << " iterations "
+         << mg.ms << " msec, rms difference " << rmsDifference(cg.Y, mg.Y)
+         << endl
+         << "  retune: cg " << cgRetune.iterations << " iterations "
+         << cgRetune.ms << " msec, multigrid " << mgRetune.iterations
+         << " iterations " << mgRetune.ms << " msec" << endl;
+}
+}
+
+int main(int argc, char **argv) {
+    vector<int> widths;
+    vector<float> tolerances;
+    vector<string> inputFiles;
+    int itmax;
+
+    po::options_description desc("Allowed options: ");
+    bench::addCommonOptions(desc, inputFiles, "width");
+    bench::addWidthOption(desc, widths);
+    desc.add_options()(
+        "tol,t", po::value<vector<float>>(&tolerances),
+        "tolerance of the solvers (repeatable, default 5e-3, the one of the "
+        "operator)")(
+        "itmax", po::value<int>(&itmax)->default_value(200),
+        "maximum number of iterations");
+
+    int exitCode;
+    if (!bench::parseOptions(argc, argv, desc, exitCode)) {
+        return exitCode;
+    }
+    bench::defaultWidths(widths);
+    if (tolerances.empty()) {
+        tolerances.push_back(5e-3f);
+    }
+
+    for (size_t w = 0; w < widths.size(); ++w) {
+        pfs::Array2Df logY(widths[w], widths[w] * 2 / 3);
+        createSynthetic(logY);
+        for (size_t t = 0; t < tolerances.size(); ++t) {
+            compare("synthetic", logY, itmax, tolerances[t]);
+        }
+    }
+
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+        pfs::Frame frame(0, 0);
+        if (!bench::readFrame(inputFiles[i], frame)) {
+            return -1;
+        }
+
+        for (size_t w = 0; w < widths.size(); ++w) {
+            std::unique_ptr<pfs::Frame> resized(
+                pfs::resize(&frame, widths[w], BilinearInterp));
+            pfs::Array2Df logY(resized->getWidth(), resized->getHeight());
+            logLuminance(*resized, logY);
+            for (size_t t = 0; t < tolerances.size(); ++t) {
+                compare(inputFiles[i], logY, itmax, tolerances[t]);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfOutputFile.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Libpfs/channel.h"
+#include "Libpfs/frame.h"
+#include "Libpfs/io/exrreader.h"
+#include "Libpfs/io/exrwriter.h"
+
+using namespace pfs;
+
+namespace {
+const char FILENAME[] = "TestEXRLayers.exr";
+const size_t WIDTH = 31;
+const size_t HEIGHT = 18;
+
+void fill(Channel &channel, float offset) {
+    for (size_t i = 0; i < channel.size(); ++i) {
+        channel(i) = offset + 0.25f * i;
+    }
+}
+
+//! \brief frame with X, Y, Z and the channels in \a names
+void createFrame(Frame &frame, const std::vector<std::string> &names) {
+    Channel *X, *Y, *Z;
+    frame.createXYZChannels(X, Y, Z);
+    fill(*X, 1.f);
+    fill(*Y, 2.f);
+    fill(*Z, 3.f);
+    for (size_t c = 0; c < names.size(); ++c) {
+        fill(*frame.createChannel(names[c]), 10.f * (c + 1));
+    }
+}
+
+void expectSameChannel(const Frame &reference, const Frame &frame,
+                       const std::string &name) {
+    const Channel *a = reference.getChannel(name);
+    const Channel *b = frame.getChannel(name);
+    ASSERT_TRUE(a != NULL) << name;
+    ASSERT_TRUE(b != NULL) << name << " was not read back";
+    ASSERT_EQ(a->size(), b->size());
+    for (size_t i = 0; i < a->size(); ++i) {
+        ASSERT_EQ((*a)(i), (*b)(i)) << name << " pixel " << i;
+    }
+}
+
+//! \brief write \a reference and read it back into \a frame
+//! \return number of parts of the file
+int roundTrip(const Frame &reference, Frame &frame,
+              const Params &readParams = Params()) {
+    io::EXRWriter(FILENAME).write(reference, Params());
+
+    int parts = 0;
+    {
+        Imf::MultiPartInputFile file(FILENAME);
+        parts = file.parts();
+    }
+    {
+        io::EXRReader reader(FILENAME);
+        reader.read(frame, readParams);
+    }
+    std::remove(FILENAME);
+    return parts;
+}
+}
+
+TEST(TestEXRLayers, Rgb) {
+    Frame reference(WIDTH, HEIGHT);
+    createFrame(reference, std::vector<std::string>());
+
+    Frame frame;
+    EXPECT_EQ(1, roundTrip(reference, frame));
+    EXPECT_EQ(3u, frame.getChannels().size());
+    expectSameChannel(reference, frame, "X");
+    expectSameChannel(reference, frame, "Y");
+    expectSameChannel(reference, frame, "Z");
+}
+
+TEST(TestEXRLayers, RgbaStaysSinglePart) {
+    std::vector<std::string> names;
+    names.push_back("A");
+    names.push_back("DEPTH");
+    Frame reference(WIDTH, HEIGHT);
+    createFrame(reference, names);
+    reference.getChannel("A")->getTags().setTag("UNIT", "coverage");
+
+    Frame frame;
+    EXPECT_EQ(1, roundTrip(reference, frame));
+    EXPECT_EQ(5u, frame.getChannels().size());
+    expectSameChannel(reference, frame, "X");
+    expectSameChannel(reference, frame, "A");
+    expectSameChannel(reference, frame, "DEPTH");
+    ASSERT_TRUE(frame.getChannel("A") != NULL);
+    EXPECT_EQ("coverage", frame.getChannel("A")->getTags().getTag("UNIT"));
+}
+
+TEST(TestEXRLayers, NamedLayersAreParts) {
+    std::vector<std::string> names;
+    names.push_back("A");
+    names.push_back("weights.w0");
+    names.push_back("weights.w1");
+    names.push_back("mask.m");
+    Frame reference(WIDTH, HEIGHT);
+    createFrame(reference, names);
+    reference.getChannel("weights.w1")->getTags().setTag("EXPOSURE", "2");
+
+    Frame frame;
+    // the radiance with A, then weights and mask
+    EXPECT_EQ(3, roundTrip(reference, frame));
+    EXPECT_EQ(7u, frame.getChannels().size());
+    for (size_t c = 0; c < names.size(); ++c) {
+        expectSameChannel(reference, frame, names[c]);
+    }
+    expectSameChannel(reference, frame, "Y");
+    ASSERT_TRUE(frame.getChannel("weights.w1") != NULL);
+    EXPECT_EQ("2",
+              frame.getChannel("weights.w1")->getTags().getTag("EXPOSURE"));
+}
+
+TEST(TestEXRLayers, RadianceOnly) {
+    std::vector<std::string> names;
+    names.push_back("A");
+    names.push_back("weights.w0");
+    Frame reference(WIDTH, HEIGHT);
+    createFrame(reference, names);
+
+    Params params;
+    params.set("exr_layers", false);
+    Frame frame;
+    roundTrip(reference, frame, params);
+    EXPECT_EQ(3u, frame.getChannels().size());
+    expectSameChannel(reference, frame, "Z");
+}
+
+TEST(TestEXRLayers, SubsampledChannelsAreSkipped) {
+    // even sizes, the chroma is sampled every other pixel and row
+    const int width = 32;
+    const int height = 18;
+    std::vector<float> rgb(width * height, 0.5f);
+    std::vector<float> chroma((width / 2) * (height / 2), 0.25f);
+
+    {
+        Imf::Header header(width, height);
+        Imf::FrameBuffer frameBuffer;
+        const char *names[] = {"R", "G", "B"};
+        for (int c = 0; c < 3; ++c) {
+            header.channels().insert(names[c], Imf::Channel(Imf::FLOAT));
+            frameBuffer.insert(
+                names[c],
+                Imf::Slice(Imf::FLOAT, (char *)rgb.data(), sizeof(float),
+                           sizeof(float) * width));
+        }
+        header.channels().insert("RY", Imf::Channel(Imf::FLOAT, 2, 2));
+        frameBuffer.insert(
+            "RY", Imf::Slice(Imf::FLOAT, (char *)chroma.data(), sizeof(float),
+                             sizeof(float) * (width / 2), 2, 2));
+
+        Imf::OutputFile file(FILENAME, header);
+        file.setFrameBuffer(frameBuffer);
+        file.writePixels(height);
+    }
+
+    Frame frame;
+    {
+        io::EXRReader reader(FILENAME);
+        reader.read(frame, Params());
+    }
+    std::remove(FILENAME);
+
+    EXPECT_EQ(3u, frame.getChannels().size());
+    EXPECT_TRUE(frame.getChannel("RY") == NULL);
+    const Channel *X, *Y, *Z;
+    frame.getXYZChannels(X, Y, Z);
+    ASSERT_TRUE(X && Y && Z);
+    for (size_t i = 0; i < X->size(); ++i) {
+        ASSERT_EQ(0.5f, (*Y)(i));
+    }
+}
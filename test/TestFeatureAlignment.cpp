@@ -0,0 +1,262 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <HdrCreation/feature_alignment.h>
+#include <Libpfs/frame.h>
+
+using namespace pfs;
+
+namespace {
+const int WIDTH = 320;
+const int HEIGHT = 240;
+// side of the grid cells of the blobs of the scene
+const int CELL = 16;
+// the recovered transform may move a pixel by at most this much
+const double TOLERANCE = 0.25;
+
+struct Blob {
+    double x;
+    double y;
+    double sigma;
+    double amplitude;
+};
+
+//! \brief blobs of random size and contrast, one per cell of a grid: they
+//! give corners everywhere and the scene can be sampled anywhere
+class Scene {
+   public:
+    Scene() : m_cellsX(WIDTH / CELL + 2), m_cellsY(HEIGHT / CELL + 2) {
+        srand(WIDTH * HEIGHT);
+        for (int i = 0; i < m_cellsX * m_cellsY; ++i) {
+            Blob b;
+            b.x = ((i % m_cellsX) - 1 + 0.25 + 0.5 * uniform()) * CELL;
+            b.y = ((i / m_cellsX) - 1 + 0.25 + 0.5 * uniform()) * CELL;
+            b.sigma = 1.5 + 1.5 * uniform();
+            b.amplitude = 0.5 + 1.5 * uniform();
+            m_blobs.push_back(b);
+        }
+    }
+
+    double operator()(double x, double y) const {
+        const int cx = static_cast<int>(std::floor(x / CELL)) + 1;
+        const int cy = static_cast<int>(std::floor(y / CELL)) + 1;
+        double value = 0.1;
+        for (int j = cy - 1; j <= cy + 1; ++j) {
+            for (int i = cx - 1; i <= cx + 1; ++i) {
+                if (i < 0 || j < 0 || i >= m_cellsX || j >= m_cellsY) {
+                    continue;
+                }
+                const Blob &b = m_blobs[j * m_cellsX + i];
+                const double dx = x - b.x;
+                const double dy = y - b.y;
+                value += b.amplitude * std::exp(-(dx * dx + dy * dy) /
+                                                (2. * b.sigma * b.sigma));
+            }
+        }
+        return value;
+    }
+
+   private:
+    static double uniform() { return double(rand()) / RAND_MAX; }
+
+    int m_cellsX;
+    int m_cellsY;
+    std::vector<Blob> m_blobs;
+};
+
+//! \brief maps the pixels of a frame to the scene, row major 3x3
+struct Transform {
+    double m[9];
+
+    void apply(double x, double y, double &u, double &v) const {
+        const double w = m[6] * x + m[7] * y + m[8];
+        u = (m[0] * x + m[1] * y + m[2]) / w;
+        v = (m[3] * x + m[4] * y + m[5]) / w;
+    }
+};
+
+Transform identity() {
+    Transform t = {{1., 0., 0., 0., 1., 0., 0., 0., 1.}};
+    return t;
+}
+
+Transform translation(double dx, double dy) {
+    Transform t = {{1., 0., dx, 0., 1., dy, 0., 0., 1.}};
+    return t;
+}
+
+//! \brief rotation by \a degrees around the center, with a slight
+//! perspective
+Transform homography(double degrees, double perspective) {
+    const double a = degrees * M_PI / 180.;
+    const double c = std::cos(a);
+    const double s = std::sin(a);
+    const double cx = WIDTH / 2.;
+    const double cy = HEIGHT / 2.;
+    Transform t = {{c, -s, cx - c * cx + s * cy, s, c, cy - s * cx - c * cy,
+                    perspective, 0., 1. - perspective * cx}};
+    return t;
+}
+
+FramePtr render(const Scene &scene, const Transform &t, float exposure) {
+    FramePtr frame(new Frame(WIDTH, HEIGHT));
+    Channel *X, *Y, *Z;
+    frame->createXYZChannels(X, Y, Z);
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            double u, v;
+            t.apply(x, y, u, v);
+            const float value = exposure * scene(u, v);
+            (*X)(x, y) = (*Y)(x, y) = (*Z)(x, y) = value;
+        }
+    }
+    return frame;
+}
+
+//! \brief displacement between \a aligned and \a reference around (\a x,
+//! \a y), by least squares on the gradients of the reference
+void displacement(const Channel &reference, const Channel &aligned,
+                  float exposure, int x, int y, double &dx, double &dy) {
+    const int radius = 12;
+    double a = 0., b = 0., c = 0., ex = 0., ey = 0.;
+    for (int j = y - radius; j <= y + radius; ++j) {
+        for (int i = x - radius; i <= x + radius; ++i) {
+            const double gx = 0.5 * (reference(i + 1, j) - reference(i - 1, j));
+            const double gy = 0.5 * (reference(i, j + 1) - reference(i, j - 1));
+            const double diff = aligned(i, j) / exposure - reference(i, j);
+            a += gx * gx;
+            b += gx * gy;
+            c += gy * gy;
+            ex += gx * diff;
+            ey += gy * diff;
+        }
+    }
+    const double det = a * c - b * b;
+    ASSERT_GT(det, 0.);
+    dx = -(c * ex - b * ey) / det;
+    dy = -(a * ey - b * ex) / det;
+}
+
+void checkAligned(const Frame &reference, const Frame &aligned,
+                  float exposure) {
+    const Channel *refY = reference.getChannel("Y");
+    const Channel *alignedY = aligned.getChannel("Y");
+    ASSERT_TRUE(refY && alignedY);
+    // away from the borders, where the warped frames have no data
+    for (int y = 40; y < HEIGHT - 40; y += 40) {
+        for (int x = 40; x < WIDTH - 40; x += 40) {
+            double dx = 0., dy = 0.;
+            displacement(*refY, *alignedY, exposure, x, y, dx, dy);
+            EXPECT_LT(std::fabs(dx), TOLERANCE) << "at " << x << ", " << y;
+            EXPECT_LT(std::fabs(dy), TOLERANCE) << "at " << x << ", " << y;
+        }
+    }
+}
+
+void align(const Transform &first, const Transform &last) {
+    const Scene scene;
+    const float exposures[3] = {0.25f, 1.f, 4.f};
+    const Transform transforms[3] = {first, identity(), last};
+
+    std::vector<FramePtr> frames;
+    for (int i = 0; i < 3; ++i) {
+        frames.push_back(render(scene, transforms[i], exposures[i]));
+    }
+    const FramePtr reference = render(scene, identity(), 1.f);
+
+    ASSERT_TRUE(libhdr::feature_alignment(frames));
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(size_t(WIDTH), frames[i]->getWidth());
+        ASSERT_EQ(size_t(HEIGHT), frames[i]->getHeight());
+        checkAligned(*reference, *frames[i], exposures[i]);
+    }
+}
+
+bool sameFrames(const Frame &a, const Frame &b) {
+    const Channel *aY = a.getChannel("Y");
+    const Channel *bY = b.getChannel("Y");
+    if (!aY || !bY || aY->size() != bY->size()) return false;
+    for (size_t i = 0; i < aY->size(); ++i) {
+        if ((*aY)(i) != (*bY)(i)) return false;
+    }
+    return true;
+}
+}
+
+TEST(TestFeatureAlignment, Translation) {
+    align(translation(6.5, -3.25), translation(-4., 5.));
+}
+
+TEST(TestFeatureAlignment, Homography) {
+    align(homography(-1.5, 0.), homography(2., 2e-5));
+}
+
+TEST(TestFeatureAlignment, FeaturelessFramesAreKept) {
+    // nothing to register: the frames must come back untouched
+    std::vector<FramePtr> frames;
+    std::vector<FramePtr> copies;
+    for (int i = 0; i < 3; ++i) {
+        for (int c = 0; c < 2; ++c) {
+            FramePtr frame(new Frame(WIDTH, HEIGHT));
+            Channel *X, *Y, *Z;
+            frame->createXYZChannels(X, Y, Z);
+            X->fill(0.5f * (i + 1));
+            Y->fill(0.5f * (i + 1));
+            Z->fill(0.5f * (i + 1));
+            (c ? copies : frames).push_back(frame);
+        }
+    }
+
+    EXPECT_FALSE(libhdr::feature_alignment(frames));
+    ASSERT_EQ(3u, frames.size());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(sameFrames(*copies[i], *frames[i]));
+    }
+}
+
+TEST(TestFeatureAlignment, DegenerateInputs) {
+    // no frames, a single frame and frames smaller than a descriptor patch
+    std::vector<FramePtr> frames;
+    EXPECT_TRUE(libhdr::feature_alignment(frames));
+
+    const Scene scene;
+    frames.push_back(render(scene, identity(), 1.f));
+    EXPECT_TRUE(libhdr::feature_alignment(frames));
+
+    frames.clear();
+    for (int i = 0; i < 2; ++i) {
+        FramePtr frame(new Frame(9, 7));
+        Channel *X, *Y, *Z;
+        frame->createXYZChannels(X, Y, Z);
+        for (size_t p = 0; p < X->size(); ++p) {
+            (*X)(p) = (*Y)(p) = (*Z)(p) = float(p % 5 + i);
+        }
+        frames.push_back(frame);
+    }
+    EXPECT_FALSE(libhdr::feature_alignment(frames));
+    EXPECT_EQ(9u, frames[0]->getWidth());
+    EXPECT_EQ(7u, frames[1]->getHeight());
+}
@@ -23,6 +23,8 @@
 
 #include <Libpfs/array2d.h>
 #include <Libpfs/frame.h>
+#include <Libpfs/manip/copy.h>
+#include <Libpfs/utils/scratchallocator.h>
 
 #include "SeqInt.h"
 #include "CompareVector.h"
@@ -126,3 +128,31 @@ TEST(TestArray2D, Ctor)
         compareVectors(array2d_v2.data(), array2d_2.data(), array2d.size());
     }
 }
+
+TEST(TestArray2D, ScratchStorage)
+{
+    typedef pfs::Array2D<int> array2d_int_t;
+    using pfs::utils::ScratchStorage;
+
+    ScratchStorage::setThreshold(64*1024);
+
+    {
+        array2d_int_t small(10, 10);
+        EXPECT_EQ(ScratchStorage::mappedBytes(), 0u);
+
+        array2d_int_t big(300, 200);
+#ifndef _WIN32
+        EXPECT_GE(ScratchStorage::mappedBytes(), big.size()*sizeof(int));
+#endif
+        std::generate(big.begin(), big.end(), SeqInt());
+
+        array2d_int_t bigCopy(300, 200);
+        pfs::copy(&big, &bigCopy);
+        compareVectors(big.data(), bigCopy.data(), big.size());
+
+        EXPECT_EQ(big(299, 199), 300*200 - 1);
+    }
+    EXPECT_EQ(ScratchStorage::mappedBytes(), 0u);
+
+    ScratchStorage::setThreshold(0);
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include <lcms2.h>
+
+#include "Libpfs/colorspace/lcms.h"
+#include "Libpfs/utils/resourcehandlerlcms.h"
+
+using namespace pfs::colorspace;
+using pfs::utils::ScopedCmsProfile;
+
+namespace {
+//! \brief sRGB primaries with a linear response: same color space as
+//! cmsCreate_sRGBProfile(), different ICC data
+cmsHPROFILE createLinearRGBProfile() {
+    cmsCIExyY whitePoint;
+    cmsWhitePointFromTemp(&whitePoint, 6504);
+    cmsCIExyYTRIPLE primaries = {
+        {0.64, 0.33, 1.0}, {0.30, 0.60, 1.0}, {0.15, 0.06, 1.0}};
+    cmsToneCurve *linear = cmsBuildGamma(NULL, 1.0);
+    cmsToneCurve *curves[3] = {linear, linear, linear};
+    cmsHPROFILE profile = cmsCreateRGBProfile(&whitePoint, &primaries, curves);
+    cmsFreeToneCurve(linear);
+    return profile;
+}
+
+std::vector<unsigned char> saveProfile(cmsHPROFILE profile) {
+    cmsUInt32Number size = 0;
+    cmsSaveProfileToMem(profile, NULL, &size);
+    std::vector<unsigned char> iccData(size);
+    cmsSaveProfileToMem(profile, iccData.data(), &size);
+    return iccData;
+}
+}
+
+class TestLcmsTransformCache : public ::testing::Test {
+   protected:
+    void SetUp() { clearCmsTransformCache(); }
+    void TearDown() { clearCmsTransformCache(); }
+};
+
+TEST_F(TestLcmsTransformCache, SameProfilesAndIntent) {
+    // distinct handles of the same profiles
+    ScopedCmsProfile input1(cmsCreate_sRGBProfile());
+    ScopedCmsProfile input2(cmsCreate_sRGBProfile());
+    ScopedCmsProfile output(createLinearRGBProfile());
+
+    CmsTransformPtr first =
+        getCmsTransform(input1.data(), TYPE_RGB_8, output.data(),
+                        TYPE_RGB_FLT, INTENT_PERCEPTUAL);
+    CmsTransformPtr second =
+        getCmsTransform(input2.data(), TYPE_RGB_8, output.data(),
+                        TYPE_RGB_FLT, INTENT_PERCEPTUAL);
+    ASSERT_TRUE(static_cast<bool>(first));
+    EXPECT_EQ(first.get(), second.get());
+}
+
+TEST_F(TestLcmsTransformCache, DifferentIntent) {
+    ScopedCmsProfile input(cmsCreate_sRGBProfile());
+    ScopedCmsProfile output(createLinearRGBProfile());
+
+    // all the transforms are kept alive, so that their addresses differ
+    CmsTransformPtr perceptual =
+        getCmsTransform(input.data(), TYPE_RGB_8, output.data(), TYPE_RGB_FLT,
+                        INTENT_PERCEPTUAL);
+    CmsTransformPtr relative =
+        getCmsTransform(input.data(), TYPE_RGB_8, output.data(), TYPE_RGB_FLT,
+                        INTENT_RELATIVE_COLORIMETRIC);
+    ASSERT_TRUE(static_cast<bool>(perceptual));
+    ASSERT_TRUE(static_cast<bool>(relative));
+    EXPECT_NE(perceptual.get(), relative.get());
+
+    EXPECT_EQ(perceptual.get(),
+              getCmsTransform(input.data(), TYPE_RGB_8, output.data(),
+                              TYPE_RGB_FLT, INTENT_PERCEPTUAL)
+                  .get());
+}
+
+TEST_F(TestLcmsTransformCache, DifferentProfile) {
+    ScopedCmsProfile srgb(cmsCreate_sRGBProfile());
+    ScopedCmsProfile linear(createLinearRGBProfile());
+
+    CmsTransformPtr fromSRGB = getCmsTransform(
+        srgb.data(), TYPE_RGB_8, linear.data(), TYPE_RGB_FLT,
+        INTENT_PERCEPTUAL);
+    CmsTransformPtr fromLinear = getCmsTransform(
+        linear.data(), TYPE_RGB_8, linear.data(), TYPE_RGB_FLT,
+        INTENT_PERCEPTUAL);
+    ASSERT_TRUE(static_cast<bool>(fromSRGB));
+    ASSERT_TRUE(static_cast<bool>(fromLinear));
+    EXPECT_NE(fromSRGB.get(), fromLinear.get());
+}
+
+TEST_F(TestLcmsTransformCache, ToSRGB) {
+    ScopedCmsProfile linear(createLinearRGBProfile());
+    ScopedCmsProfile srgb(cmsCreate_sRGBProfile());
+    const std::vector<unsigned char> linearData = saveProfile(linear.data());
+    const std::vector<unsigned char> srgbData = saveProfile(srgb.data());
+    // a copy of the ICC data, as read from another file
+    const std::vector<unsigned char> linearCopy(linearData);
+
+    CmsTransformPtr first =
+        getCmsTransformToSRGB(linearData.data(), linearData.size(),
+                              TYPE_RGB_8, TYPE_RGB_8, INTENT_PERCEPTUAL);
+    CmsTransformPtr second =
+        getCmsTransformToSRGB(linearCopy.data(), linearCopy.size(),
+                              TYPE_RGB_8, TYPE_RGB_8, INTENT_PERCEPTUAL);
+    CmsTransformPtr otherIntent = getCmsTransformToSRGB(
+        linearData.data(), linearData.size(), TYPE_RGB_8, TYPE_RGB_8,
+        INTENT_RELATIVE_COLORIMETRIC);
+    CmsTransformPtr otherProfile =
+        getCmsTransformToSRGB(srgbData.data(), srgbData.size(), TYPE_RGB_8,
+                              TYPE_RGB_8, INTENT_PERCEPTUAL);
+
+    ASSERT_TRUE(static_cast<bool>(first));
+    ASSERT_TRUE(static_cast<bool>(otherIntent));
+    ASSERT_TRUE(static_cast<bool>(otherProfile));
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_NE(first.get(), otherIntent.get());
+    EXPECT_NE(first.get(), otherProfile.get());
+}
+
+TEST_F(TestLcmsTransformCache, Clear) {
+    ScopedCmsProfile input(cmsCreate_sRGBProfile());
+    ScopedCmsProfile output(createLinearRGBProfile());
+
+    CmsTransformPtr before =
+        getCmsTransform(input.data(), TYPE_RGB_8, output.data(), TYPE_RGB_FLT,
+                        INTENT_PERCEPTUAL);
+    clearCmsTransformCache();
+    CmsTransformPtr after =
+        getCmsTransform(input.data(), TYPE_RGB_8, output.data(), TYPE_RGB_FLT,
+                        INTENT_PERCEPTUAL);
+    ASSERT_TRUE(static_cast<bool>(before));
+    ASSERT_TRUE(static_cast<bool>(after));
+    EXPECT_NE(before.get(), after.get());
+}
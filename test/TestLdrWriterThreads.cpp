@@ -0,0 +1,259 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <jpeglib.h>
+#include <png.h>
+
+#include "Libpfs/channel.h"
+#include "Libpfs/frame.h"
+#include "Libpfs/io/jpegwriter.h"
+#include "Libpfs/io/pngwriter.h"
+
+using namespace pfs;
+
+namespace {
+const char PNG_FILENAME[] = "TestLdrWriterThreads.png";
+const char JPEG_FILENAME[] = "TestLdrWriterThreads.jpg";
+const size_t WIDTH = 67;
+// not multiples of the strips of the writers (128 rows for PNG, 256 for
+// JPEG), up to more than one batch of strips for 2 threads; a restart
+// interval is one row of MCUs, so all but the first have more than 8 of them
+const size_t HEIGHTS[] = {37, 129, 300, 517};
+const int THREADS[] = {2, 4};
+// rows of the bands given to writeRows()
+const size_t BAND_ROWS = 45;
+
+//! \brief gradients with some texture, in [0, 1]
+void createFrame(Frame &frame) {
+    Channel *R, *G, *B;
+    frame.createXYZChannels(R, G, B);
+    const size_t width = frame.getWidth();
+    const size_t height = frame.getHeight();
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            (*R)(x, y) = float(x) / width;
+            (*G)(x, y) = float(y) / height;
+            (*B)(x, y) = float((x * 7 + y * 13) % 31) / 30.f;
+        }
+    }
+}
+
+Params writerParams(int threads) {
+    Params params;
+    params.set("png_threads", threads);
+    params.set("jpeg_threads", threads);
+    params.set("quality", size_t(90));
+    return params;
+}
+
+//! \brief encode \a frame in \a filename, by rows if \a bands
+template <typename Writer>
+void encode(const Frame &frame, const char *filename, int threads,
+            bool bands) {
+    Writer writer(filename);
+    const Params params = writerParams(threads);
+    if (!bands) {
+        ASSERT_TRUE(writer.write(frame, params));
+        return;
+    }
+    const size_t height = frame.getHeight();
+    writer.beginRows(frame.getWidth(), height, params);
+    for (size_t first = 0; first < height; first += BAND_ROWS) {
+        const size_t rows = std::min(BAND_ROWS, height - first);
+        Frame band(frame.getWidth(), rows);
+        Channel *R, *G, *B;
+        band.createXYZChannels(R, G, B);
+        const Channel *fR, *fG, *fB;
+        frame.getXYZChannels(fR, fG, fB);
+        for (size_t y = 0; y < rows; ++y) {
+            for (size_t x = 0; x < frame.getWidth(); ++x) {
+                (*R)(x, y) = (*fR)(x, first + y);
+                (*G)(x, y) = (*fG)(x, first + y);
+                (*B)(x, y) = (*fB)(x, first + y);
+            }
+        }
+        writer.writeRows(band);
+    }
+    ASSERT_TRUE(writer.endRows());
+}
+
+struct Image {
+    Image() : width(0), height(0), warnings(0) {}
+
+    size_t width;
+    size_t height;
+    int warnings;
+    std::vector<unsigned char> pixels;
+};
+
+struct PngErrors {
+    jmp_buf jump;
+    int warnings;
+};
+
+void pngError(png_structp png, png_const_charp) {
+    longjmp(static_cast<PngErrors *>(png_get_error_ptr(png))->jump, 1);
+}
+
+void pngWarning(png_structp png, png_const_charp) {
+    ++static_cast<PngErrors *>(png_get_error_ptr(png))->warnings;
+}
+
+//! \return false if libpng fails
+bool decodePng(const char *filename, Image &image) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) return false;
+
+    PngErrors errors;
+    errors.warnings = 0;
+    png_structp png =
+        png_create_read_struct(PNG_LIBPNG_VER_STRING, &errors, pngError,
+                               pngWarning);
+    png_infop info = png_create_info_struct(png);
+    std::vector<png_bytep> rows;
+    if (setjmp(errors.jump)) {
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_read_info(png, info);
+    image.width = png_get_image_width(png, info);
+    image.height = png_get_image_height(png, info);
+    const size_t rowBytes = png_get_rowbytes(png, info);
+    image.pixels.resize(rowBytes * image.height);
+    rows.resize(image.height);
+    for (size_t y = 0; y < image.height; ++y) {
+        rows[y] = image.pixels.data() + y * rowBytes;
+    }
+    png_read_image(png, rows.data());
+    png_read_end(png, NULL);
+    image.warnings = errors.warnings;
+
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(file);
+    return true;
+}
+
+struct JpegErrors {
+    jpeg_error_mgr manager;
+    jmp_buf jump;
+};
+
+void jpegError(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<JpegErrors *>(cinfo->err)->jump, 1);
+}
+
+void jpegMessage(j_common_ptr) {}
+
+//! \return false if libjpeg fails
+bool decodeJpeg(const char *filename, Image &image) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) return false;
+
+    jpeg_decompress_struct cinfo;
+    JpegErrors errors;
+    cinfo.err = jpeg_std_error(&errors.manager);
+    errors.manager.error_exit = jpegError;
+    errors.manager.output_message = jpegMessage;
+    if (setjmp(errors.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        fclose(file);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+    jpeg_start_decompress(&cinfo);
+    image.width = cinfo.output_width;
+    image.height = cinfo.output_height;
+    const size_t rowBytes = cinfo.output_width * cinfo.output_components;
+    image.pixels.resize(rowBytes * image.height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = image.pixels.data() + cinfo.output_scanline * rowBytes;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    image.warnings = errors.manager.num_warnings;
+
+    jpeg_destroy_decompress(&cinfo);
+    fclose(file);
+    return true;
+}
+
+template <typename Writer>
+void compareThreads(const char *filename,
+                    bool (*decode)(const char *, Image &), bool bands) {
+    for (size_t h = 0; h < sizeof(HEIGHTS) / sizeof(HEIGHTS[0]); ++h) {
+        Frame frame(WIDTH, HEIGHTS[h]);
+        createFrame(frame);
+
+        Image reference;
+        encode<Writer>(frame, filename, 1, bands);
+        ASSERT_TRUE(decode(filename, reference)) << "height " << HEIGHTS[h];
+        ASSERT_EQ(0, reference.warnings);
+        ASSERT_EQ(WIDTH, reference.width);
+        ASSERT_EQ(HEIGHTS[h], reference.height);
+
+        for (size_t t = 0; t < sizeof(THREADS) / sizeof(THREADS[0]); ++t) {
+            Image image;
+            encode<Writer>(frame, filename, THREADS[t], bands);
+            ASSERT_TRUE(decode(filename, image))
+                << "height " << HEIGHTS[h] << ", " << THREADS[t]
+                << " threads";
+            EXPECT_EQ(0, image.warnings)
+                << "height " << HEIGHTS[h] << ", " << THREADS[t]
+                << " threads";
+            ASSERT_EQ(reference.width, image.width);
+            ASSERT_EQ(reference.height, image.height);
+            EXPECT_TRUE(reference.pixels == image.pixels)
+                << "height " << HEIGHTS[h] << ", " << THREADS[t]
+                << " threads";
+        }
+    }
+    std::remove(filename);
+}
+}
+
+TEST(TestLdrWriterThreads, Png) {
+    compareThreads<io::PngWriter>(PNG_FILENAME, decodePng, false);
+}
+
+TEST(TestLdrWriterThreads, PngRows) {
+    compareThreads<io::PngWriter>(PNG_FILENAME, decodePng, true);
+}
+
+TEST(TestLdrWriterThreads, Jpeg) {
+    compareThreads<io::JpegWriter>(JPEG_FILENAME, decodeJpeg, false);
+}
+
+TEST(TestLdrWriterThreads, JpegRows) {
+    compareThreads<io::JpegWriter>(JPEG_FILENAME, decodeJpeg, true);
+}
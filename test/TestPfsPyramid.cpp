@@ -0,0 +1,323 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+
+#include <Libpfs/array2d.h>
+#include <Libpfs/manip/pyramid.h>
+
+using ::testing::TestWithParam;
+using ::testing::Values;
+using ::testing::Combine;
+
+namespace {
+const float TOLERANCE = 1e-5f;
+// the fractions of the pixels of odd sides are computed in single
+// precision, as the original downsampling of Mantiuk06
+const float BOX_TOLERANCE = 1e-4f;
+
+//! \brief weights of a 1-D reduce: weights[k][x] is the weight of the input
+//! x in the output k, taps out of the input left out
+typedef std::vector<std::vector<double> > Weights;
+
+inline size_t clampIndex(int i, size_t n) {
+    return std::min(static_cast<size_t>(std::max(i, 0)), n - 1);
+}
+
+//! \brief [1 2 1] / 4 blur, then average of each 2x2 block, as the removed
+//! createGaussianPyramids() of Fattal02
+void reduceBinomial(const pfs::Array2Df &in, pfs::Array2Df &out) {
+    const int cols = in.getCols();
+    const int rows = in.getRows();
+    pfs::Array2Df tmp(cols, rows);
+    pfs::Array2Df blur(cols, rows);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            tmp(x, y) = 0.25f * in(clampIndex(x - 1, cols), y) +
+                        0.5f * in(x, y) +
+                        0.25f * in(clampIndex(x + 1, cols), y);
+        }
+    }
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            blur(x, y) = 0.25f * tmp(x, clampIndex(y - 1, rows)) +
+                         0.5f * tmp(x, y) +
+                         0.25f * tmp(x, clampIndex(y + 1, rows));
+        }
+    }
+    for (size_t y = 0; y < out.getRows(); ++y) {
+        for (size_t x = 0; x < out.getCols(); ++x) {
+            out(x, y) = 0.25f * (blur(2 * x, 2 * y) + blur(2 * x + 1, 2 * y) +
+                                 blur(2 * x, 2 * y + 1) +
+                                 blur(2 * x + 1, 2 * y + 1));
+        }
+    }
+}
+
+//! \brief 5x5 kernel of Burt and Adelson, as the removed constructNext() of
+//! Ashikhmin02
+void reduceBurtAdelson(const pfs::Array2Df &in, pfs::Array2Df &out) {
+    static const double W[] = {0.05, 0.25, 0.4, 0.25, 0.05};
+    for (size_t y = 0; y < out.getRows(); ++y) {
+        for (size_t x = 0; x < out.getCols(); ++x) {
+            double sum = 0.;
+            for (int n = -2; n < 3; ++n) {
+                for (int m = -2; m < 3; ++m) {
+                    sum += W[m + 2] * W[n + 2] *
+                           in(clampIndex(2 * x + m, in.getCols()),
+                              clampIndex(2 * y + n, in.getRows()));
+                }
+            }
+            out(x, y) = sum;
+        }
+    }
+}
+
+//! \brief average over the area of each output pixel, as the removed
+//! matrixDownsampleFull() of Mantiuk06
+void reduceBoxFull(const pfs::Array2Df &in, pfs::Array2Df &out) {
+    const size_t inCols = in.getCols();
+    const size_t inRows = in.getRows();
+    const size_t outCols = out.getCols();
+    const size_t outRows = out.getRows();
+
+    const float dx = static_cast<float>(inCols) / outCols;
+    const float dy = static_cast<float>(inRows) / outRows;
+    const float normalize = 1.0f / (dx * dy);
+
+    for (size_t y = 0; y < outRows; y++) {
+        const size_t iy1 = (y * inRows) / outRows;
+        const size_t iy2 = ((y + 1) * inRows) / outRows;
+        const float fy1 = (iy1 + 1) - y * dy;
+        const float fy2 = (y + 1) * dy - iy2;
+
+        for (size_t x = 0; x < outCols; x++) {
+            const size_t ix1 = (x * inCols) / outCols;
+            const size_t ix2 = ((x + 1) * inCols) / outCols;
+            const float fx1 = (ix1 + 1) - x * dx;
+            const float fx2 = (x + 1) * dx - ix2;
+
+            float pixVal = 0.0f;
+            for (size_t i = iy1; i <= iy2 && i < inRows; i++) {
+                const float factory =
+                    i == iy1 ? fy1 : (i == iy2 ? fy2 : 1.0f);
+                for (size_t j = ix1; j <= ix2 && j < inCols; j++) {
+                    const float factorx =
+                        j == ix1 ? fx1 : (j == ix2 ? fx2 : 1.0f);
+                    pixVal += in(j, i) * factorx * factory;
+                }
+            }
+            out(x, y) = pixVal * normalize;
+        }
+    }
+}
+
+//! \brief weights of \a kernel reducing \a inSize samples, from the
+//! definitions of the kernels
+Weights reduceWeights(size_t inSize, pfs::PyramidKernel kernel) {
+    static const double BINOMIAL[] = {0.125, 0.375, 0.375, 0.125};
+    static const double BURT_ADELSON[] = {0.05, 0.25, 0.4, 0.25, 0.05};
+
+    const size_t outSize = inSize / 2;
+    Weights weights(outSize, std::vector<double>(inSize, 0.));
+    for (size_t k = 0; k < outSize; ++k) {
+        if (kernel == pfs::PYRAMID_BOX) {
+            // overlap of the input x with [k d, (k + 1) d), over d
+            const double d = double(inSize) / outSize;
+            for (size_t x = 0; x < inSize; ++x) {
+                const double overlap = std::min(x + 1., (k + 1) * d) -
+                                       std::max(double(x), k * d);
+                if (overlap > 0.) weights[k][x] = overlap / d;
+            }
+            continue;
+        }
+        const bool binomial = kernel == pfs::PYRAMID_BINOMIAL;
+        const int first = 2 * int(k) - (binomial ? 1 : 2);
+        const int taps = binomial ? 4 : 5;
+        for (int t = 0; t < taps; ++t) {
+            const int x = first + t;
+            if (x >= 0 && x < int(inSize)) {
+                weights[k][x] = binomial ? BINOMIAL[t] : BURT_ADELSON[t];
+            }
+        }
+    }
+    return weights;
+}
+
+//! \brief 1-D expand of \a in into \a out: the transpose of
+//! the reduce of \a outSize samples, normalized; the samples no output of
+//! reduce reaches take the nearest input
+void expand1D(const std::vector<double> &in, size_t outSize,
+              pfs::PyramidKernel kernel, std::vector<double> &out) {
+    const Weights weights = reduceWeights(outSize, kernel);
+    out.assign(outSize, 0.);
+    for (size_t x = 0; x < outSize; ++x) {
+        double sum = 0.;
+        for (size_t k = 0; k < in.size(); ++k) {
+            out[x] += weights[k][x] * in[k];
+            sum += weights[k][x];
+        }
+        if (sum > 0.) {
+            out[x] /= sum;
+        } else {
+            out[x] = in[std::min(x / 2, in.size() - 1)];
+        }
+    }
+}
+
+//! \brief expand of \a in into \a out, separable
+void expandReference(const pfs::Array2Df &in, pfs::Array2Df &out,
+                     pfs::PyramidKernel kernel) {
+    const size_t inCols = in.getCols();
+    const size_t inRows = in.getRows();
+    // columns first, then rows
+    std::vector<std::vector<double> > tmp(inCols);
+    std::vector<double> line(inRows);
+    for (size_t x = 0; x < inCols; ++x) {
+        for (size_t y = 0; y < inRows; ++y) line[y] = in(x, y);
+        expand1D(line, out.getRows(), kernel, tmp[x]);
+    }
+    std::vector<double> row(inCols);
+    std::vector<double> expanded;
+    for (size_t y = 0; y < out.getRows(); ++y) {
+        for (size_t x = 0; x < inCols; ++x) row[x] = tmp[x][y];
+        expand1D(row, out.getCols(), kernel, expanded);
+        for (size_t x = 0; x < out.getCols(); ++x) {
+            out(x, y) = static_cast<float>(expanded[x]);
+        }
+    }
+}
+
+void compareArrays(const pfs::Array2Df &reference,
+                   const pfs::Array2Df &computed, float tolerance) {
+    ASSERT_EQ(reference.getCols(), computed.getCols());
+    ASSERT_EQ(reference.getRows(), computed.getRows());
+    for (size_t idx = 0; idx < reference.size(); ++idx) {
+        ASSERT_NEAR(reference(idx), computed(idx), tolerance);
+    }
+}
+}
+
+class TestPfsPyramid : public TestWithParam< ::std::tuple<size_t, size_t> > {
+   protected:
+    size_t m_cols;
+    size_t m_rows;
+
+    pfs::Array2Df input;
+
+   public:
+    TestPfsPyramid()
+        : m_cols(::std::get<0>(GetParam())),
+          m_rows(::std::get<1>(GetParam())),
+          input(m_cols, m_rows) {
+        srand(m_cols * m_rows);
+        for (size_t idx = 0; idx < input.size(); ++idx) {
+            input(idx) = static_cast<float>(rand()) / RAND_MAX;
+        }
+    }
+
+    size_t cols() const { return m_cols; }
+    size_t rows() const { return m_rows; }
+};
+
+TEST_P(TestPfsPyramid, ReduceBinomial) {
+    pfs::Array2Df reference(cols() / 2, rows() / 2);
+    pfs::Array2Df computed(cols() / 2, rows() / 2);
+
+    reduceBinomial(input, reference);
+    pfs::reduce(input, computed, pfs::PYRAMID_BINOMIAL);
+
+    compareArrays(reference, computed, TOLERANCE);
+}
+
+TEST_P(TestPfsPyramid, ReduceBurtAdelson) {
+    pfs::Array2Df reference(cols() / 2, rows() / 2);
+    pfs::Array2Df computed(cols() / 2, rows() / 2);
+
+    reduceBurtAdelson(input, reference);
+    pfs::reduce(input, computed, pfs::PYRAMID_BURT_ADELSON);
+
+    compareArrays(reference, computed, TOLERANCE);
+}
+
+TEST_P(TestPfsPyramid, ReduceBox) {
+    pfs::Array2Df reference(cols() / 2, rows() / 2);
+    pfs::Array2Df computed(cols() / 2, rows() / 2);
+
+    // on even sides, the simplified downsampling of Mantiuk06 is the same
+    reduceBoxFull(input, reference);
+    pfs::reduce(input, computed, pfs::PYRAMID_BOX);
+
+    compareArrays(reference, computed, BOX_TOLERANCE);
+}
+
+TEST_P(TestPfsPyramid, Expand) {
+    pfs::Array2Df coarse(cols() / 2, rows() / 2);
+    for (size_t idx = 0; idx < coarse.size(); ++idx) {
+        coarse(idx) = input(idx);
+    }
+    for (int kernel = pfs::PYRAMID_BINOMIAL; kernel <= pfs::PYRAMID_BOX;
+         ++kernel) {
+        SCOPED_TRACE(kernel);
+        pfs::Array2Df reference(cols(), rows());
+        pfs::Array2Df computed(cols(), rows());
+
+        expandReference(coarse, reference,
+                        static_cast<pfs::PyramidKernel>(kernel));
+        pfs::expand(coarse, computed, static_cast<pfs::PyramidKernel>(kernel));
+
+        compareArrays(reference, computed,
+                      kernel == pfs::PYRAMID_BOX ? BOX_TOLERANCE : TOLERANCE);
+    }
+}
+
+TEST_P(TestPfsPyramid, BinomialBlurInPlace) {
+    pfs::Array2Df reference(cols(), rows());
+    pfs::Array2Df computed(input);
+
+    pfs::binomialBlur(input, reference);
+    pfs::binomialBlur(computed, computed);
+
+    compareArrays(reference, computed, 0.f);
+}
+
+TEST_P(TestPfsPyramid, LaplacianCollapse) {
+    for (int kernel = pfs::PYRAMID_BINOMIAL; kernel <= pfs::PYRAMID_BOX;
+         ++kernel) {
+        pfs::GaussianPyramid gaussian(
+            input, 5, static_cast<pfs::PyramidKernel>(kernel));
+        pfs::LaplacianPyramid laplacian(gaussian);
+        ASSERT_EQ(gaussian.numLevels(), laplacian.numLevels());
+
+        pfs::Array2Df computed(cols(), rows());
+        laplacian.collapse(computed);
+
+        compareArrays(input, computed, TOLERANCE);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Test, TestPfsPyramid,
+                        Combine(Values(37, 64, 403), Values(27, 256, 511)));
@@ -0,0 +1,132 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+
+#include "Libpfs/channel.h"
+#include "Libpfs/frame.h"
+#include "Libpfs/io/pfsreader.h"
+#include "Libpfs/io/pfswriter.h"
+#include "Libpfs/utils/scratchallocator.h"
+
+using namespace pfs;
+
+namespace {
+void fill(Frame &frame) {
+    Channel *X, *Y, *Z;
+    frame.createXYZChannels(X, Y, Z);
+    for (size_t i = 0; i < frame.getWidth() * frame.getHeight(); ++i) {
+        (*X)(i) = i * 0.5f;
+        (*Y)(i) = i * 0.25f;
+        (*Z)(i) = -1.f * i;
+    }
+    frame.getTags().setTag("LUMINANCE", "RELATIVE");
+}
+
+void roundTrip(size_t width, size_t height, size_t mappedChannels) {
+    const std::string filename("TestPfsReader.pfs");
+
+    Frame reference(width, height);
+    fill(reference);
+    io::PfsWriter(filename).write(reference, Params());
+
+    const size_t mappedBefore = utils::ScratchStorage::mappedBytes();
+    Frame frame;
+    {
+        io::PfsReader reader(filename);
+        reader.read(frame, Params());
+    }
+    std::remove(filename.c_str());
+#ifndef _WIN32
+    EXPECT_EQ(mappedChannels * width * height * sizeof(float),
+              utils::ScratchStorage::mappedBytes() - mappedBefore);
+#endif
+
+    ASSERT_EQ(width, frame.getWidth());
+    ASSERT_EQ(height, frame.getHeight());
+    EXPECT_EQ(1u, frame.getTags().size());
+
+    const Channel *X, *Y, *Z;
+    const Channel *rX, *rY, *rZ;
+    frame.getXYZChannels(X, Y, Z);
+    reference.getXYZChannels(rX, rY, rZ);
+    ASSERT_TRUE(X && Y && Z);
+    for (size_t i = 0; i < width * height; ++i) {
+        ASSERT_EQ((*rX)(i), (*X)(i));
+        ASSERT_EQ((*rY)(i), (*Y)(i));
+        ASSERT_EQ((*rZ)(i), (*Z)(i));
+    }
+
+    // mapped channels are copy-on-write: the file is gone, the data stays
+    Channel *wX = frame.getChannel("X");
+    (*wX)(0) = 42.f;
+    EXPECT_EQ(42.f, (*wX)(0));
+}
+}
+
+TEST(TestPfsReader, AlignedChannels) {
+    // every channel starts on PFS_DATA_ALIGNMENT: all of them can be mapped
+    roundTrip(64, 48, 3);
+}
+
+TEST(TestPfsReader, UnalignedChannels) {
+    // only the first channel is aligned: the others are read as usual
+    roundTrip(7, 5, 1);
+}
+
+TEST(TestPfsReader, MappedChannelsAreReleased) {
+    const size_t before = utils::ScratchStorage::mappedBytes();
+    roundTrip(64, 48, 3);
+    EXPECT_EQ(before, utils::ScratchStorage::mappedBytes());
+}
+
+TEST(TestPfsReader, SaveOverMappedFile) {
+    // the channels of the frame map the file they are written back to
+    const std::string filename("TestPfsReaderOverwrite.pfs");
+    Frame reference(64, 48);
+    fill(reference);
+    io::PfsWriter(filename).write(reference, Params());
+
+    Frame frame;
+    io::PfsReader(filename).read(frame, Params());
+    (*frame.getChannel("Y"))(1) = 42.f;
+    io::PfsWriter(filename).write(frame, Params());
+
+    Frame result;
+    io::PfsReader(filename).read(result, Params());
+    std::remove(filename.c_str());
+
+    const Channel *X, *Y, *Z;
+    const Channel *rX, *rY, *rZ;
+    result.getXYZChannels(X, Y, Z);
+    reference.getXYZChannels(rX, rY, rZ);
+    ASSERT_TRUE(X && Y && Z);
+    EXPECT_EQ(42.f, (*Y)(1));
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQ((*rX)(i), (*X)(i));
+        if (i != 1) {
+            ASSERT_EQ((*rY)(i), (*Y)(i));
+        }
+        ASSERT_EQ((*rZ)(i), (*Z)(i));
+    }
+}
@@ -48,3 +48,34 @@ TEST(solve_pde_dct, Test1)
     ASSERT_LE(residual, 1e-2);
 }
 
+
+// rows of an odd width have every alignment: the shared plans of the rows
+// must run on all of them, and give the same result on the next call
+TEST(solve_pde_dct, OddWidth)
+{
+    const int width = 99;
+    const int height = 67;
+    Array2Df U(width, height);
+    Array2Df V(width, height);
+    Array2Df divergence(width, height);
+
+    for (int j = 0; j < height; j++)
+    {
+        for (int i = 0; i < width; i++)
+        {
+            divergence(i, j) = std::exp(
+                        -std::pow(-(i-40.f), 2.f)/0.2f -
+                        std::pow(-(j-30.f), 2.f)/0.2f);
+        }
+    }
+
+    Array2Df divergenceCopy(divergence);
+    solve_pde_dct(divergence, U);
+    ASSERT_LE(residual_pde(U, divergence), 1e-2);
+
+    solve_pde_dct(divergenceCopy, V);
+    for (size_t i = 0; i < U.size(); i++)
+    {
+        ASSERT_EQ(U(i), V(i));
+    }
+}
@@ -0,0 +1,309 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Libpfs/channel.h"
+#include "Libpfs/frame.h"
+#include "Libpfs/io/rgbecommon.h"
+#include "Libpfs/io/rgbereader.h"
+#include "Libpfs/io/rgbewriter.h"
+
+using namespace pfs;
+
+namespace {
+const char FILENAME[] = "TestRGBEReader.hdr";
+
+enum Encoding { FLAT, OLD_RLE, RLE };
+
+//! \brief pixels with runs, zeros and small exponents, which the SSE2 path
+//! converts with the scalar code
+std::vector<Trgbe_pixel> createPixels(int width, int height) {
+    srand(width * height);
+    std::vector<Trgbe_pixel> pixels(width * height);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        if (i % width != 0 && rand() % 3 == 0) {
+            pixels[i] = pixels[i - 1];
+            continue;
+        }
+        Trgbe_pixel &p = pixels[i];
+        p.r = 128 + rand() % 128;
+        p.g = rand() % 256;
+        p.b = rand() % 256;
+        switch (rand() % 8) {
+            case 0:
+                p.r = p.g = p.b = p.e = 0;
+                break;
+            case 1:
+                p.e = 1 + rand() % 9;
+                break;
+            default:
+                p.e = 100 + rand() % 60;
+        }
+    }
+    return pixels;
+}
+
+//! \brief run length encode a channel, as the Radiance writer does
+void encodeChannel(const std::vector<Trgbe> &channel,
+                   std::vector<Trgbe> &out) {
+    size_t x = 0;
+    while (x < channel.size()) {
+        size_t run = 1;
+        while (x + run < channel.size() && run < 127 &&
+               channel[x + run] == channel[x]) {
+            ++run;
+        }
+        if (run >= 3) {
+            out.push_back(Trgbe(128 + run));
+            out.push_back(channel[x]);
+            x += run;
+            continue;
+        }
+        size_t count = 1;
+        while (x + count < channel.size() && count < 128 &&
+               !(x + count + 2 < channel.size() &&
+                 channel[x + count] == channel[x + count + 1] &&
+                 channel[x + count] == channel[x + count + 2])) {
+            ++count;
+        }
+        out.push_back(Trgbe(count));
+        out.insert(out.end(), channel.begin() + x,
+                   channel.begin() + x + count);
+        x += count;
+    }
+}
+
+void encodeScanline(const Trgbe_pixel *pixels, int width, Encoding encoding,
+                    std::vector<Trgbe> &out) {
+    if (encoding == RLE) {
+        out.push_back(2);
+        out.push_back(2);
+        out.push_back(Trgbe(width >> 8));
+        out.push_back(Trgbe(width & 0xFF));
+        std::vector<Trgbe> channel(width);
+        for (int ch = 0; ch < 4; ++ch) {
+            for (int x = 0; x < width; ++x) {
+                const Trgbe_pixel &p = pixels[x];
+                channel[x] = ch == 0   ? p.r
+                             : ch == 1 ? p.g
+                             : ch == 2 ? p.b
+                                       : p.e;
+            }
+            encodeChannel(channel, out);
+        }
+        return;
+    }
+    for (int x = 0; x < width;) {
+        const Trgbe_pixel &p = pixels[x];
+        out.push_back(p.r);
+        out.push_back(p.g);
+        out.push_back(p.b);
+        out.push_back(p.e);
+        int run = 1;
+        while (x + run < width && pixels[x + run].r == p.r &&
+               pixels[x + run].g == p.g && pixels[x + run].b == p.b &&
+               pixels[x + run].e == p.e) {
+            ++run;
+        }
+        if (encoding == OLD_RLE && run > 1) {
+            // (1, 1, 1, n) repeats the previous pixel n times
+            out.push_back(1);
+            out.push_back(1);
+            out.push_back(1);
+            out.push_back(Trgbe(run - 1));
+            x += run;
+        } else {
+            ++x;
+        }
+    }
+}
+
+void writeFile(const std::vector<Trgbe_pixel> &pixels, int width, int height,
+               const std::vector<Encoding> &encodings) {
+    std::vector<Trgbe> data;
+    for (int y = 0; y < height; ++y) {
+        encodeScanline(&pixels[y * width], width,
+                       encodings[y % encodings.size()], data);
+    }
+
+    FILE *file = fopen(FILENAME, "wb");
+    ASSERT_TRUE(file != NULL);
+    fprintf(file, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n",
+            height, width);
+    ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), file));
+    fclose(file);
+}
+
+//! \brief conversion of the original, scalar reader
+void rgbe2rgb(const Trgbe_pixel &rgbe, float &r, float &g, float &b) {
+    if (rgbe.e == 0) {
+        r = g = b = 0.f;
+        return;
+    }
+    const double f = ldexp(1.0, rgbe.e - int(128 + 8));
+    r = float(rgbe.r * f);
+    g = float(rgbe.g * f);
+    b = float(rgbe.b * f);
+}
+
+void compare(const std::vector<Trgbe_pixel> &pixels, size_t firstRow,
+             const Frame &frame) {
+    const Channel *X, *Y, *Z;
+    frame.getXYZChannels(X, Y, Z);
+    ASSERT_TRUE(X && Y && Z);
+    for (size_t i = 0; i < frame.getWidth() * frame.getHeight(); ++i) {
+        float r, g, b;
+        rgbe2rgb(pixels[firstRow * frame.getWidth() + i], r, g, b);
+        ASSERT_EQ(r, (*X)(i)) << "pixel " << i;
+        ASSERT_EQ(g, (*Y)(i)) << "pixel " << i;
+        ASSERT_EQ(b, (*Z)(i)) << "pixel " << i;
+    }
+}
+
+void readBack(int width, int height, const std::vector<Encoding> &encodings) {
+    const std::vector<Trgbe_pixel> pixels = createPixels(width, height);
+    writeFile(pixels, width, height, encodings);
+
+    Frame frame;
+    Frame band;
+    {
+        io::RGBEReader reader(FILENAME);
+        ASSERT_EQ(width, int(reader.width()));
+        ASSERT_EQ(height, int(reader.height()));
+        reader.read(frame, Params());
+        reader.readRows(band, height / 3, height / 2, Params());
+    }
+    std::remove(FILENAME);
+
+    ASSERT_EQ(size_t(width), frame.getWidth());
+    ASSERT_EQ(size_t(height), frame.getHeight());
+    compare(pixels, 0, frame);
+    ASSERT_EQ(size_t(height / 2), band.getHeight());
+    compare(pixels, height / 3, band);
+}
+
+//! \brief write a frame with RGBEWriter and read it back
+void roundTrip(int width, int height) {
+    srand(width * height);
+    Frame reference(width, height);
+    Channel *X, *Y, *Z;
+    reference.createXYZChannels(X, Y, Z);
+    for (size_t i = 0; i < reference.size(); ++i) {
+        if (i % width != 0 && rand() % 3 == 0) {
+            (*X)(i) = (*X)(i - 1);
+            (*Y)(i) = (*Y)(i - 1);
+            (*Z)(i) = (*Z)(i - 1);
+            continue;
+        }
+        const float scale = std::pow(2.f, float(rand() % 40 - 20));
+        (*X)(i) = scale * (rand() % 1000);
+        (*Y)(i) = scale * (rand() % 1000);
+        (*Z)(i) = scale * (rand() % 1000);
+    }
+    ASSERT_TRUE(io::RGBEWriter(FILENAME).write(reference, Params()));
+
+    Frame frame;
+    {
+        io::RGBEReader reader(FILENAME);
+        reader.read(frame, Params());
+    }
+    std::remove(FILENAME);
+
+    ASSERT_EQ(size_t(width), frame.getWidth());
+    ASSERT_EQ(size_t(height), frame.getHeight());
+    const Channel *rX, *rY, *rZ;
+    frame.getXYZChannels(rX, rY, rZ);
+    ASSERT_TRUE(rX && rY && rZ);
+    for (size_t i = 0; i < frame.size(); ++i) {
+        // the reader leaves the values divided by WHITE_EFFICACY; the
+        // mantissas keep 8 bits of the largest channel
+        const float largest = std::max((*X)(i), std::max((*Y)(i), (*Z)(i)));
+        const float tolerance = largest / 128.f;
+        ASSERT_NEAR((*X)(i), (*rX)(i) * WHITE_EFFICACY, tolerance) << i;
+        ASSERT_NEAR((*Y)(i), (*rY)(i) * WHITE_EFFICACY, tolerance) << i;
+        ASSERT_NEAR((*Z)(i), (*rZ)(i) * WHITE_EFFICACY, tolerance) << i;
+    }
+}
+}
+
+TEST(TestRGBEReader, Rle) { readBack(37, 11, std::vector<Encoding>(1, RLE)); }
+
+TEST(TestRGBEReader, Flat) {
+    readBack(37, 11, std::vector<Encoding>(1, FLAT));
+}
+
+TEST(TestRGBEReader, OldRle) {
+    readBack(37, 11, std::vector<Encoding>(1, OLD_RLE));
+}
+
+TEST(TestRGBEReader, MixedScanlines) {
+    std::vector<Encoding> encodings;
+    encodings.push_back(RLE);
+    encodings.push_back(FLAT);
+    encodings.push_back(OLD_RLE);
+    readBack(200, 9, encodings);
+}
+
+TEST(TestRGBEReader, NarrowFlat) {
+    // below 8 pixels the scanlines are never run length encoded, even when
+    // the first pixel looks like the header of an encoded one
+    const int width = 5;
+    const int height = 4;
+    std::vector<Trgbe_pixel> pixels = createPixels(width, height);
+    const Trgbe_pixel header = {2, 2, 0, width};
+    for (int y = 0; y < height; ++y) {
+        pixels[y * width] = header;
+    }
+    writeFile(pixels, width, height, std::vector<Encoding>(1, FLAT));
+
+    Frame frame;
+    {
+        io::RGBEReader reader(FILENAME);
+        reader.read(frame, Params());
+    }
+    std::remove(FILENAME);
+
+    ASSERT_EQ(size_t(width), frame.getWidth());
+    ASSERT_EQ(size_t(height), frame.getHeight());
+    compare(pixels, 0, frame);
+}
+
+TEST(TestRGBEReader, WideRle) {
+    // run length encoded above 0x7fff pixels, as the earlier versions of
+    // RGBEWriter did
+    readBack(32768, 3, std::vector<Encoding>(1, RLE));
+}
+
+TEST(TestRGBEReader, RoundTrip) {
+    // flat scanlines below 8 and above 0x7fff pixels
+    const int widths[] = {5, 7, 8, 32768};
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        SCOPED_TRACE(widths[w]);
+        roundTrip(widths[w], 3);
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * This file is a part of Luminance HDR package
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+#include "Libpfs/array2d.h"
+#include "Libpfs/utils/solvercache.h"
+
+using pfs::Array2Df;
+using pfs::utils::SolverCache;
+
+namespace {
+Array2Df createArray(size_t cols, size_t rows) {
+    Array2Df array(cols, rows);
+    for (size_t i = 0; i < array.size(); ++i) {
+        array(i) = 0.5f * i;
+    }
+    return array;
+}
+
+SolverCache::ArraysPtr createArrays() {
+    return std::make_shared<SolverCache::Arrays>(1, Array2Df(4, 3));
+}
+}
+
+class TestSolverCache : public ::testing::Test {
+   protected:
+    void SetUp() {
+        SolverCache::setEnabled(false);
+        SolverCache::clear();
+    }
+    void TearDown() {
+        SolverCache::setEnabled(false);
+        SolverCache::clear();
+    }
+};
+
+TEST_F(TestSolverCache, Fingerprint) {
+    const Array2Df array = createArray(40, 30);
+    EXPECT_EQ(SolverCache::fingerprint(array),
+              SolverCache::fingerprint(createArray(40, 30)));
+
+    Array2Df changed(array);
+    changed(17, 11) = -1.f;
+    EXPECT_NE(SolverCache::fingerprint(array),
+              SolverCache::fingerprint(changed));
+
+    // same values, other shape
+    Array2Df transposed(30, 40);
+    for (size_t i = 0; i < array.size(); ++i) {
+        transposed(i) = array(i);
+    }
+    EXPECT_NE(SolverCache::fingerprint(array),
+              SolverCache::fingerprint(transposed));
+}
+
+TEST_F(TestSolverCache, KeyMatch) {
+    SolverCache::setEnabled(true);
+    const uint64_t key = SolverCache::fingerprint(createArray(40, 30));
+    const SolverCache::ArraysPtr arrays = createArrays();
+    SolverCache::store("mantiuk06", key, arrays);
+
+    EXPECT_EQ(arrays.get(), SolverCache::lookup("mantiuk06", key).get());
+    // other image, other operator
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", key + 1));
+    EXPECT_FALSE(SolverCache::lookup("fattal02", key));
+
+    // replaced by the next store
+    const SolverCache::ArraysPtr next = createArrays();
+    SolverCache::store("mantiuk06", key, next);
+    EXPECT_EQ(next.get(), SolverCache::lookup("mantiuk06", key).get());
+
+    SolverCache::clear();
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", key));
+}
+
+TEST_F(TestSolverCache, LeastRecentlyUsedIsDropped) {
+    SolverCache::setEnabled(true);
+    for (uint64_t key = 0; key < SolverCache::MAX_ENTRIES; ++key) {
+        SolverCache::store("mantiuk06", key, createArrays());
+    }
+    // the first entry becomes the most recently used
+    ASSERT_TRUE(SolverCache::lookup("mantiuk06", 0));
+    SolverCache::store("mantiuk06", SolverCache::MAX_ENTRIES,
+                       createArrays());
+
+    EXPECT_TRUE(SolverCache::lookup("mantiuk06", 0));
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", 1));
+    for (uint64_t key = 2; key <= SolverCache::MAX_ENTRIES; ++key) {
+        EXPECT_TRUE(SolverCache::lookup("mantiuk06", key)) << key;
+    }
+}
+
+TEST_F(TestSolverCache, DisabledByDefault) {
+    EXPECT_FALSE(SolverCache::isEnabled());
+    SolverCache::store("mantiuk06", 1, createArrays());
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", 1));
+
+    // the store above was dropped
+    SolverCache::setEnabled(true);
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", 1));
+}
+
+TEST_F(TestSolverCache, Disabled) {
+    SolverCache::setEnabled(true);
+    const SolverCache::ArraysPtr arrays = createArrays();
+    SolverCache::store("mantiuk06", 1, arrays);
+
+    SolverCache::setEnabled(false);
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", 1));
+    SolverCache::store("mantiuk06", 2, createArrays());
+
+    // the entries are kept for the threads that enable the store
+    SolverCache::setEnabled(true);
+    EXPECT_EQ(arrays.get(), SolverCache::lookup("mantiuk06", 1).get());
+    EXPECT_FALSE(SolverCache::lookup("mantiuk06", 2));
+}
+
+TEST_F(TestSolverCache, EnabledPerThread) {
+    {
+        SolverCache::ScopedEnable enable;
+        EXPECT_TRUE(SolverCache::isEnabled());
+        SolverCache::store("mantiuk06", 1, createArrays());
+
+        // as a batch job running next to the interactive tone mapping
+        bool otherEnabled = true;
+        bool otherFound = true;
+        std::thread other([&]() {
+            otherEnabled = SolverCache::isEnabled();
+            otherFound =
+                static_cast<bool>(SolverCache::lookup("mantiuk06", 1));
+            SolverCache::store("mantiuk06", 2, createArrays());
+        });
+        other.join();
+        EXPECT_FALSE(otherEnabled);
+        EXPECT_FALSE(otherFound);
+        EXPECT_TRUE(SolverCache::lookup("mantiuk06", 1));
+        EXPECT_FALSE(SolverCache::lookup("mantiuk06", 2));
+
+        {
+            SolverCache::ScopedEnable disable(false);
+            EXPECT_FALSE(SolverCache::isEnabled());
+        }
+        EXPECT_TRUE(SolverCache::isEnabled());
+    }
+    EXPECT_FALSE(SolverCache::isEnabled());
+}
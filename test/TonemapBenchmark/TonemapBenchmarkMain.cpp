@@ -0,0 +1,365 @@
+/*
+ * This file is a part of Luminance HDR package.
+ * ----------------------------------------------------------------------
+ * Copyright (C) 2026 Luminance HDR developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * ----------------------------------------------------------------------
+ */
+
+//! \brief Time every tone mapping operator over synthetic and real HDR
+//! inputs, at several resolutions and thread counts.
+//!
+//! Each run is written as one JSON object of the array in --output, with the
+//! wall time, the time of each stage and the peak resident set size, so that
+//! results of two releases can be compared by a script.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+
+#include <Common/global.h>
+#include <Core/TonemappingOptions.h>
+#include <Libpfs/frame.h>
+#include <Libpfs/manip/copy.h>
+#include <Libpfs/manip/gamma.h>
+#include <Libpfs/manip/resize.h>
+#include <Libpfs/manip/saturation.h>
+#include <Libpfs/progress.h>
+#include <Libpfs/tm/TonemapOperator.h>
+
+#include "BenchmarkCommon.h"
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+namespace {
+
+struct OperatorName {
+    TMOperator tmo;
+    const char *name;
+};
+
+// same names as luminance-hdr-cli --tmo
+const OperatorName OPERATORS[] = {
+    {ashikhmin, "ashikhmin"},   {drago, "drago"},
+    {durand, "durand"},         {fattal, "fattal"},
+    {ferradans, "ferradans"},   {ferwerda, "ferwerda"},
+    {kimkautz, "kimkautz"},     {lischinski, "lischinski"},
+    {mai, "mai"},               {mantiuk06, "mantiuk06"},
+    {mantiuk08, "mantiuk08"},   {pattanaik, "pattanaik"},
+    {reinhard02, "reinhard02"}, {reinhard05, "reinhard05"},
+    {vanhateren, "vanhateren"}};
+
+struct Input {
+    string name;
+    // NULL for the synthetic scene
+    std::shared_ptr<pfs::Frame> frame;
+};
+
+struct Run {
+    string tmo;
+    string input;
+    size_t width;
+    size_t height;
+    int threads;
+    int repeat;
+    double copyMs;
+    double tonemapMs;
+    double postprocessMs;
+    double wallMs;
+    long peakRssKb;
+    string error;
+};
+
+//! \brief width and height with about \a megapixels pixels and the aspect
+//! ratio of \a width x \a height
+void scaledSize(double megapixels, size_t width, size_t height,
+                size_t &newWidth, size_t &newHeight) {
+    const double aspect = double(width) / height;
+    newHeight =
+        std::max<size_t>(1, size_t(std::sqrt(megapixels * 1e6 / aspect)));
+    newWidth = std::max<size_t>(1, size_t(newHeight * aspect));
+}
+
+void resetPeakRss() {
+#ifdef __linux__
+    // "5" resets VmHWM to the current RSS (Linux >= 4.0)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) clearRefs << "5";
+#endif
+}
+
+long peakRssKb() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atol(line.c_str() + 6);
+        }
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;  // bytes
+#else
+        return usage.ru_maxrss;  // KB
+#endif
+    }
+#endif
+    return 0;
+}
+
+string escape(const string &str) {
+    string out;
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (str[i] == '"' || str[i] == '\\') out += '\\';
+        out += str[i];
+    }
+    return out;
+}
+
+void writeRun(std::ostream &out, const Run &run) {
+    out << "  {\"tmo\": \"" << run.tmo << "\", \"input\": \""
+        << escape(run.input) << "\", \"width\": " << run.width
+        << ", \"height\": " << run.height << ", \"megapixels\": "
+        << double(run.width * run.height) / 1e6
+        << ", \"threads\": " << run.threads << ", \"repeat\": " << run.repeat
+        << ", \"wall_ms\": " << run.wallMs << ", \"stages\": {\"copy_ms\": "
+        << run.copyMs << ", \"tonemap_ms\": " << run.tonemapMs
+        << ", \"postprocess_ms\": " << run.postprocessMs
+        << "}, \"peak_rss_kb\": " << run.peakRssKb;
+    if (!run.error.empty()) {
+        out << ", \"error\": \"" << escape(run.error) << "\"";
+    }
+    out << "}";
+}
+
+Run benchmark(const OperatorName &op, const pfs::Frame &source,
+              const string &inputName, int threads, int repeat) {
+    Run run;
+    run.tmo = op.name;
+    run.input = inputName;
+    run.width = source.getWidth();
+    run.height = source.getHeight();
+    run.threads = threads;
+    run.repeat = repeat;
+    run.copyMs = run.tonemapMs = run.postprocessMs = run.wallMs = 0.;
+
+    TonemappingOptions opts;
+    opts.tmoperator = op.tmo;
+    opts.origxsize = opts.xsize = source.getWidth();
+
+    resetPeakRss();
+
+    run.wallMs = bench::timeMs([&] {
+        try {
+            std::unique_ptr<pfs::Frame> working;
+            run.copyMs = bench::timeMs([&] {
+                working.reset(pfs::copy(&source));
+                if (opts.pregamma != 1.0f) {
+                    pfs::applyGamma(working.get(), opts.pregamma);
+                }
+            });
+
+            run.tonemapMs = bench::timeMs([&] {
+                std::unique_ptr<TonemapOperator> tmEngine(
+                    TonemapOperator::getTonemapOperator(op.tmo));
+                pfs::Progress progress;
+                tmEngine->tonemapFrame(*working, &opts, progress);
+            });
+
+            run.postprocessMs = bench::timeMs([&] {
+                if (opts.postsaturation != 1.0f) {
+                    pfs::applySaturation(working.get(), opts.postsaturation);
+                }
+                if (opts.postgamma != 1.0f) {
+                    pfs::applyGamma(working.get(), opts.postgamma);
+                }
+            });
+        } catch (std::exception &e) {
+            run.error = e.what();
+        } catch (...) {
+            run.error = "unknown exception";
+        }
+    });
+    run.peakRssKb = peakRssKb();
+
+    return run;
+}
+
+template <typename T>
+vector<T> parseList(const string &str) {
+    vector<string> items;
+    boost::split(items, str, boost::is_any_of(","));
+
+    vector<T> result;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].empty()) continue;
+        std::istringstream item(items[i]);
+        T value;
+        if (!(item >> value)) {
+            throw std::invalid_argument("cannot parse \"" + items[i] + "\"");
+        }
+        result.push_back(value);
+    }
+    return result;
+}
+}
+
+int main(int argc, char **argv) {
+    string operators;
+    string sizes;
+    string threads;
+    string output;
+    int repeat;
+    bool noSynthetic = false;
+    vector<string> inputFiles;
+
+    po::options_description desc("Allowed options: ");
+    bench::addCommonOptions(desc, inputFiles, "size");
+    desc.add_options()(
+        "tmo,t", po::value<string>(&operators)->default_value("all"),
+        "comma separated operators (names of luminance-hdr-cli --tmo)")(
+        "sizes,s", po::value<string>(&sizes)->default_value("1,4,16"),
+        "comma separated sizes in megapixels, up to 100")(
+        "threads,j", po::value<string>(&threads)->default_value("1"),
+        "comma separated thread counts")(
+        "repeat,r", po::value<int>(&repeat)->default_value(1),
+        "runs of each configuration")(
+        "no-synthetic", po::bool_switch(&noSynthetic),
+        "skip the synthetic scene")(
+        "output,o",
+        po::value<string>(&output)->default_value("tmo_benchmark.json"),
+        "JSON output file");
+
+    int exitCode;
+    if (!bench::parseOptions(argc, argv, desc, exitCode)) {
+        return exitCode;
+    }
+
+    vector<OperatorName> selected;
+    vector<double> megapixels;
+    vector<int> threadCounts;
+    try {
+        const vector<string> names = parseList<string>(operators);
+        for (size_t i = 0; i < sizeof(OPERATORS) / sizeof(OPERATORS[0]);
+             ++i) {
+            if (operators == "all" ||
+                std::find(names.begin(), names.end(), OPERATORS[i].name) !=
+                    names.end()) {
+                selected.push_back(OPERATORS[i]);
+            }
+        }
+        megapixels = parseList<double>(sizes);
+        threadCounts = parseList<int>(threads);
+        if (selected.empty() || megapixels.empty() || threadCounts.empty() ||
+            repeat < 1) {
+            throw std::invalid_argument("nothing to run");
+        }
+    } catch (std::exception &e) {
+        cerr << e.what() << endl << desc << endl;
+        return -1;
+    }
+
+    vector<Input> inputs;
+    if (!noSynthetic) {
+        inputs.push_back(Input());
+        inputs.back().name = "synthetic";
+    }
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+        Input input;
+        input.name = inputFiles[i];
+        input.frame.reset(new pfs::Frame(0, 0));
+        if (!bench::readFrame(inputFiles[i], *input.frame)) {
+            return -1;
+        }
+        inputs.push_back(input);
+    }
+
+    std::ofstream out(output.c_str());
+    if (!out) {
+        cerr << "Cannot write " << output << endl;
+        return -1;
+    }
+    out << "[\n";
+
+    bool first = true;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        for (size_t s = 0; s < megapixels.size(); ++s) {
+            size_t width, height;
+            std::unique_ptr<pfs::Frame> source;
+            if (inputs[i].frame) {
+                scaledSize(megapixels[s], inputs[i].frame->getWidth(),
+                           inputs[i].frame->getHeight(), width, height);
+                source.reset(
+                    pfs::resize(inputs[i].frame.get(), width, BilinearInterp));
+            } else {
+                scaledSize(megapixels[s], 3, 2, width, height);
+                source.reset(bench::createSynthetic(width, height));
+            }
+
+            for (size_t t = 0; t < threadCounts.size(); ++t) {
+#ifdef _OPENMP
+                omp_set_num_threads(threadCounts[t]);
+#endif
+                for (size_t o = 0; o < selected.size(); ++o) {
+                    for (int r = 0; r < repeat; ++r) {
+                        const Run run =
+                            benchmark(selected[o], *source, inputs[i].name,
+                                      threadCounts[t], r);
+
+                        if (!first) out << ",\n";
+                        writeRun(out, run);
+                        out.flush();
+                        first = false;
+
+                        cerr << run.tmo << " " << run.input << " "
+                             << run.width << "x" << run.height << " T"
+                             << run.threads << ": " << run.wallMs << " msec"
+                             << (run.error.empty() ? "" : " (" + run.error +
+                                                              ")")
+                             << endl;
+                    }
+                }
+            }
+        }
+    }
+    out << "\n]\n";
+
+    return 0;
+}